@@ -6,12 +6,10 @@
  * @{
  */
 
-/** Nmero mximo de dispositivos para esta demonstrao (mantido por considerar as limitaes do dispositivo)
+/** Nmero de dispositivos desta demonstrao. O provisionador guarda os ns provisionados em flash e mantm s alguns
+ *  na RAM (device_db.h); o limite  o pool de endereos (PROVISIONER_ADDRESS_POOL_SIZE)
  */
 #define SMART_CITY_DEVICE_COUNT (30)
-#if SMART_CITY_DEVICE_COUNT > 30
-#error Maximum 30 devices currently supported by demonstration.
-#endif
 
 /** Number of group address being used in this example */
 #define GROUP_ADDR_COUNT (4)
@@ -23,6 +21,38 @@
 #define SMART_CITY_NODE_UUID_PREFIX      {'C', 'I', 'T', 'Y'}
 #define SMART_CITY_NODE_UUID_PREFIX_SIZE (4)
 
+/** Prefixo completo do UUID: o prefixo acima seguido dos IDs de produto e verso do dispositivo (little endian), os
+    mesmos do cabealho da pgina 0 da composio. mesh_app_uuid_gen() grava o DEVICEID do FICR nos bytes 8 a 15, e
+    por isso o prefixo no passa de 8 bytes: a empresa fica implcita e  sempre ACCESS_COMPANY_ID_NORDIC.
+    O provisionador reconhece pelo UUID os dispositivos de um tipo cuja composio j conhece, e no precisa l-la de novo */
+#define SMART_CITY_NODE_UUID_TYPE_SIZE   (4)
+#define SMART_CITY_NODE_UUID_TYPED_PREFIX(pid, vid)                                         \
+    {'C', 'I', 'T', 'Y',                                                                    \
+     (uint8_t) (pid), (uint8_t) ((pid) >> 8), (uint8_t) (vid), (uint8_t) ((vid) >> 8)}
+#define SMART_CITY_NODE_UUID_TYPED_PREFIX_SIZE (SMART_CITY_NODE_UUID_PREFIX_SIZE + SMART_CITY_NODE_UUID_TYPE_SIZE)
+
+/** Origem das coordenadas do formato compacto das mensagens (algum lugar no DF, Brasil).
+    Deve ser a mesma em todos os dispositivos da rede */
+#define SMART_CITY_ORIGIN_LATITUDE       (-15.832167f)
+#define SMART_CITY_ORIGIN_LONGITUDE      (-47.835299f)
+
+/** Escalonador Trickle das mensagens SHARE: intervalo mnimo (ms), nmero de vezes que o intervalo
+    pode dobrar (1 s a 64 s) e quantas mensagens SHARE consistentes suprimem o prximo compartilhamento */
+#define SMART_CITY_SHARE_TRICKLE_IMIN_MS       (1000)
+#define SMART_CITY_SHARE_TRICKLE_DOUBLINGS     (6)
+#define SMART_CITY_SHARE_TRICKLE_K             (2)
+
+/** GET sob demanda: intervalo entre as verificaes de data_store (segundos), mnimo e mximo, e a tolerncia
+    (segundos) alm do instante anunciado para a prxima mudana de estado antes de um registro ser considerado
+    desatualizado. SMART_CITY_GET_POLLING_S  o intervalo do antigo GET peridico, referncia da estatstica */
+#define SMART_CITY_GET_INTERVAL_MIN_S          (15)
+#define SMART_CITY_GET_INTERVAL_MAX_S          (240)
+#define SMART_CITY_GET_TOLERANCE_S             (5)
+#define SMART_CITY_GET_POLLING_S               (60)
+
+/** Janela (ms) do atraso aleatrio das respostas ao GET, para que os dispositivos no respondam todos juntos */
+#define SMART_CITY_GET_REPLY_WINDOW_MS         (2000)
+
 
 
 /** @} end of Common definitions for the Light switch example */
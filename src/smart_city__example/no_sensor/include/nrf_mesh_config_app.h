@@ -57,10 +57,13 @@
 /** Device company identifier. */
 #define DEVICE_COMPANY_ID (ACCESS_COMPANY_ID_NORDIC)
 
-/** Device product identifier*/
-#define DEVICE_PRODUCT_ID (0x0000)
+/** Device product identifier. Each firmware of the network has its own: 0x0001 full, 0x0002 no_sensor,
+ * 0x0003 provisioner. The provisioner caches the composition data of each product and version ID
+ * (see SMART_CITY_NODE_UUID_TYPED_PREFIX). */
+#define DEVICE_PRODUCT_ID (0x0002)
 
-/** Device version identifier */
+/** Device version identifier. Must be incremented whenever the composition data changes (elements, models or
+ * features), so that the provisioner does not configure the device with the cached composition of the old version. */
 #define DEVICE_VERSION_ID (0x0000)
 
 /** Supported features of the device. @see config_feature_bit_t */
@@ -142,6 +145,27 @@
 #define DSM_FLASH_PAGE_COUNT                            (1)
 /** @} end of DSM_CONFIG */
 
+/**
+ * @defgroup SMART_CITY_CONFIG Smart City application configuration
+ * @{
+ */
+/** Number of traffic lights kept in the application data store. Must be a power of two. */
+#define SMART_CITY_SEMAFORO_STORE_SIZE                  (64)
+/** Number of recently received SHARE records remembered to discard duplicates. Must be a power of two, at least 4.
+ *  Takes 4.25 bytes of RAM per record: 544 bytes for 128. */
+#define SMART_CITY_SEMAFORO_DEDUP_SIZE                  (128)
+/** Application messages go to a RAM ring as binary records, drained to RTT channel 1 from the idle loop
+ *  (see smart_city_semaforo_trace.h). Set to 0 to log them as text through __LOG. */
+#ifndef SMART_CITY_TRACE_BINARY
+#define SMART_CITY_TRACE_BINARY                         (1)
+#endif
+/** Size of the binary trace ring, in 32-bit words. Must be a power of two. */
+#define SMART_CITY_TRACE_RING_WORDS                     (512)
+/** Largest SHARE_BATCH, in transport segments. A batch goes to a group address without acknowledgements, so losing any
+ *  segment loses the whole batch; each record adds one segment to the two of the header. At least 3. */
+#define SMART_CITY_SHARE_BATCH_MAX_SEGMENTS             (4)
+/** @} end of SMART_CITY_CONFIG */
+
 
 /** @} */
 
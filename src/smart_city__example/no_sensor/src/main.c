@@ -7,6 +7,9 @@
 #include "access_config.h"
 #include "smart_city_semaforo_full.h"
 #include "smart_city_semaforo_common.h"
+#include "smart_city_semaforo_store.h"
+#include "smart_city_semaforo_dedup.h"
+#include "smart_city_semaforo_trace.h"
 #include "rtt_input.h"
 #include "device_state_manager.h"
 #include "simple_smart_city_example_common.h"
@@ -15,15 +18,19 @@
 #include "mesh_softdevice_init.h"
 #include "mesh_provisionee.h"
 #include "nrf_mesh_config_examples.h"
+#include "nrf_mesh_config_app.h"
 #include "nrf_mesh_configure.h"
 #include "app_timer.h"
 
-#define MAX_DATA_STORE (8)
 #define STATE_MACHINE_DELAY APP_TIMER_TICKS(1000)   // Intervalo de um segundo
-#define GET_DELAY           APP_TIMER_TICKS(60000)  // Intervalo de sessenta segundos
+#define SHARE_BATCH_MAX_RECORDS SEMAFORO_BATCH_RECORDS_IN_SEGMENTS(SMART_CITY_SHARE_BATCH_MAX_SEGMENTS)   // Registros por lote do SHARE
+
+#if SMART_CITY_SHARE_BATCH_MAX_SEGMENTS < 3 || SMART_CITY_SHARE_BATCH_MAX_SEGMENTS > 32
+#error SMART_CITY_SHARE_BATCH_MAX_SEGMENTS must hold at least one record and fit a segmented message
+#endif
 
 APP_TIMER_DEF(m_timer_1s_id);
-APP_TIMER_DEF(m_timer_60s_id);
+APP_TIMER_DEF(m_timer_get_id);
 
 static smart_city_semaforo_full_t m_semaforo_full;  // Estrutura de dados que define o modelo (ver smart_city_semaforo_full.h)
 static bool m_device_provisioned;
@@ -32,36 +39,56 @@ static bool m_device_provisioned;
 static timestamp64_t timestamp;
 static geolocalizador_t geolocalizador;
 
-// Base de dados onde as informaes coletadas sero armazenadas para posterior compartilhamento.
-static smart_city_semaforo_default_msg_t data_store[MAX_DATA_STORE];
-static bool max_data=false;
-static uint8_t ler=-1,escrever=-1;
+// Relgio local em segundos
+static uint64_t device_clock_now(void)
+{
+    return (((uint64_t) timestamp[0]) << 32) | timestamp[1];
+}
 
-static void escrever_avanca(void)
+// Base de dados onde as informaes coletadas sero armazenadas para posterior compartilhamento.
+// Guarda somente o registro mais recente de cada semforo (ver smart_city_semaforo_store.h)
+SMART_CITY_SEMAFORO_STORE_DEF(m_data_store, SMART_CITY_SEMAFORO_STORE_SIZE);
+
+// Mensagens SHARE recebidas recentemente. Cpias da mesma informao chegam por vizinhos diferentes
+SMART_CITY_SEMAFORO_DEDUP_DEF(m_share_dedup, SMART_CITY_SEMAFORO_DEDUP_SIZE);
+
+// GET sob demanda. O estado de cada semforo chega pelos SETs publicados nas suas mudanas de estado; o GET s 
+// enviado quando algum registro de data_store passou do instante anunciado para a prxima mudana sem ser atualizado
+// (SET perdido). Enquanto SETs estiverem sendo ouvidos, o intervalo entre as verificaes dobra, at
+// SMART_CITY_GET_INTERVAL_MAX_S; sem SETs, volta ao mnimo
+static uint32_t m_get_intervalo;    // Segundos at a prxima verificao
+static bool m_get_set_ouvido;       // SET recebido desde a ltima verificao
+static bool m_get_inicial;          // Primeira verificao aps o provisionamento: o GET apresenta a vizinhana
+static uint32_t m_get_enviados;     // GETs enviados desde o provisionamento
+static uint32_t m_get_decorrido;    // Segundos cobertos pelas verificaes, para a comparao com o GET peridico
+
+// Armazena a informao coletada. O SET ouvido diretamente do semforo  sempre aceito; a informao de outros
+// dispositivos  descartada se for repetida ou mais antiga que a armazenada. Retorna true se a informao era nova
+static bool data_store_put(const smart_city_semaforo_default_msg_t * msg, bool direto)
 {
-    escrever++;
-    if(escrever>=MAX_DATA_STORE)
+    smart_city_semaforo_store_result_t result = direto ? smart_city_semaforo_store_set(&m_data_store, msg) :
+                                                         smart_city_semaforo_store_put(&m_data_store, msg);
+    if(result == SMART_CITY_SEMAFORO_STORE_STALE)
+    {
+        SMART_CITY_TRACE(STORE_STALE);
+        return false;
+    }
+    else if(result == SMART_CITY_SEMAFORO_STORE_REPLACED)
     {
-        escrever=0;
-        max_data=true;
+        SMART_CITY_TRACE(STORE_REPLACED, msg->sensor_ID);
     }
+    return true;
 }
 
-static bool ler_avanca(void)
+// Armazena a informao recebida de outros dispositivos. Cpias j vistas so descartadas antes de chegar a data_store
+static bool data_store_share(const smart_city_semaforo_default_msg_t * msg)
 {
-    if(escrever < MAX_DATA_STORE)
-    {
-        ler++;
-        if(ler>=(max_data ? MAX_DATA_STORE : escrever))
-        {
-            ler=0;
-        }
-        return true;
-    }else
+    if(!smart_city_semaforo_dedup_check(&m_share_dedup, msg))
     {
-        ler=-1;
+        SMART_CITY_TRACE(SHARE_DUPLICATE, msg->sensor_ID);
         return false;
     }
+    return data_store_put(msg,false);
 }
 
 /****************************************************************************
@@ -73,27 +100,45 @@ static bool ler_avanca(void)
     Esta funo manipula a informao recebida diretamente do semforo (dispositivo sensor) */
 static void smart_city_semaforo_set_cb(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
 {
-    escrever_avanca();
-    data_store[escrever]=*msg;
-    data_store[escrever].basic.geolocalizador= geolocalizador;
-    data_store[escrever].basic.timestamp64[0] = timestamp[0];
-    data_store[escrever].basic.timestamp64[1] = timestamp[1];// timestamp fictcio
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Got a SIMPLE_SMART_CITY_SET message from t_light 0x%04x with state 0x%01x \n", msg->sensor_ID, semaforo_getstate(msg->data));
+    smart_city_semaforo_default_msg_t registro=*msg;
+    registro.basic.geolocalizador= geolocalizador;
+    registro.basic.timestamp64[0] = timestamp[0];
+    registro.basic.timestamp64[1] = timestamp[1];// timestamp fictcio
+    // Informao nova na vizinhana: o compartilhamento volta ao intervalo mnimo
+    if(data_store_put(&registro,true))
+    {
+        smart_city_semaforo_share_trickle_reset(&m_semaforo_full);
+    }
+    SMART_CITY_TRACE(SET_RX, msg->sensor_ID, semaforo_getstate(msg->data));
+    m_get_set_ouvido=true;
 }
 
 /** smart_city_semaforo_share_cb_t
     Esta funo manipula informao recebida de outros dispositivos */
 static void smart_city_semaforo_share_cb(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
 {
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Got a SIMPLE_SMART_CITY_SHARE message from 0x%04x saying t_light 0x%04x was state 0x%01x \n", src, msg->sensor_ID, semaforo_getstate(msg->data));
-    // Checagem bsica de mensagem repetida. Note que a checagem  feita com a mensagem anterior somente.
-    if(data_store[escrever].basic.timestamp64[1] - msg->basic.timestamp64[1])
+    SMART_CITY_TRACE(SHARE_RX, src, msg->sensor_ID, semaforo_getstate(msg->data));
+    // Mensagem sem novidades: a vizinhana est consistente
+    if(!data_store_share(msg))
     {
-        escrever_avanca();
-        data_store[escrever]=*msg;
-    }else
+        smart_city_semaforo_share_trickle_consistent(&m_semaforo_full);
+    }
+}
+
+/** smart_city_semaforo_share_batch_cb_t
+    Esta funo manipula um lote de informaes recebido de outros dispositivos */
+static void smart_city_semaforo_share_batch_cb(const smart_city_semaforo_full_t * p_self, const smart_city_semaforo_default_msg_t * p_msgs, uint8_t count, uint16_t src)
+{
+    SMART_CITY_TRACE(SHARE_BATCH_RX, src, count);
+    bool novidade=false;
+    for(uint8_t i=0; i<count; i++)
     {
-        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Message not stored \n");
+        novidade |= data_store_share(&p_msgs[i]);
+    }
+    // Lote sem novidades: a vizinhana est consistente
+    if(!novidade)
+    {
+        smart_city_semaforo_share_trickle_consistent(&m_semaforo_full);
     }
 }
 
@@ -102,10 +147,17 @@ static void smart_city_semaforo_share_cb(const smart_city_semaforo_full_t * p_se
     O dispositivo sem sensor no possui estado atual para compartilhar */
 static smart_city_semaforo_default_msg_t * smart_city_semaforo_get_cb(const smart_city_semaforo_full_t * p_self)
 {
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Got a SIMPLE_SMART_CITY_GET message. Nothing to say\n");
+    SMART_CITY_TRACE(GET_RX);
     return NULL;
 }
 
+/** smart_city_semaforo_time_cb_t
+    Esta funo retorna o relgio local, usado como poca das mensagens compactas */
+static uint64_t smart_city_semaforo_time_cb(const smart_city_semaforo_full_t * p_self)
+{
+    return device_clock_now();
+}
+
 // Verifica se o endereo de grupo multicast est configurado
 static bool semaforo_full_publication_configured(void)
 {
@@ -140,43 +192,141 @@ static void device_machine_state(void)
    // Ainda no implementado
 }
 
-// Funo para compartilhar informao, deve ser invocada a cada segundo
-static void semaforo_share(void)
+// Publica o lote e reinicia a sua montagem
+static void semaforo_share_batch_publish(smart_city_semaforo_batch_msg_t * p_batch)
+{
+   SMART_CITY_TRACE(SHARE_BATCH_TX, p_batch->header.count);
+   (void)smart_city_semaforo_share_batch(&m_semaforo_full,p_batch);
+   smart_city_semaforo_batch_init(p_batch);
+}
+
+/** smart_city_semaforo_share_fire_cb_t
+    Funo para compartilhar informao, invocada pelo escalonador Trickle do modelo
+    Cada compartilhamento publica um lote de no mximo SMART_CITY_SHARE_BATCH_MAX_SEGMENTS segmentos, com os registros
+    de data_store seguintes aos do lote anterior; os compartilhamentos seguintes percorrem o resto da tabela */
+static void semaforo_share(smart_city_semaforo_full_t * p_self)
 {
-   ler_avanca();
-   if(ler<MAX_DATA_STORE)
-   {   
-      __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Sending a SIMPLE_SMART_CITY_SHARE message with tlight 0x%04x state eguals to 0x%02x \n", data_store[ler].sensor_ID, semaforo_getstate(data_store[ler].data));
-      (void)smart_city_semaforo_publish(&m_semaforo_full,&data_store[ler],SIMPLE_SMART_CITY_SHARE);
+   static smart_city_semaforo_batch_msg_t lote;
+   static uint16_t cursor=SMART_CITY_SEMAFORO_STORE_ITERATOR_START;
+   uint16_t total=smart_city_semaforo_store_count(&m_data_store);
+   if(total)
+   {
+      const smart_city_semaforo_default_msg_t * p_registro;
+      uint16_t percorridos=0;
+      smart_city_semaforo_batch_init(&lote);
+      while(lote.header.count<SHARE_BATCH_MAX_RECORDS && percorridos<total)
+      {
+         uint16_t anterior=cursor;
+         if((p_registro=smart_city_semaforo_store_next(&m_data_store,&cursor)) == NULL)
+         {
+            // Fim da tabela: o lote continua do incio
+            cursor=SMART_CITY_SEMAFORO_STORE_ITERATOR_START;
+            continue;
+         }
+         // Registro fora do alcance da referncia do lote: fica para o prximo compartilhamento
+         if(!smart_city_semaforo_batch_add(&lote,p_registro))
+         {
+            cursor=anterior;
+            break;
+         }
+         percorridos++;
+      }
+      semaforo_share_batch_publish(&lote);
    }else
    {
-      __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "There is still no data in data_store \n");
+      SMART_CITY_TRACE(STORE_EMPTY);
    }
 }
 
 // Funo para solicitar o estado atual do servio
 static void semaforo_get(void)
 {
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Requesting a SIMPLE_SMART_CITY_GET message \n");
+    SMART_CITY_TRACE(GET_TX);
     (void)smart_city_semaforo_get(&m_semaforo_full);
 }
 
-// Callback para o temporizador de 1 s
-static void timer_handler_1s(void * p_context)
+// Arma o temporizador da prxima verificao do GET sob demanda
+static void semaforo_get_timer_arm(void)
 {
-    device_machine_state();
-    semaforo_share();
+    uint32_t err_code=app_timer_start(m_timer_get_id,APP_TIMER_TICKS(m_get_intervalo*1000),NULL);
+    APP_ERROR_CHECK(err_code);
 }
 
-// Callback para temporizador de 60 s
-static void timer_handler_60s(void * p_context)
+// Inicia o GET sob demanda no intervalo mnimo. A primeira verificao sempre envia o GET
+static void semaforo_get_start(void)
 {
-    if(semaforo_full_publication_configured())
+    m_get_intervalo=SMART_CITY_GET_INTERVAL_MIN_S;
+    m_get_set_ouvido=false;
+    m_get_inicial=true;
+    m_get_enviados=0;
+    m_get_decorrido=0;
+    semaforo_get_timer_arm();
+}
+
+// Verificao do GET sob demanda: envia o GET se houver registros desatualizados e ajusta o intervalo
+static void semaforo_get_check(void)
+{
+    m_get_decorrido+=m_get_intervalo;
+    uint16_t desatualizados=smart_city_semaforo_store_stale_count(&m_data_store,device_clock_now(),SMART_CITY_GET_TOLERANCE_S);
+    if(semaforo_full_publication_configured() && (m_get_inicial || desatualizados>0))
     {
         semaforo_get();
+        m_get_enviados++;
+        m_get_inicial=false;
+    }
+    // Recuo: a vizinhana est publicando as suas mudanas, o GET  menos necessrio
+    if(m_get_set_ouvido)
+    {
+        m_get_intervalo = (2*m_get_intervalo < SMART_CITY_GET_INTERVAL_MAX_S) ? 2*m_get_intervalo : SMART_CITY_GET_INTERVAL_MAX_S;
+    }else
+    {
+        m_get_intervalo=SMART_CITY_GET_INTERVAL_MIN_S;
+    }
+    m_get_set_ouvido=false;
+    // Economia em relao ao GET peridico que cada dispositivo enviava a cada SMART_CITY_GET_POLLING_S
+    uint32_t periodicos=m_get_decorrido/SMART_CITY_GET_POLLING_S;
+    SMART_CITY_TRACE(GET_STATS, desatualizados, m_get_enviados, periodicos>m_get_enviados ? periodicos-m_get_enviados : 0, m_get_intervalo);
+    semaforo_get_timer_arm();
+}
+
+// Eventos dos temporizadores
+#define EVENTO_SEGUNDO  (1UL << 0)  // Contagem do tempo
+#define EVENTO_GET      (1UL << 1)  // Verificao de data_store para o GET sob demanda
+
+// Sinalizados pelos handlers do app_timer, que interrompem o lao principal
+static volatile uint32_t m_eventos_pendentes;
+
+static void eventos_executa(uint32_t eventos)
+{
+    if(eventos & EVENTO_SEGUNDO)
+    {
+        device_machine_state();
+    }
+    if(eventos & EVENTO_GET)
+    {
+        semaforo_get_check();
     }
 }
 
+// O evento  executado no lao principal, no mesmo contexto da pilha e dos callbacks do modelo: data_store e o
+// estado do dispositivo so alterados num nico contexto
+static void evento_sinaliza(uint32_t evento)
+{
+    (void)__atomic_fetch_or(&m_eventos_pendentes, evento, __ATOMIC_RELAXED);
+}
+
+// Callback para o temporizador de 1 s
+static void timer_handler_1s(void * p_context)
+{
+    evento_sinaliza(EVENTO_SEGUNDO);
+}
+
+// Callback para o temporizador do GET sob demanda
+static void timer_handler_get(void * p_context)
+{
+    evento_sinaliza(EVENTO_GET);
+}
+
 // Cria o timer com a respectiva funo de callback
 static void timer_init(void)
 {   
@@ -186,7 +336,7 @@ static void timer_init(void)
     // Create timers
     err_code = app_timer_create(&m_timer_1s_id,APP_TIMER_MODE_REPEATED,timer_handler_1s);
     APP_ERROR_CHECK(err_code);
-    err_code = app_timer_create(&m_timer_60s_id,APP_TIMER_MODE_REPEATED,timer_handler_60s);
+    err_code = app_timer_create(&m_timer_get_id,APP_TIMER_MODE_SINGLE_SHOT,timer_handler_get);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -198,7 +348,8 @@ static void provisioning_complete_cb(void)
     geolocalizador.longitude= -47.835299; // posio fictcia do dispositivo (algum lugar no DF, Brasil)
     timestamp[0] = 0x0;
     timestamp[1] = 0x5B0EED02; // Unix timestamp fictcio de 64 bits (meados de 2018)
-    escrever=ler=-1;
+    smart_city_semaforo_store_clear(&m_data_store);
+    smart_city_semaforo_dedup_clear(&m_share_dedup);
 
     __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Successfully provisioned\n");
 
@@ -210,8 +361,8 @@ static void provisioning_complete_cb(void)
     uint32_t err_code;
     err_code = app_timer_start(m_timer_1s_id,STATE_MACHINE_DELAY,NULL);
     APP_ERROR_CHECK(err_code);
-    err_code = app_timer_start(m_timer_60s_id,GET_DELAY,NULL);
-    APP_ERROR_CHECK(err_code);
+    semaforo_get_start();
+    smart_city_semaforo_share_trickle_start(&m_semaforo_full);
 }
 
 static void node_reset(void)
@@ -238,21 +389,43 @@ static void models_init_cb(void)
     m_semaforo_full.get_cb = smart_city_semaforo_get_cb;
     m_semaforo_full.set_cb = smart_city_semaforo_set_cb;
     m_semaforo_full.share_cb = smart_city_semaforo_share_cb;
+    m_semaforo_full.share_batch_cb = smart_city_semaforo_share_batch_cb;
+    m_semaforo_full.time_cb = smart_city_semaforo_time_cb;
+    m_semaforo_full.share_fire_cb = semaforo_share;
+    // Escalonador Trickle: o intervalo entre compartilhamentos cresce enquanto a vizinhana estiver consistente
+    m_semaforo_full.share_trickle.interval_min_ms = SMART_CITY_SHARE_TRICKLE_IMIN_MS;
+    m_semaforo_full.share_trickle.interval_doublings = SMART_CITY_SHARE_TRICKLE_DOUBLINGS;
+    m_semaforo_full.share_trickle.redundancy_k = SMART_CITY_SHARE_TRICKLE_K;
+    // Formato compacto: SET e SHARE em uma nica PDU, sem segmentao
+    m_semaforo_full.format = SMART_CITY_SEMAFORO_FORMAT_COMPACT;
+    m_semaforo_full.origin.latitude = SMART_CITY_ORIGIN_LATITUDE;
+    m_semaforo_full.origin.longitude = SMART_CITY_ORIGIN_LONGITUDE;
+    // Respostas ao GET espalhadas na janela, canceladas se outro n informar o mesmo estado antes
+    m_semaforo_full.get_reply_window_ms = SMART_CITY_GET_REPLY_WINDOW_MS;
     // inicializao do modelo
     ERROR_CHECK(smart_city_semaforo_full_init(&m_semaforo_full, 0));
     ERROR_CHECK(access_model_subscription_list_alloc(m_semaforo_full.model_handle));
 }
 
+// O UUID s identifica produto e verso: a empresa  implcita (ver SMART_CITY_NODE_UUID_TYPED_PREFIX)
+#if DEVICE_COMPANY_ID != ACCESS_COMPANY_ID_NORDIC
+#error "SMART_CITY_NODE_UUID_TYPED_PREFIX requires DEVICE_COMPANY_ID == ACCESS_COMPANY_ID_NORDIC"
+#endif
+
 // Inicializa a pilha de protocolos
 static void mesh_init(void)
 {
     uint8_t dev_uuid[NRF_MESH_UUID_SIZE];
-    uint8_t node_uuid_prefix[SMART_CITY_NODE_UUID_PREFIX_SIZE] = SMART_CITY_NODE_UUID_PREFIX;
+    uint8_t node_uuid_prefix[SMART_CITY_NODE_UUID_TYPED_PREFIX_SIZE] =
+        SMART_CITY_NODE_UUID_TYPED_PREFIX(DEVICE_PRODUCT_ID, DEVICE_VERSION_ID);
 
-    ERROR_CHECK(mesh_app_uuid_gen(dev_uuid, node_uuid_prefix, SMART_CITY_NODE_UUID_PREFIX_SIZE));
+    ERROR_CHECK(mesh_app_uuid_gen(dev_uuid, node_uuid_prefix, SMART_CITY_NODE_UUID_TYPED_PREFIX_SIZE));
     mesh_stack_init_params_t init_params =
     {
-        .core.irq_priority       = NRF_MESH_IRQ_PRIORITY_LOWEST,
+        // A pilha executa em modo thread (nrf_mesh_process() no lao principal): os handlers do modelo e os eventos do
+        // timer_scheduler executam no mesmo contexto da aplicao, e no interrompem access_model_publish nem
+        // timer_sch_reschedule chamados por ela
+        .core.irq_priority       = NRF_MESH_IRQ_PRIORITY_THREAD,
         .core.lfclksrc           = DEV_BOARD_LF_CLK_CFG,
         .core.p_uuid             = dev_uuid,
         .models.models_init_cb   = models_init_cb,
@@ -265,6 +438,7 @@ static void mesh_init(void)
 static void initialize(void)
 {
     __LOG_INIT(LOG_SRC_APP | LOG_SRC_ACCESS, LOG_LEVEL_INFO, LOG_CALLBACK_DEFAULT);
+    smart_city_semaforo_trace_init();
     __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "----- BLE Mesh Traffic Light Full Demo -----\n");
 
     nrf_clock_lf_cfg_t lfc_cfg = DEV_BOARD_LF_CLK_CFG;
@@ -299,6 +473,14 @@ int main(void)
 
     for (;;)
     {
-        (void)sd_app_evt_wait();
+        bool ocioso = nrf_mesh_process();
+        // Trabalho adiado pelos temporizadores
+        eventos_executa(__atomic_exchange_n(&m_eventos_pendentes, 0, __ATOMIC_RELAXED));
+        // As mensagens gravadas nos callbacks vo para o RTT aqui, fora de contexto de interrupo
+        smart_city_semaforo_trace_flush();
+        if (ocioso)
+        {
+            (void)sd_app_evt_wait();
+        }
     }
 }
@@ -0,0 +1,89 @@
+#ifndef FLASH_MANAGER_H__
+#define FLASH_MANAGER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Gerenciador de flash da mesh, sobre uma área em RAM fornecida pelo teste.
+ *  Como no SDK, as entradas são gravadas em sequência na área, e a última gravada com um handle é a válida; sem espaço
+ *  no fim da área, as entradas substituídas são descartadas (desfragmentação). A área sobrevive a um novo
+ *  flash_manager_add(), que é o reinício do dispositivo para o teste. As gravações terminam no commit */
+#define PAGE_SIZE   (4096)
+#define WORD_SIZE   (4)
+
+typedef uint16_t fm_handle_t;
+
+typedef struct
+{
+    uint16_t len_words;     /** Tamanho da entrada com o cabeçalho, em palavras. 0xFFFF no fim das entradas */
+    fm_handle_t handle;
+} fm_header_t;
+
+typedef struct
+{
+    fm_header_t header;
+    uint32_t data[];
+} fm_entry_t;
+
+typedef struct
+{
+    uint8_t raw[PAGE_SIZE];
+} flash_manager_page_t;
+
+typedef enum
+{
+    FM_RESULT_SUCCESS,
+    FM_RESULT_ERROR_AREA_FULL,
+    FM_RESULT_ERROR_NOT_FOUND,
+    FM_RESULT_ERROR_FLASH_MALFUNCTION
+} fm_result_t;
+
+typedef struct flash_manager flash_manager_t;
+
+typedef void (*flash_manager_write_complete_cb_t)(const flash_manager_t * p_manager, const fm_entry_t * p_entry, fm_result_t result);
+typedef void (*flash_manager_invalidate_complete_cb_t)(const flash_manager_t * p_manager, fm_handle_t handle, fm_result_t result);
+typedef void (*flash_manager_remove_complete_cb_t)(const flash_manager_t * p_manager);
+typedef void (*fm_mem_listener_cb_t)(void * p_args);
+
+typedef struct
+{
+    flash_manager_write_complete_cb_t write_complete_cb;
+    flash_manager_invalidate_complete_cb_t invalidate_complete_cb;
+    flash_manager_remove_complete_cb_t remove_complete_cb;
+    uint32_t min_available_space;
+    const flash_manager_page_t * p_area;
+    uint32_t page_count;
+} flash_manager_config_t;
+
+struct flash_manager
+{
+    flash_manager_config_t config;
+    uint32_t end_words;     /** Palavras ocupadas no começo da área */
+};
+
+typedef struct
+{
+    fm_mem_listener_cb_t callback;
+    void * p_args;
+} fm_mem_listener_t;
+
+uint32_t flash_manager_add(flash_manager_t * p_manager, const flash_manager_config_t * p_config);
+uint32_t flash_manager_remove(flash_manager_t * p_manager);
+const fm_entry_t * flash_manager_entry_get(const flash_manager_t * p_manager, fm_handle_t handle);
+fm_entry_t * flash_manager_entry_alloc(flash_manager_t * p_manager, fm_handle_t handle, uint32_t data_length);
+void flash_manager_entry_commit(const fm_entry_t * p_entry);
+void flash_manager_wait(void);
+void flash_manager_mem_listener_register(fm_mem_listener_t * p_listener);
+
+/** Apaga a área (todos os bytes em 0xFF), como uma flash nova */
+void mock_flash_manager_erase(void * p_area, uint32_t page_count);
+/** As próximas @p count alocações falham, como com a fila de gravações cheia */
+void mock_flash_manager_alloc_fail(uint32_t count);
+/** Libera a fila de gravações: chama, uma vez, cada listener registrado */
+void mock_flash_manager_mem_release(void);
+/** Número de commits com o handle desde mock_flash_manager_erase() */
+uint32_t mock_flash_manager_commits(fm_handle_t handle);
+/** Número de entradas válidas com handles em [first, last] */
+uint32_t mock_flash_manager_entry_count(const flash_manager_t * p_manager, fm_handle_t first, fm_handle_t last);
+
+#endif /* FLASH_MANAGER_H__ */
@@ -0,0 +1,205 @@
+#include "flash_manager.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nrf_error.h"
+#include "nrf_mesh_assert.h"
+
+#define MOCK_FM_ERASED          (0xFFFF)
+#define MOCK_FM_LISTENERS_MAX   (8)
+#define MOCK_FM_HANDLES         (0x10000)
+
+/** Entrada alocada e ainda não gravada */
+typedef struct
+{
+    flash_manager_t * p_manager;
+    fm_entry_t entry;
+} mock_fm_alloc_t;
+
+static uint32_t m_alloc_fail;
+static fm_mem_listener_t * mp_listeners[MOCK_FM_LISTENERS_MAX];
+static uint32_t m_listener_count;
+static uint32_t m_commits[MOCK_FM_HANDLES];
+
+static uint32_t * area_words(const flash_manager_t * p_manager)
+{
+    return (uint32_t *) p_manager->config.p_area;
+}
+
+static uint32_t area_size_words(const flash_manager_t * p_manager)
+{
+    return p_manager->config.page_count * PAGE_SIZE / WORD_SIZE;
+}
+
+static const fm_entry_t * entry_at(const flash_manager_t * p_manager, uint32_t word)
+{
+    return (const fm_entry_t *) &area_words(p_manager)[word];
+}
+
+/* A entrada é válida se nenhuma gravada depois dela tem o mesmo handle */
+static bool entry_is_latest(const flash_manager_t * p_manager, uint32_t word)
+{
+    fm_handle_t handle = entry_at(p_manager, word)->header.handle;
+    for (uint32_t i = word + entry_at(p_manager, word)->header.len_words; i < p_manager->end_words;
+         i += entry_at(p_manager, i)->header.len_words)
+    {
+        if (entry_at(p_manager, i)->header.handle == handle)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Desfragmentação: as entradas válidas vão para o começo da área, na mesma ordem */
+static void area_defrag(flash_manager_t * p_manager)
+{
+    uint32_t * p_words = area_words(p_manager);
+    uint32_t * p_copy = malloc(p_manager->end_words * WORD_SIZE);
+    NRF_MESH_ASSERT(p_copy != NULL);
+    uint32_t end = 0;
+    for (uint32_t i = 0; i < p_manager->end_words; i += entry_at(p_manager, i)->header.len_words)
+    {
+        if (entry_is_latest(p_manager, i))
+        {
+            memcpy(&p_copy[end], &p_words[i], entry_at(p_manager, i)->header.len_words * WORD_SIZE);
+            end += entry_at(p_manager, i)->header.len_words;
+        }
+    }
+    memset(p_words, 0xFF, area_size_words(p_manager) * WORD_SIZE);
+    memcpy(p_words, p_copy, end * WORD_SIZE);
+    p_manager->end_words = end;
+    free(p_copy);
+}
+
+uint32_t flash_manager_add(flash_manager_t * p_manager, const flash_manager_config_t * p_config)
+{
+    p_manager->config = *p_config;
+    p_manager->end_words = 0;
+    while (p_manager->end_words < area_size_words(p_manager) &&
+           entry_at(p_manager, p_manager->end_words)->header.len_words != MOCK_FM_ERASED)
+    {
+        p_manager->end_words += entry_at(p_manager, p_manager->end_words)->header.len_words;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t flash_manager_remove(flash_manager_t * p_manager)
+{
+    mock_flash_manager_erase(area_words(p_manager), p_manager->config.page_count);
+    p_manager->end_words = 0;
+    p_manager->config.remove_complete_cb(p_manager);
+    return NRF_SUCCESS;
+}
+
+const fm_entry_t * flash_manager_entry_get(const flash_manager_t * p_manager, fm_handle_t handle)
+{
+    const fm_entry_t * p_found = NULL;
+    for (uint32_t i = 0; i < p_manager->end_words; i += entry_at(p_manager, i)->header.len_words)
+    {
+        if (entry_at(p_manager, i)->header.handle == handle)
+        {
+            p_found = entry_at(p_manager, i);
+        }
+    }
+    return p_found;
+}
+
+fm_entry_t * flash_manager_entry_alloc(flash_manager_t * p_manager, fm_handle_t handle, uint32_t data_length)
+{
+    if (m_alloc_fail > 0)
+    {
+        m_alloc_fail--;
+        return NULL;
+    }
+    uint32_t data_words = (data_length + WORD_SIZE - 1) / WORD_SIZE;
+    mock_fm_alloc_t * p_alloc = calloc(1, sizeof(mock_fm_alloc_t) + data_words * WORD_SIZE);
+    NRF_MESH_ASSERT(p_alloc != NULL);
+    p_alloc->p_manager = p_manager;
+    p_alloc->entry.header.len_words = (uint16_t) (sizeof(fm_header_t) / WORD_SIZE + data_words);
+    p_alloc->entry.header.handle = handle;
+    return &p_alloc->entry;
+}
+
+void flash_manager_entry_commit(const fm_entry_t * p_entry)
+{
+    mock_fm_alloc_t * p_alloc = (mock_fm_alloc_t *) ((uint8_t *) p_entry - offsetof(mock_fm_alloc_t, entry));
+    flash_manager_t * p_manager = p_alloc->p_manager;
+    uint32_t len_words = p_entry->header.len_words;
+
+    if (p_manager->end_words + len_words > area_size_words(p_manager))
+    {
+        area_defrag(p_manager);
+    }
+    if (p_manager->end_words + len_words > area_size_words(p_manager))
+    {
+        p_manager->config.write_complete_cb(p_manager, p_entry, FM_RESULT_ERROR_AREA_FULL);
+    }
+    else
+    {
+        fm_entry_t * p_written = (fm_entry_t *) &area_words(p_manager)[p_manager->end_words];
+        memcpy(p_written, p_entry, len_words * WORD_SIZE);
+        p_manager->end_words += len_words;
+        m_commits[p_entry->header.handle]++;
+        p_manager->config.write_complete_cb(p_manager, p_written, FM_RESULT_SUCCESS);
+    }
+    free(p_alloc);
+}
+
+void flash_manager_wait(void)
+{
+}
+
+void flash_manager_mem_listener_register(fm_mem_listener_t * p_listener)
+{
+    for (uint32_t i = 0; i < m_listener_count; i++)
+    {
+        NRF_MESH_ASSERT(mp_listeners[i] != p_listener);
+    }
+    NRF_MESH_ASSERT(m_listener_count < MOCK_FM_LISTENERS_MAX);
+    mp_listeners[m_listener_count++] = p_listener;
+}
+
+void mock_flash_manager_erase(void * p_area, uint32_t page_count)
+{
+    memset(p_area, 0xFF, page_count * PAGE_SIZE);
+    memset(m_commits, 0, sizeof(m_commits));
+    m_alloc_fail = 0;
+    m_listener_count = 0;
+}
+
+void mock_flash_manager_alloc_fail(uint32_t count)
+{
+    m_alloc_fail = count;
+}
+
+void mock_flash_manager_mem_release(void)
+{
+    /* Os listeners podem se registrar de novo durante a chamada */
+    fm_mem_listener_t * p_listeners[MOCK_FM_LISTENERS_MAX];
+    uint32_t count = m_listener_count;
+    memcpy(p_listeners, mp_listeners, sizeof(p_listeners));
+    m_listener_count = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        p_listeners[i]->callback(p_listeners[i]->p_args);
+    }
+}
+
+uint32_t mock_flash_manager_commits(fm_handle_t handle)
+{
+    return m_commits[handle];
+}
+
+uint32_t mock_flash_manager_entry_count(const flash_manager_t * p_manager, fm_handle_t first, fm_handle_t last)
+{
+    uint32_t count = 0;
+    for (uint32_t handle = first; handle <= last; handle++)
+    {
+        count += (flash_manager_entry_get(p_manager, (fm_handle_t) handle) != NULL);
+    }
+    return count;
+}
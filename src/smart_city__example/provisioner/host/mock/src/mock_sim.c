@@ -0,0 +1,31 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log.h"
+#include "app_error.h"
+#include "nrf_mesh_assert.h"
+
+/** Funções do simulador usadas pelas camadas simuladas do SDK. No build nativo o log é descartado, e um erro ou uma
+ *  asserção aborta o teste */
+int g_sim_log_level = -1;
+
+void sim_log_printf(uint32_t level, const char * p_filename, uint16_t line, const char * format, ...)
+{
+}
+
+void sim_log_hex(uint32_t level, const char * msg, const uint8_t * p_data, uint32_t len)
+{
+}
+
+void sim_app_error(uint32_t err_code, const char * p_file, uint32_t line)
+{
+    fprintf(stderr, "%s:%u: erro %u\n", p_file, (unsigned) line, (unsigned) err_code);
+    abort();
+}
+
+void sim_assert_fail(const char * p_file, uint32_t line)
+{
+    fprintf(stderr, "%s:%u: asserção falhou\n", p_file, (unsigned) line);
+    abort();
+}
@@ -0,0 +1,202 @@
+/** Testes do journal do estado da rede (network_journal.h), sobre o flash_manager em RAM do build nativo.
+ *  O reinício do dispositivo é um novo flash_manager_add() sobre a mesma área, seguido da restauração */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "flash_manager.h"
+#include "network_journal.h"
+
+#define TEST_FLASH_PAGE_COUNT   (1)     /** Como APP_FLASH_PAGE_COUNT do provisioner */
+#define TEST_ADDRESS_BASE       (0x0100)
+#define TEST_CHANGES            (400)   /** Mudanças suficientes para várias compactações e desfragmentações */
+
+static uint32_t m_area[TEST_FLASH_PAGE_COUNT * PAGE_SIZE / WORD_SIZE];
+static flash_manager_t m_flash_manager;
+static network_stats_data_stored_t m_nw_state;
+
+static void address_map_update(uint32_t * p_map, uint16_t address, uint16_t count, bool used)
+{
+    for (uint16_t bit = address - m_nw_state.address_base; count > 0 && bit < PROVISIONER_ADDRESS_POOL_SIZE; bit++, count--)
+    {
+        if (used)
+        {
+            p_map[bit / 32] |= 1u << (bit % 32);
+        }
+        else
+        {
+            p_map[bit / 32] &= ~(1u << (bit % 32));
+        }
+    }
+}
+
+/* Como network_state_change_apply() do provisioner. A ordem das mudanças importa: last_device_address fica com o
+ * último nó provisionado */
+static void state_change_apply(network_state_change_t change, uint16_t address, uint16_t count)
+{
+    switch (change)
+    {
+        case NETWORK_STATE_CHANGE_ADDRESS_POOL:
+            m_nw_state.address_base = address;
+            memset(m_nw_state.address_map, 0x00, sizeof(m_nw_state.address_map));
+            memset(m_nw_state.configured_map, 0x00, sizeof(m_nw_state.configured_map));
+            break;
+        case NETWORK_STATE_CHANGE_DEVICE_PROVISIONED:
+            address_map_update(m_nw_state.address_map, address, count, true);
+            m_nw_state.last_device_address = address;
+            m_nw_state.provisioned_devices++;
+            break;
+        case NETWORK_STATE_CHANGE_DEVICE_CONFIGURED:
+            address_map_update(m_nw_state.configured_map, address, 1, true);
+            m_nw_state.configured_devices++;
+            break;
+        case NETWORK_STATE_CHANGE_DEVICE_REMOVED:
+            address_map_update(m_nw_state.address_map, address, count, false);
+            address_map_update(m_nw_state.configured_map, address, 1, false);
+            m_nw_state.provisioned_devices--;
+            m_nw_state.configured_devices--;
+            break;
+    }
+}
+
+static void flash_write_complete(const flash_manager_t * p_manager, const fm_entry_t * p_entry, fm_result_t result)
+{
+    TEST_CHECK(result == FM_RESULT_SUCCESS);
+}
+
+static void flash_invalidate_complete(const flash_manager_t * p_manager, fm_handle_t handle, fm_result_t result)
+{
+    TEST_CHECK(false);
+}
+
+static void flash_remove_complete(const flash_manager_t * p_manager)
+{
+}
+
+/** Reinício do provisioner: o estado em RAM se perde e é restaurado da flash */
+static bool reboot(void)
+{
+    flash_manager_config_t config = {
+        .write_complete_cb = flash_write_complete,
+        .invalidate_complete_cb = flash_invalidate_complete,
+        .remove_complete_cb = flash_remove_complete,
+        .min_available_space = WORD_SIZE,
+        .p_area = (const flash_manager_page_t *) m_area,
+        .page_count = TEST_FLASH_PAGE_COUNT
+    };
+    memset(&m_nw_state, 0xA5, sizeof(m_nw_state));
+    TEST_CHECK(flash_manager_add(&m_flash_manager, &config) == NRF_SUCCESS);
+    network_journal_init(&m_flash_manager, &m_nw_state, state_change_apply);
+    return network_journal_load();
+}
+
+/** Flash nova: sem estado gravado, e o estado inicial é gravado inteiro, como no provisioner */
+static void network_start(void)
+{
+    mock_flash_manager_erase(m_area, TEST_FLASH_PAGE_COUNT);
+    TEST_CHECK(!reboot());
+    TEST_CHECK(network_journal_state_store() == NRF_SUCCESS);
+    TEST_CHECK(reboot());
+    state_change_apply(NETWORK_STATE_CHANGE_ADDRESS_POOL, TEST_ADDRESS_BASE, 0);
+    network_journal_append(NETWORK_STATE_CHANGE_ADDRESS_POOL, TEST_ADDRESS_BASE, 0);
+}
+
+/** Mudança n da sequência do teste. A cada cinco mudanças, dois nós de dois elementos são provisionados e
+ *  configurados, e o segundo volta resetado */
+static void change_make(uint32_t n)
+{
+    static const network_state_change_t changes[] = {
+        NETWORK_STATE_CHANGE_DEVICE_PROVISIONED, NETWORK_STATE_CHANGE_DEVICE_CONFIGURED,
+        NETWORK_STATE_CHANGE_DEVICE_PROVISIONED, NETWORK_STATE_CHANGE_DEVICE_CONFIGURED,
+        NETWORK_STATE_CHANGE_DEVICE_REMOVED
+    };
+    network_state_change_t change = changes[n % 5];
+    uint16_t address = TEST_ADDRESS_BASE + (uint16_t) ((4 * (n / 5) + (n % 5 >= 2 ? 2 : 0)) % PROVISIONER_ADDRESS_POOL_SIZE);
+    state_change_apply(change, address, 2);
+    network_journal_append(change, address, 2);
+}
+
+/** O estado restaurado é o que estava na RAM */
+static bool reboot_check(void)
+{
+    network_stats_data_stored_t antes = m_nw_state;
+    bool restaurado = reboot();
+    TEST_CHECK(restaurado);
+    return restaurado && memcmp(&antes, &m_nw_state, sizeof(antes)) == 0;
+}
+
+/** O journal nunca passa de NETWORK_JOURNAL_SIZE registros: a cada NETWORK_JOURNAL_SIZE registros o estado inteiro é
+ *  gravado, e os registros seguintes reaproveitam os handles dos anteriores à compactação */
+static void test_journal_compaction(void)
+{
+    network_start();
+    for (uint32_t n = 0; n < TEST_CHANGES; n++)
+    {
+        change_make(n);
+    }
+    TEST_CHECK(reboot_check());
+
+    /* O estado inicial, e uma compactação a cada NETWORK_JOURNAL_SIZE registros mais a mudança que não coube */
+    const uint32_t mudancas = TEST_CHANGES + 1;
+    TEST_CHECK(mock_flash_manager_commits(NETWORK_JOURNAL_STATE_HANDLE) == 1 + mudancas / (NETWORK_JOURNAL_SIZE + 1));
+    TEST_CHECK(m_nw_state.journal_seq == (mudancas / (NETWORK_JOURNAL_SIZE + 1)) * NETWORK_JOURNAL_SIZE);
+    TEST_CHECK(mock_flash_manager_entry_count(&m_flash_manager, NETWORK_JOURNAL_HANDLE_BASE,
+                                              NETWORK_JOURNAL_HANDLE_BASE + NETWORK_JOURNAL_SIZE - 1) == NETWORK_JOURNAL_SIZE);
+    for (uint32_t seq = 0; seq < NETWORK_JOURNAL_SIZE; seq++)
+    {
+        TEST_CHECK(mock_flash_manager_commits(NETWORK_JOURNAL_HANDLE(seq)) >= mudancas / (NETWORK_JOURNAL_SIZE + 1));
+    }
+}
+
+/** Reinício depois de cada mudança, em todas as posições do journal: logo depois de uma compactação, o handle do
+ *  próximo registro ainda tem um registro de antes dela, que não pode ser aplicado */
+static void test_journal_replay(void)
+{
+    network_start();
+    TEST_CHECK(reboot_check());
+    for (uint32_t n = 0; n < TEST_CHANGES; n++)
+    {
+        change_make(n);
+        TEST_CHECK(reboot_check());
+    }
+    TEST_CHECK(m_nw_state.journal_seq > 2 * NETWORK_JOURNAL_SIZE);
+}
+
+/** Sem espaço para o registro nem para o estado inteiro, as mudanças ficam na RAM até o flash_manager liberar memória,
+ *  e então o estado inteiro, já com todas elas, é gravado */
+static void test_journal_state_pending(void)
+{
+    network_start();
+    for (uint32_t n = 0; n < 5; n++)
+    {
+        change_make(n);
+    }
+    const uint32_t gravacoes = mock_flash_manager_commits(NETWORK_JOURNAL_STATE_HANDLE);
+
+    mock_flash_manager_alloc_fail(2);
+    for (uint32_t n = 5; n < 9; n++)
+    {
+        change_make(n);
+    }
+    TEST_CHECK(mock_flash_manager_commits(NETWORK_JOURNAL_STATE_HANDLE) == gravacoes);
+    mock_flash_manager_mem_release();
+    TEST_CHECK(mock_flash_manager_commits(NETWORK_JOURNAL_STATE_HANDLE) == gravacoes + 1);
+    TEST_CHECK(reboot_check());
+
+    /* O journal continua depois do estado gravado */
+    for (uint32_t n = 9; n < 9 + NETWORK_JOURNAL_SIZE; n++)
+    {
+        change_make(n);
+        TEST_CHECK(reboot_check());
+    }
+    TEST_CHECK(mock_flash_manager_commits(NETWORK_JOURNAL_STATE_HANDLE) == gravacoes + 1);
+}
+
+int main(void)
+{
+    test_journal_compaction();
+    test_journal_replay();
+    test_journal_state_pending();
+    return TEST_RESULT();
+}
@@ -0,0 +1,60 @@
+#ifndef DEVICE_DB_H__
+#define DEVICE_DB_H__
+
+#include <stdint.h>
+#include "device_state_manager.h"
+#include "network_setup_types.h"
+
+/**
+ * @defgroup DEVICE_DB Base dos dispositivos provisionados
+ *
+ * Guarda a chave de dispositivo e o nmero de elementos de cada n provisionado, em um registro por endereo do pool.
+ * Os registros ficam em flash (na RAM quando PERSISTENT_STORAGE  0). A DSM guarda s as chaves e os endereos de um
+ * conjunto de trabalho de PROVISIONER_DSM_DEVICE_COUNT ns, carregados quando o n  configurado; o n usado h mais
+ * tempo d lugar ao prximo. Assim a RAM e a DSM no crescem com o nmero de ns da rede.
+ * @{
+ */
+
+/** Pginas de flash da base: um registro de 24 bytes, com o cabealho do flash_manager, por endereo do pool, e uma
+ *  pgina livre para a desfragmentao */
+#define DEVICE_DB_FLASH_PAGE_COUNT  (3)
+
+/**
+ * Inicializa a base. Os ns que j esto na DSM (restaurada da flash) passam a ser o conjunto de trabalho.
+ *
+ * @param[in] p_dev_data   Handles da rede; a chave do dispositivo  adicionada  subrede de m_netkey_handle.
+ * @param[in] p_nw_data    Estado da rede; o endereo de um registro  relativo a address_base.
+ * @param[in] p_flash_area rea de DEVICE_DB_FLASH_PAGE_COUNT pginas dos registros. Ignorada sem PERSISTENT_STORAGE.
+ */
+void device_db_init(const network_dsm_handles_data_volatile_t * p_dev_data,
+                    const network_stats_data_stored_t * p_nw_data,
+                    const void * p_flash_area);
+
+/**
+ * Grava o registro de um n provisionado. A chave s vai para a DSM quando o n for configurado.
+ *
+ * @retval NRF_SUCCESS             O registro foi gravado, ou ser quando houver espao na flash.
+ * @retval NRF_ERROR_INVALID_PARAM O endereo est fora do pool.
+ * @retval NRF_ERROR_NO_MEM        H gravaes demais esperando espao na flash.
+ */
+uint32_t device_db_add(uint16_t address, uint16_t elements, const uint8_t * p_devkey);
+
+/**
+ * Handles da DSM da chave e do endereo de um n, para o cliente de configurao. Carrega o n no conjunto de
+ * trabalho se ele ainda no estiver l.
+ *
+ * @retval NRF_SUCCESS          Os handles so vlidos at a prxima chamada com outro n.
+ * @retval NRF_ERROR_NOT_FOUND  O n no tem registro.
+ */
+uint32_t device_db_handles_get(uint16_t address, dsm_handle_t * p_devkey_handle, dsm_handle_t * p_address_handle);
+
+/**
+ * Nmero de elementos do n provisionado no endereo.
+ *
+ * @returns 0 se o endereo no for o primeiro de um n da base.
+ */
+uint16_t device_db_elements_get(uint16_t address);
+
+/** @} end of DEVICE_DB */
+
+#endif /* DEVICE_DB_H__ */
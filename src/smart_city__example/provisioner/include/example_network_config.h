@@ -56,10 +56,46 @@
 #define PROVISIONER_ADDRESS  (0x0001)
 #define UNPROV_START_ADDRESS (0x0100)
 
+/** Number of unprovisioned devices heard on their beacons, and ranked by RSSI, from which the next device to
+ * provision is taken. */
 #define UNPROV_MAX_SCANNED_ITEMS_LIST   10
+/** Time during which beacons are collected before the best devices are given the free links. A little longer than
+ * the beacon interval, so that each device in range is heard at least once. */
+#define PROVISIONER_SCAN_WINDOW_MS      (2500)
+/** A device not heard for this long is dropped from the scanned list */
+#define PROVISIONER_SCAN_AGE_MS         (6000)
 
 #define PROVISIONER_RETRY_COUNT  (2)
 
+/** Number of times node setup of a device is started again after it fails. The device is then reported as failed,
+ * and left unconfigured until the provisioner restarts, and queues again the devices not configured. */
+#define PROVISIONER_CONFIG_RETRY_COUNT  (8)
+
+/** Delay before a device whose provisioning failed is tried again. It doubles on each failure of the device, up to
+ * PROVISIONER_BACKOFF_MAX_MS, and a random jitter of up to half of it is added. Meanwhile, the links are used for
+ * the other devices. */
+#define PROVISIONER_BACKOFF_BASE_MS     (500)
+#define PROVISIONER_BACKOFF_MAX_MS      (16000)
+
+/** Number of devices provisioned in parallel. Each link uses its own provisioning context and PB-ADV bearer. */
+#define PROVISIONER_LINK_COUNT          (3)
+/** Number of unicast addresses reserved for a device when it is first seen, before its link is opened. */
+#define PROVISIONER_DEVICE_ELEMENTS     (1)
+/** Size of the device table, indexed by UUID. Must be a power of two, larger than the number of devices being
+ * provisioned or configured at a time: the entries of configured devices are reused. */
+#define PROVISIONER_DEVICE_TABLE_SIZE   (64)
+
+/** Number of unicast addresses given to the devices, starting at a base derived from the provisioner device key.
+ * Free addresses are kept in a bitmap stored with the network state; it must be a multiple of 32. */
+#define PROVISIONER_ADDRESS_POOL_SIZE   (256)
+
+/** Number of device types whose composition data is cached, and stored in flash. A device whose UUID names a cached
+ * type is configured without reading its composition data. */
+#define PROVISIONER_COMPOSITION_CACHE_SIZE  (4)
+/** Largest composition data page kept in the cache. A cache entry must fit in a flash manager entry; devices with a
+ * larger page have it read every time. */
+#define PROVISIONER_COMPOSITION_DATA_MAX    (96)
+
 /** @} end of LIGHT_SWT_V2 */
 
 #endif /* EXAMPLE_COMMON_H__ */
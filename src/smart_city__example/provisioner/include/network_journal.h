@@ -0,0 +1,64 @@
+#ifndef NETWORK_JOURNAL_H__
+#define NETWORK_JOURNAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash_manager.h"
+#include "network_setup_types.h"
+
+/**
+ * @defgroup NETWORK_JOURNAL Journal do estado da rede
+ *
+ * O estado da rede  gravado inteiro s de vez em quando; cada mudana entre duas gravaes vira um registro de trs
+ * palavras. Os registros ocupam NETWORK_JOURNAL_SIZE handles do flash_manager, reaproveitados em crculo: o registro
+ * de sequncia seq fica em NETWORK_JOURNAL_HANDLE(seq), e o estado inteiro  gravado de novo (compactao) antes que
+ * um registro ainda no includo nele seja sobrescrito. Na restaurao, os registros posteriores ao estado gravado
+ * so aplicados a ele, em ordem.
+ * @{
+ */
+
+#define NETWORK_JOURNAL_STATE_HANDLE    (0x0001)    /** Estado inteiro da rede */
+#define NETWORK_JOURNAL_HANDLE_BASE     (0x0100)    /** Uma entrada por posio do journal */
+#define NETWORK_JOURNAL_SIZE            (32)        /** Registros do journal entre duas gravaes do estado inteiro */
+
+#define NETWORK_JOURNAL_HANDLE(seq)     ((fm_handle_t) (NETWORK_JOURNAL_HANDLE_BASE + ((seq) % NETWORK_JOURNAL_SIZE)))
+
+/** Aplica uma mudana ao estado da rede. Usada na restaurao */
+typedef void (*network_journal_apply_cb_t)(network_state_change_t change, uint16_t address, uint16_t count);
+
+/**
+ * Inicializa o journal.
+ *
+ * @param[in] p_flash_manager Gerenciador j adicionado da rea da aplicao. Os handles do journal no podem ser usados
+ *                            por outros registros dela.
+ * @param[in] p_nw_state      Estado da rede, restaurado por network_journal_load() e gravado inteiro na compactao.
+ * @param[in] apply_cb        Aplicao das mudanas restauradas.
+ */
+void network_journal_init(flash_manager_t * p_flash_manager, network_stats_data_stored_t * p_nw_state,
+                          network_journal_apply_cb_t apply_cb);
+
+/**
+ * Restaura o estado da rede: o estado gravado, com os registros do journal posteriores a ele.
+ *
+ * @returns false se no houver estado gravado. O estado  zerado.
+ */
+bool network_journal_load(void);
+
+/**
+ * Grava o estado inteiro da rede, que inclui todas as mudanas at aqui; o journal recomea depois dele.
+ * Sem espao na flash, a gravao  feita quando o flash_manager liberar memria.
+ */
+uint32_t network_journal_state_store(void);
+
+/**
+ * Grava uma mudana j aplicada ao estado da rede. Com o journal cheio, ou sem espao na flash para o registro, grava
+ * o estado inteiro (que j tem a mudana).
+ */
+void network_journal_append(network_state_change_t change, uint16_t address, uint16_t count);
+
+/** Esquece o journal, depois que a rea da aplicao  apagada */
+void network_journal_clear(void);
+
+/** @} end of NETWORK_JOURNAL */
+
+#endif /* NETWORK_JOURNAL_H__ */
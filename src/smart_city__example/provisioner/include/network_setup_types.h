@@ -40,6 +40,7 @@
 #include "device_state_manager.h"
 #include "health_client.h"
 #include "nrf_mesh_defines.h"
+#include "example_network_config.h"
 
 /** Structure to store the handles data related to provisioned devices */
 typedef struct
@@ -59,11 +60,37 @@ typedef struct
     uint16_t provisioned_devices;
     uint16_t configured_devices;
     uint16_t last_device_address;
-    uint16_t next_device_address;
+    uint16_t address_base;      /**< First address of the pool, NRF_MESH_ADDR_UNASSIGNED until the pool is set up */
+    uint32_t journal_seq;       /**< Sequence number of the first journal record not included in this state */
+
+    /** Addresses of the pool owned by provisioned devices, one bit per address */
+    uint32_t address_map[PROVISIONER_ADDRESS_POOL_SIZE / 32];
+    /** Configured devices, one bit at the first address of each one. The provisioned devices still to be configured
+     * are the ones owning an address without this bit */
+    uint32_t configured_map[PROVISIONER_ADDRESS_POOL_SIZE / 32];
 
     uint8_t  netkey[NRF_MESH_KEY_SIZE];
     uint8_t  appkey[NRF_MESH_KEY_SIZE];
     uint8_t  self_devkey[NRF_MESH_KEY_SIZE];
 } network_stats_data_stored_t;
 
+/** Changes to the network state. The application stores each one as a small journal record, and applies the
+ * records to the last stored state on boot. */
+typedef enum
+{
+    NETWORK_STATE_CHANGE_ADDRESS_POOL,          /**< The pool was set up at `address`, with empty address maps */
+    NETWORK_STATE_CHANGE_DEVICE_PROVISIONED,    /**< A device was provisioned at `address`, and owns `count` addresses */
+    NETWORK_STATE_CHANGE_DEVICE_CONFIGURED,     /**< The device at `address` was configured */
+    NETWORK_STATE_CHANGE_DEVICE_REMOVED         /**< The configured device at `address` was reset: its `count` addresses
+                                                     go back to the pool, and it is no longer counted */
+} network_state_change_t;
+
+/** Structure to store the composition data page 0 of a device type. The company, product and version IDs at the
+ * start of the page are the key of the cache entry. */
+typedef struct
+{
+    uint16_t length;    /**< Length of the page in `data`, 0 if the entry is unused */
+    uint8_t  data[PROVISIONER_COMPOSITION_DATA_MAX];
+} composition_data_stored_t;
+
 #endif /* NETWORK_SETUP_H__ */
@@ -61,31 +61,57 @@
 /** Delay after which config client message will be re-sent if client model is busy */
 #define CLIENT_BUSY_SEND_RETRY_DELAY_MS  (500)
 
+/** Number of nodes configured concurrently. The config client has a single pending request, which is given to
+ * each node in turn, so that a node that does not answer does not hold the others. */
+#define NODE_SETUP_SESSION_COUNT         (4)
+
+/** Time to wait for the status of a request before it is cancelled and the config client is given to the next
+ * node. The request is sent again on the next turn of its node, up to the retry count given to node_setup_start(). */
+#define NODE_SETUP_REQUEST_TIMEOUT_MS    (5000)
+
+/** Maximum number of models, SIG and vendor, in all the elements of a node. The composition data of a node is
+ * indexed in one pass when it is received; a node with more models fails the node setup. */
+#define NODE_SETUP_MODEL_INDEX_SIZE      (16)
+
 /**
  * @defgroup NODE_SETUP_CALLBACKS User application callback prototypes for node setup module
  * @{
  */
 
 
-/** Callback to user indicating that all steps in the node setup were completed. */
-typedef void (*node_setup_successful_cb_t)(void);
+/** Callback to user indicating that all steps in the node setup were completed for the node at `address`. */
+typedef void (*node_setup_successful_cb_t)(uint16_t address);
 
-/** Callback to user indicating that the node setup failed. */
-typedef void (*node_setup_failed_cb_t)(void);
+/** Callback to user indicating that the node setup failed for the node at `address`. */
+typedef void (*node_setup_failed_cb_t)(uint16_t address);
+
+/** Callback to user indicating that a new device type was added to the composition data cache, which should be
+ * stored. */
+typedef void (*node_setup_composition_store_cb_t)(void);
 
 /** @} end of NODE_SETUP_CALLBACKS */
 
 /**
- * Starts state machine for configuring the newly provisioned node. If this function is called
- * when previous setup process is underway it will trigger error condition.
+ * Starts state machine for configuring the newly provisioned node. Up to NODE_SETUP_SESSION_COUNT nodes
+ * are configured at the same time.
+ *
+ * If the UUID of the node names a device type of the composition data cache (see
+ * SMART_CITY_NODE_UUID_TYPED_PREFIX), the cached composition data is used, and it is not read from the node.
+ * If the node then rejects a configuration step, the composition data is read from the node, replaces the cached one,
+ * and node setup starts over.
  *
  * @param[in]  address      Unicast address of the node to be configured.
  * @param[in]  retry_cnt    Number of times a message can be resent if failed
  * @param[in]  p_appkey     Pointer to the appkey that will be used for configuring nodes
  * @param[in]  appkey_idx   Desired appkey index.
+ * @param[in]  p_uuid       UUID of the node, or NULL if it is not known.
+ *
+ * @retval NRF_SUCCESS              The node setup was started.
+ * @retval NRF_ERROR_NO_MEM         NODE_SETUP_SESSION_COUNT nodes are being configured already.
+ * @retval NRF_ERROR_INVALID_STATE  The node is being configured already.
  */
-void node_setup_start(uint16_t address, uint8_t  retry_cnt, const uint8_t * p_appkey,
-                      uint16_t appkey_idx);
+uint32_t node_setup_start(uint16_t address, uint8_t  retry_cnt, const uint8_t * p_appkey,
+                          uint16_t appkey_idx, const uint8_t * p_uuid);
 
 /**
  * Sets the application callbacks to be called when node setup succeeds or fails.
@@ -97,6 +123,17 @@ void node_setup_start(uint16_t address, uint8_t  retry_cnt, const uint8_t * p_ap
 void node_setup_cb_set(node_setup_successful_cb_t config_success_cb,
                        node_setup_failed_cb_t config_failed_cb);
 
+/**
+ * Sets the composition data cache, with PROVISIONER_COMPOSITION_CACHE_SIZE entries. Entries already filled, restored
+ * from flash, are used right away. The composition data read from a node of a new device type is added to a free
+ * entry, and `store_cb` is called.
+ *
+ * @param[in]  p_cache      Cache entries, owned by the application.
+ * @param[in]  store_cb     Application callback called when an entry is filled.
+ */
+void node_setup_composition_cache_set(composition_data_stored_t * p_cache,
+                                      node_setup_composition_store_cb_t store_cb);
+
 /**
  * Process the config client events.
  *
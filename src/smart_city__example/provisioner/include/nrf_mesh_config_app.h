@@ -57,10 +57,13 @@
 /** Device company identifier. */
 #define DEVICE_COMPANY_ID (ACCESS_COMPANY_ID_NORDIC)
 
-/** Device product identifier*/
-#define DEVICE_PRODUCT_ID (0x0000)
+/** Device product identifier. Each firmware of the network has its own: 0x0001 full, 0x0002 no_sensor,
+ * 0x0003 provisioner. The provisioner caches the composition data of each product and version ID
+ * (see SMART_CITY_NODE_UUID_TYPED_PREFIX). */
+#define DEVICE_PRODUCT_ID (0x0003)
 
-/** Device version identifier */
+/** Device version identifier. Must be incremented whenever the composition data changes (elements, models or
+ * features), so that the provisioner does not configure the device with the cached composition of the old version. */
 #define DEVICE_VERSION_ID (0x0000)
 
 /** Supported features of the device. @see config_feature_bit_t */
@@ -133,15 +136,18 @@
 #define DSM_SUBNET_MAX                                  (1)
 /** Maximum number of applications */
 #define DSM_APP_MAX                                     (1)
+/** Number of provisioned devices whose device key and address are kept in the DSM at a time. The others are stored
+ * by the device database (device_db.h), and loaded when the node is configured. */
+#define PROVISIONER_DSM_DEVICE_COUNT                    (8)
 /** Maximum number of device keys */
 #define DSM_DEVICE_MAX                                  (1 + /* for self */\
-                                                         SMART_CITY_DEVICE_COUNT /* for each device*/ )
+                                                         PROVISIONER_DSM_DEVICE_COUNT /* for the working set */)
 /** Maximum number of virtual addresses. */
 #define DSM_VIRTUAL_ADDR_MAX                            (1)
-/** Maximum number of non-virtual addresses. One for each of the servers and a group address. */
+/** Maximum number of non-virtual addresses. One for each server of the working set and the group addresses. */
 #define DSM_NONVIRTUAL_ADDR_MAX                         (1 + /* For self address */\
                                                          GROUP_ADDR_COUNT + /* Group addresses  */\
-                                                         SMART_CITY_DEVICE_COUNT /* For each server */)
+                                                         PROVISIONER_DSM_DEVICE_COUNT /* For the working set */)
 /** Number of flash pages reserved for the DSM storage */
 #define DSM_FLASH_PAGE_COUNT                            (3)
 /** @} end of DSM_CONFIG */
@@ -152,8 +158,9 @@
  * @{
  */
 
-/** Number of entries in the replay protection cache. */
-#define REPLAY_CACHE_ENTRIES                            (SMART_CITY_DEVICE_COUNT * 2)
+/** Number of entries in the replay protection cache. Does not grow with the network: when it is full, the oldest
+ * source is replaced. */
+#define REPLAY_CACHE_ENTRIES                            (64)
 
 /** @} end of REPLAY_CONFIG */
 
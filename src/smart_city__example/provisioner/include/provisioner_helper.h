@@ -55,6 +55,7 @@
  *
  * User application can initiate the provisioning process and repond with appropriate data when
  * events are generated. This module handles the process failures, timeouts and initiates retry.
+ * Several devices are provisioned in parallel, each one on its own provisioning context.
  *
  * After provisioning is completed, it adds the given AppKey, at the give index, to the node
  * and binds all the models to this App Key, and configures the major node features as specified.
@@ -71,10 +72,14 @@
 /**
  * Provisioning helper application data store trigger callback type.
  *
- * After provisioning is completed successfully, application receives this callback to trigger
- * data storage operation.
+ * After the address pool is set up, and after provisioning is completed successfully, application
+ * receives this callback to store the change. The network state in RAM is already updated.
+ *
+ * @param[in] change  What changed in the network state.
+ * @param[in] address Address of the pool, or of the provisioned device.
+ * @param[in] count   Number of addresses owned by the provisioned device, 0 otherwise.
  */
-typedef void (*prov_helper_data_store_cb_t) (void);
+typedef void (*prov_helper_data_store_cb_t) (network_state_change_t change, uint16_t address, uint16_t count);
 
 /** Callback to user indicating that the provisioning failed. */
 typedef void (*prov_helper_failed_cb_t)(void);
@@ -127,33 +132,53 @@ void prov_helper_init(mesh_provisioner_init_params_t * p_prov_init_info);
 void prov_helper_scan_start(void);
 
 /**
- * This API sets the address and UUID that will be used by the provisioner library.
- *
- * The address specified here will be used by the provisioner as a unicast address for the
- * unprovisioned device. .
- *
- * @param[in] retry_cnt         Number of times, provisioning process will be re-run, if it fails.
- * @param[in] address           The address specified here will be used by the provisioner as a
- *                              start address (unicast address) for the unprovisioned device.
+ * Starts provisioning the devices accepted by the UUID filter, up to PROVISIONER_LINK_COUNT of them in parallel.
+ *
+ * Each accepted device gets an entry in a table indexed by its UUID, and a unicast address range of
+ * PROVISIONER_DEVICE_ELEMENTS addresses, reserved first fit from the address pool when it is first seen. A device
+ * whose provisioning fails keeps its address and is retried on its next beacon, without holding the other links;
+ * when it runs out of retries, its range goes back to the pool until the device is seen again. The pool is set up on
+ * the first call, and the ranges of provisioned devices are stored with the network state.
+ * Provisioned devices are queued for node setup, so the configuration of a device overlaps with the provisioning
+ * of the next ones, and up to NODE_SETUP_SESSION_COUNT devices are configured at the same time. Scanning stops when `device_count` devices have been provisioned.
+ *
+ * @param[in] retry_cnt         Number of times, provisioning process will be re-run for a device, if it fails,
+ *                              before the failure is reported to the application.
+ * @param[in] device_count      Total number of devices in the network, including the ones already provisioned.
  * @param[in] uuid_filter       Structure of the type @prov_helper_uuid_filter_t containing pointer
  *                              to uuid filter array (p_uuid) and length of the filter (length).
  *                              If `uuid_filter->p_uuid` is set to NULL or if `uuid_filter->length`
- *                              is zero provisioner helper will provision the next unprovisioned
- *                              device it sees.
+ *                              is zero provisioner helper will provision any unprovisioned device it sees.
+ */
+void prov_helper_provision_devices(uint8_t retry_cnt, uint16_t device_count,
+                                   prov_helper_uuid_filter_t * p_uuid_filter);
+
+/**
+ * Queues a provisioned device for node setup. Devices provisioned by this module are queued automatically; this
+ * is used for devices that were provisioned but not configured before a reset.
+ *
+ * @param[in] address           Unicast address of the device.
+ */
+void prov_helper_config_enqueue(uint16_t address);
+
+/**
+ * Reports the end of node setup for a device, and starts the next ones in the queue. Must be called from the
+ * node setup callbacks. A device whose setup failed is queued again, after the devices already waiting, up to
+ * PROVISIONER_CONFIG_RETRY_COUNT times.
+ *
+ * @param[in] address           Unicast address of the device.
+ * @param[in] success           true if node setup succeeded.
  *
- * @note In this example, we know that our light switch servers only have _one_ element,
- *       therefore their unicast addresses will be sequential. This assumption does not hold
- *       in general.
+ * @returns false if node setup failed, and the device ran out of retries.
  */
-void prov_helper_provision_next_device(uint8_t retry_cnt, uint16_t address,
-                                       prov_helper_uuid_filter_t * p_uuid_filter);
+bool prov_helper_config_done(uint16_t address, bool success);
 
 /** Initializes the local node by adding self address, self device key, and by binding models. */
 void prov_helper_provision_self(void);
 
 
 /**
- *  Retrives the number of elements for the recently provisioned device.
+ *  Retrives the number of elements for the most recently provisioned device.
  *
  * @returns value of the number of elements based on the capabilities messages received from the
  * provisioned node during provisioning process. Returned value will be undefined if no device has
@@ -0,0 +1,366 @@
+#include "device_db.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "nrf_mesh_config_app.h"
+#include "nrf_mesh_assert.h"
+#include "mesh_app_utils.h"
+#include "example_network_config.h"
+#include "nrf_mesh_config_examples.h"
+#include "log.h"
+
+#if PERSISTENT_STORAGE
+#include "flash_manager.h"
+#endif
+
+/** Handle do registro de um endereo no flash_manager: a posio no pool, a partir de 1 (0  invlido) */
+#define DEVICE_DB_HANDLE(offset)    ((fm_handle_t) ((offset) + 1))
+/** Registros que podem esperar espao na flash: um por link de provisionamento */
+#define DEVICE_DB_PENDING_COUNT     (PROVISIONER_LINK_COUNT)
+
+/** Registro de um n provisionado */
+typedef struct
+{
+    uint16_t address;
+    uint16_t elements;
+    uint8_t  devkey[NRF_MESH_KEY_SIZE];
+} device_db_record_t;
+
+/** N do conjunto de trabalho, com a chave e o endereo na DSM */
+typedef struct
+{
+    uint16_t     address;       /** NRF_MESH_ADDR_UNASSIGNED se a posio estiver livre */
+    dsm_handle_t devkey_handle;
+    dsm_handle_t address_handle;
+    uint32_t     last_used;
+} device_db_dsm_entry_t;
+
+static const network_dsm_handles_data_volatile_t * mp_dev_data;
+static const network_stats_data_stored_t * mp_nw_data;
+
+static device_db_dsm_entry_t m_dsm_entries[PROVISIONER_DSM_DEVICE_COUNT];
+static uint32_t m_use_count;
+
+/** Posio do endereo no pool, ou PROVISIONER_ADDRESS_POOL_SIZE se ele estiver fora */
+static uint16_t record_offset(uint16_t address)
+{
+    uint16_t base = mp_nw_data->address_base;
+    if (base == NRF_MESH_ADDR_UNASSIGNED || address < base || address - base >= PROVISIONER_ADDRESS_POOL_SIZE)
+    {
+        return PROVISIONER_ADDRESS_POOL_SIZE;
+    }
+    return address - base;
+}
+
+/*************************************************************************************************/
+/* Armazenamento dos registros */
+
+#if PERSISTENT_STORAGE
+
+static flash_manager_t m_flash_manager;
+static const void * mp_flash_area;
+
+/* Registros que no couberam na flash, gravados quando o flash_manager liberar espao */
+static device_db_record_t m_pending[DEVICE_DB_PENDING_COUNT];
+static uint32_t m_pending_count;
+
+static void flash_write_complete(const flash_manager_t * p_manager, const fm_entry_t * p_entry, fm_result_t result)
+{
+    /* A rea tem espao para um registro por endereo do pool */
+    NRF_MESH_ASSERT(result != FM_RESULT_ERROR_AREA_FULL);
+    NRF_MESH_ASSERT(result != FM_RESULT_ERROR_NOT_FOUND);
+    if (result == FM_RESULT_ERROR_FLASH_MALFUNCTION)
+    {
+        ERROR_CHECK(NRF_ERROR_NO_MEM);
+    }
+}
+
+static void flash_invalidate_complete(const flash_manager_t * p_manager, fm_handle_t handle, fm_result_t result)
+{
+    /* Os registros no so invalidados. O registro de um n removido fica na flash at o prximo device_db_add na
+     * mesma posio do pool, que grava outro registro com o mesmo handle no lugar dele */
+    ERROR_CHECK(NRF_ERROR_INTERNAL);
+}
+
+static void flash_remove_complete(const flash_manager_t * p_manager)
+{
+    /* A base no  apagada */
+    ERROR_CHECK(NRF_ERROR_INTERNAL);
+}
+
+static void flash_mem_available(void * p_args)
+{
+    ((void (*)(void)) p_args)(); /*lint !e611 Suspicious cast */
+}
+
+static void flash_manager_add_retry(void)
+{
+    static fm_mem_listener_t mem_listener = {
+        .callback = flash_mem_available,
+        .p_args = flash_manager_add_retry
+    };
+    flash_manager_config_t manager_config;
+    manager_config.write_complete_cb = flash_write_complete;
+    manager_config.invalidate_complete_cb = flash_invalidate_complete;
+    manager_config.remove_complete_cb = flash_remove_complete;
+    manager_config.min_available_space = WORD_SIZE;
+    manager_config.p_area = (const flash_manager_page_t *) mp_flash_area;
+    manager_config.page_count = DEVICE_DB_FLASH_PAGE_COUNT;
+    if (flash_manager_add(&m_flash_manager, &manager_config) != NRF_SUCCESS)
+    {
+        flash_manager_mem_listener_register(&mem_listener);
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Unable to add flash manager for the device database\n");
+    }
+}
+
+static bool record_write(const device_db_record_t * p_record)
+{
+    fm_entry_t * p_entry = flash_manager_entry_alloc(&m_flash_manager, DEVICE_DB_HANDLE(record_offset(p_record->address)),
+                                                     sizeof(device_db_record_t));
+    if (p_entry == NULL)
+    {
+        return false;
+    }
+    memcpy(p_entry->data, p_record, sizeof(device_db_record_t));
+    flash_manager_entry_commit(p_entry);
+    return true;
+}
+
+static void pending_flush(void)
+{
+    static fm_mem_listener_t mem_listener = {
+        .callback = flash_mem_available,
+        .p_args = pending_flush
+    };
+    uint32_t written = 0;
+    while (written < m_pending_count && record_write(&m_pending[written]))
+    {
+        written++;
+    }
+    m_pending_count -= written;
+    memmove(&m_pending[0], &m_pending[written], m_pending_count * sizeof(device_db_record_t));
+    if (m_pending_count > 0)
+    {
+        flash_manager_mem_listener_register(&mem_listener);
+    }
+}
+
+static void store_init(const void * p_flash_area)
+{
+    mp_flash_area = p_flash_area;
+    m_pending_count = 0;
+    flash_manager_add_retry();
+}
+
+static uint32_t record_store(const device_db_record_t * p_record)
+{
+    if (m_pending_count == 0 && record_write(p_record))
+    {
+        return NRF_SUCCESS;
+    }
+    if (m_pending_count >= DEVICE_DB_PENDING_COUNT)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_pending[m_pending_count++] = *p_record;
+    if (m_pending_count == 1)
+    {
+        pending_flush();
+    }
+    return NRF_SUCCESS;
+}
+
+static const device_db_record_t * record_get(uint16_t address)
+{
+    for (uint32_t i = 0; i < m_pending_count; i++)
+    {
+        if (m_pending[i].address == address)
+        {
+            return &m_pending[i];
+        }
+    }
+    const fm_entry_t * p_entry = flash_manager_entry_get(&m_flash_manager, DEVICE_DB_HANDLE(record_offset(address)));
+    if (p_entry == NULL || ((const device_db_record_t *) p_entry->data)->address != address)
+    {
+        return NULL;
+    }
+    return (const device_db_record_t *) p_entry->data;
+}
+
+#else
+
+/* Sem flash, os registros ficam em um vetor indexado pela posio no pool */
+static device_db_record_t m_records[PROVISIONER_ADDRESS_POOL_SIZE];
+
+static void store_init(const void * p_flash_area)
+{
+    memset(m_records, 0, sizeof(m_records));
+}
+
+static uint32_t record_store(const device_db_record_t * p_record)
+{
+    m_records[record_offset(p_record->address)] = *p_record;
+    return NRF_SUCCESS;
+}
+
+static const device_db_record_t * record_get(uint16_t address)
+{
+    const device_db_record_t * p_record = &m_records[record_offset(address)];
+    return (p_record->address == address) ? p_record : NULL;
+}
+
+#endif
+
+/*************************************************************************************************/
+/* Conjunto de trabalho na DSM */
+
+/* Posio do n no conjunto de trabalho; se ele no estiver l, a posio livre ou a usada h mais tempo */
+static device_db_dsm_entry_t * dsm_entry_find(uint16_t address)
+{
+    device_db_dsm_entry_t * p_victim = &m_dsm_entries[0];
+    for (uint32_t i = 0; i < PROVISIONER_DSM_DEVICE_COUNT; i++)
+    {
+        device_db_dsm_entry_t * p_entry = &m_dsm_entries[i];
+        if (p_entry->address == address)
+        {
+            return p_entry;
+        }
+        if (p_victim->address != NRF_MESH_ADDR_UNASSIGNED &&
+            (p_entry->address == NRF_MESH_ADDR_UNASSIGNED || p_entry->last_used < p_victim->last_used))
+        {
+            p_victim = p_entry;
+        }
+    }
+    return p_victim;
+}
+
+static void dsm_entry_evict(device_db_dsm_entry_t * p_entry)
+{
+    __LOG(LOG_SRC_APP, LOG_LEVEL_DBG1, "Device key of 0x%04x removed from the DSM\n", p_entry->address);
+    ERROR_CHECK(dsm_devkey_delete(p_entry->devkey_handle));
+    ERROR_CHECK(dsm_address_publish_remove(p_entry->address_handle));
+    p_entry->address = NRF_MESH_ADDR_UNASSIGNED;
+}
+
+/* Os ns do pool que esto na DSM restaurada entram no conjunto de trabalho, e os que no cabem nele saem da DSM */
+static void dsm_entries_restore(void)
+{
+    for (uint32_t i = 0; i < PROVISIONER_DSM_DEVICE_COUNT; i++)
+    {
+        m_dsm_entries[i].address = NRF_MESH_ADDR_UNASSIGNED;
+    }
+    m_use_count = 0;
+    if (mp_nw_data->address_base == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        return;
+    }
+
+    for (uint16_t offset = 0; offset < PROVISIONER_ADDRESS_POOL_SIZE; offset++)
+    {
+        uint16_t address = mp_nw_data->address_base + offset;
+        nrf_mesh_address_t mesh_address = {.type = NRF_MESH_ADDRESS_TYPE_UNICAST, .value = address};
+        device_db_dsm_entry_t entry = {.address = address, .devkey_handle = DSM_HANDLE_INVALID,
+                                       .address_handle = DSM_HANDLE_INVALID, .last_used = 0};
+        if (dsm_devkey_handle_get(address, &entry.devkey_handle) != NRF_SUCCESS ||
+            dsm_address_handle_get(&mesh_address, &entry.address_handle) != NRF_SUCCESS)
+        {
+            continue;
+        }
+        device_db_dsm_entry_t * p_entry = dsm_entry_find(address);
+        if (p_entry->address != NRF_MESH_ADDR_UNASSIGNED)
+        {
+            dsm_entry_evict(&entry);
+        }
+        else
+        {
+            *p_entry = entry;
+        }
+    }
+}
+
+/*************************************************************************************************/
+/* Funes pblicas */
+
+void device_db_init(const network_dsm_handles_data_volatile_t * p_dev_data,
+                    const network_stats_data_stored_t * p_nw_data,
+                    const void * p_flash_area)
+{
+    NRF_MESH_ASSERT(p_dev_data != NULL && p_nw_data != NULL);
+    mp_dev_data = p_dev_data;
+    mp_nw_data = p_nw_data;
+    store_init(p_flash_area);
+    dsm_entries_restore();
+}
+
+uint32_t device_db_add(uint16_t address, uint16_t elements, const uint8_t * p_devkey)
+{
+    if (record_offset(address) == PROVISIONER_ADDRESS_POOL_SIZE)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    device_db_record_t record;
+    record.address = address;
+    record.elements = elements;
+    memcpy(record.devkey, p_devkey, NRF_MESH_KEY_SIZE);
+
+    /* Um n provisionado de novo no mesmo endereo no pode ficar com a chave antiga na DSM */
+    device_db_dsm_entry_t * p_entry = dsm_entry_find(address);
+    if (p_entry->address == address)
+    {
+        dsm_entry_evict(p_entry);
+    }
+    return record_store(&record);
+}
+
+uint32_t device_db_handles_get(uint16_t address, dsm_handle_t * p_devkey_handle, dsm_handle_t * p_address_handle)
+{
+    device_db_dsm_entry_t * p_entry = dsm_entry_find(address);
+    if (p_entry->address != address)
+    {
+        if (record_offset(address) == PROVISIONER_ADDRESS_POOL_SIZE)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        const device_db_record_t * p_record = record_get(address);
+        if (p_record == NULL)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        if (p_entry->address != NRF_MESH_ADDR_UNASSIGNED)
+        {
+            dsm_entry_evict(p_entry);
+        }
+
+        uint32_t status = dsm_address_publish_add(address, &p_entry->address_handle);
+        if (status != NRF_SUCCESS)
+        {
+            return status;
+        }
+        status = dsm_devkey_add(address, mp_dev_data->m_netkey_handle, p_record->devkey, &p_entry->devkey_handle);
+        if (status != NRF_SUCCESS)
+        {
+            ERROR_CHECK(dsm_address_publish_remove(p_entry->address_handle));
+            return status;
+        }
+        p_entry->address = address;
+        __LOG(LOG_SRC_APP, LOG_LEVEL_DBG1, "Device key of 0x%04x loaded: devkey_handle: %d addr_handle: %d\n",
+              address, p_entry->devkey_handle, p_entry->address_handle);
+    }
+
+    p_entry->last_used = ++m_use_count;
+    *p_devkey_handle = p_entry->devkey_handle;
+    *p_address_handle = p_entry->address_handle;
+    return NRF_SUCCESS;
+}
+
+uint16_t device_db_elements_get(uint16_t address)
+{
+    if (record_offset(address) == PROVISIONER_ADDRESS_POOL_SIZE)
+    {
+        return 0;
+    }
+    const device_db_record_t * p_record = record_get(address);
+    return (p_record != NULL) ? p_record->elements : 0;
+}
@@ -19,6 +19,7 @@
 /* Provisioning and configuration */
 #include "provisioner_helper.h"
 #include "node_setup.h"
+#include "device_db.h"
 #include "mesh_app_utils.h"
 #include "mesh_softdevice_init.h"
 
@@ -36,18 +37,21 @@
 #include "simple_smart_city_example_common.h"
 #include "example_network_config.h"
 #include "nrf_mesh_config_examples.h"
-#include "app_timer.h"
+#if PERSISTENT_STORAGE
+#include "network_journal.h"
+#endif
 
-#define APP_NETWORK_STATE_ENTRY_HANDLE (0x0001)
+#define APP_COMPOSITION_ENTRY_HANDLE_BASE (0x0010) // uma entrada por posio do cache de composio
 #define APP_FLASH_PAGE_COUNT           (1)
 
-#define PROV_START_DELAY APP_TIMER_TICKS(5000) // O provisionamento iniciar aps cinco segundos
-
-APP_TIMER_DEF(m_timer_id);
+#if SMART_CITY_DEVICE_COUNT > PROVISIONER_ADDRESS_POOL_SIZE
+#error SMART_CITY_DEVICE_COUNT devices do not fit in the address pool
+#endif
 
 /* Required for the provisioner helper module */
 static network_dsm_handles_data_volatile_t m_dev_handles;
 static network_stats_data_stored_t m_nw_state;
+static composition_data_stored_t m_composition_cache[PROVISIONER_COMPOSITION_CACHE_SIZE];
 
 static const uint8_t m_device_uuid_filter[SMART_CITY_NODE_UUID_PREFIX_SIZE] = SMART_CITY_NODE_UUID_PREFIX;
 static prov_helper_uuid_filter_t m_exp_uuid;
@@ -55,18 +59,80 @@ static bool m_node_prov_setup_started;
 
 /* Forward declarations */
 static void app_health_event_cb(const health_client_t * p_client, const health_client_evt_t * p_event);
-static void app_config_successful_cb(void);
-static void app_config_failed_cb(void);
+static void app_config_successful_cb(uint16_t address);
+static void app_config_failed_cb(uint16_t address);
 static void app_mesh_core_event_cb (const nrf_mesh_evt_t * p_evt);
 
 static void app_start(void);
 
 static nrf_mesh_evt_handler_t m_mesh_core_event_handler = { .evt_cb = app_mesh_core_event_cb };
 
+/*****************************************************************************/
+/**** Network state ****/
+
+static bool address_map_test(const uint32_t * p_map, uint16_t bit)
+{
+    return (p_map[bit / 32] & (1u << (bit % 32))) != 0;
+}
+
+static void address_map_set(uint32_t * p_map, uint16_t address, uint16_t count)
+{
+    for (uint16_t bit = address - m_nw_state.address_base; count > 0 && bit < PROVISIONER_ADDRESS_POOL_SIZE; bit++, count--)
+    {
+        p_map[bit / 32] |= 1u << (bit % 32);
+    }
+}
+
+static void address_map_clear(uint32_t * p_map, uint16_t address, uint16_t count)
+{
+    for (uint16_t bit = address - m_nw_state.address_base; count > 0 && bit < PROVISIONER_ADDRESS_POOL_SIZE; bit++, count--)
+    {
+        p_map[bit / 32] &= ~(1u << (bit % 32));
+    }
+}
+
+/* Aplica uma mudana ao estado da rede: as do journal, na restaurao, e a configurao de um n */
+static void network_state_change_apply(network_state_change_t change, uint16_t address, uint16_t count)
+{
+    switch (change)
+    {
+        case NETWORK_STATE_CHANGE_ADDRESS_POOL:
+            m_nw_state.address_base = address;
+            memset(m_nw_state.address_map, 0x00, sizeof(m_nw_state.address_map));
+            memset(m_nw_state.configured_map, 0x00, sizeof(m_nw_state.configured_map));
+            break;
+
+        case NETWORK_STATE_CHANGE_DEVICE_PROVISIONED:
+            address_map_set(m_nw_state.address_map, address, count);
+            m_nw_state.last_device_address = address;
+            m_nw_state.provisioned_devices++;
+            break;
+
+        case NETWORK_STATE_CHANGE_DEVICE_CONFIGURED:
+            address_map_set(m_nw_state.configured_map, address, 1);
+            m_nw_state.configured_devices++;
+            break;
+
+        case NETWORK_STATE_CHANGE_DEVICE_REMOVED:
+            address_map_clear(m_nw_state.address_map, address, count);
+            address_map_clear(m_nw_state.configured_map, address, 1);
+            m_nw_state.provisioned_devices--;
+            m_nw_state.configured_devices--;
+            break;
+
+        default:
+            break;
+    }
+}
+
 /*****************************************************************************/
 /**** Flash handling ****/
 #if PERSISTENT_STORAGE
 
+/* A rea da aplicao fica abaixo da rea do acesso, e a da base de dispositivos abaixo dela */
+#define APP_FLASH_AREA       (((const uint8_t *) dsm_flash_area_get()) - (ACCESS_FLASH_PAGE_COUNT * PAGE_SIZE * 2))
+#define DEVICE_DB_FLASH_AREA (APP_FLASH_AREA - (DEVICE_DB_FLASH_PAGE_COUNT * PAGE_SIZE))
+
 static flash_manager_t m_flash_manager;
 
 static void app_flash_manager_add(void);
@@ -116,7 +182,7 @@ static void app_flash_manager_add(void)
     manager_config.invalidate_complete_cb = flash_invalidate_complete;
     manager_config.remove_complete_cb = flash_remove_complete;
     manager_config.min_available_space = WORD_SIZE;
-    manager_config.p_area = (const flash_manager_page_t *) (((const uint8_t *) dsm_flash_area_get()) - (ACCESS_FLASH_PAGE_COUNT * PAGE_SIZE * 2));
+    manager_config.p_area = (const flash_manager_page_t *) APP_FLASH_AREA;
     manager_config.page_count = APP_FLASH_PAGE_COUNT;
     uint32_t status = flash_manager_add(&m_flash_manager, &manager_config);
     if (NRF_SUCCESS != status)
@@ -129,42 +195,67 @@ static void app_flash_manager_add(void)
 static bool load_app_data(void)
 {
     flash_manager_wait();
-    const fm_entry_t * p_entry = flash_manager_entry_get(&m_flash_manager, APP_NETWORK_STATE_ENTRY_HANDLE);
-    if (p_entry == NULL)
+    return network_journal_load();
+}
+
+/* O estado inteiro e as mudanas dele so gravados pelo journal (network_journal.h) */
+static uint32_t store_app_data(void)
+{
+    return network_journal_state_store();
+}
+
+static void journal_append(network_state_change_t change, uint16_t address, uint16_t count)
+{
+    network_journal_append(change, address, count);
+}
+
+static void load_composition_cache(void)
+{
+    for (uint32_t i = 0; i < PROVISIONER_COMPOSITION_CACHE_SIZE; i++)
     {
-        memset(&m_nw_state, 0x00, sizeof(m_nw_state));
-        return false;
+        const fm_entry_t * p_entry = flash_manager_entry_get(&m_flash_manager, APP_COMPOSITION_ENTRY_HANDLE_BASE + i);
+        if (p_entry == NULL)
+        {
+            memset(&m_composition_cache[i], 0x00, sizeof(m_composition_cache[i]));
+        }
+        else
+        {
+            memcpy(&m_composition_cache[i], p_entry->data, sizeof(m_composition_cache[i]));
+        }
     }
-
-    memcpy(&m_nw_state, p_entry->data, sizeof(m_nw_state));
-    return true;
 }
 
-static uint32_t store_app_data(void)
+/* Grava as entradas preenchidas do cache de composio. S  chamada quando um tipo novo de dispositivo aparece */
+static void store_composition_cache(void)
 {
-    fm_entry_t * p_entry = flash_manager_entry_alloc(&m_flash_manager, APP_NETWORK_STATE_ENTRY_HANDLE, sizeof(m_nw_state));
     static fm_mem_listener_t flash_add_mem_available_struct = {
         .callback = flash_manager_mem_available,
-        .p_args = store_app_data
+        .p_args = store_composition_cache
     };
 
-    if (p_entry == NULL)
+    for (uint32_t i = 0; i < PROVISIONER_COMPOSITION_CACHE_SIZE; i++)
     {
-        flash_manager_mem_listener_register(&flash_add_mem_available_struct);
-    }
-    else
-    {
-        network_stats_data_stored_t * p_nw_state = (network_stats_data_stored_t *) p_entry->data;
-        memcpy(p_nw_state, &m_nw_state, sizeof(m_nw_state));
+        if (m_composition_cache[i].length == 0)
+        {
+            continue;
+        }
+        fm_entry_t * p_entry = flash_manager_entry_alloc(&m_flash_manager, APP_COMPOSITION_ENTRY_HANDLE_BASE + i,
+                                                         sizeof(m_composition_cache[i]));
+        if (p_entry == NULL)
+        {
+            flash_manager_mem_listener_register(&flash_add_mem_available_struct);
+            return;
+        }
+        memcpy(p_entry->data, &m_composition_cache[i], sizeof(m_composition_cache[i]));
         flash_manager_entry_commit(p_entry);
     }
-
-    return NRF_SUCCESS;
 }
 
 static void clear_app_data(void)
 {
     memset(&m_nw_state, 0x00, sizeof(m_nw_state));
+    memset(m_composition_cache, 0x00, sizeof(m_composition_cache));
+    network_journal_clear();
 
     if (flash_manager_remove(&m_flash_manager) != NRF_SUCCESS)
     {
@@ -177,7 +268,12 @@ static void clear_app_data(void)
 
 #else
 
-static void clear_app_data(void)
+static void load_composition_cache(void)
+{
+    return;
+}
+
+static void store_composition_cache(void)
 {
     return;
 }
@@ -191,50 +287,56 @@ static uint32_t store_app_data(void)
     return NRF_SUCCESS;
 }
 
+static void journal_append(network_state_change_t change, uint16_t address, uint16_t count)
+{
+    return;
+}
+
 #endif
 
 
-static void app_data_store_cb(void)
+static void app_data_store_cb(network_state_change_t change, uint16_t address, uint16_t count)
 {
-    ERROR_CHECK(store_app_data());
+    journal_append(change, address, count);
+}
+
+static void app_composition_store_cb(void)
+{
+    store_composition_cache();
 }
 
 /*****************************************************************************/
 /**** Configuration process related callbacks ****/
 
-static void app_config_successful_cb(void)
+static void app_config_successful_cb(uint16_t address)
 {
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configuration of device %u successful\n", m_nw_state.configured_devices);
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configuration of device %u (0x%04x) successful\n", m_nw_state.configured_devices, address);
 
-    m_nw_state.configured_devices++;
-    access_flash_config_store();
-    ERROR_CHECK(store_app_data());
+    /* A configurao de outro n no muda o estado de acesso local; as chaves e endereos da DSM so gravados por ela */
+    network_state_change_apply(NETWORK_STATE_CHANGE_DEVICE_CONFIGURED, address, 0);
+    journal_append(NETWORK_STATE_CHANGE_DEVICE_CONFIGURED, address, 0);
 
-    if (m_nw_state.configured_devices < SMART_CITY_DEVICE_COUNT)
-    {
-        m_exp_uuid.p_uuid = m_device_uuid_filter;
-        m_exp_uuid.length = SMART_CITY_NODE_UUID_PREFIX_SIZE;
-        prov_helper_provision_next_device(PROVISIONER_RETRY_COUNT, m_nw_state.next_device_address, &m_exp_uuid);
-        prov_helper_scan_start();
-    }
-    else
+    /* Provisioning goes on in parallel; only the next configuration is started here */
+    prov_helper_config_done(address, true);
+
+    if (m_nw_state.configured_devices >= SMART_CITY_DEVICE_COUNT)
     {
         __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "All servers provisioned\n");
     }
 }
 
-static void prov_retry(void)
+static void app_config_failed_cb(uint16_t address)
 {
-    uint32_t err_code;
-    err_code = app_timer_start(m_timer_id,PROV_START_DELAY,NULL);
-    APP_ERROR_CHECK(err_code);
-}
-
-static void app_config_failed_cb(void)
-{
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configuration of device %u failed. Retrying in five seconds \n", m_nw_state.configured_devices);
-    prov_retry();
-    m_node_prov_setup_started = false;
+    if (prov_helper_config_done(address, false))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configuration of device 0x%04x failed. Retrying after the devices already waiting \n", address);
+    }
+    else
+    {
+        /* Fica provisionado e sem configurao;  colocado na fila de novo quando o provisionador reinicia */
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Configuration of device 0x%04x failed %d times. Device left unconfigured\n",
+              address, PROVISIONER_CONFIG_RETRY_COUNT + 1);
+    }
 }
 
 static void app_prov_success_cb(void)
@@ -244,9 +346,7 @@ static void app_prov_success_cb(void)
 
 static void app_prov_failed_cb(void)
 {
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning failed. Retrying in five seconds \n");
-    prov_retry();
-    m_node_prov_setup_started = false;
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning failed. Retrying on the next beacon of the device \n");
 }
 
 
@@ -294,26 +394,35 @@ static void app_config_client_event_cb(config_client_event_type_t event_type, co
 
 /** Check if all devices have been provisioned. If not, provision remaining devices.
  *  Check if all devices have been configured. If not, start configuring them.
+ *  Both run at the same time: provisioned devices are configured while the next ones are provisioned.
  */
 static void check_network_state(void)
 {
     if (!m_node_prov_setup_started)
     {
-        /* If previously provisioned device is not configured, start node setup procedure. */
+        /* Os ns provisionados antes do reset e ainda no configurados voltam  fila de configurao: cada endereo do
+         * pool que  de um n, mas no est no mapa dos configurados, e que  o primeiro do n na base */
         if (m_nw_state.configured_devices < m_nw_state.provisioned_devices)
         {
-            /* Execute configuration */
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Waiting for provisioned node to be configured ...\n");
-            node_setup_start(m_nw_state.last_device_address, PROVISIONER_RETRY_COUNT,
-                            m_nw_state.appkey, APPKEY_INDEX);
+            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Waiting for %u provisioned nodes to be configured ...\n",
+                  m_nw_state.provisioned_devices - m_nw_state.configured_devices);
+            for (uint16_t bit = 0; bit < PROVISIONER_ADDRESS_POOL_SIZE; bit++)
+            {
+                uint16_t address = m_nw_state.address_base + bit;
+                if (address_map_test(m_nw_state.address_map, bit) && !address_map_test(m_nw_state.configured_map, bit) &&
+                    device_db_elements_get(address) > 0)
+                {
+                    prov_helper_config_enqueue(address);
+                }
+            }
         }
-        else if (m_nw_state.provisioned_devices < SMART_CITY_DEVICE_COUNT)
+        if (m_nw_state.provisioned_devices < SMART_CITY_DEVICE_COUNT)
         {
             /* Start provisioning - rest of the devices */
             m_exp_uuid.p_uuid = m_device_uuid_filter;
             m_exp_uuid.length = SMART_CITY_NODE_UUID_PREFIX_SIZE;
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Waiting for device to be provisioned ...\n");
-            prov_helper_provision_next_device(PROVISIONER_RETRY_COUNT, m_nw_state.next_device_address, &m_exp_uuid);
+            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Waiting for devices to be provisioned ...\n");
+            prov_helper_provision_devices(PROVISIONER_RETRY_COUNT, SMART_CITY_DEVICE_COUNT, &m_exp_uuid);
             prov_helper_scan_start();
         }
         m_node_prov_setup_started = true;
@@ -368,13 +477,18 @@ static bool app_flash_config_load(void)
     bool app_load = false;
 #if PERSISTENT_STORAGE
     app_flash_manager_add();
+    network_journal_init(&m_flash_manager, &m_nw_state, network_state_change_apply);
     app_load = load_app_data();
 #endif
+    load_composition_cache();
     if (!app_load)
     {
         m_nw_state.provisioned_devices = 0;
         m_nw_state.configured_devices = 0;
-        m_nw_state.next_device_address = UNPROV_START_ADDRESS;
+        /* The address pool is set up by the provisioner helper, once the device key is known */
+        m_nw_state.address_base = NRF_MESH_ADDR_UNASSIGNED;
+        memset(m_nw_state.address_map, 0x00, sizeof(m_nw_state.address_map));
+        memset(m_nw_state.configured_map, 0x00, sizeof(m_nw_state.configured_map));
         ERROR_CHECK(store_app_data());
     }
     else
@@ -384,23 +498,6 @@ static bool app_flash_config_load(void)
     return app_load;
 }
 
-static void timer_handler(void * p_context)
-{
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisionamento iniciado\n");
-    check_network_state();
-}
-
-static void timer_init(void)
-{
-    ret_code_t err_code;
-    // inicializa o temporizador
-    err_code = app_timer_init();
-    APP_ERROR_CHECK(err_code);
-    // cria o temporizador
-    err_code = app_timer_create(&m_timer_id,APP_TIMER_MODE_SINGLE_SHOT,timer_handler);
-    APP_ERROR_CHECK(err_code);
-}
-
 void models_init_cb(void)
 {
     __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Initializing and adding models\n");
@@ -431,6 +528,11 @@ static void mesh_init(void)
 
     /* Load application configuration, if available */
     m_dev_handles.flash_load_success = app_flash_config_load();
+#if PERSISTENT_STORAGE
+    device_db_init(&m_dev_handles, &m_nw_state, DEVICE_DB_FLASH_AREA);
+#else
+    device_db_init(&m_dev_handles, &m_nw_state, NULL);
+#endif
 
     /* Initialize the provisioner */
     mesh_provisioner_init_params_t m_prov_helper_init_info =
@@ -451,7 +553,7 @@ static void mesh_init(void)
         prov_helper_provision_self();
         app_default_models_bind_setup();
         access_flash_config_store();
-        app_data_store_cb();
+        ERROR_CHECK(store_app_data());
     }
     else
     {
@@ -460,6 +562,7 @@ static void mesh_init(void)
     }
 
     node_setup_cb_set(app_config_successful_cb, app_config_failed_cb);
+    node_setup_composition_cache_set(m_composition_cache, app_composition_store_cb);
 }
 
 static void initialize(void)
@@ -475,15 +578,16 @@ static void initialize(void)
 
 static void app_start(void)
 {
-    m_nw_state.next_device_address=((m_nw_state.self_devkey[1]<<8)+m_nw_state.self_devkey[0])&0x7fff;
     __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Starting application ...\n");
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisoned Nodes: %d, Configured Nodes: %d Next Address: 0x%04x\n",
-          m_nw_state.provisioned_devices, m_nw_state.configured_devices, m_nw_state.next_device_address);
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisoned Nodes: %d, Configured Nodes: %d Address pool: 0x%04x\n",
+          m_nw_state.provisioned_devices, m_nw_state.configured_devices, m_nw_state.address_base);
     __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "Dev key ", m_nw_state.self_devkey, NRF_MESH_KEY_SIZE);
     __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "Net key ", m_nw_state.netkey, NRF_MESH_KEY_SIZE);
     __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "App key ", m_nw_state.appkey, NRF_MESH_KEY_SIZE);
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning will start in five seconds\n");
-    prov_retry();
+    /* O provisionamento comea assim que a flash est estvel; as novas tentativas de cada dispositivo so espaadas
+     * pelo provisioner helper */
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisionamento iniciado\n");
+    check_network_state();
 }
 
 static void start(void)
@@ -499,7 +603,6 @@ static void start(void)
 int main(void)
 {
     initialize();
-    timer_init();
     execution_start(start);
 
     for (;;)
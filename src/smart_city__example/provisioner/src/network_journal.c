@@ -0,0 +1,142 @@
+#include "network_journal.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "nrf_mesh_assert.h"
+#include "mesh_app_utils.h"
+#include "log.h"
+
+/** Registro do journal: uma mudana do estado da rede. Com o cabealho do flash_manager, ocupa trs palavras */
+typedef struct
+{
+    uint32_t seq;
+    uint16_t address;
+    uint8_t  count;
+    uint8_t  change;    /** network_state_change_t */
+} network_journal_record_t;
+
+static flash_manager_t * mp_flash_manager;
+static network_stats_data_stored_t * mp_nw_state;
+static network_journal_apply_cb_t m_apply_cb;
+
+static uint32_t m_journal_next;     /** Sequncia do prximo registro */
+static bool m_state_pending;        /** O estado inteiro espera espao na flash para ser gravado */
+
+static void flash_mem_available(void * p_args)
+{
+    ((void (*)(void)) p_args)(); /*lint !e611 Suspicious cast */
+}
+
+static void state_store_retry(void)
+{
+    (void) network_journal_state_store();
+}
+
+/* Aplica os registros posteriores ao estado gravado. O journal termina na primeira posio sem registro, ou com um
+ * registro de antes da ltima compactao */
+static void journal_replay(void)
+{
+    m_journal_next = mp_nw_state->journal_seq;
+    for (uint32_t i = 0; i < NETWORK_JOURNAL_SIZE; i++)
+    {
+        const fm_entry_t * p_entry = flash_manager_entry_get(mp_flash_manager, NETWORK_JOURNAL_HANDLE(m_journal_next));
+        if (p_entry == NULL)
+        {
+            break;
+        }
+        const network_journal_record_t * p_record = (const network_journal_record_t *) p_entry->data;
+        if (p_record->seq != m_journal_next)
+        {
+            break;
+        }
+        m_apply_cb((network_state_change_t) p_record->change, p_record->address, p_record->count);
+        m_journal_next++;
+    }
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Restored: %u journal records\n", m_journal_next - mp_nw_state->journal_seq);
+}
+
+void network_journal_init(flash_manager_t * p_flash_manager, network_stats_data_stored_t * p_nw_state,
+                          network_journal_apply_cb_t apply_cb)
+{
+    NRF_MESH_ASSERT(p_flash_manager != NULL && p_nw_state != NULL && apply_cb != NULL);
+    mp_flash_manager = p_flash_manager;
+    mp_nw_state = p_nw_state;
+    m_apply_cb = apply_cb;
+    network_journal_clear();
+}
+
+bool network_journal_load(void)
+{
+    m_state_pending = false;
+    const fm_entry_t * p_entry = flash_manager_entry_get(mp_flash_manager, NETWORK_JOURNAL_STATE_HANDLE);
+    if (p_entry == NULL)
+    {
+        memset(mp_nw_state, 0x00, sizeof(*mp_nw_state));
+        m_journal_next = 0;
+        return false;
+    }
+
+    memcpy(mp_nw_state, p_entry->data, sizeof(*mp_nw_state));
+    journal_replay();
+    return true;
+}
+
+uint32_t network_journal_state_store(void)
+{
+    static fm_mem_listener_t mem_listener = {
+        .callback = flash_mem_available,
+        .p_args = state_store_retry
+    };
+
+    fm_entry_t * p_entry = flash_manager_entry_alloc(mp_flash_manager, NETWORK_JOURNAL_STATE_HANDLE, sizeof(*mp_nw_state));
+    if (p_entry == NULL)
+    {
+        m_state_pending = true;
+        flash_manager_mem_listener_register(&mem_listener);
+    }
+    else
+    {
+        mp_nw_state->journal_seq = m_journal_next;
+        memcpy(p_entry->data, mp_nw_state, sizeof(*mp_nw_state));
+        flash_manager_entry_commit(p_entry);
+        m_state_pending = false;
+    }
+
+    return NRF_SUCCESS;
+}
+
+void network_journal_append(network_state_change_t change, uint16_t address, uint16_t count)
+{
+    if (m_state_pending)
+    {
+        /* O estado inteiro ainda ser gravado, j com esta mudana */
+        return;
+    }
+
+    fm_entry_t * p_entry = NULL;
+    if (m_journal_next - mp_nw_state->journal_seq < NETWORK_JOURNAL_SIZE)
+    {
+        p_entry = flash_manager_entry_alloc(mp_flash_manager, NETWORK_JOURNAL_HANDLE(m_journal_next),
+                                            sizeof(network_journal_record_t));
+    }
+    if (p_entry == NULL)
+    {
+        ERROR_CHECK(network_journal_state_store());
+        return;
+    }
+
+    network_journal_record_t * p_record = (network_journal_record_t *) p_entry->data;
+    p_record->seq = m_journal_next++;
+    p_record->address = address;
+    p_record->count = (uint8_t) count;
+    p_record->change = (uint8_t) change;
+    flash_manager_entry_commit(p_entry);
+}
+
+void network_journal_clear(void)
+{
+    m_journal_next = 0;
+    m_state_pending = false;
+}
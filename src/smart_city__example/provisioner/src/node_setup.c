@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 #include "nrf_mesh_utils.h"
 #include "device_state_manager.h"
@@ -15,6 +16,7 @@
 #include "composition_data.h"
 
 #include "node_setup.h"
+#include "device_db.h"
 #include "example_network_config.h"
 #include "simple_smart_city_example_common.h"
 #include "mesh_app_utils.h"
@@ -39,22 +41,23 @@ typedef enum
     NODE_SETUP_DONE,
 } config_steps_t;
 
-/* Structure to hold the composition data */
+/* Model index entry, built from the composition data */
 typedef struct
 {
-    uint16_t    len;
-    struct
-    {
-        uint8_t page_number;
-        uint8_t data[NRF_MESH_SEG_PAYLOAD_SIZE_MAX];
-    }composition;
-} composition_data_t;
-
-/* Expected status structure, used for setup state machine */
+    uint16_t element_address;
+    access_model_id_t model_id;
+    bool vendor;
+} node_setup_model_t;
+
+/* Expected status structure, used for setup state machine. The element address and model ID of the request are
+ * checked too, in the statuses that carry them, so that a late status of a cancelled request is not taken as the
+ * reply of another. */
 typedef struct
 {
     uint8_t  num_statuses;
     uint16_t expected_opcode;
+    uint16_t element_address;
+    access_model_id_t model_id;
     const uint8_t  * p_statuses;
 } expected_status_list_t;
 
@@ -68,9 +71,25 @@ typedef enum
 {
     STATUS_CHECK_PASS,
     STATUS_CHECK_FAIL,
-    STATUS_CHECK_UNEXPECTED_OPCODE
+    STATUS_CHECK_UNEXPECTED_OPCODE,
+    STATUS_CHECK_UNEXPECTED_TARGET
 } status_check_t;
 
+/* Configurao de um n. As sesses avanam de forma independente; o cliente de configurao s aceita um pedido
+ * pendente, e atende uma sesso de cada vez, em rodzio */
+typedef struct
+{
+    uint16_t address;                   /* NRF_MESH_ADDR_UNASSIGNED: sesso livre */
+    uint16_t retry_count;
+    const config_steps_t * p_step;
+    expected_status_list_t expected_status;
+    node_setup_model_t models[NODE_SETUP_MODEL_INDEX_SIZE];     /* Todos os modelos do n, elemento por elemento */
+    uint8_t model_count;
+    uint8_t model_next;                 /* Prxima entrada de models a examinar */
+    const node_setup_model_t * p_model; /* Modelo de cidade inteligente sendo configurado */
+    bool composition_cached;            /* O ndice dos modelos foi montado com a composio do cache */
+} node_setup_session_t;
+
 /* USER_NOTE:
 You can define one or more such configuration steps for a given node in your network. The choice
 of the steps can be done in @ref setup_select_steps() function.
@@ -94,39 +113,41 @@ static const config_steps_t smart_city_models_config_steps[]=
     NODE_SETUP_DONE
 };
 
-static uint16_t m_current_node_addr;
-static composition_data_t m_node_composition;
-static uint16_t m_retry_count;
+static const config_steps_t m_idle_step = NODE_SETUP_IDLE;
+static node_setup_session_t m_sessions[NODE_SETUP_SESSION_COUNT];
+static node_setup_session_t * mp_active;    /* Sesso com pedido pendente no cliente de configurao */
+static uint32_t m_next_session;
 static client_send_retry_t m_send_timer;
+static timer_event_t m_request_timer;
 static const uint8_t * mp_appkey;
 static uint16_t m_appkey_idx;
-static uint8_t current_model_count;
-static access_model_id_t* current_model_id=NULL;
-static config_composition_element_header_t * element_header=NULL;
 
-static const config_steps_t m_idle_step = NODE_SETUP_IDLE;
-static const config_steps_t * mp_config_step = &m_idle_step;
 static node_setup_successful_cb_t m_node_setup_success_cb;
 static node_setup_failed_cb_t m_node_setup_failed_cb;
-static expected_status_list_t m_expected_status_list;
-static bool m_status_checked;
+
+static composition_data_stored_t * mp_composition_cache;
+static node_setup_composition_store_cb_t m_composition_store_cb;
 
 /* Forward declaration */
-static void config_step_execute(void);
+static void config_step_execute(node_setup_session_t * p_session);
+static void request_next(void);
 
 /*************************************************************************************************/
-/* Set expected status opcode and acceptable value of status codes */
-static void expected_status_set(uint32_t opcode, uint32_t n, const uint8_t * p_list)
+/* Set expected status opcode, target and acceptable value of status codes. For statuses without element address,
+ * element_address is NRF_MESH_ADDR_UNASSIGNED. */
+static void expected_status_set(node_setup_session_t * p_session, uint32_t opcode, uint16_t element_address,
+                                access_model_id_t model_id, uint32_t n, const uint8_t * p_list)
 {
     if (n > 0)
     {
         NRF_MESH_ASSERT(p_list != NULL);
     }
 
-    m_expected_status_list.expected_opcode = opcode;
-    m_expected_status_list.num_statuses = n;
-    m_expected_status_list.p_statuses = p_list;
-    m_status_checked = false;
+    p_session->expected_status.expected_opcode = opcode;
+    p_session->expected_status.element_address = element_address;
+    p_session->expected_status.model_id = model_id;
+    p_session->expected_status.num_statuses = n;
+    p_session->expected_status.p_statuses = p_list;
 }
 
 /* setup retry timer, if client model is busy sending a previous message */
@@ -152,24 +173,50 @@ static void client_send_timer_cb(timestamp_t timestamp, void * p_context)
     timer_sch_abort(&m_send_timer.timer);
 
     /* retry the last step */
-    config_step_execute();
+    if (mp_active != NULL)
+    {
+        config_step_execute(mp_active);
+    }
+}
+
+/* Compara o ID de modelo de um status, no formato da rede, com o esperado */
+static bool status_model_id_match(const void * p_model_id, uint16_t length, access_model_id_t model_id)
+{
+    uint16_t raw[2];
+    uint16_t size;
+    if (model_id.company_id == ACCESS_COMPANY_ID_NONE)
+    {
+        raw[0] = model_id.model_id;
+        size = sizeof(uint16_t);
+    }
+    else
+    {
+        raw[0] = model_id.company_id;
+        raw[1] = model_id.model_id;
+        size = 2 * sizeof(uint16_t);
+    }
+    return length >= size && memcmp(p_model_id, raw, size) == 0;
 }
 
 /**
- *  When config client status message is received, this function checks for the expected opcode, and
+ *  When config client status message is received, this function checks for the expected opcode, target and
  *  status values. It is required by the node setup state machine.
  */
-static status_check_t check_expected_status(uint16_t rx_opcode, const config_msg_t * p_msg)
+static status_check_t check_expected_status(const node_setup_session_t * p_session, uint16_t rx_opcode,
+                                             const config_msg_t * p_msg, uint16_t length)
 {
+    const expected_status_list_t * p_expected = &p_session->expected_status;
     uint8_t status = 0xFF;
-    if (rx_opcode != m_expected_status_list.expected_opcode)
+    uint16_t element_address = NRF_MESH_ADDR_UNASSIGNED;
+    const void * p_model_id = NULL;
+    uint16_t model_id_offset = 0;
+    if (rx_opcode != p_expected->expected_opcode)
     {
         __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Unexpected opcode: exp 0x%04x  rx 0x%04x\n",
-              m_expected_status_list.expected_opcode, rx_opcode);
+              p_expected->expected_opcode, rx_opcode);
         return STATUS_CHECK_UNEXPECTED_OPCODE;
     }
 
-    m_status_checked = true;
     switch (rx_opcode)
     {
         /* COMPOSITION_DATA_STATUS does not have a STATUS field */
@@ -178,14 +225,23 @@ static status_check_t check_expected_status(uint16_t rx_opcode, const config_msg
 
         case CONFIG_OPCODE_MODEL_APP_STATUS:
             status = p_msg->app_status.status;
+            element_address = p_msg->app_status.element_address;
+            p_model_id = &p_msg->app_status.model_id;
+            model_id_offset = offsetof(config_msg_app_status_t, model_id);
             break;
 
         case CONFIG_OPCODE_MODEL_PUBLICATION_STATUS:
             status = p_msg->publication_status.status;
+            element_address = p_msg->publication_status.element_address;
+            p_model_id = &p_msg->publication_status.model_id;
+            model_id_offset = offsetof(config_msg_publication_status_t, model_id);
             break;
 
         case CONFIG_OPCODE_MODEL_SUBSCRIPTION_STATUS:
             status = p_msg->subscription_status.status;
+            element_address = p_msg->subscription_status.element_address;
+            p_model_id = &p_msg->subscription_status.model_id;
+            model_id_offset = offsetof(config_msg_subscription_status_t, model_id);
             break;
 
         case CONFIG_OPCODE_APPKEY_STATUS:
@@ -199,14 +255,23 @@ static status_check_t check_expected_status(uint16_t rx_opcode, const config_msg
             break;
     }
 
-    if (m_expected_status_list.num_statuses == 0)
+    if (p_expected->element_address != NRF_MESH_ADDR_UNASSIGNED &&
+        (element_address != p_expected->element_address ||
+         !status_model_id_match(p_model_id, length > model_id_offset ? length - model_id_offset : 0, p_expected->model_id)))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Unexpected target: exp 0x%04x  rx 0x%04x\n",
+              p_expected->element_address, element_address);
+        return STATUS_CHECK_UNEXPECTED_TARGET;
+    }
+
+    if (p_expected->num_statuses == 0)
     {
         return STATUS_CHECK_PASS;
     }
     __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "opcode status field: %d \n", status);
-    for(uint32_t i = 0; i<m_expected_status_list.num_statuses; i++)
+    for(uint32_t i = 0; i<p_expected->num_statuses; i++)
     {
-        if (status == m_expected_status_list.p_statuses[i])
+        if (status == p_expected->p_statuses[i])
         {
             return STATUS_CHECK_PASS;
         }
@@ -222,20 +287,26 @@ node in your network.
 */
 /**
  * Selects the configuration steps for the node.
- * @param[in]  addr    Address of the device being configured.
+ * @param[in]  p_session            Session of the device being configured.
+ * @param[in]  composition_known    The composition data of the node was taken from the cache.
  *
  */
-static void setup_select_steps(uint16_t addr)
+static void setup_select_steps(node_setup_session_t * p_session, bool composition_known)
 {
-    mp_config_step = smart_city_device_config_steps;
+    p_session->p_step = smart_city_device_config_steps;
+    // Com a composio do tipo j conhecida, a leitura  pulada
+    if (composition_known && *p_session->p_step == NODE_SETUP_CONFIG_COMPOSITION_GET)
+    {
+        p_session->p_step++;
+    }
 }
 
 
 /** Step execution function for the configuration state machine. */
-static void config_step_execute(void)
+static void config_step_execute(node_setup_session_t * p_session)
 {
-    uint32_t status;
-    switch (*mp_config_step)
+    access_model_id_t no_model = {ACCESS_COMPANY_ID_NONE, 0};
+    switch (*p_session->p_step)
     {
         /* Read the composition data from the node: */
         case NODE_SETUP_CONFIG_COMPOSITION_GET:
@@ -243,7 +314,7 @@ static void config_step_execute(void)
             __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Getting composition data\n");
             retry_on_fail(config_client_composition_data_get(0x00));
 
-            expected_status_set(CONFIG_OPCODE_COMPOSITION_DATA_STATUS, 0, NULL);
+            expected_status_set(p_session, CONFIG_OPCODE_COMPOSITION_DATA_STATUS, NRF_MESH_ADDR_UNASSIGNED, no_model, 0, NULL);
             break;
         }
 
@@ -254,7 +325,7 @@ static void config_step_execute(void)
             retry_on_fail(config_client_appkey_add(NETKEY_INDEX, m_appkey_idx, mp_appkey));
 
             static const uint8_t exp_status[] = {ACCESS_STATUS_SUCCESS, ACCESS_STATUS_KEY_INDEX_ALREADY_STORED};
-            expected_status_set(CONFIG_OPCODE_APPKEY_STATUS, sizeof(exp_status), exp_status);
+            expected_status_set(p_session, CONFIG_OPCODE_APPKEY_STATUS, NRF_MESH_ADDR_UNASSIGNED, no_model, sizeof(exp_status), exp_status);
             break;
         }
 
@@ -265,11 +336,11 @@ static void config_step_execute(void)
             access_model_id_t model_id;
             model_id.company_id = ACCESS_COMPANY_ID_NONE;
             model_id.model_id = HEALTH_SERVER_MODEL_ID;
-            uint16_t element_address = m_current_node_addr;
+            uint16_t element_address = p_session->address;
             retry_on_fail(config_client_model_app_bind(element_address, m_appkey_idx, model_id));
 
             static const uint8_t exp_status[] = {ACCESS_STATUS_SUCCESS};
-            expected_status_set(CONFIG_OPCODE_MODEL_APP_STATUS, sizeof(exp_status), exp_status);
+            expected_status_set(p_session, CONFIG_OPCODE_MODEL_APP_STATUS, element_address, model_id, sizeof(exp_status), exp_status);
             break;
         }
 
@@ -277,14 +348,12 @@ static void config_step_execute(void)
         case NODE_SETUP_CONFIG_APPKEY_BIND_SERVICE:
         {
             __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "App key bind: Smart City Service\n");
-            access_model_id_t model_id;
-            model_id.company_id = current_model_id->company_id;
-            model_id.model_id = current_model_id->model_id;
-            uint16_t element_address = m_current_node_addr;
+            access_model_id_t model_id = p_session->p_model->model_id;
+            uint16_t element_address = p_session->p_model->element_address;
             retry_on_fail(config_client_model_app_bind(element_address, m_appkey_idx, model_id));
 
             static const uint8_t exp_status[] = {ACCESS_STATUS_SUCCESS};
-            expected_status_set(CONFIG_OPCODE_MODEL_APP_STATUS, sizeof(exp_status), exp_status);
+            expected_status_set(p_session, CONFIG_OPCODE_MODEL_APP_STATUS, element_address, model_id, sizeof(exp_status), exp_status);
             break;
         }
 
@@ -292,7 +361,7 @@ static void config_step_execute(void)
         case NODE_SETUP_CONFIG_PUBLICATION_HEALTH:
         {
             config_publication_state_t pubstate = {0};
-            pubstate.element_address = m_current_node_addr;
+            pubstate.element_address = p_session->address;
             pubstate.publish_address.type = NRF_MESH_ADDRESS_TYPE_UNICAST;
             pubstate.publish_address.value = PROVISIONER_ADDRESS;
             pubstate.appkey_index = 0;
@@ -308,25 +377,23 @@ static void config_step_execute(void)
             retry_on_fail(config_client_model_publication_set(&pubstate));
 
             static const uint8_t exp_status[] = {ACCESS_STATUS_SUCCESS};
-            expected_status_set(CONFIG_OPCODE_MODEL_PUBLICATION_STATUS, sizeof(exp_status), exp_status);
+            expected_status_set(p_session, CONFIG_OPCODE_MODEL_PUBLICATION_STATUS, pubstate.element_address, pubstate.model_id, sizeof(exp_status), exp_status);
             break;
         }
 
         /* Configure subscription address for the On/Off server */
         case NODE_SETUP_CONFIG_SUBSCRIPTION_SERVICE:
         {
-            uint16_t element_address = m_current_node_addr;
+            uint16_t element_address = p_session->p_model->element_address;
             nrf_mesh_address_t address = {NRF_MESH_ADDRESS_TYPE_INVALID, 0, NULL};
             address.type = NRF_MESH_ADDRESS_TYPE_GROUP;
-            address.value  = current_model_id->model_id | 0xC000; // garante que ser um endereo de grupo multicast
-            access_model_id_t model_id;
-            model_id.company_id = current_model_id->company_id;
-            model_id.model_id = current_model_id->model_id;
+            address.value  = p_session->p_model->model_id.model_id | 0xC000; // garante que ser um endereo de grupo multicast
+            access_model_id_t model_id = p_session->p_model->model_id;
             __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Set: smart city device: 0x%04x  sub addr: 0x%04x\n",element_address,address.value);
             retry_on_fail(config_client_model_subscription_add(element_address, address, model_id));
 
             static const uint8_t exp_status[] = {ACCESS_STATUS_SUCCESS};
-            expected_status_set(CONFIG_OPCODE_MODEL_SUBSCRIPTION_STATUS, sizeof(exp_status), exp_status);
+            expected_status_set(p_session, CONFIG_OPCODE_MODEL_SUBSCRIPTION_STATUS, element_address, model_id, sizeof(exp_status), exp_status);
             break;
         }
 
@@ -334,9 +401,9 @@ static void config_step_execute(void)
         case NODE_SETUP_CONFIG_PUBLICATION_SERVICE:
         {
             config_publication_state_t pubstate = {0};
-            pubstate.element_address = m_current_node_addr;
+            pubstate.element_address = p_session->p_model->element_address;
             pubstate.publish_address.type = NRF_MESH_ADDRESS_TYPE_GROUP;
-            pubstate.publish_address.value = current_model_id->model_id | 0xC000; // garante que ser um endereo de grupo multicast
+            pubstate.publish_address.value = p_session->p_model->model_id.model_id | 0xC000; // garante que ser um endereo de grupo multicast
             pubstate.appkey_index = m_appkey_idx;
             pubstate.frendship_credential_flag = false;
             pubstate.publish_ttl = (SMART_CITY_DEVICE_COUNT > NRF_MESH_TTL_MAX ? NRF_MESH_TTL_MAX : SMART_CITY_DEVICE_COUNT);
@@ -344,13 +411,12 @@ static void config_step_execute(void)
             pubstate.publish_period.step_res = ACCESS_PUBLISH_RESOLUTION_100MS;
             pubstate.retransmit_count = 1;
             pubstate.retransmit_interval = 0;
-            pubstate.model_id.company_id = current_model_id->company_id;
-            pubstate.model_id.model_id = current_model_id->model_id;
+            pubstate.model_id = p_session->p_model->model_id;
             __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Set: smart city device: 0x%04x  pub addr: 0x%04x\n",pubstate.element_address, pubstate.publish_address.value);
             retry_on_fail(config_client_model_publication_set(&pubstate));
 
             static const uint8_t exp_status[] = {ACCESS_STATUS_SUCCESS};
-            expected_status_set(CONFIG_OPCODE_MODEL_PUBLICATION_STATUS, sizeof(exp_status), exp_status);
+            expected_status_set(p_session, CONFIG_OPCODE_MODEL_PUBLICATION_STATUS, pubstate.element_address, pubstate.model_id, sizeof(exp_status), exp_status);
             break;
         }
 
@@ -362,101 +428,328 @@ static void config_step_execute(void)
 
 /**
  * This function retrieves the device key for the given address, and configures the tx and rx paths
- * of the config client model.
+ * of the config client model. Returns false if the device database has no key for the address.
  */
-static void setup_config_client(uint16_t target_addr)
+static bool setup_config_client(uint16_t target_addr)
 {
     dsm_handle_t        addr_handle = DSM_HANDLE_INVALID;
     dsm_handle_t        devkey_handle = DSM_HANDLE_INVALID;
-    nrf_mesh_address_t  addr;
 
-    addr.type  = NRF_MESH_ADDRESS_TYPE_UNICAST;
-    addr.value = target_addr;
-
-    /* Provisioner helper has stored address and device keys already. Retrieve them. */
-    ERROR_CHECK(dsm_address_handle_get(&addr, &addr_handle));
-    ERROR_CHECK(dsm_devkey_handle_get(addr.value, &devkey_handle));
+    /* Provisioner helper has stored the device key in the device database. Load it into the DSM, if needed. */
+    uint32_t status = device_db_handles_get(target_addr, &devkey_handle, &addr_handle);
+    if (status != NRF_SUCCESS)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "No device key for node 0x%04x. Error: %d\n", target_addr, status);
+        return false;
+    }
 
     /* Configure client to communicate with server at the given address */
     ERROR_CHECK(config_client_server_bind(devkey_handle));
     ERROR_CHECK(config_client_server_set(devkey_handle, addr_handle));
     __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Config client setup: devkey_handle:%d addr_handle:%d\n", devkey_handle, addr_handle);
+    return true;
+}
+
+/*************************************************************************************************/
+/* Cache da composio por tipo de dispositivo. A chave so os IDs de empresa, produto e verso, no incio da pgina 0
+ * da composio. No UUID dos dispositivos, logo depois do prefixo, esto s os de produto e verso: a empresa 
+ * ACCESS_COMPANY_ID_NORDIC */
+#define COMPOSITION_TYPE_SIZE   (6)
+
+static composition_data_stored_t * composition_cache_find(const uint8_t * p_type)
+{
+    if (mp_composition_cache == NULL)
+    {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < PROVISIONER_COMPOSITION_CACHE_SIZE; i++)
+    {
+        if (mp_composition_cache[i].length >= sizeof(config_composition_data_header_t) &&
+            memcmp(mp_composition_cache[i].data, p_type, COMPOSITION_TYPE_SIZE) == 0)
+        {
+            return &mp_composition_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* Entrada do cache com a composio do tipo indicado no UUID, ou NULL se o tipo no estiver no cache */
+static const composition_data_stored_t * composition_cache_lookup(const uint8_t * p_uuid)
+{
+    static const uint8_t prefix[SMART_CITY_NODE_UUID_PREFIX_SIZE] = SMART_CITY_NODE_UUID_PREFIX;
+    if (p_uuid == NULL || memcmp(p_uuid, prefix, SMART_CITY_NODE_UUID_PREFIX_SIZE) != 0)
+    {
+        return NULL;
+    }
+    uint8_t type[COMPOSITION_TYPE_SIZE] = {(uint8_t) ACCESS_COMPANY_ID_NORDIC, (uint8_t) (ACCESS_COMPANY_ID_NORDIC >> 8)};
+    memcpy(&type[2], &p_uuid[SMART_CITY_NODE_UUID_PREFIX_SIZE], SMART_CITY_NODE_UUID_TYPE_SIZE);
+    return composition_cache_find(type);
+}
+
+/* Guarda no cache a composio lida do n, se o tipo for novo e houver entrada livre. Se o tipo j estiver no cache
+ * com outra composio, a lida do n toma o lugar dela */
+static void composition_cache_add(uint16_t address, const uint8_t * p_data, uint16_t length)
+{
+    if (mp_composition_cache == NULL || length < sizeof(config_composition_data_header_t) ||
+        length > PROVISIONER_COMPOSITION_DATA_MAX)
+    {
+        return;
+    }
+    composition_data_stored_t * p_entry = composition_cache_find(p_data);
+    if (p_entry != NULL)
+    {
+        if (p_entry->length == length && memcmp(p_entry->data, p_data, length) == 0)
+        {
+            return;
+        }
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Data Composition of node 0x%04x differs from the cached one of its type\n", address);
+    }
+    for (uint32_t i = 0; i < PROVISIONER_COMPOSITION_CACHE_SIZE && p_entry == NULL; i++)
+    {
+        if (mp_composition_cache[i].length == 0)
+        {
+            p_entry = &mp_composition_cache[i];
+        }
+    }
+    if (p_entry == NULL)
+    {
+        return;
+    }
+    memcpy(p_entry->data, p_data, length);
+    p_entry->length = length;
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Data Composition of node 0x%04x cached at entry %u\n", address,
+          (uint32_t) (p_entry - mp_composition_cache));
+    m_composition_store_cb();
 }
 
 /*****************************************************************************************
- * m_node_composition.composition.data  um vetor de uint8_t com a seguinte estrutura de dados
- * uint8_t * data
+ * A pgina 0 da composio tem a seguinte estrutura (Mesh Profile 4.2.1), em little endian
  * {
  *    config_composition_data_header_t,
  *    para cada elemento[]
  *    {
  *        config_composition_element_header_t,
- *        access_model_id_t.model_id[],
- *        access_model_id_t[]
+ *        uint16_t sig_model_id[sig_model_count],
+ *        {uint16_t company_id, uint16_t model_id}[vendor_model_count]
  *    }
  * }
- * Queremos as listas de modelos personalizados em access_model_id_t[]
+ * Os elementos tm endereos consecutivos a partir do endereo do n.
  *****************************************************************************************/
-static void get_next_smart_city_model(void)
+static uint16_t le16_get(const uint8_t * p_data)
+{
+    return (uint16_t) (p_data[0] | (p_data[1] << 8));
+}
+
+static void model_index_add(node_setup_session_t * p_session, uint16_t element_address, uint16_t company_id,
+                            uint16_t model_id, bool vendor)
 {
-    do
+    node_setup_model_t * p_model = &p_session->models[p_session->model_count++];
+    p_model->element_address = element_address;
+    p_model->model_id.company_id = company_id;
+    p_model->model_id.model_id = model_id;
+    p_model->vendor = vendor;
+}
+
+/* L a composio em uma passada e monta o ndice dos modelos da sesso. Retorna false se a pgina estiver
+ * truncada, ou tiver mais modelos que NODE_SETUP_MODEL_INDEX_SIZE */
+static bool composition_parse(node_setup_session_t * p_session, const uint8_t * p_data, uint16_t length)
+{
+    uint16_t element_address = p_session->address;
+    uint32_t offset = sizeof(config_composition_data_header_t);
+
+    p_session->model_count = 0;
+    p_session->model_next = 0;
+    p_session->p_model = NULL;
+    if (length < offset)
     {
-        // Se o elemento ainda no foi capturado
-        if(element_header==NULL)
+        return false;
+    }
+
+    while (offset < length)
+    {
+        if (length - offset < sizeof(config_composition_element_header_t))
         {
-            // Obtendo o primeiro elemento
-            element_header = (config_composition_element_header_t *) ((unsigned int) m_node_composition.composition.data+sizeof(config_composition_data_header_t));
-            // Obtendo o contador de modelos personalizados do elemento
-            current_model_count=element_header->vendor_model_count;
-            __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "Captured Element Header: ", (uint8_t*)element_header, sizeof(element_header));
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "This element has %2d personalized models\n",current_model_count);
+            return false;
         }
-        // Se foi capturado, mas j se considerou o ltimo modelo
-        else if (current_model_count<1)
+        uint8_t sig_count = p_data[offset + offsetof(config_composition_element_header_t, sig_model_count)];
+        uint8_t vendor_count = p_data[offset + offsetof(config_composition_element_header_t, vendor_model_count)];
+        offset += sizeof(config_composition_element_header_t);
+        if (length - offset < sig_count * sizeof(uint16_t) + vendor_count * sizeof(access_model_id_t) ||
+            p_session->model_count + sig_count + vendor_count > NODE_SETUP_MODEL_INDEX_SIZE)
         {
-            // Esgotou os modelos do elemento anterior. Avana para o prximo
-            element_header = (config_composition_element_header_t *)((current_model_id==NULL) ? (unsigned int) (element_header + sizeof(config_composition_element_header_t) + element_header->sig_model_count*sizeof(current_model_id->model_id)) : (unsigned int) (++current_model_id));
-            // Obtendo o contador de modelos personalizados do elemento
-            current_model_count=element_header->vendor_model_count;
-            __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "Captured Element Header: ", (uint8_t*)element_header, sizeof(element_header));
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "This element has %2d personalized models\n",current_model_count);
-            current_model_id=NULL;
+            return false;
         }
 
-        // Se o elemento for invlido (fora da estrutura da composio)
-        if(element_header>=(config_composition_element_header_t*)((unsigned int) m_node_composition.composition.data + m_node_composition.len-1))
+        for (uint32_t i = 0; i < sig_count; i++, offset += sizeof(uint16_t))
         {
-            element_header=NULL;
-            break;
+            model_index_add(p_session, element_address, ACCESS_COMPANY_ID_NONE, le16_get(&p_data[offset]), false);
         }
+        for (uint32_t i = 0; i < vendor_count; i++, offset += sizeof(access_model_id_t))
+        {
+            model_index_add(p_session, element_address, le16_get(&p_data[offset]), le16_get(&p_data[offset + 2]), true);
+        }
+        element_address++;
+    }
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Node 0x%04x: %u elements, %u models\n", p_session->address,
+          element_address - p_session->address, p_session->model_count);
+    return true;
+}
 
-        // Se o modelo do elemento atual ainda no foi capturado e existe
-        if((current_model_id==NULL) && (current_model_count>0))
+/* Avana para o prximo modelo de cidade inteligente do ndice. Retorna false se no houver mais nenhum */
+static bool smart_city_model_next(node_setup_session_t * p_session)
+{
+    while (p_session->model_next < p_session->model_count)
+    {
+        const node_setup_model_t * p_model = &p_session->models[p_session->model_next++];
+        if (p_model->vendor && IS_SMART_CITY_MODEL(p_model->model_id.model_id))
         {
-            // Obtendo o ID do modelo
-            current_model_id=(access_model_id_t *) ((unsigned int) element_header + sizeof(config_composition_element_header_t) + element_header->sig_model_count*sizeof(current_model_id->model_id));
-            current_model_count--;
+            p_session->p_model = p_model;
+            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configurando modelo 0x%04x do elemento 0x%04x\n",
+                  p_model->model_id.model_id, p_model->element_address);
+            return true;
         }
-        // Se o modelo foi capturado e ainda existem outros
-        else if(current_model_count>1)
+    }
+    p_session->p_model = NULL;
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "All models parsed\n");
+    return false;
+}
+
+/*************************************************************************************************/
+/* Sesses e pedidos */
+
+static node_setup_session_t * session_find(uint16_t address)
+{
+    for (uint32_t i = 0; i < NODE_SETUP_SESSION_COUNT; i++)
+    {
+        if (m_sessions[i].address == address)
         {
-            // Avanando para o prximo modelo no elemento
-            current_model_id++;
-            current_model_count--;
+            return &m_sessions[i];
         }
-        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Captured Model ID: 0x%04x \n", current_model_id->model_id);
-    }while(!IS_SMART_CITY_MODEL(current_model_id->model_id) && (element_header!=NULL));
+    }
+    return NULL;
+}
+
+/* Libera a sesso e avisa a aplicao */
+static void session_finish(node_setup_session_t * p_session, bool success)
+{
+    uint16_t address = p_session->address;
+    p_session->address = NRF_MESH_ADDR_UNASSIGNED;
+    p_session->p_step = &m_idle_step;
+    if (success)
+    {
+        m_node_setup_success_cb(address);
+    }
+    else
+    {
+        m_node_setup_failed_cb(address);
+    }
+}
+
+/* O n recusou um passo. Com os modelos indexados pela composio do cache, ela pode no ser a do n (um firmware que
+ * mudou a composio sem mudar DEVICE_VERSION_ID): a configurao recomea, lendo a composio do n. Seno, a sesso
+ * termina com falha */
+static void session_step_rejected(node_setup_session_t * p_session)
+{
+    if (p_session->composition_cached)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Step rejected with cached Data Composition. Reading it from node 0x%04x\n",
+              p_session->address);
+        p_session->composition_cached = false;
+        setup_select_steps(p_session, false);
+        return;
+    }
+    session_finish(p_session, false);
+}
+
+/* Avana a sesso depois do status esperado. Retorna false se a configurao do n terminou */
+static bool session_step_next(node_setup_session_t * p_session)
+{
+    // Queremos configurar todos os modelos de cidade inteligente
+    // Se o prximo passo indica o fim da configurao
+    if (*(p_session->p_step+1)==NODE_SETUP_DONE)
+    {
+        // Verifica se ainda h modelos da cidade inteligente a serem configurados
+        if (smart_city_model_next(p_session))
+        {
+            // Se sim, configura o modelo
+            p_session->p_step=smart_city_models_config_steps;
+        }
+        else
+        {
+            // Seno, finaliza a configurao
+            p_session->p_step++;
+        }
+    }
+    else
+    {
+        p_session->p_step++;
+    }
+
+    return *p_session->p_step != NODE_SETUP_DONE;
+}
 
-    // Se a estrutura de dados da composio acabou
-    if(element_header==NULL)
+/* Encerra o pedido pendente: o cliente de configurao fica livre para a prxima sesso */
+static node_setup_session_t * request_done(void)
+{
+    node_setup_session_t * p_session = mp_active;
+    timer_sch_abort(&m_request_timer);
+    timer_sch_abort(&m_send_timer.timer);
+    mp_active = NULL;
+    return p_session;
+}
+
+/* O pedido pendente ficou sem resposta: a sesso tenta o mesmo passo na sua prxima vez, depois das outras */
+static void request_failed(void)
+{
+    node_setup_session_t * p_session = request_done();
+    if (p_session->retry_count)
     {
-        // operao segura com ponteiros
-        current_model_id=NULL;
-        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "All models parsed\n");
+        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Retry node 0x%04x ...\n", p_session->address);
+        p_session->retry_count--;
     }
     else
     {
-        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configurando modelo 0x%04x\n", current_model_id->model_id)
+        session_finish(p_session, false);
+    }
+    request_next();
+}
+
+static void request_timer_cb(timestamp_t timestamp, void * p_context)
+{
+    if (mp_active != NULL)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Status not received in time from node 0x%04x\n", mp_active->address);
+        config_client_pending_msg_cancel();
+        request_failed();
+    }
+}
+
+/* Envia o passo corrente da prxima sesso em andamento, em rodzio, se o cliente de configurao estiver livre */
+static void request_next(void)
+{
+    if (mp_active != NULL)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < NODE_SETUP_SESSION_COUNT; i++)
+    {
+        node_setup_session_t * p_session = &m_sessions[(m_next_session + i) % NODE_SETUP_SESSION_COUNT];
+        if (p_session->address != NRF_MESH_ADDR_UNASSIGNED)
+        {
+            m_next_session = (m_next_session + i + 1) % NODE_SETUP_SESSION_COUNT;
+            mp_active = p_session;
+            m_send_timer.count = CLIENT_BUSY_SEND_RETRY_LIMIT;
+            m_request_timer.timestamp = timer_now() + MS_TO_US(NODE_SETUP_REQUEST_TIMEOUT_MS);
+            timer_sch_schedule(&m_request_timer);
+
+            /* Sem a chave do n o pedido no  enviado, e expira como um pedido sem resposta */
+            if (setup_config_client(p_session->address))
+            {
+                config_step_execute(p_session);
+            }
+            return;
+        }
     }
 }
 
@@ -464,8 +757,8 @@ static void get_next_smart_city_model(void)
 /* Public functions */
 
 /**
- * Proccess the config client model events, and advances the node setup state machine to the next
- * state, if expected status message is received.
+ * Proccess the config client model events, and advances the node setup state machine of the session with the
+ * pending request to the next state, if expected status message is received.
  */
 void node_setup_config_client_event_process(config_client_event_type_t event_type,
                                         const config_client_event_t * p_event,
@@ -473,76 +766,49 @@ void node_setup_config_client_event_process(config_client_event_type_t event_typ
 {
     status_check_t status;
 
+    if (mp_active == NULL)
+    {
+        return;
+    }
+
     if (event_type == CONFIG_CLIENT_EVENT_TYPE_TIMEOUT)
     {
         __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Acknowledged message status not received \n");
-
-        if (m_retry_count)
-        {
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Retry ...\n");
-            m_retry_count--;
-            config_step_execute();
-        }
-        else
-        {
-            // TODO: fazer pular para o prximo dispositivo
-            mp_config_step = &m_idle_step;
-            m_node_setup_failed_cb();
-        }
+        request_failed();
     }
-    else if (event_type == CONFIG_CLIENT_EVENT_TYPE_MSG && *mp_config_step != NODE_SETUP_DONE
-             && m_status_checked == false)
+    else if (event_type == CONFIG_CLIENT_EVENT_TYPE_MSG)
     {
         NRF_MESH_ASSERT(p_event != NULL);
-        status = check_expected_status(p_event->opcode, p_event->p_msg);
+        status = check_expected_status(mp_active, p_event->opcode, p_event->p_msg, length);
         if (status == STATUS_CHECK_PASS)
         {
-            /* Save composition data for later use */
-            if (p_event->opcode == CONFIG_OPCODE_COMPOSITION_DATA_STATUS)
-            {
-                m_node_composition.len  = length;
-                m_node_composition.composition.page_number = p_event->p_msg->composition_data_status.page_number;
-                memcpy(m_node_composition.composition.data, p_event->p_msg->composition_data_status.data, length - 1);
-                __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "Captured Data Composition: ", m_node_composition.composition.data, m_node_composition.len);
-            }
+            node_setup_session_t * p_session = request_done();
 
-            // Queremos configurar todos os modelos de cidade inteligente
-            // Se o prximo passo indica o fim da configurao
-            if (*(mp_config_step+1)==NODE_SETUP_DONE)
+            /* Index the models of the node, and cache the composition data of its type */
+            if (p_event->opcode == CONFIG_OPCODE_COMPOSITION_DATA_STATUS)
             {
-                // Verifica se ainda h modelos da cidade inteligente a serem configurados
-                get_next_smart_city_model();
-                if(current_model_id != NULL)
+                const uint8_t * p_data = p_event->p_msg->composition_data_status.data;
+                __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "Captured Data Composition: ", p_data, length - 1);
+                if (!composition_parse(p_session, p_data, length - 1))
                 {
-                    // Se sim, configura o modelo
-                    mp_config_step=smart_city_models_config_steps;
+                    __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Invalid Data Composition from node 0x%04x\n", p_session->address);
+                    session_finish(p_session, false);
+                    request_next();
+                    return;
                 }
-                else
-                {
-                    // Seno, finaliza a configurao
-                    mp_config_step++;
-                }
-            }
-            else
-            {
-                mp_config_step++;
+                composition_cache_add(p_session->address, p_data, length - 1);
             }
 
-            if (*mp_config_step == NODE_SETUP_DONE)
-            {
-                mp_config_step = &m_idle_step;
-                m_node_setup_success_cb();
-            }
-            else
+            if (!session_step_next(p_session))
             {
-                m_send_timer.count = CLIENT_BUSY_SEND_RETRY_LIMIT;
-                config_step_execute();
+                session_finish(p_session, true);
             }
+            request_next();
         }
         else if (status == STATUS_CHECK_FAIL)
         {
-            mp_config_step = &m_idle_step;
-            m_node_setup_failed_cb();
+            session_step_rejected(request_done());
+            request_next();
         }
     }
 }
@@ -550,26 +816,43 @@ void node_setup_config_client_event_process(config_client_event_type_t event_typ
 /**
  * Begins the node setup process.
  */
-void node_setup_start(uint16_t address, uint8_t  retry_cnt, const uint8_t * p_appkey,
-                      uint16_t appkey_idx)
+uint32_t node_setup_start(uint16_t address, uint8_t  retry_cnt, const uint8_t * p_appkey,
+                          uint16_t appkey_idx, const uint8_t * p_uuid)
 {
-    if (*mp_config_step != NODE_SETUP_IDLE)
+    if (session_find(address) != NULL)
     {
-        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Cannot start. Node setup procedure is in progress.\n");
-        return;
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Cannot start. Node 0x%04X is being configured.\n", address);
+        return NRF_ERROR_INVALID_STATE;
+    }
+    node_setup_session_t * p_session = session_find(NRF_MESH_ADDR_UNASSIGNED);
+    if (p_session == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
     }
-    m_current_node_addr = address;
-    m_retry_count = retry_cnt;
+
+    p_session->address = address;
+    p_session->retry_count = retry_cnt;
+    p_session->p_model = NULL;
+    p_session->model_count = 0;
+    p_session->model_next = 0;
     m_send_timer.timer.cb = client_send_timer_cb;
-    m_send_timer.count = CLIENT_BUSY_SEND_RETRY_LIMIT;
+    m_request_timer.cb = request_timer_cb;
     mp_appkey = p_appkey;
     m_appkey_idx = appkey_idx;
 
-    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configuring Node: 0x%04X\n", m_current_node_addr);
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Configuring Node: 0x%04X\n", address);
 
-    setup_config_client(m_current_node_addr);
-    setup_select_steps(m_current_node_addr);
-    config_step_execute();
+    /* With the composition data of the device type cached, the models are indexed right away */
+    const composition_data_stored_t * p_cached = composition_cache_lookup(p_uuid);
+    bool composition_known = (p_cached != NULL && composition_parse(p_session, p_cached->data, p_cached->length));
+    if (composition_known)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Data Composition of node 0x%04X taken from cache\n", address);
+    }
+    p_session->composition_cached = composition_known;
+    setup_select_steps(p_session, composition_known);
+    request_next();
+    return NRF_SUCCESS;
 }
 
 void node_setup_cb_set(node_setup_successful_cb_t config_success_cb,
@@ -581,3 +864,13 @@ void node_setup_cb_set(node_setup_successful_cb_t config_success_cb,
     m_node_setup_success_cb = config_success_cb;
     m_node_setup_failed_cb = config_failed_cb;
 }
+
+void node_setup_composition_cache_set(composition_data_stored_t * p_cache,
+                                      node_setup_composition_store_cb_t store_cb)
+{
+    NRF_MESH_ASSERT(p_cache != NULL);
+    NRF_MESH_ASSERT(store_cb != NULL);
+
+    mp_composition_cache = p_cache;
+    m_composition_store_cb = store_cb;
+}
@@ -46,30 +46,98 @@
 #include "nrf_mesh_config_app.h"
 #include "provisioner_helper.h"
 #include "node_setup.h"
+#include "device_db.h"
 #include "rand.h"
+#include "timer_scheduler.h"
 #include "log.h"
 
 
+#if (PROVISIONER_DEVICE_TABLE_SIZE & (PROVISIONER_DEVICE_TABLE_SIZE - 1)) != 0
+#error PROVISIONER_DEVICE_TABLE_SIZE must be a power of two
+#endif
+
+#define DEVICE_TABLE_MASK   (PROVISIONER_DEVICE_TABLE_SIZE - 1)
+
+#if (PROVISIONER_ADDRESS_POOL_SIZE % 32) != 0 || PROVISIONER_ADDRESS_POOL_SIZE > (0x8000 - UNPROV_START_ADDRESS)
+#error PROVISIONER_ADDRESS_POOL_SIZE must be a multiple of 32, and fit in the unicast address range
+#endif
+
+#define ADDRESS_MAP_WORDS   (PROVISIONER_ADDRESS_POOL_SIZE / 32)
+/** Largest address range given to a device */
+#define ADDRESS_RANGE_MAX   (32)
+
+/** State of a device in the provisioning table */
 typedef enum
 {
-    PROV_STATE_IDLE,
-    PROV_STATE_WAIT,
-    PROV_STATE_COMPLETE,
-    PROV_STATE_PROV
-} prov_state_t;
+    PROV_DEVICE_FREE,           /**< Unused table entry */
+    PROV_DEVICE_WAIT,           /**< Address reserved, waiting for a free link and the next beacon */
+    PROV_DEVICE_PROV,           /**< Provisioning link open */
+    PROV_DEVICE_COMPLETE,       /**< Provisioning data delivered, waiting for the link to close */
+    PROV_DEVICE_PROVISIONED,    /**< Provisioned, and queued for configuration */
+    PROV_DEVICE_CONFIGURED      /**< Configured. The device is in the device database, and the entry can be reused.
+                                     Until then it keeps the address range, released if the device comes back reset */
+} prov_device_state_t;
+
+/** Device table entry. The address range is reserved when the device is first seen, so retries and parallel links
+ * never compete for the same address. */
+typedef struct
+{
+    uint8_t  uuid[NRF_MESH_UUID_SIZE];
+    uint16_t address;
+    uint16_t elements;
+    uint8_t  state;
+    uint8_t  retry_cnt;
+    uint8_t  failures;          /**< Failed attempts, for the backoff delay */
+    timestamp_t next_attempt;   /**< The device is not tried again before this time */
+} prov_device_t;
+
+/** Device heard on an unprovisioned beacon, waiting in the scanned list for a free link */
+typedef struct
+{
+    prov_device_t * p_device;   /**< Device table entry, NULL if the list entry is free */
+    int8_t rssi;                /**< Average RSSI of the beacons heard */
+    timestamp_t last_seen;
+} prov_candidate_t;
+
+/** Provisioning link: one context and one PB-ADV bearer each */
+typedef struct
+{
+    nrf_mesh_prov_ctx_t ctx;
+    nrf_mesh_prov_bearer_adv_t bearer;
+    prov_device_t * p_device;   /**< Device being provisioned, NULL if the link is free */
+    uint8_t devkey[NRF_MESH_KEY_SIZE];  /**< Device key of the provisioned device, while it waits for the database */
+    bool devkey_pending;        /**< The device database had no room for the device key */
+    bool closed;                /**< The link closed with the device key pending. It is freed once the key is stored. */
+} prov_link_t;
 
 static uint8_t m_public_key[NRF_MESH_PROV_PUBKEY_SIZE];
 static uint8_t m_private_key[NRF_MESH_PROV_PRIVKEY_SIZE];
 
-static nrf_mesh_prov_bearer_adv_t m_prov_bearer_adv;
-static nrf_mesh_prov_ctx_t m_prov_ctx;
+static prov_link_t m_links[PROVISIONER_LINK_COUNT];
+static prov_device_t m_devices[PROVISIONER_DEVICE_TABLE_SIZE];
+static prov_candidate_t m_candidates[UNPROV_MAX_SCANNED_ITEMS_LIST];
+static timer_event_t m_scan_window_timer;
+static bool m_scan_window_open;
+static timer_event_t m_devkey_retry_timer;
+static bool m_devkey_retry_scheduled;
 static prov_helper_uuid_filter_t * mp_expected_uuid;
 
-static prov_state_t m_prov_state;
-static uint8_t      m_retry_cnt;
+static bool     m_prov_active;
+static uint8_t  m_retry_cnt;
+static uint16_t m_device_count;
+static uint16_t m_last_elements;
+
+/* Addresses of the pool reserved for devices being provisioned. Not stored: after a reset, only the addresses of
+ * provisioned devices, in p_nw_data->address_map, are taken. */
+static uint32_t m_address_reserved[ADDRESS_MAP_WORDS];
 
-static uint16_t m_target_address;
-static uint16_t m_target_elements;
+/* Provisioned devices waiting for a free node setup session, one bit per address of the pool, so that all the
+ * devices of the pool can wait at once. They are started in address order, from the address after the last one
+ * started, so a device queued again is started after the devices already waiting. */
+static uint32_t m_config_pending[ADDRESS_MAP_WORDS];
+static uint16_t m_config_cursor;
+/* Node setup failures of each address of the pool, since the device was queued by provisioning or by the application */
+static uint8_t m_config_failures[PROVISIONER_ADDRESS_POOL_SIZE];
 
 static mesh_provisioner_init_params_t m_provisioner;
 static bool m_provisioner_init_done;
@@ -103,19 +171,208 @@ static bool uuid_filter_compare(const uint8_t *p_in_uuid)
     return false;
 }
 
-static void start_provisioning(const uint8_t * p_uuid)
+static uint32_t uuid_hash(const uint8_t * p_uuid)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < NRF_MESH_UUID_SIZE; i++)
+    {
+        hash = (hash ^ p_uuid[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Returns the table entry of the given UUID, configured or not, or the entry where it is to be inserted: the free
+ * entry ending its probe sequence or, in a full table, the first configured entry on it. Configured entries are kept
+ * as long as possible, so that a configured device that comes back is recognized. Returns NULL if the table is full
+ * of devices being provisioned or configured. */
+static prov_device_t * device_lookup(const uint8_t * p_uuid)
+{
+    uint32_t index = uuid_hash(p_uuid);
+    prov_device_t * p_reusable = NULL;
+    for (uint32_t i = 0; i < PROVISIONER_DEVICE_TABLE_SIZE; i++)
+    {
+        prov_device_t * p_device = &m_devices[(index + i) & DEVICE_TABLE_MASK];
+        if (p_device->state == PROV_DEVICE_FREE)
+        {
+            return p_device;
+        }
+        if (memcmp(p_device->uuid, p_uuid, NRF_MESH_UUID_SIZE) == 0)
+        {
+            return p_device;
+        }
+        if (p_device->state == PROV_DEVICE_CONFIGURED && p_reusable == NULL)
+        {
+            p_reusable = p_device;
+        }
+    }
+    return p_reusable;
+}
+
+/* Places the address pool in the unicast range, at a base derived from the provisioner device key, so that networks
+ * of different provisioners use different addresses */
+static void address_pool_init(void)
+{
+    network_stats_data_stored_t * p_nw_data = m_provisioner.p_nw_data;
+    uint16_t base = ((p_nw_data->self_devkey[1] << 8) + p_nw_data->self_devkey[0]) & 0x7FFF;
+    if (base < UNPROV_START_ADDRESS)
+    {
+        base = UNPROV_START_ADDRESS;
+    }
+    else if (base > 0x8000 - PROVISIONER_ADDRESS_POOL_SIZE)
+    {
+        base = 0x8000 - PROVISIONER_ADDRESS_POOL_SIZE;
+    }
+    p_nw_data->address_base = base;
+    memset(p_nw_data->address_map, 0, sizeof(p_nw_data->address_map));
+    memset(p_nw_data->configured_map, 0, sizeof(p_nw_data->configured_map));
+    m_provisioner.p_data_store_cb(NETWORK_STATE_CHANGE_ADDRESS_POOL, base, 0);
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Address pool: 0x%04x to 0x%04x\n", base, base + PROVISIONER_ADDRESS_POOL_SIZE - 1);
+}
+
+static void address_map_update(uint32_t * p_map, uint16_t address, uint16_t count, bool used)
+{
+    uint32_t bit = address - m_provisioner.p_nw_data->address_base;
+    NRF_MESH_ASSERT(bit + count <= PROVISIONER_ADDRESS_POOL_SIZE);
+    for (uint32_t i = bit; i < bit + count; i++)
+    {
+        if (used)
+        {
+            p_map[i / 32] |= 1u << (i % 32);
+        }
+        else
+        {
+            p_map[i / 32] &= ~(1u << (i % 32));
+        }
+    }
+}
+
+/* First fit: reserves the first range of `count` consecutive free addresses. Each word of the bitmap is checked
+ * together with the next one, so a range may cross a word boundary; the cost is bounded by ADDRESS_MAP_WORDS.
+ * Returns NRF_MESH_ADDR_UNASSIGNED if the pool has no such range. */
+static uint16_t address_alloc(uint16_t count)
+{
+    const uint32_t * p_owned = m_provisioner.p_nw_data->address_map;
+    if (count == 0 || count > ADDRESS_RANGE_MAX)
+    {
+        return NRF_MESH_ADDR_UNASSIGNED;
+    }
+    for (uint32_t w = 0; w < ADDRESS_MAP_WORDS; w++)
+    {
+        uint64_t used = p_owned[w] | m_address_reserved[w];
+        used |= ((w + 1 < ADDRESS_MAP_WORDS) ? (uint64_t) (p_owned[w + 1] | m_address_reserved[w + 1]) : UINT32_MAX) << 32;
+        /* Bit i of `starts` is set if the addresses i to i + count - 1 are free */
+        uint64_t starts = ~used;
+        for (uint32_t i = 1; i < count && starts != 0; i++)
+        {
+            starts &= ~used >> i;
+        }
+        starts &= UINT32_MAX;
+        if (starts != 0)
+        {
+            uint16_t address = m_provisioner.p_nw_data->address_base + w * 32 + __builtin_ctzll(starts);
+            address_map_update(m_address_reserved, address, count, true);
+            return address;
+        }
+    }
+    return NRF_MESH_ADDR_UNASSIGNED;
+}
+
+/* Reserves an address range for the device. Returns false if the pool has no free range of that size */
+static bool device_address_reserve(prov_device_t * p_device, uint16_t elements)
+{
+    p_device->address = address_alloc(elements);
+    p_device->elements = elements;
+    if (p_device->address == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "No free range of %d addresses in the pool\n", elements);
+        return false;
+    }
+    return true;
+}
+
+/* Returns the reserved range of the device to the pool. The number of elements is kept, so that the range reserved
+ * when the device comes back is large enough */
+static void device_address_release(prov_device_t * p_device)
+{
+    if (p_device->address != NRF_MESH_ADDR_UNASSIGNED)
+    {
+        address_map_update(m_address_reserved, p_device->address, p_device->elements, false);
+        p_device->address = NRF_MESH_ADDR_UNASSIGNED;
+    }
+}
+
+/* The reserved range of the provisioned device becomes owned, and is stored with the network state */
+static void device_address_commit(prov_device_t * p_device)
+{
+    address_map_update(m_address_reserved, p_device->address, p_device->elements, false);
+    address_map_update(m_provisioner.p_nw_data->address_map, p_device->address, p_device->elements, true);
+}
+
+/* The configured device was reset. Its range goes back to the pool, and it is no longer counted as provisioned and
+ * configured, so that it is counted once when provisioned again */
+static void device_address_remove(prov_device_t * p_device)
+{
+    network_stats_data_stored_t * p_nw_data = m_provisioner.p_nw_data;
+    address_map_update(p_nw_data->address_map, p_device->address, p_device->elements, false);
+    address_map_update(p_nw_data->configured_map, p_device->address, 1, false);
+    p_nw_data->provisioned_devices--;
+    p_nw_data->configured_devices--;
+    m_provisioner.p_data_store_cb(NETWORK_STATE_CHANGE_DEVICE_REMOVED, p_device->address, p_device->elements);
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Node addr: 0x%04x was reset, %d addresses released\n", p_device->address, p_device->elements);
+}
+
+static prov_link_t * link_get(const nrf_mesh_prov_ctx_t * p_ctx)
+{
+    for (uint32_t i = 0; i < PROVISIONER_LINK_COUNT; i++)
+    {
+        if (&m_links[i].ctx == p_ctx)
+        {
+            return &m_links[i];
+        }
+    }
+    return NULL;
+}
+
+/* Returns a free link, or NULL if all links are busy or enough devices are already being provisioned */
+static prov_link_t * link_free_get(void)
+{
+    prov_link_t * p_free = NULL;
+    uint32_t busy = 0;
+    for (uint32_t i = 0; i < PROVISIONER_LINK_COUNT; i++)
+    {
+        if (m_links[i].p_device != NULL)
+        {
+            busy++;
+        }
+        else if (p_free == NULL)
+        {
+            p_free = &m_links[i];
+        }
+    }
+    if (m_provisioner.p_nw_data->provisioned_devices + busy >= m_device_count)
+    {
+        return NULL;
+    }
+    return p_free;
+}
+
+static void start_provisioning(prov_link_t * p_link, prov_device_t * p_device)
 {
     nrf_mesh_prov_provisioning_data_t prov_data =
         {
             .netkey_index = m_provisioner.netkey_idx,
             .iv_index = 0,
-            .address = m_target_address,
+            .address = p_device->address,
             .flags.iv_update = false,
             .flags.key_refresh = false
         };
     memcpy(prov_data.netkey, m_provisioner.p_nw_data->netkey, NRF_MESH_KEY_SIZE);
-    ERROR_CHECK(nrf_mesh_prov_provision(&m_prov_ctx, p_uuid, &prov_data, NRF_MESH_PROV_BEARER_ADV));
-    m_prov_state = PROV_STATE_PROV;
+    ERROR_CHECK(nrf_mesh_prov_provision(&p_link->ctx, p_device->uuid, &prov_data, NRF_MESH_PROV_BEARER_ADV));
+    p_link->p_device = p_device;
+    p_link->devkey_pending = false;
+    p_link->closed = false;
+    p_device->state = PROV_DEVICE_PROV;
 }
 
 static void prov_helper_provisioner_init(void)
@@ -125,126 +382,409 @@ static void prov_helper_provisioner_init(void)
         nrf_mesh_prov_oob_caps_t capabilities = NRF_MESH_PROV_OOB_CAPS_DEFAULT(ACCESS_ELEMENT_COUNT);
 
         ERROR_CHECK(nrf_mesh_prov_generate_keys(m_public_key, m_private_key));
-        ERROR_CHECK(nrf_mesh_prov_init(&m_prov_ctx, m_public_key, m_private_key, &capabilities, prov_evt_handler));
-        ERROR_CHECK(nrf_mesh_prov_bearer_add(&m_prov_ctx, nrf_mesh_prov_bearer_adv_interface_get(&m_prov_bearer_adv)));
+        for (uint32_t i = 0; i < PROVISIONER_LINK_COUNT; i++)
+        {
+            ERROR_CHECK(nrf_mesh_prov_init(&m_links[i].ctx, m_public_key, m_private_key, &capabilities, prov_evt_handler));
+            ERROR_CHECK(nrf_mesh_prov_bearer_add(&m_links[i].ctx, nrf_mesh_prov_bearer_adv_interface_get(&m_links[i].bearer)));
+            m_links[i].p_device = NULL;
+        }
     }
 
     m_provisioner_init_done = true;
 }
 
-/* Provisioning process event handling */
-static void prov_evt_handler(const nrf_mesh_prov_evt_t * p_evt)
+/* Holds the failed device back for an exponential backoff delay with jitter, so that the links go to other devices */
+static void device_backoff(prov_device_t * p_device)
 {
-    static dsm_handle_t addr_handle;
-    static dsm_handle_t devkey_handle;
+    uint32_t delay_ms = PROVISIONER_BACKOFF_MAX_MS;
+    if (p_device->failures < 16 && (PROVISIONER_BACKOFF_BASE_MS << p_device->failures) < PROVISIONER_BACKOFF_MAX_MS)
+    {
+        delay_ms = PROVISIONER_BACKOFF_BASE_MS << p_device->failures;
+    }
+    if (p_device->failures < UINT8_MAX)
+    {
+        p_device->failures++;
+    }
 
-    switch (p_evt->type)
+    uint16_t jitter;
+    rand_hw_rng_get((uint8_t *) &jitter, sizeof(jitter));
+    delay_ms += jitter % (delay_ms / 2 + 1);
+    p_device->next_attempt = timer_now() + MS_TO_US(delay_ms);
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Node addr: 0x%04x tried again in %u ms\n", p_device->address, delay_ms);
+}
+
+/* Returns the UUID of the device provisioned at the given address, or NULL if it is not in the table (devices
+ * provisioned before a reset) */
+static const uint8_t * device_uuid_get(uint16_t address)
+{
+    for (uint32_t i = 0; i < PROVISIONER_DEVICE_TABLE_SIZE; i++)
     {
-        case NRF_MESH_PROV_EVT_UNPROVISIONED_RECEIVED:
-            if (m_prov_state == PROV_STATE_WAIT)
-            {
+        if (m_devices[i].state == PROV_DEVICE_PROVISIONED && m_devices[i].address == address)
+        {
+            return m_devices[i].uuid;
+        }
+    }
+    return NULL;
+}
 
-                __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "UUID seen", p_evt->params.unprov.device_uuid, NRF_MESH_UUID_SIZE);
-                if (!uuid_filter_compare(p_evt->params.unprov.device_uuid))
-                {
-                    break;
-                }
-                start_provisioning(p_evt->params.unprov.device_uuid);
-                m_prov_state = PROV_STATE_PROV;
-            }
+/* Starts node setup for the devices waiting for configuration, while node setup has free sessions */
+static void config_next(void)
+{
+    uint32_t start = m_config_cursor;
+    for (uint32_t i = 0; i < PROVISIONER_ADDRESS_POOL_SIZE; i++)
+    {
+        uint32_t bit = (start + i) % PROVISIONER_ADDRESS_POOL_SIZE;
+        if ((m_config_pending[bit / 32] & (1u << (bit % 32))) == 0)
+        {
+            continue;
+        }
+        uint16_t address = m_provisioner.p_nw_data->address_base + bit;
+        if (node_setup_start(address, PROVISIONER_RETRY_COUNT, m_provisioner.p_nw_data->appkey, APPKEY_INDEX,
+                             device_uuid_get(address)) != NRF_SUCCESS)
+        {
             break;
+        }
+        m_config_pending[bit / 32] &= ~(1u << (bit % 32));
+        m_config_cursor = (bit + 1) % PROVISIONER_ADDRESS_POOL_SIZE;
+    }
+}
 
-        case NRF_MESH_PROV_EVT_LINK_CLOSED:
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Local provisioning link closed: prov_state: %d  remaining retries: %d\n", m_prov_state, m_retry_cnt);
-            if (m_prov_state == PROV_STATE_PROV)
+static void config_enqueue(uint16_t address)
+{
+    address_map_update(m_config_pending, address, 1, true);
+    config_next();
+}
+
+static bool candidate_is_stale(const prov_candidate_t * p_candidate, timestamp_t now)
+{
+    return p_candidate->p_device->state != PROV_DEVICE_WAIT ||
+           (int32_t) (now - p_candidate->last_seen) > (int32_t) MS_TO_US(PROVISIONER_SCAN_AGE_MS);
+}
+
+/* Adds the device to the scanned list, or updates its RSSI. When the list is full, the device takes the place of a
+ * stale entry, or else of the weakest one, if it is stronger. */
+static void candidate_update(prov_device_t * p_device, int8_t rssi)
+{
+    timestamp_t now = timer_now();
+    prov_candidate_t * p_slot = NULL;
+    for (uint32_t i = 0; i < UNPROV_MAX_SCANNED_ITEMS_LIST; i++)
+    {
+        prov_candidate_t * p_candidate = &m_candidates[i];
+        if (p_candidate->p_device == p_device)
+        {
+            p_candidate->rssi = (int8_t) ((p_candidate->rssi + rssi) / 2);
+            p_candidate->last_seen = now;
+            return;
+        }
+        if (p_candidate->p_device == NULL || candidate_is_stale(p_candidate, now))
+        {
+            p_candidate->p_device = NULL;
+            p_slot = p_candidate;
+        }
+        else if (p_slot == NULL || (p_slot->p_device != NULL && p_candidate->rssi < p_slot->rssi))
+        {
+            p_slot = p_candidate;
+        }
+    }
+
+    if (p_slot->p_device == NULL || p_slot->rssi < rssi)
+    {
+        p_slot->p_device = p_device;
+        p_slot->rssi = rssi;
+        p_slot->last_seen = now;
+    }
+}
+
+/* Returns the strongest device of the scanned list that is not backing off, and drops the stale entries */
+static prov_candidate_t * candidate_best_get(void)
+{
+    timestamp_t now = timer_now();
+    prov_candidate_t * p_best = NULL;
+    for (uint32_t i = 0; i < UNPROV_MAX_SCANNED_ITEMS_LIST; i++)
+    {
+        prov_candidate_t * p_candidate = &m_candidates[i];
+        if (p_candidate->p_device == NULL)
+        {
+            continue;
+        }
+        if (candidate_is_stale(p_candidate, now))
+        {
+            p_candidate->p_device = NULL;
+            continue;
+        }
+        if ((int32_t) (now - p_candidate->p_device->next_attempt) >= 0 &&
+            (p_best == NULL || p_candidate->rssi > p_best->rssi))
+        {
+            p_best = p_candidate;
+        }
+    }
+    return p_best;
+}
+
+/* Gives the free links to the strongest devices of the scanned list */
+static void candidates_dispatch(void)
+{
+    prov_link_t * p_link;
+    prov_candidate_t * p_candidate;
+    while (m_prov_active && (p_link = link_free_get()) != NULL && (p_candidate = candidate_best_get()) != NULL)
+    {
+        prov_device_t * p_device = p_candidate->p_device;
+        p_candidate->p_device = NULL;
+
+        /* The range of a device is released when it runs out of retries, and reserved again when it comes back */
+        if (p_device->address == NRF_MESH_ADDR_UNASSIGNED)
+        {
+            if (!device_address_reserve(p_device, p_device->elements))
             {
-                if (m_retry_cnt)
-                {
-                    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning failed. Retrying...\n");
-                    m_prov_state = PROV_STATE_WAIT;
-                    m_retry_cnt--;
-                }
-                else
-                {
-                    __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Provisioning Failed. Code: %d, Could not assign node addr: 0x%04x\n",
-                          p_evt->params.failed.failure_code, m_target_address);
-                    m_prov_state = PROV_STATE_IDLE;
-                    m_provisioner.p_prov_failed_cb();
-                }
+                return;
             }
-            else if (m_prov_state == PROV_STATE_COMPLETE)
-            {
-                m_provisioner.p_nw_data->last_device_address = m_target_address;
-                m_provisioner.p_nw_data->provisioned_devices++;
-                m_provisioner.p_nw_data->next_device_address += m_target_elements;
-                m_provisioner.p_data_store_cb();
-                m_provisioner.p_prov_success_cb();
+            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Reserved node addr: 0x%04x\n", p_device->address);
+        }
+        __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning node addr: 0x%04x RSSI: %d\n", p_device->address, p_candidate->rssi);
+        start_provisioning(p_link, p_device);
+    }
+}
 
-                __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning complete. Node addr: 0x%04x elements: %d\n",
-                      m_provisioner.p_nw_data->last_device_address, m_target_elements);
+static void scan_window_timer_cb(timestamp_t timestamp, void * p_context)
+{
+    m_scan_window_open = false;
+    candidates_dispatch();
+}
 
-                node_setup_start(m_provisioner.p_nw_data->last_device_address, PROVISIONER_RETRY_COUNT,
-                m_provisioner.p_nw_data->appkey, APPKEY_INDEX);
-                m_prov_state = PROV_STATE_IDLE;
+static void unprovisioned_device_handle(const uint8_t * p_uuid, const nrf_mesh_rx_metadata_t * p_metadata)
+{
+    if (!m_prov_active)
+    {
+        return;
+    }
+
+    prov_device_t * p_device = device_lookup(p_uuid);
+    if (p_device == NULL)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Device table full\n");
+        return;
+    }
+
+    /* A configured device seen again has been reset, and is provisioned as a new one. An entry of another configured
+     * device is reused */
+    if (p_device->state == PROV_DEVICE_FREE || p_device->state == PROV_DEVICE_CONFIGURED)
+    {
+        if (!uuid_filter_compare(p_uuid))
+        {
+            return;
+        }
+        if (p_device->state == PROV_DEVICE_CONFIGURED && memcmp(p_device->uuid, p_uuid, NRF_MESH_UUID_SIZE) == 0)
+        {
+            device_address_remove(p_device);
+        }
+        __LOG_XB(LOG_SRC_APP, LOG_LEVEL_INFO, "UUID seen", p_uuid, NRF_MESH_UUID_SIZE);
+        memcpy(p_device->uuid, p_uuid, NRF_MESH_UUID_SIZE);
+        p_device->retry_cnt = m_retry_cnt;
+        p_device->state = PROV_DEVICE_WAIT;
+        p_device->address = NRF_MESH_ADDR_UNASSIGNED;
+        p_device->elements = PROVISIONER_DEVICE_ELEMENTS;
+        p_device->failures = 0;
+        p_device->next_attempt = timer_now();
+    }
+
+    if (p_device->state != PROV_DEVICE_WAIT)
+    {
+        return;
+    }
+
+    /* Beacons are collected for a scan window while a link is free, and the strongest devices are provisioned
+    first. A device backing off stays in the list, and leaves the link to the next one. */
+    int8_t rssi = INT8_MIN;
+    if (p_metadata != NULL && p_metadata->source == NRF_MESH_RX_SOURCE_SCANNER)
+    {
+        rssi = p_metadata->params.scanner.rssi;
+    }
+    candidate_update(p_device, rssi);
+    if (!m_scan_window_open && link_free_get() != NULL)
+    {
+        m_scan_window_open = true;
+        m_scan_window_timer.timestamp = timer_now() + MS_TO_US(PROVISIONER_SCAN_WINDOW_MS);
+        timer_sch_schedule(&m_scan_window_timer);
+    }
+}
+
+/* The provisioned device is taken into the network state, and queued for configuration */
+static void device_provisioned(prov_device_t * p_device)
+{
+    p_device->state = PROV_DEVICE_PROVISIONED;
+    device_address_commit(p_device);
+    m_last_elements = p_device->elements;
+    m_provisioner.p_nw_data->last_device_address = p_device->address;
+    m_provisioner.p_nw_data->provisioned_devices++;
+    m_provisioner.p_data_store_cb(NETWORK_STATE_CHANGE_DEVICE_PROVISIONED, p_device->address, p_device->elements);
+    m_provisioner.p_prov_success_cb();
+
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning complete. Node addr: 0x%04x elements: %d\n",
+          p_device->address, p_device->elements);
+
+    if (m_provisioner.p_nw_data->provisioned_devices >= m_device_count)
+    {
+        m_prov_active = false;
+        nrf_mesh_prov_scan_stop();
+    }
 
+    /* The device is configured while the other links go on provisioning */
+    m_config_failures[p_device->address - m_provisioner.p_nw_data->address_base] = 0;
+    config_enqueue(p_device->address);
+}
+
+/* Stores the device key of the device provisioned on the link in the device database. It is loaded into the DSM,
+ * and the config client bound to it, when node setup for the device sends its requests, since another device may be
+ * under configuration now. When the database has too many records waiting for flash, the key is kept in the link and
+ * stored again after a delay. The link is not freed meanwhile, so no other device is provisioned on it. */
+static void link_devkey_store(prov_link_t * p_link)
+{
+    uint32_t status = device_db_add(p_link->p_device->address, p_link->p_device->elements, p_link->devkey);
+    if (status == NRF_ERROR_NO_MEM)
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Device database full. Device key of 0x%04x stored later\n",
+              p_link->p_device->address);
+        p_link->devkey_pending = true;
+        if (!m_devkey_retry_scheduled)
+        {
+            m_devkey_retry_scheduled = true;
+            m_devkey_retry_timer.timestamp = timer_now() + MS_TO_US(PROVISIONER_BACKOFF_BASE_MS);
+            timer_sch_schedule(&m_devkey_retry_timer);
+        }
+        return;
+    }
+    ERROR_CHECK(status);
+    p_link->devkey_pending = false;
+}
+
+static void link_closed_handle(prov_link_t * p_link, const nrf_mesh_prov_evt_t * p_evt)
+{
+    prov_device_t * p_device = p_link->p_device;
+    if (p_device->state == PROV_DEVICE_COMPLETE && p_link->devkey_pending)
+    {
+        /* The device is provisioned once its device key is stored */
+        p_link->closed = true;
+        return;
+    }
+    p_link->p_device = NULL;
+
+    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning link closed: node addr: 0x%04x prov_state: %d  remaining retries: %d\n",
+          p_device->address, p_device->state, p_device->retry_cnt);
+    if (p_device->state == PROV_DEVICE_PROV)
+    {
+        /* The failed device goes back to the table, and does not hold the other links */
+        p_device->state = PROV_DEVICE_WAIT;
+        device_backoff(p_device);
+        if (p_device->retry_cnt)
+        {
+            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning failed. Retrying on a beacon after the backoff...\n");
+            p_device->retry_cnt--;
+        }
+        else
+        {
+            __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Provisioning Failed. Code: %d, Could not assign node addr: 0x%04x\n",
+                  p_evt->params.link_closed.close_reason, p_device->address);
+            p_device->retry_cnt = m_retry_cnt;
+            device_address_release(p_device);
+            m_provisioner.p_prov_failed_cb();
+        }
+    }
+    else if (p_device->state == PROV_DEVICE_COMPLETE)
+    {
+        device_provisioned(p_device);
+    }
+}
+
+static void devkey_retry_timer_cb(timestamp_t timestamp, void * p_context)
+{
+    m_devkey_retry_scheduled = false;
+    for (uint32_t i = 0; i < PROVISIONER_LINK_COUNT; i++)
+    {
+        prov_link_t * p_link = &m_links[i];
+        if (p_link->p_device == NULL || !p_link->devkey_pending)
+        {
+            continue;
+        }
+        link_devkey_store(p_link);
+        if (!p_link->devkey_pending && p_link->closed)
+        {
+            prov_device_t * p_device = p_link->p_device;
+            p_link->p_device = NULL;
+            device_provisioned(p_device);
+        }
+    }
+    candidates_dispatch();
+}
+
+/* Provisioning process event handling */
+static void prov_evt_handler(const nrf_mesh_prov_evt_t * p_evt)
+{
+    prov_link_t * p_link;
+
+    switch (p_evt->type)
+    {
+        case NRF_MESH_PROV_EVT_UNPROVISIONED_RECEIVED:
+            unprovisioned_device_handle(p_evt->params.unprov.device_uuid, p_evt->params.unprov.p_metadata);
+            break;
+
+        case NRF_MESH_PROV_EVT_LINK_CLOSED:
+            p_link = link_get(p_evt->params.link_closed.p_context);
+            if (p_link != NULL && p_link->p_device != NULL)
+            {
+                link_closed_handle(p_link, p_evt);
+                /* The devices already in the scanned list do not wait for a new scan window */
+                candidates_dispatch();
             }
             break;
 
         case NRF_MESH_PROV_EVT_COMPLETE:
         {
+            p_link = link_get(p_evt->params.complete.p_context);
+            NRF_MESH_ASSERT(p_link != NULL && p_link->p_device != NULL);
             __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning completed received\n");
-            m_prov_state = PROV_STATE_COMPLETE;
+            p_link->p_device->state = PROV_DEVICE_COMPLETE;
 
-            /* After provisioning completes, add corresponding node's address and device key to
-            local database */
             __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Adding device address, and device keys\n");
-            ERROR_CHECK(dsm_address_publish_add(p_evt->params.complete.p_prov_data->address,
-                                                &addr_handle));
-            ERROR_CHECK(dsm_devkey_add(p_evt->params.complete.p_prov_data->address,
-                                       m_provisioner.p_dev_data->m_netkey_handle,
-                                       p_evt->params.complete.p_devkey,
-                                       &devkey_handle));
-
-            /* Bind the device key to the configuration server and set the new node as the active server. */
-            ERROR_CHECK(config_client_server_bind(devkey_handle));
-            ERROR_CHECK(config_client_server_set(devkey_handle,
-                                                addr_handle));
-
-            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Addr: 0x%04x addr_handle: %d netkey_handle: %d devkey_handle: %d\n",
+            memcpy(p_link->devkey, p_evt->params.complete.p_devkey, NRF_MESH_KEY_SIZE);
+            link_devkey_store(p_link);
+
+            __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Addr: 0x%04x elements: %d netkey_handle: %d\n",
                   p_evt->params.complete.p_prov_data->address,
-                  addr_handle,
-                  m_provisioner.p_dev_data->m_netkey_handle,
-                  devkey_handle);
+                  p_link->p_device->elements,
+                  m_provisioner.p_dev_data->m_netkey_handle);
 
             break;
         }
 
         case NRF_MESH_PROV_EVT_CAPS_RECEIVED:
         {
-            m_target_elements = p_evt->params.oob_caps_received.oob_caps.num_elements;
+            p_link = link_get(p_evt->params.oob_caps_received.p_context);
+            NRF_MESH_ASSERT(p_link != NULL && p_link->p_device != NULL);
+            prov_device_t * p_device = p_link->p_device;
+            uint16_t elements = p_evt->params.oob_caps_received.oob_caps.num_elements;
+            if (elements > p_device->elements)
+            {
+                /* The reserved range is too small. Release it and reserve a new one for the next attempt, and
+                let this link time out. If the pool has no such range, it is tried again on the next beacon. */
+                device_address_release(p_device);
+                if (device_address_reserve(p_device, elements))
+                {
+                    __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Device has %d elements. Node addr moved to: 0x%04x\n",
+                          elements, p_device->address);
+                }
+                break;
+            }
+            p_device->elements = elements;
 
-            /* This example uses static OOB only. */
+            /* This example uses static OOB only. On failure, the link times out and the device is retried. */
             uint32_t status = nrf_mesh_prov_oob_use(p_evt->params.oob_caps_received.p_context,
                                                     NRF_MESH_PROV_OOB_METHOD_STATIC,
                                                     0,
                                                     NRF_MESH_KEY_SIZE);
             if (status != NRF_SUCCESS)
             {
-                __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Provisioning OOB selection rejected. Error: %d\n", status);
-                if (m_retry_cnt)
-                {
-                    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Retrying ...\n");
-                    m_prov_state = PROV_STATE_WAIT;
-                    m_retry_cnt--;
-                }
-                else
-                {
-                    __LOG(LOG_SRC_APP, LOG_LEVEL_INFO, "Provisioning Failed. Cannot select static OOB. \
-                    Could not assign node addr: 0x%04x\n", m_target_address);
-
-                    m_prov_state = PROV_STATE_IDLE;
-                    m_provisioner.p_prov_failed_cb();
-                }
+                __LOG(LOG_SRC_APP, LOG_LEVEL_ERROR, "Provisioning OOB selection rejected. Error: %d, node addr: 0x%04x\n",
+                      status, p_device->address);
             }
 
             break;
@@ -268,11 +808,16 @@ static void prov_evt_handler(const nrf_mesh_prov_evt_t * p_evt)
 
 }
 
-void prov_helper_provision_next_device(uint8_t retry_cnt, uint16_t address, prov_helper_uuid_filter_t * p_uuid_filter)
+void prov_helper_provision_devices(uint8_t retry_cnt, uint16_t device_count, prov_helper_uuid_filter_t * p_uuid_filter)
 {
     m_retry_cnt = retry_cnt;
-    m_target_address = address;
-    m_prov_state = PROV_STATE_WAIT;
+    m_device_count = device_count;
+    m_prov_active = true;
+
+    if (m_provisioner.p_nw_data->address_base == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        address_pool_init();
+    }
 
     NRF_MESH_ASSERT(p_uuid_filter->length <= NRF_MESH_UUID_SIZE);
     mp_expected_uuid= p_uuid_filter;
@@ -286,6 +831,42 @@ void prov_helper_scan_start(void)
     ERROR_CHECK(nrf_mesh_prov_scan_start(prov_evt_handler));
 }
 
+void prov_helper_config_enqueue(uint16_t address)
+{
+    m_config_failures[address - m_provisioner.p_nw_data->address_base] = 0;
+    config_enqueue(address);
+}
+
+bool prov_helper_config_done(uint16_t address, bool success)
+{
+    if (success)
+    {
+        /* The device table only holds the devices still being provisioned or configured */
+        for (uint32_t i = 0; i < PROVISIONER_DEVICE_TABLE_SIZE; i++)
+        {
+            if (m_devices[i].state == PROV_DEVICE_PROVISIONED && m_devices[i].address == address)
+            {
+                m_devices[i].state = PROV_DEVICE_CONFIGURED;
+                break;
+            }
+        }
+        config_next();
+        return true;
+    }
+
+    uint8_t * p_failures = &m_config_failures[address - m_provisioner.p_nw_data->address_base];
+    if (*p_failures >= PROVISIONER_CONFIG_RETRY_COUNT)
+    {
+        /* Left unconfigured. It keeps its address and its table entry, and is not provisioned again. */
+        config_next();
+        return false;
+    }
+    (*p_failures)++;
+    /* Retried after the devices already waiting */
+    config_enqueue(address);
+    return true;
+}
+
 void prov_helper_device_handles_load(void)
 {
     dsm_local_unicast_address_t local_addr;
@@ -312,7 +893,21 @@ void prov_helper_init(mesh_provisioner_init_params_t * p_prov_init_info)
 
     m_provisioner = *p_prov_init_info;
     m_provisioner_init_done = false;
-    m_prov_state = PROV_STATE_IDLE;
+    m_prov_active = false;
+    memset(m_config_pending, 0, sizeof(m_config_pending));
+    memset(m_config_failures, 0, sizeof(m_config_failures));
+    m_config_cursor = 0;
+    memset(m_devices, 0, sizeof(m_devices));
+    memset(m_candidates, 0, sizeof(m_candidates));
+    memset(m_address_reserved, 0, sizeof(m_address_reserved));
+    m_scan_window_open = false;
+    m_scan_window_timer.cb = scan_window_timer_cb;
+    m_scan_window_timer.interval = 0;
+    m_scan_window_timer.p_context = NULL;
+    m_devkey_retry_scheduled = false;
+    m_devkey_retry_timer.cb = devkey_retry_timer_cb;
+    m_devkey_retry_timer.interval = 0;
+    m_devkey_retry_timer.p_context = NULL;
 }
 
 void prov_helper_provision_self(void)
@@ -341,6 +936,6 @@ void prov_helper_provision_self(void)
 
 uint32_t prov_helper_element_count_get(void)
 {
-    return m_prov_ctx.capabilities.num_elements;
+    return m_last_elements;
 }
 
@@ -0,0 +1,124 @@
+#ifndef ACCESS_H__
+#define ACCESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_mesh.h"
+#include "device_state_manager.h"
+
+/** Subconjunto da camada de acesso (simulador). Os tipos seguem access.h do nRF5 SDK for Mesh */
+
+#define ACCESS_COMPANY_ID_NONE      (0xFFFF)
+#define ACCESS_COMPANY_ID_NORDIC    (0x0059)
+
+typedef uint16_t access_model_handle_t;
+#define ACCESS_HANDLE_INVALID (0xFFFF)
+
+typedef enum
+{
+    ACCESS_STATUS_SUCCESS                   = 0x00,
+    ACCESS_STATUS_INVALID_ADDRESS           = 0x01,
+    ACCESS_STATUS_INVALID_MODEL             = 0x02,
+    ACCESS_STATUS_INVALID_APPKEY            = 0x03,
+    ACCESS_STATUS_INVALID_NETKEY            = 0x04,
+    ACCESS_STATUS_INSUFFICIENT_RESOURCES    = 0x05,
+    ACCESS_STATUS_KEY_INDEX_ALREADY_STORED  = 0x06,
+    ACCESS_STATUS_INVALID_PUBLISH_PARAMS    = 0x07,
+    ACCESS_STATUS_NOT_A_SUBSCRIPTION_MODEL  = 0x08,
+    ACCESS_STATUS_STORAGE_FAILURE           = 0x09,
+    ACCESS_STATUS_FEATURE_NOT_SUPPORTED     = 0x0A,
+    ACCESS_STATUS_CANNOT_UPDATE             = 0x0B,
+    ACCESS_STATUS_CANNOT_REMOVE             = 0x0C,
+    ACCESS_STATUS_CANNOT_BIND               = 0x0D,
+    ACCESS_STATUS_TEMPORARILY_UNABLE_TO_CHANGE_STATE = 0x0E,
+    ACCESS_STATUS_CANNOT_SET                = 0x0F,
+    ACCESS_STATUS_UNSPECIFIED_ERROR         = 0x10,
+    ACCESS_STATUS_INVALID_BINDING           = 0x11
+} access_status_t;
+
+typedef enum
+{
+    ACCESS_PUBLISH_RESOLUTION_100MS = 0,
+    ACCESS_PUBLISH_RESOLUTION_1S    = 1,
+    ACCESS_PUBLISH_RESOLUTION_10S   = 2,
+    ACCESS_PUBLISH_RESOLUTION_10MIN = 3
+} access_publish_resolution_t;
+
+typedef struct
+{
+    uint8_t step_res : 2;
+    uint8_t step_num : 6;
+} access_publish_period_t;
+
+typedef struct
+{
+    uint16_t opcode;
+    uint16_t company_id;
+} access_opcode_t;
+
+#define ACCESS_OPCODE_SIG(opcode)               { (opcode), ACCESS_COMPANY_ID_NONE }
+#define ACCESS_OPCODE_VENDOR(opcode, company)   { (opcode), (company) }
+
+typedef struct
+{
+    uint16_t company_id;
+    uint16_t model_id;
+} access_model_id_t;
+
+typedef struct
+{
+    nrf_mesh_address_t src;
+    nrf_mesh_address_t dst;
+    uint8_t ttl;
+    dsm_handle_t appkey_handle;
+    dsm_handle_t subnet_handle;
+    const nrf_mesh_rx_metadata_t * p_core_metadata;
+} access_message_rx_meta_t;
+
+typedef struct
+{
+    access_opcode_t opcode;
+    const uint8_t * p_data;
+    uint16_t length;
+    access_message_rx_meta_t meta_data;
+} access_message_rx_t;
+
+typedef struct
+{
+    access_opcode_t opcode;
+    const uint8_t * p_buffer;
+    uint16_t length;
+    bool force_segmented;
+    nrf_mesh_transmic_size_t transmic_size;
+} access_message_tx_t;
+
+typedef void (*access_opcode_handler_cb_t)(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args);
+
+typedef struct
+{
+    access_opcode_t opcode;
+    access_opcode_handler_cb_t handler;
+} access_opcode_handler_t;
+
+typedef void (*access_publish_timeout_cb_t)(access_model_handle_t handle, void * p_args);
+
+typedef struct
+{
+    access_model_id_t model_id;
+    uint16_t element_index;
+    const access_opcode_handler_t * p_opcode_handlers;
+    uint32_t opcode_count;
+    void * p_args;
+    access_publish_timeout_cb_t publish_timeout_cb;
+} access_model_add_params_t;
+
+uint32_t access_model_add(const access_model_add_params_t * p_model_params, access_model_handle_t * p_model_handle);
+uint32_t access_model_publish(access_model_handle_t handle, const access_message_tx_t * p_message);
+uint32_t access_model_reply(access_model_handle_t handle, const access_message_rx_t * p_message, const access_message_tx_t * p_reply);
+uint32_t access_model_publish_address_get(access_model_handle_t handle, dsm_handle_t * p_address_handle);
+uint32_t access_model_subscription_list_alloc(access_model_handle_t handle);
+uint32_t access_model_application_bind(access_model_handle_t handle, dsm_handle_t appkey_handle);
+uint32_t access_model_publish_application_set(access_model_handle_t handle, dsm_handle_t appkey_handle);
+void access_flash_config_store(void);
+
+#endif /* ACCESS_H__ */
@@ -0,0 +1,7 @@
+#ifndef ACCESS_CONFIG_H__
+#define ACCESS_CONFIG_H__
+
+#include "access.h"
+#include "nrf_mesh_config_app.h"
+
+#endif /* ACCESS_CONFIG_H__ */
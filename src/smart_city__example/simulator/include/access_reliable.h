@@ -0,0 +1,6 @@
+#ifndef ACCESS_RELIABLE_H__
+#define ACCESS_RELIABLE_H__
+
+#include "access.h"
+
+#endif /* ACCESS_RELIABLE_H__ */
@@ -0,0 +1,22 @@
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+/** Tratamento de erros do nRF5 SDK. No simulador o erro é reportado com o nó que o gerou e a simulação é abortada */
+void sim_app_error(uint32_t err_code, const char * p_file, uint32_t line);
+
+#define APP_ERROR_HANDLER(ERR_CODE) sim_app_error((ERR_CODE), __FILE__, __LINE__)
+
+#define APP_ERROR_CHECK(ERR_CODE)                           \
+    do                                                      \
+    {                                                       \
+        const uint32_t LOCAL_ERR_CODE = (ERR_CODE);         \
+        if (LOCAL_ERR_CODE != NRF_SUCCESS)                  \
+        {                                                   \
+            APP_ERROR_HANDLER(LOCAL_ERR_CODE);              \
+        }                                                   \
+    } while (0)
+
+#endif /* APP_ERROR_H__ */
@@ -0,0 +1,47 @@
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_error.h"
+#include "sdk_errors.h"
+
+/** app_timer do nRF5 SDK (simulador). O contador de 24 bits do RTC (32768 Hz) é derivado do relógio virtual */
+#define APP_TIMER_CLOCK_FREQ            (32768)
+#define APP_TIMER_MAX_CNT_VAL           (0x00FFFFFF)
+#define APP_TIMER_MIN_TIMEOUT_TICKS     (5)
+
+#define APP_TIMER_TICKS(MS) ((uint32_t) (((uint64_t) (MS) * APP_TIMER_CLOCK_FREQ + 500) / 1000))
+
+typedef void (*app_timer_timeout_handler_t)(void * p_context);
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+typedef struct
+{
+    app_timer_timeout_handler_t handler;
+    app_timer_mode_t mode;
+    uint32_t interval;
+    void * p_context;
+    uint32_t generation;
+    bool running;
+} app_timer_t;
+
+typedef app_timer_t * app_timer_id_t;
+
+#define APP_TIMER_DEF(timer_id)                         \
+    static app_timer_t timer_id##_data = { 0 };         \
+    static const app_timer_id_t timer_id = &timer_id##_data
+
+ret_code_t app_timer_init(void);
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler);
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
+ret_code_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_cnt_get(void);
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from);
+
+#endif /* APP_TIMER_H__ */
@@ -0,0 +1,8 @@
+#ifndef BOARDS_H__
+#define BOARDS_H__
+
+/** Placa de desenvolvimento. O simulador não tem LEDs nem botões */
+#define LEDS_NUMBER     (0)
+#define BUTTONS_NUMBER  (0)
+
+#endif /* BOARDS_H__ */
@@ -0,0 +1,28 @@
+#ifndef COMPOSITION_DATA_H__
+#define COMPOSITION_DATA_H__
+
+#include <stdint.h>
+
+/** Formato da página 0 dos dados de composição (Mesh Profile 4.2.1) */
+#define CONFIG_FEATURE_RELAY_BIT        (1 << 0)
+#define CONFIG_FEATURE_PROXY_BIT        (1 << 1)
+#define CONFIG_FEATURE_FRIEND_BIT       (1 << 2)
+#define CONFIG_FEATURE_LOW_POWER_BIT    (1 << 3)
+
+typedef struct __attribute((packed))
+{
+    uint16_t company_id;
+    uint16_t product_id;
+    uint16_t version_id;
+    uint16_t replay_cache_entries;
+    uint16_t features;
+} config_composition_data_header_t;
+
+typedef struct __attribute((packed))
+{
+    uint16_t location;
+    uint8_t sig_model_count;
+    uint8_t vendor_model_count;
+} config_composition_element_header_t;
+
+#endif /* COMPOSITION_DATA_H__ */
@@ -0,0 +1,53 @@
+#ifndef CONFIG_CLIENT_H__
+#define CONFIG_CLIENT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "access.h"
+#include "device_state_manager.h"
+#include "config_opcodes.h"
+#include "config_messages.h"
+
+/** Cliente de configuração (simulador). Cada pedido é uma mensagem confiável: é retransmitido até chegar o status
+ *  esperado ou até o tempo limite, e somente um pedido pode estar pendente de cada vez */
+#define CONFIG_CLIENT_MODEL_ID  (0x0001)
+
+typedef enum
+{
+    CONFIG_CLIENT_EVENT_TYPE_MSG,
+    CONFIG_CLIENT_EVENT_TYPE_TIMEOUT,
+    CONFIG_CLIENT_EVENT_TYPE_CANCELLED
+} config_client_event_type_t;
+
+typedef struct
+{
+    config_opcode_t opcode;
+    const config_msg_t * p_msg;
+} config_client_event_t;
+
+typedef void (*config_client_event_cb_t)(config_client_event_type_t event_type, const config_client_event_t * p_event, uint16_t length);
+
+typedef struct
+{
+    uint16_t element_address;
+    nrf_mesh_address_t publish_address;
+    uint16_t appkey_index;
+    bool frendship_credential_flag;
+    uint8_t publish_ttl;
+    access_publish_period_t publish_period;
+    uint8_t retransmit_count;
+    uint8_t retransmit_interval;
+    access_model_id_t model_id;
+} config_publication_state_t;
+
+uint32_t config_client_init(config_client_event_cb_t event_cb);
+uint32_t config_client_server_bind(dsm_handle_t server_devkey);
+uint32_t config_client_server_set(dsm_handle_t server_devkey, dsm_handle_t server_address);
+uint32_t config_client_composition_data_get(uint8_t page_number);
+uint32_t config_client_appkey_add(uint16_t netkey_index, uint16_t appkey_index, const uint8_t * p_appkey);
+uint32_t config_client_model_app_bind(uint16_t element_address, uint16_t appkey_index, access_model_id_t model_id);
+uint32_t config_client_model_publication_set(const config_publication_state_t * p_publication_state);
+uint32_t config_client_model_subscription_add(uint16_t element_address, nrf_mesh_address_t address, access_model_id_t model_id);
+void config_client_pending_msg_cancel(void);
+
+#endif /* CONFIG_CLIENT_H__ */
@@ -0,0 +1,58 @@
+#ifndef CONFIG_MESSAGES_H__
+#define CONFIG_MESSAGES_H__
+
+#include <stdint.h>
+#include "nrf_mesh_defines.h"
+
+/** Mensagens de status do modelo de configuração, no formato em que trafegam na rede */
+
+typedef struct __attribute((packed))
+{
+    uint8_t status;
+    uint8_t key_indexes[3];
+} config_msg_appkey_status_t;
+
+typedef struct __attribute((packed))
+{
+    uint8_t status;
+    uint16_t element_address;
+    uint16_t appkey_index;
+    uint16_t model_id[2];
+} config_msg_app_status_t;
+
+typedef struct __attribute((packed))
+{
+    uint8_t status;
+    uint16_t element_address;
+    uint16_t publish_address;
+    uint16_t state;
+    uint8_t publish_ttl;
+    uint8_t publish_period;
+    uint8_t retransmit;
+    uint16_t model_id[2];
+} config_msg_publication_status_t;
+
+typedef struct __attribute((packed))
+{
+    uint8_t status;
+    uint16_t element_address;
+    uint16_t address;
+    uint16_t model_id[2];
+} config_msg_subscription_status_t;
+
+typedef struct __attribute((packed))
+{
+    uint8_t page_number;
+    uint8_t data[NRF_MESH_SEG_PAYLOAD_SIZE_MAX];
+} config_msg_composition_data_status_t;
+
+typedef union
+{
+    config_msg_appkey_status_t appkey_status;
+    config_msg_app_status_t app_status;
+    config_msg_publication_status_t publication_status;
+    config_msg_subscription_status_t subscription_status;
+    config_msg_composition_data_status_t composition_data_status;
+} config_msg_t;
+
+#endif /* CONFIG_MESSAGES_H__ */
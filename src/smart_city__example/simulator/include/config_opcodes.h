@@ -0,0 +1,21 @@
+#ifndef CONFIG_OPCODES_H__
+#define CONFIG_OPCODES_H__
+
+/** Opcodes do modelo de configuração usados pelos exemplos */
+typedef enum
+{
+    CONFIG_OPCODE_APPKEY_ADD                    = 0x00,
+    CONFIG_OPCODE_COMPOSITION_DATA_STATUS       = 0x02,
+    CONFIG_OPCODE_MODEL_PUBLICATION_SET         = 0x03,
+    CONFIG_OPCODE_APPKEY_STATUS                 = 0x8003,
+    CONFIG_OPCODE_COMPOSITION_DATA_GET          = 0x8008,
+    CONFIG_OPCODE_MODEL_PUBLICATION_STATUS      = 0x8019,
+    CONFIG_OPCODE_MODEL_SUBSCRIPTION_ADD        = 0x801B,
+    CONFIG_OPCODE_MODEL_SUBSCRIPTION_STATUS     = 0x801F,
+    CONFIG_OPCODE_MODEL_APP_BIND                = 0x803D,
+    CONFIG_OPCODE_MODEL_APP_STATUS              = 0x803E,
+    CONFIG_OPCODE_NODE_RESET                    = 0x8049,
+    CONFIG_OPCODE_NODE_RESET_STATUS             = 0x804A
+} config_opcode_t;
+
+#endif /* CONFIG_OPCODES_H__ */
@@ -0,0 +1,30 @@
+#ifndef CONFIG_SERVER_H__
+#define CONFIG_SERVER_H__
+
+#include <stdint.h>
+#include "device_state_manager.h"
+#include "composition_data.h"
+
+/** Servidor de configuração (simulador). Os pedidos do cliente de configuração são tratados pelo simulador
+ *  sobre o estado do nó; a aplicação recebe somente os eventos abaixo */
+#define CONFIG_SERVER_MODEL_ID  (0x0000)
+
+typedef enum
+{
+    CONFIG_SERVER_EVT_APPKEY_ADD,
+    CONFIG_SERVER_EVT_MODEL_APP_BIND,
+    CONFIG_SERVER_EVT_MODEL_PUBLICATION_SET,
+    CONFIG_SERVER_EVT_MODEL_SUBSCRIPTION_ADD,
+    CONFIG_SERVER_EVT_NODE_RESET
+} config_server_evt_type_t;
+
+typedef struct
+{
+    config_server_evt_type_t type;
+} config_server_evt_t;
+
+typedef void (*config_server_evt_cb_t)(const config_server_evt_t * p_evt);
+
+uint32_t config_server_bind(dsm_handle_t devkey_handle);
+
+#endif /* CONFIG_SERVER_H__ */
@@ -0,0 +1,35 @@
+#ifndef DEVICE_STATE_MANAGER_H__
+#define DEVICE_STATE_MANAGER_H__
+
+#include <stdint.h>
+#include "nrf_mesh.h"
+
+/** Subconjunto do gerenciador de estado do dispositivo (simulador).
+ *  Cada nó simulado tem as suas tabelas de endereços e chaves; as chaves são guardadas mas não há criptografia.
+ *  Uma posição removida fica livre para a próxima inclusão, e o seu handle deixa de ser válido */
+typedef uint16_t dsm_handle_t;
+#define DSM_HANDLE_INVALID (0xFFFF)
+
+typedef struct
+{
+    uint16_t address_start;
+    uint16_t count;
+} dsm_local_unicast_address_t;
+
+uint32_t dsm_local_unicast_addresses_set(const dsm_local_unicast_address_t * p_address);
+void dsm_local_unicast_addresses_get(dsm_local_unicast_address_t * p_address);
+
+uint32_t dsm_address_publish_add(uint16_t raw_address, dsm_handle_t * p_address_handle);
+uint32_t dsm_address_handle_get(const nrf_mesh_address_t * p_address, dsm_handle_t * p_address_handle);
+uint32_t dsm_address_get(dsm_handle_t address_handle, nrf_mesh_address_t * p_address);
+uint32_t dsm_address_publish_remove(dsm_handle_t address_handle);
+
+uint32_t dsm_subnet_add(uint16_t net_key_id, const uint8_t * p_key, dsm_handle_t * p_subnet_handle);
+uint32_t dsm_subnet_get_all(dsm_handle_t * p_key_list, uint32_t * p_count);
+uint32_t dsm_appkey_add(uint16_t app_key_id, dsm_handle_t subnet_handle, const uint8_t * p_key, dsm_handle_t * p_app_handle);
+uint32_t dsm_appkey_get_all(dsm_handle_t subnet_handle, dsm_handle_t * p_key_list, uint32_t * p_count);
+uint32_t dsm_devkey_add(uint16_t raw_unicast_addr, dsm_handle_t subnet_handle, const uint8_t * p_key, dsm_handle_t * p_devkey_handle);
+uint32_t dsm_devkey_handle_get(uint16_t unicast_address, dsm_handle_t * p_devkey_handle);
+uint32_t dsm_devkey_delete(dsm_handle_t devkey_handle);
+
+#endif /* DEVICE_STATE_MANAGER_H__ */
@@ -0,0 +1,6 @@
+#ifndef FLASH_MANAGER_H__
+#define FLASH_MANAGER_H__
+
+/** O simulador é compilado com PERSISTENT_STORAGE = 0 (ver nrf_mesh_config_examples.h); não há gerenciador de flash */
+
+#endif /* FLASH_MANAGER_H__ */
@@ -0,0 +1,51 @@
+#ifndef HEALTH_CLIENT_H__
+#define HEALTH_CLIENT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "access.h"
+#include "health_common.h"
+
+/** Cliente Health (simulador). Somente a recepção de Current Status é tratada */
+typedef enum
+{
+    HEALTH_CLIENT_EVT_TYPE_CURRENT_STATUS_RECEIVED,
+    HEALTH_CLIENT_EVT_TYPE_FAULT_STATUS_RECEIVED,
+    HEALTH_CLIENT_EVT_TYPE_PERIOD_STATUS_RECEIVED,
+    HEALTH_CLIENT_EVT_TYPE_ATTENTION_STATUS_RECEIVED,
+    HEALTH_CLIENT_EVT_TYPE_TIMEOUT,
+    HEALTH_CLIENT_EVT_TYPE_CANCELLED
+} health_client_evt_type_t;
+
+typedef struct
+{
+    uint8_t test_id;
+    uint16_t company_id;
+    uint8_t fault_array_length;
+    const uint8_t * p_fault_array;
+} health_client_evt_fault_status_t;
+
+typedef struct
+{
+    health_client_evt_type_t type;
+    const access_message_rx_meta_t * p_meta_data;
+    union
+    {
+        health_client_evt_fault_status_t fault_status;
+    } data;
+} health_client_evt_t;
+
+typedef struct __health_client_t health_client_t;
+
+typedef void (*health_client_evt_cb_t)(const health_client_t * p_client, const health_client_evt_t * p_event);
+
+struct __health_client_t
+{
+    access_model_handle_t model_handle;
+    health_client_evt_cb_t event_handler;
+    bool waiting_for_reply;
+};
+
+uint32_t health_client_init(health_client_t * p_client, uint16_t element_index, health_client_evt_cb_t evt_handler);
+
+#endif /* HEALTH_CLIENT_H__ */
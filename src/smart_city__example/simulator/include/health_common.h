@@ -0,0 +1,10 @@
+#ifndef HEALTH_COMMON_H__
+#define HEALTH_COMMON_H__
+
+#define HEALTH_SERVER_MODEL_ID  (0x0002)
+#define HEALTH_CLIENT_MODEL_ID  (0x0003)
+
+#define HEALTH_OPCODE_CURRENT_STATUS    (0x04)
+#define HEALTH_OPCODE_FAULT_STATUS      (0x05)
+
+#endif /* HEALTH_COMMON_H__ */
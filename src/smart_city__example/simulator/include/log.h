@@ -0,0 +1,55 @@
+#ifndef LOG_H__
+#define LOG_H__
+
+#include <stdint.h>
+
+/** Log da mesh (RTT). No simulador as mensagens vão para stderr, prefixadas pelo instante virtual e pelo nó.
+ *  Como no SDK, __LOG é um bloco if sem do/while */
+#define LOG_SRC_BEARER      (1 << 0)
+#define LOG_SRC_NETWORK     (1 << 1)
+#define LOG_SRC_TRANSPORT   (1 << 2)
+#define LOG_SRC_PROV        (1 << 3)
+#define LOG_SRC_PACMAN      (1 << 4)
+#define LOG_SRC_INTERNAL    (1 << 5)
+#define LOG_SRC_API         (1 << 6)
+#define LOG_SRC_DFU         (1 << 7)
+#define LOG_SRC_BEACON      (1 << 8)
+#define LOG_SRC_TEST        (1 << 9)
+#define LOG_SRC_ENC         (1 << 10)
+#define LOG_SRC_TIMER_SCHEDULER (1 << 11)
+#define LOG_SRC_CCM         (1 << 12)
+#define LOG_SRC_ACCESS      (1 << 13)
+#define LOG_SRC_APP         (1 << 14)
+#define LOG_SRC_SERIAL      (1 << 15)
+
+#define LOG_LEVEL_ASSERT    (0)
+#define LOG_LEVEL_ERROR     (1)
+#define LOG_LEVEL_WARN      (2)
+#define LOG_LEVEL_REPORT    (3)
+#define LOG_LEVEL_INFO      (4)
+#define LOG_LEVEL_DBG1      (5)
+#define LOG_LEVEL_DBG2      (6)
+#define LOG_LEVEL_DBG3      (7)
+
+#define LOG_CALLBACK_DEFAULT (0)
+
+extern int g_sim_log_level;
+
+void sim_log_printf(uint32_t level, const char * p_filename, uint16_t line, const char * format, ...) __attribute__((format(printf, 4, 5)));
+void sim_log_hex(uint32_t level, const char * msg, const uint8_t * p_data, uint32_t len);
+
+#define __LOG_INIT(msk, level, callback)    ((void) (msk), (void) (level), (void) (callback))
+
+#define __LOG(source, level, ...)                                       \
+    if ((int) (level) <= g_sim_log_level)                               \
+    {                                                                   \
+        sim_log_printf((level), __FILE__, __LINE__, __VA_ARGS__);       \
+    }
+
+#define __LOG_XB(source, level, msg, array, array_len)                  \
+    if ((int) (level) <= g_sim_log_level)                               \
+    {                                                                   \
+        sim_log_hex((level), (msg), (const uint8_t *) (array), (array_len)); \
+    }
+
+#endif /* LOG_H__ */
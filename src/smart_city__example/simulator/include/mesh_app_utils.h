@@ -0,0 +1,18 @@
+#ifndef MESH_APP_UTILS_H__
+#define MESH_APP_UTILS_H__
+
+#include <stdint.h>
+#include "app_error.h"
+
+/** Utilitários dos exemplos da mesh (simulador) */
+#define ERROR_CHECK(ERR_CODE) APP_ERROR_CHECK(ERR_CODE)
+
+typedef void (*mesh_app_start_cb_t)(void);
+
+/** No dispositivo real a função espera o SoftDevice; no simulador invoca @p start_cb imediatamente */
+void execution_start(mesh_app_start_cb_t start_cb);
+
+/** Gera o UUID do dispositivo: prefixo seguido de bytes derivados do índice do nó simulado */
+uint32_t mesh_app_uuid_gen(uint8_t * p_uuid, const uint8_t * p_name_prefix, uint8_t name_prefix_size);
+
+#endif /* MESH_APP_UTILS_H__ */
@@ -0,0 +1,18 @@
+#ifndef MESH_PROVISIONEE_H__
+#define MESH_PROVISIONEE_H__
+
+#include <stdint.h>
+
+/** Provisionamento do lado do dispositivo (simulador). O nó anuncia o beacon não provisionado até ser provisionado */
+typedef void (*mesh_provisionee_prov_complete_cb_t)(void);
+
+typedef struct
+{
+    mesh_provisionee_prov_complete_cb_t prov_complete_cb;
+    const uint8_t * p_static_data;
+    const char * p_device_uri;
+} mesh_provisionee_start_params_t;
+
+uint32_t mesh_provisionee_prov_start(const mesh_provisionee_start_params_t * p_start_params);
+
+#endif /* MESH_PROVISIONEE_H__ */
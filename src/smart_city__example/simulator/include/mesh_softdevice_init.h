@@ -0,0 +1,9 @@
+#ifndef MESH_SOFTDEVICE_INIT_H__
+#define MESH_SOFTDEVICE_INIT_H__
+
+#include <stdint.h>
+#include "nrf_sdm.h"
+
+uint32_t mesh_softdevice_init(nrf_clock_lf_cfg_t lfc_cfg);
+
+#endif /* MESH_SOFTDEVICE_INIT_H__ */
@@ -0,0 +1,34 @@
+#ifndef MESH_STACK_H__
+#define MESH_STACK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_mesh.h"
+#include "config_server.h"
+
+/** Inicialização da pilha (simulador). O servidor de configuração e o servidor Health são embutidos em cada nó */
+typedef void (*mesh_stack_models_init_cb_t)(void);
+
+typedef struct
+{
+    uint8_t irq_priority;
+    nrf_clock_lf_cfg_t lfclksrc;
+    const uint8_t * p_uuid;
+} nrf_mesh_init_params_t;
+
+typedef struct
+{
+    nrf_mesh_init_params_t core;
+    struct
+    {
+        mesh_stack_models_init_cb_t models_init_cb;
+        config_server_evt_cb_t config_server_cb;
+    } models;
+} mesh_stack_init_params_t;
+
+uint32_t mesh_stack_init(const mesh_stack_init_params_t * p_init_params, bool * p_device_provisioned);
+uint32_t mesh_stack_start(void);
+void mesh_stack_device_reset(void);
+bool mesh_stack_is_device_provisioned(void);
+
+#endif /* MESH_STACK_H__ */
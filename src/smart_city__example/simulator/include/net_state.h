@@ -0,0 +1,6 @@
+#ifndef NET_STATE_H__
+#define NET_STATE_H__
+
+/** Estado da rede (IV index, sequência). Mantido pelo simulador, sem API para a aplicação */
+
+#endif /* NET_STATE_H__ */
@@ -0,0 +1,10 @@
+#ifndef NRF_DELAY_H__
+#define NRF_DELAY_H__
+
+#include <stdint.h>
+
+/** Espera ativa. No simulador não consome tempo virtual */
+static inline void nrf_delay_ms(uint32_t ms) { (void) ms; }
+static inline void nrf_delay_us(uint32_t us) { (void) us; }
+
+#endif /* NRF_DELAY_H__ */
@@ -0,0 +1,68 @@
+#ifndef NRF_MESH_H__
+#define NRF_MESH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_error.h"
+#include "nrf_sdm.h"
+#include "nrf_mesh_defines.h"
+#include "nrf_mesh_assert.h"
+
+/** Subconjunto de nrf_mesh.h usado pelas aplicações (simulador) */
+#define NRF_MESH_IRQ_PRIORITY_LOWEST    (7)
+#define NRF_MESH_IRQ_PRIORITY_THREAD    (15)
+
+typedef enum
+{
+    NRF_MESH_TRANSMIC_SIZE_SMALL,
+    NRF_MESH_TRANSMIC_SIZE_LARGE,
+    NRF_MESH_TRANSMIC_SIZE_DEFAULT,
+    NRF_MESH_TRANSMIC_SIZE_INVALID
+} nrf_mesh_transmic_size_t;
+
+typedef enum
+{
+    NRF_MESH_ADDRESS_TYPE_INVALID,
+    NRF_MESH_ADDRESS_TYPE_UNICAST,
+    NRF_MESH_ADDRESS_TYPE_VIRTUAL,
+    NRF_MESH_ADDRESS_TYPE_GROUP
+} nrf_mesh_address_type_t;
+
+typedef struct
+{
+    nrf_mesh_address_type_t type;
+    uint16_t value;
+    const uint8_t * p_virtual_uuid;
+} nrf_mesh_address_t;
+
+typedef enum
+{
+    NRF_MESH_RX_SOURCE_SCANNER,
+    NRF_MESH_RX_SOURCE_GATT,
+    NRF_MESH_RX_SOURCE_FRIEND,
+    NRF_MESH_RX_SOURCE_LOW_POWER,
+    NRF_MESH_RX_SOURCE_INSTABURST,
+    NRF_MESH_RX_SOURCE_LOOPBACK
+} nrf_mesh_rx_source_t;
+
+/** Metadados da recepção. No simulador o RSSI é derivado da distância entre os nós */
+typedef struct
+{
+    nrf_mesh_rx_source_t source;
+    union
+    {
+        struct
+        {
+            uint32_t timestamp;
+            uint32_t access_addr;
+            uint8_t channel;
+            int8_t rssi;
+        } scanner;
+    } params;
+} nrf_mesh_rx_metadata_t;
+
+uint32_t nrf_mesh_enable(void);
+/** No simulador os eventos da pilha são tratados nos eventos do nó, antes do laço principal: nada fica pendente */
+bool nrf_mesh_process(void);
+
+#endif /* NRF_MESH_H__ */
@@ -0,0 +1,18 @@
+#ifndef NRF_MESH_ASSERT_H__
+#define NRF_MESH_ASSERT_H__
+
+#include <stdint.h>
+
+/** Asserção da mesh. No simulador a falha identifica o nó e aborta a simulação */
+void sim_assert_fail(const char * p_file, uint32_t line);
+
+#define NRF_MESH_ASSERT(cond)                       \
+    do                                              \
+    {                                               \
+        if (!(cond))                                \
+        {                                           \
+            sim_assert_fail(__FILE__, __LINE__);    \
+        }                                           \
+    } while (0)
+
+#endif /* NRF_MESH_ASSERT_H__ */
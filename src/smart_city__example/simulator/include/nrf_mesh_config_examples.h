@@ -0,0 +1,17 @@
+#ifndef NRF_MESH_CONFIG_EXAMPLES_H__
+#define NRF_MESH_CONFIG_EXAMPLES_H__
+
+#include "nrf_sdm.h"
+
+/** Sem flash no simulador: os exemplos iniciam sem restaurar estado */
+#define PERSISTENT_STORAGE  (0)
+
+#define DEV_BOARD_LF_CLK_CFG    \
+    {                           \
+        .source = NRF_CLOCK_LF_SRC_XTAL, \
+        .rc_ctiv = 0,           \
+        .rc_temp_ctiv = 0,      \
+        .accuracy = NRF_CLOCK_LF_ACCURACY_20_PPM \
+    }
+
+#endif /* NRF_MESH_CONFIG_EXAMPLES_H__ */
@@ -0,0 +1,8 @@
+#ifndef NRF_MESH_CONFIGURE_H__
+#define NRF_MESH_CONFIGURE_H__
+
+#include <stdint.h>
+
+const uint8_t * nrf_mesh_configure_device_uuid_get(void);
+
+#endif /* NRF_MESH_CONFIGURE_H__ */
@@ -0,0 +1,16 @@
+#ifndef NRF_MESH_DEFINES_H__
+#define NRF_MESH_DEFINES_H__
+
+/** Constantes da mesh (simulador) */
+#define NRF_MESH_KEY_SIZE               (16)
+#define NRF_MESH_UUID_SIZE              (16)
+#define NRF_MESH_TTL_MAX                (0x7F)
+#define NRF_MESH_SEG_PAYLOAD_SIZE_MAX   (384)
+#define NRF_MESH_UNSEG_PAYLOAD_SIZE_MAX (11)
+#define NRF_MESH_SEG_SIZE               (12)
+#define NRF_MESH_TRANSMIC_SIZE          (4)
+
+#define NRF_MESH_ADDR_UNASSIGNED        (0x0000)
+#define NRF_MESH_ALL_NODES_ADDR         (0xFFFF)
+
+#endif /* NRF_MESH_DEFINES_H__ */
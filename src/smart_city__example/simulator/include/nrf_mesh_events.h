@@ -0,0 +1,37 @@
+#ifndef NRF_MESH_EVENTS_H__
+#define NRF_MESH_EVENTS_H__
+
+#include <stdint.h>
+#include "nrf_mesh.h"
+
+/** Eventos do núcleo da mesh (simulador). Sem armazenamento persistente, somente FLASH_STABLE é gerado */
+typedef enum
+{
+    NRF_MESH_EVT_MESSAGE_RECEIVED,
+    NRF_MESH_EVT_TX_COMPLETE,
+    NRF_MESH_EVT_IV_UPDATE_NOTIFICATION,
+    NRF_MESH_EVT_KEY_REFRESH_NOTIFICATION,
+    NRF_MESH_EVT_NET_BEACON_RECEIVED,
+    NRF_MESH_EVT_HB_MESSAGE_RECEIVED,
+    NRF_MESH_EVT_DFU_REQ_RELAY,
+    NRF_MESH_EVT_FLASH_STABLE,
+    NRF_MESH_EVT_RX_FAILED,
+    NRF_MESH_EVT_SAR_FAILED
+} nrf_mesh_evt_type_t;
+
+typedef struct
+{
+    nrf_mesh_evt_type_t type;
+} nrf_mesh_evt_t;
+
+typedef void (*nrf_mesh_evt_handler_cb_t)(const nrf_mesh_evt_t * p_evt);
+
+typedef struct nrf_mesh_evt_handler
+{
+    nrf_mesh_evt_handler_cb_t evt_cb;
+    struct nrf_mesh_evt_handler * p_next;
+} nrf_mesh_evt_handler_t;
+
+void nrf_mesh_evt_handler_add(nrf_mesh_evt_handler_t * p_handler_params);
+
+#endif /* NRF_MESH_EVENTS_H__ */
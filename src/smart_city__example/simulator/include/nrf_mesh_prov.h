@@ -0,0 +1,20 @@
+#ifndef NRF_MESH_PROV_H__
+#define NRF_MESH_PROV_H__
+
+#include <stdint.h>
+#include "nrf_mesh_prov_types.h"
+#include "nrf_mesh_prov_events.h"
+
+/** API do provisionador (simulador). Somente dispositivos ao alcance direto do provisionador são vistos (PB-ADV) */
+uint32_t nrf_mesh_prov_generate_keys(uint8_t * p_public, uint8_t * p_private);
+uint32_t nrf_mesh_prov_init(nrf_mesh_prov_ctx_t * p_ctx, const uint8_t * p_public_key, const uint8_t * p_private_key,
+                            const nrf_mesh_prov_oob_caps_t * p_caps, nrf_mesh_prov_evt_handler_cb_t event_handler);
+uint32_t nrf_mesh_prov_bearer_add(nrf_mesh_prov_ctx_t * p_ctx, prov_bearer_t * p_prov_bearer);
+uint32_t nrf_mesh_prov_provision(nrf_mesh_prov_ctx_t * p_ctx, const uint8_t * p_target_uuid,
+                                 const nrf_mesh_prov_provisioning_data_t * p_data, nrf_mesh_prov_bearer_type_t bearer);
+uint32_t nrf_mesh_prov_oob_use(nrf_mesh_prov_ctx_t * p_ctx, nrf_mesh_prov_oob_method_t method, uint8_t action, uint8_t size);
+uint32_t nrf_mesh_prov_auth_data_provide(nrf_mesh_prov_ctx_t * p_ctx, const uint8_t * p_data, uint8_t size);
+uint32_t nrf_mesh_prov_scan_start(nrf_mesh_prov_evt_handler_cb_t event_handler);
+void nrf_mesh_prov_scan_stop(void);
+
+#endif /* NRF_MESH_PROV_H__ */
@@ -0,0 +1,13 @@
+#ifndef NRF_MESH_PROV_BEARER_ADV_H__
+#define NRF_MESH_PROV_BEARER_ADV_H__
+
+#include "nrf_mesh_prov_types.h"
+
+typedef struct
+{
+    prov_bearer_t prov_bearer;
+} nrf_mesh_prov_bearer_adv_t;
+
+prov_bearer_t * nrf_mesh_prov_bearer_adv_interface_get(nrf_mesh_prov_bearer_adv_t * p_bearer_adv);
+
+#endif /* NRF_MESH_PROV_BEARER_ADV_H__ */
@@ -0,0 +1,83 @@
+#ifndef NRF_MESH_PROV_EVENTS_H__
+#define NRF_MESH_PROV_EVENTS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_mesh.h"
+#include "nrf_mesh_prov_types.h"
+
+typedef enum
+{
+    NRF_MESH_PROV_EVT_UNPROVISIONED_RECEIVED,
+    NRF_MESH_PROV_EVT_LINK_ESTABLISHED,
+    NRF_MESH_PROV_EVT_LINK_CLOSED,
+    NRF_MESH_PROV_EVT_INPUT_REQUEST,
+    NRF_MESH_PROV_EVT_OUTPUT_REQUEST,
+    NRF_MESH_PROV_EVT_STATIC_REQUEST,
+    NRF_MESH_PROV_EVT_OOB_PUBKEY_REQUEST,
+    NRF_MESH_PROV_EVT_CAPS_RECEIVED,
+    NRF_MESH_PROV_EVT_COMPLETE,
+    NRF_MESH_PROV_EVT_ECDH_REQUEST,
+    NRF_MESH_PROV_EVT_FAILED
+} nrf_mesh_prov_evt_type_t;
+
+typedef struct
+{
+    uint8_t device_uuid[NRF_MESH_UUID_SIZE];
+    bool gatt_supported;
+    bool uri_hash_present;
+    uint8_t uri_hash[4];
+    const nrf_mesh_rx_metadata_t * p_metadata;
+} nrf_mesh_prov_evt_unprov_t;
+
+typedef struct
+{
+    nrf_mesh_prov_ctx_t * p_context;
+} nrf_mesh_prov_evt_link_established_t;
+
+typedef struct
+{
+    nrf_mesh_prov_ctx_t * p_context;
+    nrf_mesh_prov_link_close_reason_t close_reason;
+} nrf_mesh_prov_evt_link_closed_t;
+
+typedef struct
+{
+    nrf_mesh_prov_ctx_t * p_context;
+} nrf_mesh_prov_evt_static_request_t;
+
+typedef struct
+{
+    nrf_mesh_prov_ctx_t * p_context;
+    nrf_mesh_prov_oob_caps_t oob_caps;
+} nrf_mesh_prov_evt_oob_caps_received_t;
+
+typedef struct
+{
+    nrf_mesh_prov_ctx_t * p_context;
+    const uint8_t * p_devkey;
+    const nrf_mesh_prov_provisioning_data_t * p_prov_data;
+} nrf_mesh_prov_evt_complete_t;
+
+typedef struct
+{
+    nrf_mesh_prov_ctx_t * p_context;
+    uint8_t failure_code;
+} nrf_mesh_prov_evt_failed_t;
+
+typedef struct nrf_mesh_prov_evt
+{
+    nrf_mesh_prov_evt_type_t type;
+    union
+    {
+        nrf_mesh_prov_evt_unprov_t unprov;
+        nrf_mesh_prov_evt_link_established_t link_established;
+        nrf_mesh_prov_evt_link_closed_t link_closed;
+        nrf_mesh_prov_evt_static_request_t static_request;
+        nrf_mesh_prov_evt_oob_caps_received_t oob_caps_received;
+        nrf_mesh_prov_evt_complete_t complete;
+        nrf_mesh_prov_evt_failed_t failed;
+    } params;
+} nrf_mesh_prov_evt_t;
+
+#endif /* NRF_MESH_PROV_EVENTS_H__ */
@@ -0,0 +1,100 @@
+#ifndef NRF_MESH_PROV_TYPES_H__
+#define NRF_MESH_PROV_TYPES_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_mesh_defines.h"
+
+/** Tipos do provisionamento (simulador). O protocolo PB-ADV é reduzido às etapas que geram eventos na aplicação */
+#define NRF_MESH_PROV_PUBKEY_SIZE           (64)
+#define NRF_MESH_PROV_PRIVKEY_SIZE          (32)
+#define NRF_MESH_PROV_ALGORITHM_FIPS_P256EC (1 << 0)
+#define NRF_MESH_PROV_OOB_STATIC_TYPE_SUPPORTED (1 << 0)
+
+typedef enum
+{
+    NRF_MESH_PROV_OOB_METHOD_NONE,
+    NRF_MESH_PROV_OOB_METHOD_STATIC,
+    NRF_MESH_PROV_OOB_METHOD_OUTPUT,
+    NRF_MESH_PROV_OOB_METHOD_INPUT
+} nrf_mesh_prov_oob_method_t;
+
+typedef enum
+{
+    NRF_MESH_PROV_BEARER_ADV,
+    NRF_MESH_PROV_BEARER_GATT
+} nrf_mesh_prov_bearer_type_t;
+
+typedef enum
+{
+    NRF_MESH_PROV_STATE_IDLE,
+    NRF_MESH_PROV_STATE_LINK_ESTABLISHED,
+    NRF_MESH_PROV_STATE_COMPLETE,
+    NRF_MESH_PROV_STATE_FAILED
+} nrf_mesh_prov_state_t;
+
+typedef enum
+{
+    NRF_MESH_PROV_LINK_CLOSE_REASON_SUCCESS = 0,
+    NRF_MESH_PROV_LINK_CLOSE_REASON_TIMEOUT = 1,
+    NRF_MESH_PROV_LINK_CLOSE_REASON_ERROR   = 2
+} nrf_mesh_prov_link_close_reason_t;
+
+typedef struct
+{
+    uint8_t num_elements;
+    uint16_t algorithms;
+    uint8_t pubkey_type;
+    uint8_t oob_static_types;
+    uint8_t oob_output_size;
+    uint16_t oob_output_actions;
+    uint8_t oob_input_size;
+    uint16_t oob_input_actions;
+} nrf_mesh_prov_oob_caps_t;
+
+#define NRF_MESH_PROV_OOB_CAPS_DEFAULT(num_elements_param)      \
+    {                                                           \
+        .num_elements = (num_elements_param),                   \
+        .algorithms = NRF_MESH_PROV_ALGORITHM_FIPS_P256EC,      \
+        .pubkey_type = 0,                                       \
+        .oob_static_types = NRF_MESH_PROV_OOB_STATIC_TYPE_SUPPORTED, \
+        .oob_output_size = 0,                                   \
+        .oob_output_actions = 0,                                \
+        .oob_input_size = 0,                                    \
+        .oob_input_actions = 0                                  \
+    }
+
+typedef struct
+{
+    uint8_t netkey[NRF_MESH_KEY_SIZE];
+    uint16_t netkey_index;
+    uint32_t iv_index;
+    uint16_t address;
+    struct
+    {
+        uint8_t iv_update : 1;
+        uint8_t key_refresh : 1;
+    } flags;
+} nrf_mesh_prov_provisioning_data_t;
+
+typedef struct
+{
+    uint8_t sim_bearer_type;
+} prov_bearer_t;
+
+struct nrf_mesh_prov_evt;
+typedef void (*nrf_mesh_prov_evt_handler_cb_t)(const struct nrf_mesh_prov_evt * p_evt);
+
+typedef struct nrf_mesh_prov_ctx
+{
+    nrf_mesh_prov_evt_handler_cb_t event_handler;
+    nrf_mesh_prov_oob_caps_t capabilities;
+    nrf_mesh_prov_oob_caps_t peer_capabilities;
+    nrf_mesh_prov_provisioning_data_t data;
+    uint8_t device_key[NRF_MESH_KEY_SIZE];
+    nrf_mesh_prov_state_t state;
+    prov_bearer_t * p_bearer;
+    void * p_sim_link;      /**< Enlace de provisionamento do contexto no simulador */
+} nrf_mesh_prov_ctx_t;
+
+#endif /* NRF_MESH_PROV_TYPES_H__ */
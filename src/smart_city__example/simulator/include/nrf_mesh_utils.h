@@ -0,0 +1,6 @@
+#ifndef NRF_MESH_UTILS_H__
+#define NRF_MESH_UTILS_H__
+
+#include "nrf_mesh.h"
+
+#endif /* NRF_MESH_UTILS_H__ */
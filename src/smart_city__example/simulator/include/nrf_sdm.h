@@ -0,0 +1,21 @@
+#ifndef NRF_SDM_H__
+#define NRF_SDM_H__
+
+#include <stdint.h>
+
+/** Configuração do relógio de baixa frequência. Ignorada pelo simulador, cujo relógio é virtual */
+typedef struct
+{
+    uint8_t source;
+    uint8_t rc_ctiv;
+    uint8_t rc_temp_ctiv;
+    uint8_t accuracy;
+} nrf_clock_lf_cfg_t;
+
+#define NRF_CLOCK_LF_SRC_XTAL           (1)
+#define NRF_CLOCK_LF_ACCURACY_20_PPM    (7)
+
+/** Espera por eventos do SoftDevice. No simulador devolve o controle ao laço de eventos e não retorna */
+uint32_t sd_app_evt_wait(void);
+
+#endif /* NRF_SDM_H__ */
@@ -0,0 +1,11 @@
+#ifndef RTT_INPUT_H__
+#define RTT_INPUT_H__
+
+#include <stdint.h>
+
+/** Entrada pelo RTT. Não há terminal por nó no simulador */
+typedef void (*rtt_input_handler_t)(int key);
+
+static inline void rtt_input_enable(rtt_input_handler_t handler, uint32_t poll_period_us) { (void) handler; (void) poll_period_us; }
+
+#endif /* RTT_INPUT_H__ */
@@ -0,0 +1,9 @@
+#ifndef SIMPLE_HAL_H__
+#define SIMPLE_HAL_H__
+
+#include <stdint.h>
+
+/** Reinicia o nó simulado: o estado da mesh é apagado e a aplicação não volta a executar */
+void hal_device_reset(uint32_t gpregret_value);
+
+#endif /* SIMPLE_HAL_H__ */
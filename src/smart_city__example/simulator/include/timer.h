@@ -0,0 +1,14 @@
+#ifndef TIMER_H__
+#define TIMER_H__
+
+#include <stdint.h>
+
+/** Relógio da mesh em microssegundos, derivado do relógio virtual do simulador */
+typedef uint32_t timestamp_t;
+
+#define MS_TO_US(t) ((t) * 1000)
+#define SEC_TO_US(t) ((t) * 1000000)
+
+timestamp_t timer_now(void);
+
+#endif /* TIMER_H__ */
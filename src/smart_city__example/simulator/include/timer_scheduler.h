@@ -0,0 +1,26 @@
+#ifndef TIMER_SCHEDULER_H__
+#define TIMER_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/** Escalonador de timers da mesh (simulador). Cada timer agendado vira um evento no relógio virtual do nó */
+typedef void (*timer_sch_callback_t)(timestamp_t timestamp, void * p_context);
+
+typedef struct timer_event
+{
+    volatile uint8_t state;
+    timestamp_t timestamp;
+    timer_sch_callback_t cb;
+    timestamp_t interval;
+    void * p_context;
+    struct timer_event * p_next;
+    uint32_t sim_generation;    /**< Usado pelo simulador para descartar agendamentos cancelados */
+} timer_event_t;
+
+void timer_sch_schedule(timer_event_t * p_timer_evt);
+void timer_sch_abort(timer_event_t * p_timer_evt);
+void timer_sch_reschedule(timer_event_t * p_timer_evt, timestamp_t new_timestamp);
+
+#endif /* TIMER_SCHEDULER_H__ */
@@ -0,0 +1,363 @@
+#ifndef SIM_H__
+#define SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <ucontext.h>
+
+#include "access.h"
+#include "config_client.h"
+#include "config_server.h"
+#include "health_client.h"
+#include "mesh_provisionee.h"
+#include "mesh_stack.h"
+#include "nrf_mesh_events.h"
+#include "nrf_mesh_prov.h"
+
+/** Simulador de eventos discretos da rede Smart City.
+ *  Cada nó executa uma cópia própria da aplicação (full, no_sensor ou provisioner), carregada de um módulo compartilhado,
+ *  sobre as camadas simuladas declaradas em include/. O relógio é virtual: os eventos (timers, fim de transmissões,
+ *  etapas de provisionamento) são processados em ordem de tempo, sem esperas reais.
+ *
+ *  Os nós são divididos em partições espaciais, cada uma com a sua fila de eventos e, com --threads, a sua thread.
+ *  Um nó só afeta outro por eventos agendados pelo menos SIM_LOOKAHEAD_US à frente, de modo que as partições avançam
+ *  em janelas de SIM_LOOKAHEAD_US sem se esperar dentro da janela. Os eventos de cada nó são ordenados por uma chave
+ *  que não depende do particionamento, e o resultado é o mesmo para qualquer número de threads */
+
+#define SIM_NODE_MODELS_MAX     (8)     /**< Modelos por nó, incluindo o cliente Health do provisionador */
+#define SIM_MODEL_SUBS_MAX      (4)     /**< Endereços de grupo assinados por modelo */
+#define SIM_DSM_ADDR_MAX        (256)   /**< Endereços de publicação na DSM de um nó (o provisionador guarda um por nó) */
+#define SIM_DSM_DEVKEY_MAX      (256)
+#define SIM_NET_CACHE_SIZE      (128)   /**< Cache da camada de rede: (src, seq) já vistos */
+#define SIM_PROV_LINKS_MAX      (8)     /**< Contextos de provisionamento (enlaces simultâneos) de um nó */
+#define SIM_APP_STACK_SIZE      (256 * 1024)    /**< Pilha da aplicação de cada nó, que executa como corrotina */
+
+/** Temporização do bearer de advertising */
+#define SIM_ADV_TX_LATENCY_US   (1000)  /**< Atraso mínimo entre o pedido de transmissão e o evento de advertising */
+#define SIM_ADV_DELAY_MAX_US    (10000) /**< advDelay aleatório antes de cada evento de advertising */
+#define SIM_ADV_AIRTIME_US      (1200)  /**< Um segmento nos três canais de advertising */
+#define SIM_ADV_INTERVAL_US     (20000) /**< Intervalo entre repetições da mesma PDU de rede */
+#define SIM_RSSI_AT_1M          (-45)
+#define SIM_RSSI_PATH_LOSS_EXP  (2.5)
+#define SIM_CAPTURE_DB          (6)     /**< Diferença de RSSI para o sinal mais forte sobreviver a uma colisão */
+
+/** Menor atraso de um evento agendado para outro nó: o rádio não começa a transmitir antes de SIM_ADV_TX_LATENCY_US */
+#define SIM_LOOKAHEAD_US        (SIM_ADV_TX_LATENCY_US)
+
+typedef enum
+{
+    SIM_APP_FULL,
+    SIM_APP_NO_SENSOR,
+    SIM_APP_PROVISIONER,
+    SIM_APP_COUNT
+} sim_app_t;
+
+/** Tipo de tráfego, para despachar a PDU na camada de acesso do receptor */
+typedef enum
+{
+    SIM_PDU_APP,            /**< Mensagem de um modelo da aplicação */
+    SIM_PDU_CONFIG_REQUEST, /**< Cliente -> servidor de configuração */
+    SIM_PDU_CONFIG_STATUS,  /**< Servidor -> cliente de configuração */
+    SIM_PDU_HEALTH          /**< Publicação do servidor Health */
+} sim_pdu_kind_t;
+
+typedef struct sim_node sim_node_t;
+
+typedef struct sim_partition sim_partition_t;
+typedef struct sim_stats_partition sim_stats_partition_t;
+
+typedef void (*sim_event_cb_t)(sim_node_t * p_node, void * p_arg, uint32_t value);
+
+/** Evento. A chave (time, order) é única e igual em qualquer particionamento: order combina o índice do nó que agendou
+ *  o evento com o contador de eventos agendados por esse nó */
+typedef struct
+{
+    uint64_t time;
+    uint64_t order;
+    sim_node_t * p_node;
+    sim_event_cb_t cb;
+    void * p_arg;
+    uint32_t value;
+} sim_event_t;
+
+/** Mudança de posição de um nó, aplicada entre janelas */
+typedef struct
+{
+    sim_node_t * p_node;
+    double x;
+    double y;
+} sim_move_t;
+
+/** Evento em trânsito para outra partição */
+typedef struct sim_event_link
+{
+    sim_event_t event;
+    struct sim_event_link * p_next;
+} sim_event_link_t;
+
+struct sim_partition
+{
+    uint32_t index;
+    sim_event_t * p_heap;           /**< Heap binário pela chave do evento */
+    uint32_t heap_count;
+    uint32_t heap_size;
+    sim_event_link_t * p_inbox;     /**< Pilha lock-free dos eventos agendados por outras partições; esvaziada entre janelas */
+    uint64_t next_time;             /**< Primeiro evento pendente, publicado entre janelas */
+    sim_node_t ** pp_touched;       /**< Nós que executaram eventos na janela, para publicar o seu estado de recepção */
+    uint32_t touched_count;
+    uint32_t touched_size;
+    sim_move_t * p_moves;           /**< Movimentos dos nós da partição na janela */
+    uint32_t move_count;
+    uint32_t move_size;
+    sim_stats_partition_t * p_stats;
+};
+
+/** PDU de acesso em trânsito. É compartilhada (contagem de referências) por todas as cópias retransmitidas */
+typedef struct
+{
+    uint32_t refs;
+    sim_pdu_kind_t kind;
+    uint16_t src;
+    uint16_t dst;
+    uint32_t seq;
+    uint8_t ttl;            /**< TTL na origem; a diferença para o TTL recebido é o número de saltos */
+    access_opcode_t opcode;
+    uint16_t length;
+    uint8_t segments;
+    uint64_t origin_us;
+    uint8_t data[NRF_MESH_SEG_PAYLOAD_SIZE_MAX];
+} sim_pdu_t;
+
+/** Intervalo de ocupação do rádio de um nó: recepção em curso ou transmissão própria */
+typedef struct sim_air
+{
+    uint64_t start;
+    uint64_t end;
+    bool own;
+    bool corrupt;
+    sim_pdu_t * p_pdu;
+    uint8_t ttl;
+    int8_t rssi;
+    struct sim_air * p_next;
+} sim_air_t;
+
+typedef struct
+{
+    access_model_id_t id;
+    uint16_t element_index;
+    const access_opcode_handler_t * p_handlers;
+    uint32_t opcode_count;
+    void * p_args;
+    uint16_t publish_address;   /**< NRF_MESH_ADDR_UNASSIGNED enquanto a publicação não estiver configurada */
+    uint8_t publish_ttl;
+    bool publish_appkey;
+    bool app_bound;
+    bool subscription_list;
+    uint16_t subscriptions[SIM_MODEL_SUBS_MAX];
+    uint8_t subscription_count;
+} sim_model_t;
+
+/** Endereços em que um nó recebe mensagens, como visto pelos outros nós: publicado entre janelas */
+typedef struct
+{
+    bool active;            /**< Provisionado e vivo */
+    uint16_t unicast;
+    uint16_t element_count;
+    bool all_nodes;         /**< Algum modelo com appkey aceita o endereço de todos os nós */
+    uint8_t group_count;
+    uint16_t groups[SIM_NODE_MODELS_MAX * SIM_MODEL_SUBS_MAX];
+} sim_accept_t;
+
+/** Enlace de provisionamento do lado do provisionador, um por contexto nrf_mesh_prov_ctx_t. As etapas que dependem do
+ *  dispositivo são eventos trocados com ele; generation, única entre os enlaces do nó, identifica o enlace nas respostas
+ *  e descarta as de enlaces anteriores */
+typedef struct
+{
+    bool active;
+    uint16_t generation;
+    uint8_t stage;
+    uint8_t close_reason;
+    sim_node_t * p_target;
+    nrf_mesh_prov_ctx_t * p_ctx;
+} sim_prov_link_t;
+
+/** Pedido confiável pendente no cliente de configuração */
+typedef struct
+{
+    bool active;
+    uint32_t generation;
+    uint16_t dst;
+    uint16_t request_opcode;
+    uint16_t status_opcode;
+    uint8_t request[32];
+    uint16_t request_length;
+    uint64_t deadline;
+    uint32_t interval_us;
+} sim_config_pending_t;
+
+struct sim_node
+{
+    uint32_t index;
+    sim_app_t app;
+    double x;
+    double y;
+    bool alive;
+    uint64_t rng;
+    uint8_t uuid[NRF_MESH_UUID_SIZE];
+
+    void * p_module;
+    int (*p_app_main)(void);
+    ucontext_t app_context;     /**< main() da aplicação, parada em sd_app_evt_wait() entre os eventos do nó */
+    void * p_app_stack;         /**< NULL até o boot */
+
+    /* Execução */
+    sim_partition_t * p_partition;
+    uint64_t event_seq;         /**< Eventos agendados pelo nó: parte da chave dos eventos */
+    uint32_t trace_seq;         /**< Linhas de trace do nó: ordena o trace dentro de um mesmo evento */
+    bool touched;
+    sim_accept_t accept;
+    sim_node_t ** pp_neighbors;     /**< Nós ao alcance, em ordem de índice; refeita quando invalidada por movimento */
+    uint32_t neighbor_count;
+    uint32_t neighbor_size;
+    bool neighbors_valid;
+
+    /* Pilha */
+    mesh_stack_models_init_cb_t models_init_cb;
+    config_server_evt_cb_t config_server_cb;
+    nrf_mesh_evt_handler_t * p_evt_handlers;
+    mesh_provisionee_prov_complete_cb_t prov_complete_cb;
+    bool beaconing;
+
+    /* Rede */
+    uint16_t unicast;
+    uint16_t element_count;
+    bool has_subnet;
+    bool has_appkey;
+    uint32_t seq;
+    uint64_t net_cache[SIM_NET_CACHE_SIZE];
+    uint32_t net_cache_next;
+    uint64_t tx_busy_until;
+    sim_air_t * p_air;
+
+    /* Camada de acesso e DSM */
+    sim_model_t models[SIM_NODE_MODELS_MAX];
+    uint16_t model_count;
+    uint16_t dsm_addr[SIM_DSM_ADDR_MAX];
+    uint16_t dsm_addr_count;
+    uint16_t dsm_devkey[SIM_DSM_DEVKEY_MAX];
+    uint16_t dsm_devkey_count;
+
+    /* Servidor Health embutido */
+    bool health_bound;
+    uint16_t health_pub_address;
+    uint8_t health_pub_ttl;
+    uint32_t health_period_ms;
+    uint32_t health_generation;
+
+    /* Clientes (provisionador) */
+    health_client_t * p_health_client;
+    config_client_event_cb_t config_client_cb;
+    uint16_t config_server_address;
+    sim_config_pending_t config_pending;
+    nrf_mesh_prov_evt_handler_cb_t scan_handler;
+    sim_prov_link_t prov_links[SIM_PROV_LINKS_MAX];
+    uint16_t prov_link_count;
+    uint16_t prov_generation;
+
+    /* Estatísticas */
+    uint32_t tx_count;
+    uint32_t relay_count;
+    uint32_t adv_count;
+    uint32_t rx_count;
+    uint32_t collision_count;
+    uint32_t loss_count;
+};
+
+/** Parâmetros da simulação (linha de comando) */
+typedef struct
+{
+    uint32_t node_count[SIM_APP_COUNT];
+    double area_width;
+    double area_height;
+    double range;
+    double loss;
+    uint8_t ttl;
+    uint8_t repeats;
+    double duration_s;
+    double boot_spread_s;
+    uint64_t seed;
+    uint32_t threads;
+    const char * p_trace_path;
+    const char * p_map_path;
+    const char * p_app_dir;
+    int log_level;
+} sim_config_t;
+
+typedef struct
+{
+    sim_config_t config;
+    sim_node_t * p_nodes;
+    uint32_t node_count;
+    sim_partition_t * p_partitions;
+    uint32_t partition_count;
+    uint32_t * p_accept_count;      /**< Nós que recebem cada endereço de 16 bits (sim_accept_t publicados) */
+    FILE * p_trace;
+    bool preprovisioned;
+} sim_t;
+
+extern sim_t g_sim;
+extern __thread sim_node_t * g_sim_node;   /**< Nó em execução: as chamadas da aplicação às camadas simuladas referem-se a ele */
+extern __thread uint64_t g_sim_now;        /**< Relógio virtual da partição em execução, em microssegundos */
+
+/* sim_core.c */
+void sim_event_schedule(uint64_t time, sim_node_t * p_node, sim_event_cb_t cb, void * p_arg, uint32_t value);
+void sim_run(uint64_t until);
+uint64_t sim_rand(sim_node_t * p_node);
+double sim_rand_unit(sim_node_t * p_node);
+void sim_node_boot(sim_node_t * p_node, uint32_t value);
+/** Retoma o laço principal da aplicação do nó, parado em sd_app_evt_wait(), até a próxima chamada */
+void sim_node_resume(sim_node_t * p_node);
+void sim_partitions_init(uint32_t count);
+const char * sim_app_name(sim_app_t app);
+
+/* sim_radio.c */
+void sim_net_send(sim_node_t * p_node, sim_pdu_kind_t kind, uint16_t dst, uint8_t ttl, access_opcode_t opcode,
+                  const uint8_t * p_data, uint16_t length, bool force_segmented);
+double sim_distance(const sim_node_t * p_a, const sim_node_t * p_b);
+int8_t sim_rssi(const sim_node_t * p_a, const sim_node_t * p_b);
+bool sim_in_range(const sim_node_t * p_a, const sim_node_t * p_b);
+
+/* sim_grid.c */
+void sim_grid_init(void);
+sim_node_t * const * sim_neighbors(sim_node_t * p_node, uint32_t * p_count);
+/** Move o nó em execução (ou qualquer nó, fora da simulação). A nova posição vale a partir da próxima janela */
+void sim_node_move(sim_node_t * p_node, double x, double y);
+void sim_grid_moves_apply(void);
+
+/* sim_access.c */
+sim_model_t * sim_model_find(sim_node_t * p_node, uint16_t element_index, access_model_id_t id);
+void sim_access_deliver(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint8_t ttl, int8_t rssi);
+bool sim_node_accepts(const sim_node_t * p_node, uint16_t dst, sim_pdu_kind_t kind);
+void sim_access_publish(sim_node_t * p_node);
+uint32_t sim_access_expected(const sim_node_t * p_sender, uint16_t dst, sim_pdu_kind_t kind);
+
+/* sim_config.c */
+void sim_config_server_rx(sim_node_t * p_node, const sim_pdu_t * p_pdu);
+void sim_config_client_rx(sim_node_t * p_node, const sim_pdu_t * p_pdu);
+void sim_health_client_rx(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint8_t ttl, int8_t rssi);
+void sim_health_publication_start(sim_node_t * p_node);
+
+/* sim_prov.c */
+void sim_prov_preprovision(sim_node_t * p_node, uint16_t address);
+void sim_prov_configure_defaults(sim_node_t * p_node);
+
+/* sim_stats.c */
+void sim_stats_partition_init(sim_partition_t * p_partition);
+void sim_stats_sent(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint32_t expected);
+void sim_stats_delivery(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint8_t ttl);
+void sim_stats_report(FILE * p_out, double wall_s);
+void sim_trace(const char * p_event, sim_node_t * p_node, const sim_pdu_t * p_pdu, uint64_t time, uint8_t ttl);
+void sim_trace_flush(void);
+
+#endif /* SIM_H__ */
@@ -0,0 +1,536 @@
+#include "sim.h"
+
+#include <string.h>
+
+#include "config_server.h"
+#include "device_state_manager.h"
+#include "health_common.h"
+
+/** Camada de acesso e DSM simuladas. Os modelos da aplicação são registrados no nó em execução; a publicação
+ *  vai para a camada de rede com o endereço e o TTL configurados pelo provisionador (ou pelo simulador, no modo
+ *  pré-provisionado). As chaves são guardadas somente como presença: não há criptografia */
+
+/*****************************************************************************
+ * Camada de acesso
+ *****************************************************************************/
+
+static sim_model_t * model_get(access_model_handle_t handle)
+{
+    if (g_sim_node == NULL || handle >= g_sim_node->model_count)
+    {
+        return NULL;
+    }
+    return &g_sim_node->models[handle];
+}
+
+sim_model_t * sim_model_find(sim_node_t * p_node, uint16_t element_index, access_model_id_t id)
+{
+    for (uint16_t i = 0; i < p_node->model_count; i++)
+    {
+        sim_model_t * p_model = &p_node->models[i];
+        if (p_model->element_index == element_index && p_model->id.model_id == id.model_id &&
+            p_model->id.company_id == id.company_id)
+        {
+            return p_model;
+        }
+    }
+    return NULL;
+}
+
+uint32_t access_model_add(const access_model_add_params_t * p_model_params, access_model_handle_t * p_model_handle)
+{
+    if (p_model_params == NULL || p_model_handle == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (g_sim_node->model_count >= SIM_NODE_MODELS_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    if (sim_model_find(g_sim_node, p_model_params->element_index, p_model_params->model_id) != NULL)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+
+    sim_model_t * p_model = &g_sim_node->models[g_sim_node->model_count];
+    memset(p_model, 0, sizeof(*p_model));
+    p_model->id = p_model_params->model_id;
+    p_model->element_index = p_model_params->element_index;
+    p_model->p_handlers = p_model_params->p_opcode_handlers;
+    p_model->opcode_count = p_model_params->opcode_count;
+    p_model->p_args = p_model_params->p_args;
+    if (p_model_params->element_index >= g_sim_node->element_count)
+    {
+        g_sim_node->element_count = p_model_params->element_index + 1;
+    }
+    *p_model_handle = g_sim_node->model_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_publish(access_model_handle_t handle, const access_message_tx_t * p_message)
+{
+    sim_model_t * p_model = model_get(handle);
+    if (p_model == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_message->length > NRF_MESH_SEG_PAYLOAD_SIZE_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_model->publish_address == NRF_MESH_ADDR_UNASSIGNED || !p_model->publish_appkey || !g_sim_node->has_subnet)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    sim_net_send(g_sim_node, SIM_PDU_APP, p_model->publish_address, p_model->publish_ttl, p_message->opcode,
+                 p_message->p_buffer, p_message->length, p_message->force_segmented);
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_reply(access_model_handle_t handle, const access_message_rx_t * p_message, const access_message_tx_t * p_reply)
+{
+    if (model_get(handle) == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_reply->length > NRF_MESH_SEG_PAYLOAD_SIZE_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    sim_net_send(g_sim_node, SIM_PDU_APP, p_message->meta_data.src.value, g_sim.config.ttl, p_reply->opcode,
+                 p_reply->p_buffer, p_reply->length, p_reply->force_segmented);
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_publish_address_get(access_model_handle_t handle, dsm_handle_t * p_address_handle)
+{
+    sim_model_t * p_model = model_get(handle);
+    if (p_model == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_address_handle = DSM_HANDLE_INVALID;
+    if (p_model->publish_address != NRF_MESH_ADDR_UNASSIGNED)
+    {
+        nrf_mesh_address_t address = { NRF_MESH_ADDRESS_TYPE_GROUP, p_model->publish_address, NULL };
+        if (dsm_address_handle_get(&address, p_address_handle) != NRF_SUCCESS)
+        {
+            (void) dsm_address_publish_add(p_model->publish_address, p_address_handle);
+        }
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_subscription_list_alloc(access_model_handle_t handle)
+{
+    sim_model_t * p_model = model_get(handle);
+    if (p_model == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_model->subscription_list)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    p_model->subscription_list = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_application_bind(access_model_handle_t handle, dsm_handle_t appkey_handle)
+{
+    sim_model_t * p_model = model_get(handle);
+    if (p_model == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    p_model->app_bound = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_publish_application_set(access_model_handle_t handle, dsm_handle_t appkey_handle)
+{
+    sim_model_t * p_model = model_get(handle);
+    if (p_model == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    p_model->publish_appkey = true;
+    return NRF_SUCCESS;
+}
+
+void access_flash_config_store(void)
+{
+}
+
+uint32_t config_server_bind(dsm_handle_t devkey_handle)
+{
+    return NRF_SUCCESS;
+}
+
+bool sim_node_accepts(const sim_node_t * p_node, uint16_t dst, sim_pdu_kind_t kind)
+{
+    if (kind != SIM_PDU_APP || dst < 0xC000)
+    {
+        return false;
+    }
+    for (uint16_t i = 0; i < p_node->model_count; i++)
+    {
+        const sim_model_t * p_model = &p_node->models[i];
+        if (!p_model->app_bound)
+        {
+            continue;
+        }
+        if (dst == NRF_MESH_ALL_NODES_ADDR)
+        {
+            return true;
+        }
+        for (uint8_t j = 0; j < p_model->subscription_count; j++)
+        {
+            if (p_model->subscriptions[j] == dst)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void accept_build(const sim_node_t * p_node, sim_accept_t * p_accept)
+{
+    memset(p_accept, 0, sizeof(*p_accept));
+    p_accept->active = p_node->alive && p_node->has_subnet;
+    if (!p_accept->active)
+    {
+        return;
+    }
+    p_accept->unicast = p_node->unicast;
+    p_accept->element_count = p_node->element_count;
+    for (uint16_t i = 0; i < p_node->model_count; i++)
+    {
+        const sim_model_t * p_model = &p_node->models[i];
+        if (!p_model->app_bound)
+        {
+            continue;
+        }
+        p_accept->all_nodes = true;
+        for (uint8_t j = 0; j < p_model->subscription_count; j++)
+        {
+            bool present = false;
+            for (uint8_t k = 0; k < p_accept->group_count; k++)
+            {
+                present |= p_accept->groups[k] == p_model->subscriptions[j];
+            }
+            if (!present)
+            {
+                p_accept->groups[p_accept->group_count++] = p_model->subscriptions[j];
+            }
+        }
+    }
+}
+
+static void accept_count_add(const sim_accept_t * p_accept, uint32_t delta)
+{
+    uint32_t * p_count = g_sim.p_accept_count;
+    if (!p_accept->active)
+    {
+        return;
+    }
+    for (uint16_t i = 0; i < p_accept->element_count; i++)
+    {
+        __atomic_fetch_add(&p_count[(uint16_t) (p_accept->unicast + i)], delta, __ATOMIC_RELAXED);
+    }
+    if (p_accept->all_nodes)
+    {
+        __atomic_fetch_add(&p_count[NRF_MESH_ALL_NODES_ADDR], delta, __ATOMIC_RELAXED);
+    }
+    for (uint8_t i = 0; i < p_accept->group_count; i++)
+    {
+        __atomic_fetch_add(&p_count[p_accept->groups[i]], delta, __ATOMIC_RELAXED);
+    }
+}
+
+static bool accept_match(const sim_accept_t * p_accept, uint16_t dst)
+{
+    if (!p_accept->active)
+    {
+        return false;
+    }
+    if (dst >= p_accept->unicast && dst < p_accept->unicast + p_accept->element_count)
+    {
+        return true;
+    }
+    if (dst == NRF_MESH_ALL_NODES_ADDR)
+    {
+        return p_accept->all_nodes;
+    }
+    for (uint8_t i = 0; i < p_accept->group_count; i++)
+    {
+        if (p_accept->groups[i] == dst)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Chamada entre janelas: as contagens por endereço só mudam enquanto nenhuma partição as lê */
+void sim_access_publish(sim_node_t * p_node)
+{
+    sim_accept_t accept;
+    accept_build(p_node, &accept);
+    if (memcmp(&accept, &p_node->accept, sizeof(accept)) != 0)
+    {
+        accept_count_add(&p_node->accept, (uint32_t) -1);
+        accept_count_add(&accept, 1);
+        p_node->accept = accept;
+    }
+}
+
+/* Receptores esperados de uma mensagem: os nós que recebiam o destino no início da janela, exceto o emissor */
+uint32_t sim_access_expected(const sim_node_t * p_sender, uint16_t dst, sim_pdu_kind_t kind)
+{
+    if (dst >= 0xC000 && kind != SIM_PDU_APP)
+    {
+        return 0;
+    }
+    uint32_t count = __atomic_load_n(&g_sim.p_accept_count[dst], __ATOMIC_RELAXED);
+    return count - (accept_match(&p_sender->accept, dst) ? 1 : 0);
+}
+
+static bool model_accepts(const sim_node_t * p_node, const sim_model_t * p_model, uint16_t dst)
+{
+    if (!p_model->app_bound)
+    {
+        return false;
+    }
+    if (dst < 0x8000)
+    {
+        return dst == p_node->unicast + p_model->element_index;
+    }
+    if (dst == NRF_MESH_ALL_NODES_ADDR)
+    {
+        return true;
+    }
+    for (uint8_t j = 0; j < p_model->subscription_count; j++)
+    {
+        if (p_model->subscriptions[j] == dst)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void sim_access_deliver(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint8_t ttl, int8_t rssi)
+{
+    switch (p_pdu->kind)
+    {
+        case SIM_PDU_CONFIG_REQUEST:
+            sim_config_server_rx(p_node, p_pdu);
+            return;
+        case SIM_PDU_CONFIG_STATUS:
+            sim_config_client_rx(p_node, p_pdu);
+            return;
+        case SIM_PDU_HEALTH:
+            sim_health_client_rx(p_node, p_pdu, ttl, rssi);
+            return;
+        default:
+            break;
+    }
+
+    nrf_mesh_rx_metadata_t core_metadata;
+    memset(&core_metadata, 0, sizeof(core_metadata));
+    core_metadata.source = NRF_MESH_RX_SOURCE_SCANNER;
+    core_metadata.params.scanner.timestamp = (uint32_t) g_sim_now;
+    core_metadata.params.scanner.rssi = rssi;
+
+    access_message_rx_t message;
+    memset(&message, 0, sizeof(message));
+    message.opcode = p_pdu->opcode;
+    message.p_data = p_pdu->data;
+    message.length = p_pdu->length;
+    message.meta_data.src.type = NRF_MESH_ADDRESS_TYPE_UNICAST;
+    message.meta_data.src.value = p_pdu->src;
+    message.meta_data.dst.type = p_pdu->dst >= 0xC000 ? NRF_MESH_ADDRESS_TYPE_GROUP : NRF_MESH_ADDRESS_TYPE_UNICAST;
+    message.meta_data.dst.value = p_pdu->dst;
+    message.meta_data.ttl = ttl;
+    message.meta_data.appkey_handle = 0;
+    message.meta_data.subnet_handle = 0;
+    message.meta_data.p_core_metadata = &core_metadata;
+
+    for (uint16_t i = 0; i < p_node->model_count; i++)
+    {
+        sim_model_t * p_model = &p_node->models[i];
+        if (!model_accepts(p_node, p_model, p_pdu->dst))
+        {
+            continue;
+        }
+        for (uint32_t j = 0; j < p_model->opcode_count; j++)
+        {
+            const access_opcode_handler_t * p_handler = &p_model->p_handlers[j];
+            if (p_handler->opcode.opcode == p_pdu->opcode.opcode && p_handler->opcode.company_id == p_pdu->opcode.company_id)
+            {
+                p_handler->handler(i, &message, p_model->p_args);
+                break;
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+ * Gerenciador de estado do dispositivo (DSM)
+ *****************************************************************************/
+
+uint32_t dsm_local_unicast_addresses_set(const dsm_local_unicast_address_t * p_address)
+{
+    if (p_address->address_start == NRF_MESH_ADDR_UNASSIGNED || p_address->address_start >= 0x8000)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    g_sim_node->unicast = p_address->address_start;
+    g_sim_node->element_count = p_address->count;
+    return NRF_SUCCESS;
+}
+
+void dsm_local_unicast_addresses_get(dsm_local_unicast_address_t * p_address)
+{
+    p_address->address_start = g_sim_node->unicast;
+    p_address->count = g_sim_node->element_count;
+}
+
+/* Posição de "value" em "p_table", ou a primeira posição livre (NRF_MESH_ADDR_UNASSIGNED) se não estiver lá.
+ * Retorna "count" se não houver nenhuma das duas */
+static uint16_t dsm_slot_find(const uint16_t * p_table, uint16_t count, uint16_t value)
+{
+    uint16_t free_slot = count;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (p_table[i] == value)
+        {
+            return i;
+        }
+        if (p_table[i] == NRF_MESH_ADDR_UNASSIGNED && free_slot == count)
+        {
+            free_slot = i;
+        }
+    }
+    return free_slot;
+}
+
+uint32_t dsm_address_publish_add(uint16_t raw_address, dsm_handle_t * p_address_handle)
+{
+    uint16_t slot = dsm_slot_find(g_sim_node->dsm_addr, g_sim_node->dsm_addr_count, raw_address);
+    if (slot == g_sim_node->dsm_addr_count)
+    {
+        if (g_sim_node->dsm_addr_count >= SIM_DSM_ADDR_MAX)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        g_sim_node->dsm_addr_count++;
+    }
+    g_sim_node->dsm_addr[slot] = raw_address;
+    *p_address_handle = slot;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_address_publish_remove(dsm_handle_t address_handle)
+{
+    if (address_handle >= g_sim_node->dsm_addr_count || g_sim_node->dsm_addr[address_handle] == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    g_sim_node->dsm_addr[address_handle] = NRF_MESH_ADDR_UNASSIGNED;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_address_handle_get(const nrf_mesh_address_t * p_address, dsm_handle_t * p_address_handle)
+{
+    for (uint16_t i = 0; i < g_sim_node->dsm_addr_count; i++)
+    {
+        if (g_sim_node->dsm_addr[i] == p_address->value)
+        {
+            *p_address_handle = i;
+            return NRF_SUCCESS;
+        }
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
+
+uint32_t dsm_address_get(dsm_handle_t address_handle, nrf_mesh_address_t * p_address)
+{
+    if (address_handle >= g_sim_node->dsm_addr_count || g_sim_node->dsm_addr[address_handle] == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    p_address->value = g_sim_node->dsm_addr[address_handle];
+    p_address->type = p_address->value >= 0xC000 ? NRF_MESH_ADDRESS_TYPE_GROUP : NRF_MESH_ADDRESS_TYPE_UNICAST;
+    p_address->p_virtual_uuid = NULL;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_subnet_add(uint16_t net_key_id, const uint8_t * p_key, dsm_handle_t * p_subnet_handle)
+{
+    g_sim_node->has_subnet = true;
+    *p_subnet_handle = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_subnet_get_all(dsm_handle_t * p_key_list, uint32_t * p_count)
+{
+    *p_count = g_sim_node->has_subnet ? 1 : 0;
+    p_key_list[0] = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_appkey_add(uint16_t app_key_id, dsm_handle_t subnet_handle, const uint8_t * p_key, dsm_handle_t * p_app_handle)
+{
+    g_sim_node->has_appkey = true;
+    *p_app_handle = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_appkey_get_all(dsm_handle_t subnet_handle, dsm_handle_t * p_key_list, uint32_t * p_count)
+{
+    *p_count = g_sim_node->has_appkey ? 1 : 0;
+    p_key_list[0] = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_devkey_add(uint16_t raw_unicast_addr, dsm_handle_t subnet_handle, const uint8_t * p_key, dsm_handle_t * p_devkey_handle)
+{
+    uint16_t slot = dsm_slot_find(g_sim_node->dsm_devkey, g_sim_node->dsm_devkey_count, raw_unicast_addr);
+    if (slot == g_sim_node->dsm_devkey_count)
+    {
+        if (g_sim_node->dsm_devkey_count >= SIM_DSM_DEVKEY_MAX)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        g_sim_node->dsm_devkey_count++;
+    }
+    g_sim_node->dsm_devkey[slot] = raw_unicast_addr;
+    *p_devkey_handle = slot;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_devkey_delete(dsm_handle_t devkey_handle)
+{
+    if (devkey_handle >= g_sim_node->dsm_devkey_count || g_sim_node->dsm_devkey[devkey_handle] == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    g_sim_node->dsm_devkey[devkey_handle] = NRF_MESH_ADDR_UNASSIGNED;
+    return NRF_SUCCESS;
+}
+
+uint32_t dsm_devkey_handle_get(uint16_t unicast_address, dsm_handle_t * p_devkey_handle)
+{
+    for (uint16_t i = 0; i < g_sim_node->dsm_devkey_count; i++)
+    {
+        if (g_sim_node->dsm_devkey[i] == unicast_address)
+        {
+            *p_devkey_handle = i;
+            return NRF_SUCCESS;
+        }
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
@@ -0,0 +1,494 @@
+#include "sim.h"
+
+#include <string.h>
+
+#include "composition_data.h"
+#include "config_client.h"
+#include "config_opcodes.h"
+#include "config_server.h"
+#include "health_client.h"
+#include "health_common.h"
+
+/** Modelos de fundação simulados: servidor de configuração e servidor Health embutidos em cada nó, e os clientes
+ *  usados pelo provisionador. As mensagens trafegam pela rede simulada com o tamanho real de cada opcode */
+
+#define CONFIG_RETRY_INTERVAL_US    (500000)    /**< Primeira retransmissão do pedido confiável; dobra a cada tentativa */
+#define CONFIG_TIMEOUT_US           (30000000)
+
+static access_opcode_t opcode_sig(uint16_t opcode)
+{
+    access_opcode_t result = { opcode, ACCESS_COMPANY_ID_NONE };
+    return result;
+}
+
+static uint16_t model_id_put(uint8_t * p_buffer, access_model_id_t model_id)
+{
+    if (model_id.company_id == ACCESS_COMPANY_ID_NONE)
+    {
+        memcpy(p_buffer, &model_id.model_id, 2);
+        return 2;
+    }
+    memcpy(p_buffer, &model_id.company_id, 2);
+    memcpy(p_buffer + 2, &model_id.model_id, 2);
+    return 4;
+}
+
+static access_model_id_t model_id_get(const uint8_t * p_buffer, uint16_t length)
+{
+    access_model_id_t model_id = { ACCESS_COMPANY_ID_NONE, 0 };
+    if (length >= 4)
+    {
+        memcpy(&model_id.company_id, p_buffer, 2);
+        memcpy(&model_id.model_id, p_buffer + 2, 2);
+    }
+    else
+    {
+        memcpy(&model_id.model_id, p_buffer, 2);
+    }
+    return model_id;
+}
+
+/*****************************************************************************
+ * Cliente de configuração
+ *****************************************************************************/
+
+static void config_request_send(sim_node_t * p_node);
+
+static void config_retry(sim_node_t * p_node, void * p_arg, uint32_t generation)
+{
+    sim_config_pending_t * p_pending = &p_node->config_pending;
+    if (!p_pending->active || p_pending->generation != generation)
+    {
+        return;
+    }
+    if (g_sim_now >= p_pending->deadline)
+    {
+        p_pending->active = false;
+        p_node->config_client_cb(CONFIG_CLIENT_EVENT_TYPE_TIMEOUT, NULL, 0);
+        return;
+    }
+    p_pending->interval_us *= 2;
+    config_request_send(p_node);
+}
+
+static void config_request_send(sim_node_t * p_node)
+{
+    sim_config_pending_t * p_pending = &p_node->config_pending;
+    sim_net_send(p_node, SIM_PDU_CONFIG_REQUEST, p_pending->dst, g_sim.config.ttl, opcode_sig(p_pending->request_opcode),
+                 p_pending->request, p_pending->request_length, false);
+    uint64_t next = g_sim_now + p_pending->interval_us;
+    sim_event_schedule(next < p_pending->deadline ? next : p_pending->deadline, p_node, config_retry, NULL, p_pending->generation);
+}
+
+static uint32_t config_request(uint16_t request_opcode, uint16_t status_opcode, const uint8_t * p_data, uint16_t length)
+{
+    sim_config_pending_t * p_pending = &g_sim_node->config_pending;
+    if (g_sim_node->config_client_cb == NULL || g_sim_node->config_server_address == NRF_MESH_ADDR_UNASSIGNED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_pending->active)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    p_pending->active = true;
+    p_pending->generation++;
+    p_pending->dst = g_sim_node->config_server_address;
+    p_pending->request_opcode = request_opcode;
+    p_pending->status_opcode = status_opcode;
+    memcpy(p_pending->request, p_data, length);
+    p_pending->request_length = length;
+    p_pending->deadline = g_sim_now + CONFIG_TIMEOUT_US;
+    p_pending->interval_us = CONFIG_RETRY_INTERVAL_US;
+    config_request_send(g_sim_node);
+    return NRF_SUCCESS;
+}
+
+uint32_t config_client_init(config_client_event_cb_t event_cb)
+{
+    if (event_cb == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    g_sim_node->config_client_cb = event_cb;
+    return NRF_SUCCESS;
+}
+
+uint32_t config_client_server_bind(dsm_handle_t server_devkey)
+{
+    return (server_devkey < g_sim_node->dsm_devkey_count && g_sim_node->dsm_devkey[server_devkey] != NRF_MESH_ADDR_UNASSIGNED)
+               ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND;
+}
+
+uint32_t config_client_server_set(dsm_handle_t server_devkey, dsm_handle_t server_address)
+{
+    nrf_mesh_address_t address;
+    uint32_t status = dsm_address_get(server_address, &address);
+    if (status != NRF_SUCCESS)
+    {
+        return status;
+    }
+    g_sim_node->config_server_address = address.value;
+    return NRF_SUCCESS;
+}
+
+uint32_t config_client_composition_data_get(uint8_t page_number)
+{
+    return config_request(CONFIG_OPCODE_COMPOSITION_DATA_GET, CONFIG_OPCODE_COMPOSITION_DATA_STATUS, &page_number, 1);
+}
+
+uint32_t config_client_appkey_add(uint16_t netkey_index, uint16_t appkey_index, const uint8_t * p_appkey)
+{
+    uint8_t buffer[3 + NRF_MESH_KEY_SIZE];
+    uint32_t indexes = (netkey_index & 0x0FFF) | ((uint32_t) (appkey_index & 0x0FFF) << 12);
+    memcpy(buffer, &indexes, 3);
+    memcpy(&buffer[3], p_appkey, NRF_MESH_KEY_SIZE);
+    return config_request(CONFIG_OPCODE_APPKEY_ADD, CONFIG_OPCODE_APPKEY_STATUS, buffer, sizeof(buffer));
+}
+
+uint32_t config_client_model_app_bind(uint16_t element_address, uint16_t appkey_index, access_model_id_t model_id)
+{
+    uint8_t buffer[8];
+    memcpy(buffer, &element_address, 2);
+    memcpy(&buffer[2], &appkey_index, 2);
+    uint16_t length = 4 + model_id_put(&buffer[4], model_id);
+    return config_request(CONFIG_OPCODE_MODEL_APP_BIND, CONFIG_OPCODE_MODEL_APP_STATUS, buffer, length);
+}
+
+uint32_t config_client_model_publication_set(const config_publication_state_t * p_publication_state)
+{
+    uint8_t buffer[13];
+    uint16_t state = (p_publication_state->appkey_index & 0x0FFF) | (p_publication_state->frendship_credential_flag ? 0x1000 : 0);
+    uint8_t period = (uint8_t) (p_publication_state->publish_period.step_num << 2) | p_publication_state->publish_period.step_res;
+    uint8_t retransmit = (uint8_t) ((p_publication_state->retransmit_count & 0x07) | (p_publication_state->retransmit_interval << 3));
+    memcpy(buffer, &p_publication_state->element_address, 2);
+    memcpy(&buffer[2], &p_publication_state->publish_address.value, 2);
+    memcpy(&buffer[4], &state, 2);
+    buffer[6] = p_publication_state->publish_ttl;
+    buffer[7] = period;
+    buffer[8] = retransmit;
+    uint16_t length = 9 + model_id_put(&buffer[9], p_publication_state->model_id);
+    return config_request(CONFIG_OPCODE_MODEL_PUBLICATION_SET, CONFIG_OPCODE_MODEL_PUBLICATION_STATUS, buffer, length);
+}
+
+uint32_t config_client_model_subscription_add(uint16_t element_address, nrf_mesh_address_t address, access_model_id_t model_id)
+{
+    uint8_t buffer[8];
+    memcpy(buffer, &element_address, 2);
+    memcpy(&buffer[2], &address.value, 2);
+    uint16_t length = 4 + model_id_put(&buffer[4], model_id);
+    return config_request(CONFIG_OPCODE_MODEL_SUBSCRIPTION_ADD, CONFIG_OPCODE_MODEL_SUBSCRIPTION_STATUS, buffer, length);
+}
+
+void config_client_pending_msg_cancel(void)
+{
+    g_sim_node->config_pending.active = false;
+    g_sim_node->config_pending.generation++;
+}
+
+void sim_config_client_rx(sim_node_t * p_node, const sim_pdu_t * p_pdu)
+{
+    sim_config_pending_t * p_pending = &p_node->config_pending;
+    if (!p_pending->active || p_pdu->src != p_pending->dst || p_pdu->opcode.opcode != p_pending->status_opcode)
+    {
+        return;
+    }
+    p_pending->active = false;
+
+    config_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    memcpy(&msg, p_pdu->data, p_pdu->length < sizeof(msg) ? p_pdu->length : sizeof(msg));
+    config_client_event_t event = { (config_opcode_t) p_pdu->opcode.opcode, &msg };
+    p_node->config_client_cb(CONFIG_CLIENT_EVENT_TYPE_MSG, &event, p_pdu->length);
+}
+
+/*****************************************************************************
+ * Servidor de configuração
+ *****************************************************************************/
+
+/* Página 0: cabeçalho e um elemento com os servidores de configuração e Health e os modelos da aplicação.
+ * No dispositivo, os IDs de produto e versão do cabeçalho são DEVICE_PRODUCT_ID e DEVICE_VERSION_ID, os mesmos que a
+ * aplicação grava no UUID, depois do prefixo de 4 bytes (ver SMART_CITY_NODE_UUID_TYPED_PREFIX); aqui vêm do UUID */
+static uint16_t composition_data_build(const sim_node_t * p_node, uint8_t * p_buffer)
+{
+    config_composition_data_header_t header = { ACCESS_COMPANY_ID_NORDIC, 0, 0, 32, CONFIG_FEATURE_RELAY_BIT };
+    header.product_id = (uint16_t) (p_node->uuid[4] | (p_node->uuid[5] << 8));
+    header.version_id = (uint16_t) (p_node->uuid[6] | (p_node->uuid[7] << 8));
+    uint16_t length = 0;
+    memcpy(p_buffer, &header, sizeof(header));
+    length += sizeof(header);
+
+    for (uint16_t element = 0; element < p_node->element_count; element++)
+    {
+        config_composition_element_header_t * p_element = (config_composition_element_header_t *) &p_buffer[length];
+        uint8_t sig_count = 0;
+        uint8_t vendor_count = 0;
+        length += sizeof(*p_element);
+        if (element == 0)
+        {
+            static const uint16_t foundation[] = { CONFIG_SERVER_MODEL_ID, HEALTH_SERVER_MODEL_ID };
+            memcpy(&p_buffer[length], foundation, sizeof(foundation));
+            length += sizeof(foundation);
+            sig_count += 2;
+        }
+        for (uint16_t i = 0; i < p_node->model_count; i++)
+        {
+            if (p_node->models[i].element_index == element && p_node->models[i].id.company_id == ACCESS_COMPANY_ID_NONE)
+            {
+                length += model_id_put(&p_buffer[length], p_node->models[i].id);
+                sig_count++;
+            }
+        }
+        for (uint16_t i = 0; i < p_node->model_count; i++)
+        {
+            if (p_node->models[i].element_index == element && p_node->models[i].id.company_id != ACCESS_COMPANY_ID_NONE)
+            {
+                length += model_id_put(&p_buffer[length], p_node->models[i].id);
+                vendor_count++;
+            }
+        }
+        p_element->location = 0;
+        p_element->sig_model_count = sig_count;
+        p_element->vendor_model_count = vendor_count;
+    }
+    return length;
+}
+
+static void config_server_event(sim_node_t * p_node, config_server_evt_type_t type)
+{
+    if (p_node->config_server_cb != NULL)
+    {
+        config_server_evt_t event = { type };
+        p_node->config_server_cb(&event);
+    }
+}
+
+/* Modelo alvo de um pedido: NULL para o servidor Health embutido, que não está na lista de modelos da aplicação */
+static uint8_t config_model_lookup(sim_node_t * p_node, uint16_t element_address, access_model_id_t model_id,
+                                   sim_model_t ** pp_model, bool * p_health)
+{
+    *pp_model = NULL;
+    *p_health = false;
+    if (element_address < p_node->unicast || element_address >= p_node->unicast + p_node->element_count)
+    {
+        return ACCESS_STATUS_INVALID_ADDRESS;
+    }
+    if (model_id.company_id == ACCESS_COMPANY_ID_NONE && model_id.model_id == HEALTH_SERVER_MODEL_ID &&
+        element_address == p_node->unicast)
+    {
+        *p_health = true;
+        return ACCESS_STATUS_SUCCESS;
+    }
+    *pp_model = sim_model_find(p_node, element_address - p_node->unicast, model_id);
+    return *pp_model != NULL ? ACCESS_STATUS_SUCCESS : ACCESS_STATUS_INVALID_MODEL;
+}
+
+static uint32_t publish_period_ms(uint8_t period)
+{
+    static const uint32_t resolution_ms[] = { 100, 1000, 10000, 600000 };
+    return (period >> 2) * resolution_ms[period & 0x03];
+}
+
+void sim_config_server_rx(sim_node_t * p_node, const sim_pdu_t * p_pdu)
+{
+    uint8_t reply[1 + NRF_MESH_SEG_PAYLOAD_SIZE_MAX];
+    uint16_t reply_length = 0;
+    uint16_t status_opcode;
+    const uint8_t * p_data = p_pdu->data;
+    sim_model_t * p_model;
+    bool health;
+
+    switch (p_pdu->opcode.opcode)
+    {
+        case CONFIG_OPCODE_COMPOSITION_DATA_GET:
+            status_opcode = CONFIG_OPCODE_COMPOSITION_DATA_STATUS;
+            reply[0] = 0;
+            reply_length = 1 + composition_data_build(p_node, &reply[1]);
+            break;
+
+        case CONFIG_OPCODE_APPKEY_ADD:
+            status_opcode = CONFIG_OPCODE_APPKEY_STATUS;
+            p_node->has_appkey = true;
+            reply[0] = ACCESS_STATUS_SUCCESS;
+            memcpy(&reply[1], p_data, 3);
+            reply_length = 4;
+            config_server_event(p_node, CONFIG_SERVER_EVT_APPKEY_ADD);
+            break;
+
+        case CONFIG_OPCODE_MODEL_APP_BIND:
+        {
+            uint16_t element_address;
+            memcpy(&element_address, p_data, 2);
+            status_opcode = CONFIG_OPCODE_MODEL_APP_STATUS;
+            reply[0] = config_model_lookup(p_node, element_address, model_id_get(&p_data[4], p_pdu->length - 4), &p_model, &health);
+            if (reply[0] == ACCESS_STATUS_SUCCESS && !p_node->has_appkey)
+            {
+                reply[0] = ACCESS_STATUS_INVALID_APPKEY;
+            }
+            if (reply[0] == ACCESS_STATUS_SUCCESS)
+            {
+                if (health)
+                {
+                    p_node->health_bound = true;
+                }
+                else
+                {
+                    p_model->app_bound = true;
+                }
+            }
+            memcpy(&reply[1], p_data, p_pdu->length);
+            reply_length = 1 + p_pdu->length;
+            config_server_event(p_node, CONFIG_SERVER_EVT_MODEL_APP_BIND);
+            break;
+        }
+
+        case CONFIG_OPCODE_MODEL_PUBLICATION_SET:
+        {
+            uint16_t element_address;
+            uint16_t publish_address;
+            memcpy(&element_address, p_data, 2);
+            memcpy(&publish_address, &p_data[2], 2);
+            status_opcode = CONFIG_OPCODE_MODEL_PUBLICATION_STATUS;
+            reply[0] = config_model_lookup(p_node, element_address, model_id_get(&p_data[9], p_pdu->length - 9), &p_model, &health);
+            if (reply[0] == ACCESS_STATUS_SUCCESS)
+            {
+                if (health)
+                {
+                    p_node->health_pub_address = publish_address;
+                    p_node->health_pub_ttl = p_data[6];
+                    p_node->health_period_ms = publish_period_ms(p_data[7]);
+                    sim_health_publication_start(p_node);
+                }
+                else
+                {
+                    p_model->publish_address = publish_address;
+                    p_model->publish_ttl = p_data[6];
+                    p_model->publish_appkey = true;
+                }
+            }
+            memcpy(&reply[1], p_data, p_pdu->length);
+            reply_length = 1 + p_pdu->length;
+            config_server_event(p_node, CONFIG_SERVER_EVT_MODEL_PUBLICATION_SET);
+            break;
+        }
+
+        case CONFIG_OPCODE_MODEL_SUBSCRIPTION_ADD:
+        {
+            uint16_t element_address;
+            uint16_t address;
+            memcpy(&element_address, p_data, 2);
+            memcpy(&address, &p_data[2], 2);
+            status_opcode = CONFIG_OPCODE_MODEL_SUBSCRIPTION_STATUS;
+            reply[0] = config_model_lookup(p_node, element_address, model_id_get(&p_data[4], p_pdu->length - 4), &p_model, &health);
+            if (reply[0] == ACCESS_STATUS_SUCCESS && (health || !p_model->subscription_list))
+            {
+                reply[0] = ACCESS_STATUS_NOT_A_SUBSCRIPTION_MODEL;
+            }
+            if (reply[0] == ACCESS_STATUS_SUCCESS)
+            {
+                bool present = false;
+                for (uint8_t i = 0; i < p_model->subscription_count; i++)
+                {
+                    present |= p_model->subscriptions[i] == address;
+                }
+                if (!present && p_model->subscription_count >= SIM_MODEL_SUBS_MAX)
+                {
+                    reply[0] = ACCESS_STATUS_INSUFFICIENT_RESOURCES;
+                }
+                else if (!present)
+                {
+                    p_model->subscriptions[p_model->subscription_count++] = address;
+                }
+            }
+            memcpy(&reply[1], p_data, p_pdu->length);
+            reply_length = 1 + p_pdu->length;
+            config_server_event(p_node, CONFIG_SERVER_EVT_MODEL_SUBSCRIPTION_ADD);
+            break;
+        }
+
+        default:
+            return;
+    }
+
+    sim_net_send(p_node, SIM_PDU_CONFIG_STATUS, p_pdu->src, g_sim.config.ttl, opcode_sig(status_opcode), reply, reply_length, false);
+}
+
+/*****************************************************************************
+ * Servidor e cliente Health
+ *****************************************************************************/
+
+static void health_publish(sim_node_t * p_node, void * p_arg, uint32_t generation)
+{
+    if (p_node->health_generation != generation || p_node->health_period_ms == 0)
+    {
+        return;
+    }
+    if (p_node->health_bound && p_node->has_appkey && p_node->health_pub_address != NRF_MESH_ADDR_UNASSIGNED)
+    {
+        /* Current Status sem falhas: test ID e company ID */
+        uint8_t status[3] = { 0, ACCESS_COMPANY_ID_NORDIC & 0xFF, ACCESS_COMPANY_ID_NORDIC >> 8 };
+        sim_net_send(p_node, SIM_PDU_HEALTH, p_node->health_pub_address, p_node->health_pub_ttl,
+                     opcode_sig(HEALTH_OPCODE_CURRENT_STATUS), status, sizeof(status), false);
+    }
+    sim_event_schedule(g_sim_now + (uint64_t) p_node->health_period_ms * 1000, p_node, health_publish, NULL, generation);
+}
+
+void sim_health_publication_start(sim_node_t * p_node)
+{
+    p_node->health_generation++;
+    if (p_node->health_period_ms > 0)
+    {
+        sim_event_schedule(g_sim_now + (uint64_t) p_node->health_period_ms * 1000, p_node, health_publish, NULL,
+                           p_node->health_generation);
+    }
+}
+
+uint32_t health_client_init(health_client_t * p_client, uint16_t element_index, health_client_evt_cb_t evt_handler)
+{
+    static const access_opcode_handler_t no_handlers[1];
+    access_model_add_params_t params =
+    {
+        .model_id = { ACCESS_COMPANY_ID_NONE, HEALTH_CLIENT_MODEL_ID },
+        .element_index = element_index,
+        .p_opcode_handlers = no_handlers,
+        .opcode_count = 0,
+        .p_args = p_client
+    };
+    p_client->event_handler = evt_handler;
+    p_client->waiting_for_reply = false;
+    g_sim_node->p_health_client = p_client;
+    return access_model_add(&params, &p_client->model_handle);
+}
+
+void sim_health_client_rx(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint8_t ttl, int8_t rssi)
+{
+    health_client_t * p_client = p_node->p_health_client;
+    if (p_client == NULL || p_client->event_handler == NULL || p_pdu->length < 3)
+    {
+        return;
+    }
+
+    nrf_mesh_rx_metadata_t core_metadata;
+    memset(&core_metadata, 0, sizeof(core_metadata));
+    core_metadata.source = NRF_MESH_RX_SOURCE_SCANNER;
+    core_metadata.params.scanner.rssi = rssi;
+
+    access_message_rx_meta_t meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.src.type = NRF_MESH_ADDRESS_TYPE_UNICAST;
+    meta.src.value = p_pdu->src;
+    meta.dst.type = NRF_MESH_ADDRESS_TYPE_UNICAST;
+    meta.dst.value = p_pdu->dst;
+    meta.ttl = ttl;
+    meta.p_core_metadata = &core_metadata;
+
+    health_client_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = HEALTH_CLIENT_EVT_TYPE_CURRENT_STATUS_RECEIVED;
+    event.p_meta_data = &meta;
+    event.data.fault_status.test_id = p_pdu->data[0];
+    event.data.fault_status.company_id = (uint16_t) (p_pdu->data[1] | (p_pdu->data[2] << 8));
+    event.data.fault_status.fault_array_length = (uint8_t) (p_pdu->length - 3);
+    event.data.fault_status.p_fault_array = &p_pdu->data[3];
+    p_client->event_handler(p_client, &event);
+}
@@ -0,0 +1,681 @@
+#include "sim.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <ucontext.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "log.h"
+#include "mesh_app_utils.h"
+#include "mesh_softdevice_init.h"
+#include "nrf_mesh_assert.h"
+#include "nrf_mesh_configure.h"
+#include "rand.h"
+#include "simple_hal.h"
+#include "timer_scheduler.h"
+
+/** Núcleo do simulador: filas de eventos das partições, execução em janelas, inicialização dos nós e as camadas do SDK
+ *  que só dependem do nó em execução (timers, aleatoriedade, log e erros) */
+
+sim_t g_sim;
+__thread sim_node_t * g_sim_node;
+__thread uint64_t g_sim_now;
+int g_sim_log_level = -1;
+
+static __thread ucontext_t m_event_loop;    /**< Retorno ao laço de eventos quando a aplicação chama sd_app_evt_wait() */
+
+/** Barreira entre janelas: espera ativa, pois as janelas são curtas e muitas */
+static struct
+{
+    uint32_t count;
+    uint32_t waiting;
+    uint32_t phase;
+} m_barrier;
+
+static uint64_t m_run_until;
+
+static void sim_fatal(const char * p_message)
+{
+    fprintf(stderr, "sim: %s\n", p_message);
+    exit(EXIT_FAILURE);
+}
+
+/*****************************************************************************
+ * Filas de eventos: heap binário por partição, ordenado pela chave do evento
+ *****************************************************************************/
+
+static bool event_before(const sim_event_t * p_a, const sim_event_t * p_b)
+{
+    return p_a->time < p_b->time || (p_a->time == p_b->time && p_a->order < p_b->order);
+}
+
+static void heap_push(sim_partition_t * p_partition, const sim_event_t * p_event)
+{
+    if (p_partition->heap_count == p_partition->heap_size)
+    {
+        p_partition->heap_size = p_partition->heap_size ? 2 * p_partition->heap_size : 1024;
+        p_partition->p_heap = realloc(p_partition->p_heap, p_partition->heap_size * sizeof(sim_event_t));
+        if (p_partition->p_heap == NULL)
+        {
+            sim_fatal("sem memória para a fila de eventos");
+        }
+    }
+
+    sim_event_t * p_heap = p_partition->p_heap;
+    uint32_t i = p_partition->heap_count++;
+    while (i > 0 && event_before(p_event, &p_heap[(i - 1) / 2]))
+    {
+        p_heap[i] = p_heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    p_heap[i] = *p_event;
+}
+
+static sim_event_t heap_pop(sim_partition_t * p_partition)
+{
+    sim_event_t * p_heap = p_partition->p_heap;
+    sim_event_t top = p_heap[0];
+    sim_event_t last = p_heap[--p_partition->heap_count];
+    uint32_t count = p_partition->heap_count;
+    uint32_t i = 0;
+    for (;;)
+    {
+        uint32_t child = 2 * i + 1;
+        if (child >= count)
+        {
+            break;
+        }
+        if (child + 1 < count && event_before(&p_heap[child + 1], &p_heap[child]))
+        {
+            child++;
+        }
+        if (!event_before(&p_heap[child], &last))
+        {
+            break;
+        }
+        p_heap[i] = p_heap[child];
+        i = child;
+    }
+    p_heap[i] = last;
+    return top;
+}
+
+/* Pilha de Treiber: várias partições produzem, a dona consome tudo de uma vez entre janelas */
+static void inbox_push(sim_partition_t * p_partition, const sim_event_t * p_event)
+{
+    sim_event_link_t * p_link = malloc(sizeof(sim_event_link_t));
+    if (p_link == NULL)
+    {
+        sim_fatal("sem memória para a fila de eventos");
+    }
+    p_link->event = *p_event;
+    p_link->p_next = __atomic_load_n(&p_partition->p_inbox, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&p_partition->p_inbox, &p_link->p_next, p_link, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+static void inbox_drain(sim_partition_t * p_partition)
+{
+    sim_event_link_t * p_link = __atomic_exchange_n(&p_partition->p_inbox, NULL, __ATOMIC_ACQUIRE);
+    while (p_link != NULL)
+    {
+        sim_event_link_t * p_next = p_link->p_next;
+        heap_push(p_partition, &p_link->event);
+        free(p_link);
+        p_link = p_next;
+    }
+}
+
+void sim_event_schedule(uint64_t time, sim_node_t * p_node, sim_event_cb_t cb, void * p_arg, uint32_t value)
+{
+    sim_node_t * p_source = g_sim_node != NULL ? g_sim_node : p_node;
+    sim_event_t event =
+    {
+        .time = time < g_sim_now ? g_sim_now : time,
+        .order = ((uint64_t) p_source->index << 40) | p_source->event_seq++,
+        .p_node = p_node,
+        .cb = cb,
+        .p_arg = p_arg,
+        .value = value
+    };
+
+    if (g_sim_node == NULL || p_node == g_sim_node)
+    {
+        heap_push(p_node->p_partition, &event);
+        return;
+    }
+    /* Entre nós, o atraso mínimo garante que o evento cai numa janela ainda não iniciada */
+    if (event.time < g_sim_now + SIM_LOOKAHEAD_US)
+    {
+        sim_fatal("evento para outro nó dentro do lookahead");
+    }
+    if (p_node->p_partition == g_sim_node->p_partition)
+    {
+        heap_push(p_node->p_partition, &event);
+    }
+    else
+    {
+        inbox_push(p_node->p_partition, &event);
+    }
+}
+
+void sim_partitions_init(uint32_t count)
+{
+    g_sim.partition_count = count;
+    g_sim.p_partitions = calloc(count, sizeof(sim_partition_t));
+    g_sim.p_accept_count = calloc(0x10000, sizeof(uint32_t));
+    if (g_sim.p_partitions == NULL || g_sim.p_accept_count == NULL)
+    {
+        sim_fatal("sem memória para as partições");
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        g_sim.p_partitions[i].index = i;
+        g_sim.p_partitions[i].next_time = UINT64_MAX;
+        sim_stats_partition_init(&g_sim.p_partitions[i]);
+    }
+    m_barrier.count = count;
+}
+
+/*****************************************************************************
+ * Execução em janelas de SIM_LOOKAHEAD_US
+ *****************************************************************************/
+
+static void barrier_wait(void)
+{
+    if (m_barrier.count == 1)
+    {
+        return;
+    }
+    uint32_t phase = __atomic_load_n(&m_barrier.phase, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&m_barrier.waiting, 1, __ATOMIC_ACQ_REL) == m_barrier.count)
+    {
+        __atomic_store_n(&m_barrier.waiting, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&m_barrier.phase, phase + 1, __ATOMIC_RELEASE);
+        return;
+    }
+    for (uint32_t spins = 0; __atomic_load_n(&m_barrier.phase, __ATOMIC_ACQUIRE) == phase; spins++)
+    {
+        if (spins > 1000)
+        {
+            sched_yield();
+        }
+    }
+}
+
+static void partition_touch(sim_partition_t * p_partition, sim_node_t * p_node)
+{
+    if (p_node->touched)
+    {
+        return;
+    }
+    if (p_partition->touched_count == p_partition->touched_size)
+    {
+        p_partition->touched_size = p_partition->touched_size ? 2 * p_partition->touched_size : 64;
+        p_partition->pp_touched = realloc(p_partition->pp_touched, p_partition->touched_size * sizeof(sim_node_t *));
+        if (p_partition->pp_touched == NULL)
+        {
+            sim_fatal("sem memória para as partições");
+        }
+    }
+    p_node->touched = true;
+    p_partition->pp_touched[p_partition->touched_count++] = p_node;
+}
+
+/* Entre janelas: recebe os eventos das outras partições e publica o estado de recepção dos nós que executaram */
+static void partition_sync(sim_partition_t * p_partition)
+{
+    inbox_drain(p_partition);
+    for (uint32_t i = 0; i < p_partition->touched_count; i++)
+    {
+        p_partition->pp_touched[i]->touched = false;
+        sim_access_publish(p_partition->pp_touched[i]);
+    }
+    p_partition->touched_count = 0;
+    p_partition->next_time = p_partition->heap_count > 0 ? p_partition->p_heap[0].time : UINT64_MAX;
+}
+
+static void partition_window(sim_partition_t * p_partition, uint64_t end)
+{
+    while (p_partition->heap_count > 0 && p_partition->p_heap[0].time < end)
+    {
+        sim_event_t event = heap_pop(p_partition);
+        g_sim_now = event.time;
+        if (!event.p_node->alive)
+        {
+            continue;
+        }
+        g_sim_node = event.p_node;
+        partition_touch(p_partition, event.p_node);
+        event.cb(event.p_node, event.p_arg, event.value);
+        sim_node_resume(event.p_node);
+    }
+    g_sim_node = NULL;
+}
+
+static void * partition_run(void * p_arg)
+{
+    sim_partition_t * p_partition = p_arg;
+    for (;;)
+    {
+        partition_sync(p_partition);
+        barrier_wait();
+
+        /* A janela começa no primeiro evento pendente em qualquer partição: períodos ociosos são pulados */
+        uint64_t start = UINT64_MAX;
+        for (uint32_t i = 0; i < g_sim.partition_count; i++)
+        {
+            uint64_t next_time = g_sim.p_partitions[i].next_time;
+            start = next_time < start ? next_time : start;
+        }
+        if (start > m_run_until)
+        {
+            break;
+        }
+        uint64_t end = start + SIM_LOOKAHEAD_US;
+        partition_window(p_partition, end <= m_run_until ? end : m_run_until + 1);
+
+        /* A partição 0 grava o trace e aplica os movimentos da janela; até a próxima barreira, as outras só
+         * recebem eventos e publicam o estado de recepção, sem ler posições */
+        barrier_wait();
+        if (p_partition->index == 0)
+        {
+            sim_trace_flush();
+            sim_grid_moves_apply();
+        }
+    }
+    return NULL;
+}
+
+void sim_run(uint64_t until)
+{
+    pthread_t * p_threads = calloc(g_sim.partition_count, sizeof(pthread_t));
+    m_run_until = until;
+    for (uint32_t i = 1; i < g_sim.partition_count; i++)
+    {
+        if (pthread_create(&p_threads[i], NULL, partition_run, &g_sim.p_partitions[i]) != 0)
+        {
+            sim_fatal("não foi possível criar as threads das partições");
+        }
+    }
+    (void) partition_run(&g_sim.p_partitions[0]);
+    for (uint32_t i = 1; i < g_sim.partition_count; i++)
+    {
+        pthread_join(p_threads[i], NULL);
+    }
+    free(p_threads);
+    g_sim_now = until;
+}
+
+/*****************************************************************************
+ * Aleatoriedade: xorshift64* por nó, para o resultado não depender da ordem de execução dos nós
+ *****************************************************************************/
+
+uint64_t sim_rand(sim_node_t * p_node)
+{
+    uint64_t x = p_node->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    p_node->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double sim_rand_unit(sim_node_t * p_node)
+{
+    return (sim_rand(p_node) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void rand_hw_rng_get(uint8_t * p_result, uint16_t bytes)
+{
+    while (bytes > 0)
+    {
+        uint64_t r = sim_rand(g_sim_node);
+        uint16_t n = bytes < sizeof(r) ? bytes : sizeof(r);
+        memcpy(p_result, &r, n);
+        p_result += n;
+        bytes -= n;
+    }
+}
+
+/*****************************************************************************
+ * Log e erros
+ *****************************************************************************/
+
+const char * sim_app_name(sim_app_t app)
+{
+    static const char * const names[SIM_APP_COUNT] = { "full", "no_sensor", "provisioner" };
+    return app < SIM_APP_COUNT ? names[app] : "?";
+}
+
+static void log_prefix(FILE * p_out)
+{
+    if (g_sim_node != NULL)
+    {
+        fprintf(p_out, "[%11.6f] %-11s #%-4u 0x%04x: ", g_sim_now / 1e6, sim_app_name(g_sim_node->app),
+                g_sim_node->index, g_sim_node->unicast);
+    }
+    else
+    {
+        fprintf(p_out, "[%11.6f] sim: ", g_sim_now / 1e6);
+    }
+}
+
+/* Com várias threads, as linhas de log de partições diferentes se intercalam fora da ordem do tempo virtual */
+void sim_log_printf(uint32_t level, const char * p_filename, uint16_t line, const char * format, ...)
+{
+    va_list args;
+    flockfile(stderr);
+    log_prefix(stderr);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    funlockfile(stderr);
+}
+
+void sim_log_hex(uint32_t level, const char * msg, const uint8_t * p_data, uint32_t len)
+{
+    flockfile(stderr);
+    log_prefix(stderr);
+    fputs(msg, stderr);
+    for (uint32_t i = 0; i < len; i++)
+    {
+        fprintf(stderr, "%02x", p_data[i]);
+    }
+    fputc('\n', stderr);
+    funlockfile(stderr);
+}
+
+void sim_app_error(uint32_t err_code, const char * p_file, uint32_t line)
+{
+    log_prefix(stderr);
+    fprintf(stderr, "erro %u em %s:%u\n", err_code, p_file, line);
+    exit(EXIT_FAILURE);
+}
+
+void sim_assert_fail(const char * p_file, uint32_t line)
+{
+    log_prefix(stderr);
+    fprintf(stderr, "asserção falhou em %s:%u\n", p_file, line);
+    exit(EXIT_FAILURE);
+}
+
+/*****************************************************************************
+ * Laço principal da aplicação: main() executa numa corrotina do nó até a primeira chamada a sd_app_evt_wait(), e
+ * volta dela depois de cada evento do nó, como depois de cada interrupção no dispositivo. Cada nó fica sempre na
+ * mesma partição, e a corrotina é retomada sempre pela mesma thread
+ *****************************************************************************/
+
+uint32_t sd_app_evt_wait(void)
+{
+    if (swapcontext(&g_sim_node->app_context, &m_event_loop) != 0)
+    {
+        sim_fatal("swapcontext falhou");
+    }
+    return NRF_SUCCESS;
+}
+
+bool nrf_mesh_process(void)
+{
+    return true;
+}
+
+static void app_entry(void)
+{
+    (void) g_sim_node->p_app_main();
+    log_prefix(stderr);
+    fprintf(stderr, "main() retornou\n");
+    exit(EXIT_FAILURE);
+}
+
+void sim_node_resume(sim_node_t * p_node)
+{
+    if (p_node->alive && p_node->p_app_stack != NULL && swapcontext(&m_event_loop, &p_node->app_context) != 0)
+    {
+        sim_fatal("swapcontext falhou");
+    }
+}
+
+void sim_node_boot(sim_node_t * p_node, uint32_t value)
+{
+    p_node->p_app_stack = malloc(SIM_APP_STACK_SIZE);
+    if (p_node->p_app_stack == NULL || getcontext(&p_node->app_context) != 0)
+    {
+        sim_fatal("sem memória para a pilha da aplicação");
+    }
+    p_node->app_context.uc_stack.ss_sp = p_node->p_app_stack;
+    p_node->app_context.uc_stack.ss_size = SIM_APP_STACK_SIZE;
+    p_node->app_context.uc_link = NULL;
+    makecontext(&p_node->app_context, app_entry, 0);
+    sim_node_resume(p_node);
+
+    if (g_sim.preprovisioned && p_node->app != SIM_APP_PROVISIONER)
+    {
+        sim_prov_preprovision(p_node, (uint16_t) value);
+        sim_prov_configure_defaults(p_node);
+    }
+}
+
+uint32_t mesh_softdevice_init(nrf_clock_lf_cfg_t lfc_cfg)
+{
+    return NRF_SUCCESS;
+}
+
+void execution_start(mesh_app_start_cb_t start_cb)
+{
+    start_cb();
+}
+
+/* Como no SDK: o prefixo, zeros até o byte 7 e o DEVICEID do FICR (aqui, a segunda metade do UUID sorteado do nó)
+ * nos bytes 8 a 15. Um prefixo maior seria sobrescrito pelo DEVICEID */
+uint32_t mesh_app_uuid_gen(uint8_t * p_uuid, const uint8_t * p_name_prefix, uint8_t name_prefix_size)
+{
+    const uint8_t device_id_offset = NRF_MESH_UUID_SIZE / 2;
+    if (name_prefix_size > device_id_offset)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    memset(p_uuid, 0, device_id_offset);
+    memcpy(p_uuid, p_name_prefix, name_prefix_size);
+    memcpy(&p_uuid[device_id_offset], &g_sim_node->uuid[device_id_offset], NRF_MESH_UUID_SIZE - device_id_offset);
+    return NRF_SUCCESS;
+}
+
+const uint8_t * nrf_mesh_configure_device_uuid_get(void)
+{
+    return g_sim_node->uuid;
+}
+
+uint32_t mesh_stack_init(const mesh_stack_init_params_t * p_init_params, bool * p_device_provisioned)
+{
+    if (p_init_params->core.p_uuid != NULL)
+    {
+        memcpy(g_sim_node->uuid, p_init_params->core.p_uuid, NRF_MESH_UUID_SIZE);
+    }
+    g_sim_node->config_server_cb = p_init_params->models.config_server_cb;
+    g_sim_node->models_init_cb = p_init_params->models.models_init_cb;
+    if (g_sim_node->models_init_cb != NULL)
+    {
+        g_sim_node->models_init_cb();
+    }
+    *p_device_provisioned = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_stack_start(void)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_mesh_enable(void)
+{
+    return NRF_SUCCESS;
+}
+
+bool mesh_stack_is_device_provisioned(void)
+{
+    return g_sim_node->has_subnet;
+}
+
+void nrf_mesh_evt_handler_add(nrf_mesh_evt_handler_t * p_handler_params)
+{
+    p_handler_params->p_next = g_sim_node->p_evt_handlers;
+    g_sim_node->p_evt_handlers = p_handler_params;
+}
+
+/* O nó reiniciado sai da simulação: o estado da aplicação não sobrevive ao reset e não há flash */
+void mesh_stack_device_reset(void)
+{
+    log_prefix(stderr);
+    fprintf(stderr, "reset do nó\n");
+    g_sim_node->alive = false;
+}
+
+void hal_device_reset(uint32_t gpregret_value)
+{
+    mesh_stack_device_reset();
+}
+
+/*****************************************************************************
+ * app_timer: contador do RTC de 24 bits a 32768 Hz, derivado do relógio virtual
+ *****************************************************************************/
+
+static uint64_t ticks_from_us(uint64_t us)
+{
+    return us * APP_TIMER_CLOCK_FREQ / 1000000;
+}
+
+/* Primeiro instante em que o contador alcança @p ticks, como na comparação do RTC */
+static uint64_t us_from_ticks(uint64_t ticks)
+{
+    return (ticks * 1000000 + APP_TIMER_CLOCK_FREQ - 1) / APP_TIMER_CLOCK_FREQ;
+}
+
+static void app_timer_fire(sim_node_t * p_node, void * p_arg, uint32_t generation)
+{
+    app_timer_t * p_timer = p_arg;
+    if (!p_timer->running || p_timer->generation != generation)
+    {
+        return;
+    }
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED)
+    {
+        sim_event_schedule(us_from_ticks(ticks_from_us(g_sim_now) + p_timer->interval), p_node, app_timer_fire, p_timer, generation);
+    }
+    else
+    {
+        p_timer->running = false;
+    }
+    p_timer->handler(p_timer->p_context);
+}
+
+ret_code_t app_timer_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler)
+{
+    if (p_timer_id == NULL || *p_timer_id == NULL || timeout_handler == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    (*p_timer_id)->handler = timeout_handler;
+    (*p_timer_id)->mode = mode;
+    (*p_timer_id)->running = false;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS || timeout_ticks > APP_TIMER_MAX_CNT_VAL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (timer_id->handler == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    timer_id->generation++;
+    timer_id->interval = timeout_ticks;
+    timer_id->p_context = p_context;
+    timer_id->running = true;
+    sim_event_schedule(us_from_ticks(ticks_from_us(g_sim_now) + timeout_ticks), g_sim_node, app_timer_fire, timer_id, timer_id->generation);
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+    timer_id->generation++;
+    timer_id->running = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(void)
+{
+    return (uint32_t) ticks_from_us(g_sim_now) & APP_TIMER_MAX_CNT_VAL;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from)
+{
+    return (ticks_to - ticks_from) & APP_TIMER_MAX_CNT_VAL;
+}
+
+/*****************************************************************************
+ * timer_scheduler da mesh: timestamps de 32 bits em microssegundos
+ *****************************************************************************/
+
+timestamp_t timer_now(void)
+{
+    return (timestamp_t) g_sim_now;
+}
+
+/* O timestamp de 32 bits dá a volta a cada 71 minutos: é interpretado relativo ao instante atual */
+static uint64_t timestamp_to_abs(timestamp_t timestamp)
+{
+    int32_t delta = (int32_t) (timestamp - (timestamp_t) g_sim_now);
+    return delta > 0 ? g_sim_now + (uint64_t) delta : g_sim_now;
+}
+
+static void timer_sch_fire(sim_node_t * p_node, void * p_arg, uint32_t generation)
+{
+    timer_event_t * p_timer = p_arg;
+    if (p_timer->state == 0 || p_timer->sim_generation != generation)
+    {
+        return;
+    }
+    timestamp_t timestamp = p_timer->timestamp;
+    if (p_timer->interval > 0)
+    {
+        p_timer->timestamp += p_timer->interval;
+        timer_sch_schedule(p_timer);
+    }
+    else
+    {
+        p_timer->state = 0;
+    }
+    p_timer->cb(timestamp, p_timer->p_context);
+}
+
+void timer_sch_schedule(timer_event_t * p_timer_evt)
+{
+    p_timer_evt->sim_generation++;
+    p_timer_evt->state = 1;
+    sim_event_schedule(timestamp_to_abs(p_timer_evt->timestamp), g_sim_node, timer_sch_fire, p_timer_evt, p_timer_evt->sim_generation);
+}
+
+void timer_sch_abort(timer_event_t * p_timer_evt)
+{
+    p_timer_evt->sim_generation++;
+    p_timer_evt->state = 0;
+}
+
+void timer_sch_reschedule(timer_event_t * p_timer_evt, timestamp_t new_timestamp)
+{
+    p_timer_evt->timestamp = new_timestamp;
+    timer_sch_schedule(p_timer_evt);
+}
@@ -0,0 +1,236 @@
+#include "sim.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Índice espacial dos nós: grade uniforme com células do tamanho do alcance de rádio, de modo que os vizinhos de um
+ *  nó estão na sua célula ou nas oito adjacentes. Cada nó guarda a lista dos vizinhos ao alcance, montada na primeira
+ *  consulta e invalidada quando ele ou um nó próximo se move.
+ *
+ *  As posições só mudam entre janelas: sim_node_move() enfileira o movimento na partição do nó, e a partição 0
+ *  aplica os movimentos de todas enquanto as outras esperam na barreira. Dentro de uma janela, a grade e as posições
+ *  são somente leitura, e a lista de vizinhos de um nó só é montada pela partição dele */
+
+#define GRID_CELLS_MAX      (1u << 20)  /**< Limite de células; com alcance muito pequeno, as células crescem */
+
+typedef struct
+{
+    sim_node_t ** pp_nodes;
+    uint32_t count;
+    uint32_t size;
+} grid_cell_t;
+
+static struct
+{
+    double min_x;
+    double min_y;
+    double cell_size;
+    uint32_t columns;
+    uint32_t rows;
+    grid_cell_t * p_cells;
+} m_grid;
+
+static void grid_fatal(void)
+{
+    fprintf(stderr, "sim: sem memória para o índice espacial\n");
+    exit(EXIT_FAILURE);
+}
+
+/* Posições fora da área inicial ficam nas células da borda: a busca continua correta, só menos seletiva */
+static uint32_t axis_cell(double value, double min, uint32_t cells)
+{
+    double cell = floor((value - min) / m_grid.cell_size);
+    if (cell < 0.0)
+    {
+        return 0;
+    }
+    return cell >= cells ? cells - 1 : (uint32_t) cell;
+}
+
+static grid_cell_t * grid_cell(double x, double y)
+{
+    return &m_grid.p_cells[axis_cell(y, m_grid.min_y, m_grid.rows) * m_grid.columns + axis_cell(x, m_grid.min_x, m_grid.columns)];
+}
+
+static void cell_add(grid_cell_t * p_cell, sim_node_t * p_node)
+{
+    if (p_cell->count == p_cell->size)
+    {
+        p_cell->size = p_cell->size ? 2 * p_cell->size : 8;
+        p_cell->pp_nodes = realloc(p_cell->pp_nodes, p_cell->size * sizeof(sim_node_t *));
+        if (p_cell->pp_nodes == NULL)
+        {
+            grid_fatal();
+        }
+    }
+    p_cell->pp_nodes[p_cell->count++] = p_node;
+}
+
+static void cell_remove(grid_cell_t * p_cell, const sim_node_t * p_node)
+{
+    for (uint32_t i = 0; i < p_cell->count; i++)
+    {
+        if (p_cell->pp_nodes[i] == p_node)
+        {
+            p_cell->pp_nodes[i] = p_cell->pp_nodes[--p_cell->count];
+            return;
+        }
+    }
+}
+
+void sim_grid_init(void)
+{
+    double max_x = g_sim.p_nodes[0].x;
+    double max_y = g_sim.p_nodes[0].y;
+    m_grid.min_x = max_x;
+    m_grid.min_y = max_y;
+    for (uint32_t i = 1; i < g_sim.node_count; i++)
+    {
+        const sim_node_t * p_node = &g_sim.p_nodes[i];
+        m_grid.min_x = p_node->x < m_grid.min_x ? p_node->x : m_grid.min_x;
+        m_grid.min_y = p_node->y < m_grid.min_y ? p_node->y : m_grid.min_y;
+        max_x = p_node->x > max_x ? p_node->x : max_x;
+        max_y = p_node->y > max_y ? p_node->y : max_y;
+    }
+
+    double width = max_x - m_grid.min_x;
+    double height = max_y - m_grid.min_y;
+    m_grid.cell_size = g_sim.config.range > 1.0 ? g_sim.config.range : 1.0;
+    while ((floor(width / m_grid.cell_size) + 1) * (floor(height / m_grid.cell_size) + 1) > GRID_CELLS_MAX)
+    {
+        m_grid.cell_size *= 2;
+    }
+    m_grid.columns = (uint32_t) floor(width / m_grid.cell_size) + 1;
+    m_grid.rows = (uint32_t) floor(height / m_grid.cell_size) + 1;
+    m_grid.p_cells = calloc((size_t) m_grid.columns * m_grid.rows, sizeof(grid_cell_t));
+    if (m_grid.p_cells == NULL)
+    {
+        grid_fatal();
+    }
+    for (uint32_t i = 0; i < g_sim.node_count; i++)
+    {
+        cell_add(grid_cell(g_sim.p_nodes[i].x, g_sim.p_nodes[i].y), &g_sim.p_nodes[i]);
+    }
+}
+
+/* Chama visit para as células da vizinhança de (x, y), incluindo a própria */
+static void grid_around(double x, double y, void (*visit)(grid_cell_t * p_cell, void * p_context), void * p_context)
+{
+    uint32_t column = axis_cell(x, m_grid.min_x, m_grid.columns);
+    uint32_t row = axis_cell(y, m_grid.min_y, m_grid.rows);
+    uint32_t last_column = column + 1 < m_grid.columns ? column + 1 : column;
+    uint32_t last_row = row + 1 < m_grid.rows ? row + 1 : row;
+    for (uint32_t r = row ? row - 1 : 0; r <= last_row; r++)
+    {
+        for (uint32_t c = column ? column - 1 : 0; c <= last_column; c++)
+        {
+            visit(&m_grid.p_cells[r * m_grid.columns + c], p_context);
+        }
+    }
+}
+
+static void neighbors_collect(grid_cell_t * p_cell, void * p_context)
+{
+    sim_node_t * p_node = p_context;
+    for (uint32_t i = 0; i < p_cell->count; i++)
+    {
+        sim_node_t * p_other = p_cell->pp_nodes[i];
+        if (p_other == p_node || !sim_in_range(p_node, p_other))
+        {
+            continue;
+        }
+        if (p_node->neighbor_count == p_node->neighbor_size)
+        {
+            p_node->neighbor_size = p_node->neighbor_size ? 2 * p_node->neighbor_size : 8;
+            p_node->pp_neighbors = realloc(p_node->pp_neighbors, p_node->neighbor_size * sizeof(sim_node_t *));
+            if (p_node->pp_neighbors == NULL)
+            {
+                grid_fatal();
+            }
+        }
+        p_node->pp_neighbors[p_node->neighbor_count++] = p_other;
+    }
+}
+
+static int neighbor_compare(const void * p_a, const void * p_b)
+{
+    uint32_t a = (*(sim_node_t * const *) p_a)->index;
+    uint32_t b = (*(sim_node_t * const *) p_b)->index;
+    return (a > b) - (a < b);
+}
+
+/* Em ordem de índice, como a varredura de todos os nós que a grade substitui */
+sim_node_t * const * sim_neighbors(sim_node_t * p_node, uint32_t * p_count)
+{
+    if (!p_node->neighbors_valid)
+    {
+        p_node->neighbor_count = 0;
+        grid_around(p_node->x, p_node->y, neighbors_collect, p_node);
+        qsort(p_node->pp_neighbors, p_node->neighbor_count, sizeof(sim_node_t *), neighbor_compare);
+        p_node->neighbors_valid = true;
+    }
+    *p_count = p_node->neighbor_count;
+    return p_node->pp_neighbors;
+}
+
+static void neighbors_invalidate(grid_cell_t * p_cell, void * p_context)
+{
+    for (uint32_t i = 0; i < p_cell->count; i++)
+    {
+        p_cell->pp_nodes[i]->neighbors_valid = false;
+    }
+}
+
+static void node_move_apply(sim_node_t * p_node, double x, double y)
+{
+    grid_cell_t * p_from = grid_cell(p_node->x, p_node->y);
+    grid_cell_t * p_to = grid_cell(x, y);
+
+    /* Quem estava ou passa a estar ao alcance do nó está na vizinhança da célula de origem ou de destino */
+    grid_around(p_node->x, p_node->y, neighbors_invalidate, NULL);
+    grid_around(x, y, neighbors_invalidate, NULL);
+    p_node->neighbors_valid = false;
+    p_node->x = x;
+    p_node->y = y;
+    if (p_from != p_to)
+    {
+        cell_remove(p_from, p_node);
+        cell_add(p_to, p_node);
+    }
+}
+
+void sim_node_move(sim_node_t * p_node, double x, double y)
+{
+    if (g_sim_node == NULL)
+    {
+        node_move_apply(p_node, x, y);
+        return;
+    }
+
+    sim_partition_t * p_partition = p_node->p_partition;
+    if (p_partition->move_count == p_partition->move_size)
+    {
+        p_partition->move_size = p_partition->move_size ? 2 * p_partition->move_size : 16;
+        p_partition->p_moves = realloc(p_partition->p_moves, p_partition->move_size * sizeof(sim_move_t));
+        if (p_partition->p_moves == NULL)
+        {
+            grid_fatal();
+        }
+    }
+    p_partition->p_moves[p_partition->move_count++] = (sim_move_t) { .p_node = p_node, .x = x, .y = y };
+}
+
+/* Os movimentos de um nó estão todos na fila da sua partição, em ordem: o resultado não depende da ordem das filas */
+void sim_grid_moves_apply(void)
+{
+    for (uint32_t i = 0; i < g_sim.partition_count; i++)
+    {
+        sim_partition_t * p_partition = &g_sim.p_partitions[i];
+        for (uint32_t j = 0; j < p_partition->move_count; j++)
+        {
+            node_move_apply(p_partition->p_moves[j].p_node, p_partition->p_moves[j].x, p_partition->p_moves[j].y);
+        }
+        p_partition->move_count = 0;
+    }
+}
@@ -0,0 +1,454 @@
+#include "sim.h"
+
+#include <dlfcn.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+
+/** Simulador de eventos discretos da rede Smart City: ponto de entrada, topologia e carga das aplicações.
+ *  Uso: smart_city_sim [opções]; --help lista as opções */
+
+#ifndef SIM_APP_DIR
+#define SIM_APP_DIR "."
+#endif
+
+#define SIM_PREPROVISIONED_START_ADDRESS    (0x0100)
+
+static const char * const m_module_names[SIM_APP_COUNT] =
+{
+    "semaforo_full.so",
+    "semaforo_no_sensor.so",
+    "provisioner.so"
+};
+
+static void usage(FILE * p_out)
+{
+    fprintf(p_out,
+            "uso: smart_city_sim [opções]\n"
+            "  --full N           semáforos completos (padrão 20)\n"
+            "  --no-sensor N      semáforos sem sensor (padrão 10)\n"
+            "  --provisioner      inclui o provisionador; os nós começam não provisionados\n"
+            "                     (sem esta opção, os nós já começam provisionados e configurados)\n"
+            "  --area LxA         área do mapa em metros (padrão 500x500)\n"
+            "  --range M          alcance do rádio em metros (padrão 100)\n"
+            "  --loss P           probabilidade de perda de cada segmento (padrão 0)\n"
+            "  --ttl N            TTL das publicações configuradas (padrão 30)\n"
+            "  --repeats N        transmissões de cada PDU de rede (padrão 1)\n"
+            "  --duration S       tempo simulado em segundos (padrão 600)\n"
+            "  --boot-spread S    intervalo de partida dos nós em segundos (padrão 10)\n"
+            "  --seed N           semente da simulação (padrão 1)\n"
+            "  --threads N        partições espaciais, uma thread cada; o resultado não muda (padrão 1)\n"
+            "  --map ARQ          posições dos nós: linhas \"full|no_sensor|provisioner x y\"\n"
+            "  --trace ARQ        trace CSV de transmissões, entregas, colisões e perdas\n"
+            "  --log N            nível de log das aplicações (padrão: sem log)\n"
+            "  --app-dir DIR      diretório dos módulos das aplicações (padrão %s)\n",
+            SIM_APP_DIR);
+}
+
+static bool app_parse(const char * p_name, sim_app_t * p_app)
+{
+    static const char * const names[SIM_APP_COUNT] = { "full", "no_sensor", "provisioner" };
+    for (uint32_t i = 0; i < SIM_APP_COUNT; i++)
+    {
+        if (strcmp(p_name, names[i]) == 0)
+        {
+            *p_app = (sim_app_t) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t seed_mix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x ? x : 1;
+}
+
+static bool config_parse(int argc, char ** argv, sim_config_t * p_config)
+{
+    p_config->node_count[SIM_APP_FULL] = 20;
+    p_config->node_count[SIM_APP_NO_SENSOR] = 10;
+    p_config->node_count[SIM_APP_PROVISIONER] = 0;
+    p_config->area_width = 500.0;
+    p_config->area_height = 500.0;
+    p_config->range = 100.0;
+    p_config->loss = 0.0;
+    p_config->ttl = 30;
+    p_config->repeats = 1;
+    p_config->duration_s = 600.0;
+    p_config->boot_spread_s = 10.0;
+    p_config->seed = 1;
+    p_config->threads = 1;
+    p_config->p_app_dir = SIM_APP_DIR;
+    p_config->log_level = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char * p_arg = argv[i];
+        const char * p_value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool has_value = true;
+
+        if (strcmp(p_arg, "--help") == 0)
+        {
+            usage(stdout);
+            exit(EXIT_SUCCESS);
+        }
+        else if (strcmp(p_arg, "--provisioner") == 0)
+        {
+            p_config->node_count[SIM_APP_PROVISIONER] = 1;
+            has_value = false;
+        }
+        else if (p_value == NULL)
+        {
+            fprintf(stderr, "sim: opção inválida ou sem valor: %s\n", p_arg);
+            return false;
+        }
+        else if (strcmp(p_arg, "--full") == 0)
+        {
+            p_config->node_count[SIM_APP_FULL] = (uint32_t) strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--no-sensor") == 0)
+        {
+            p_config->node_count[SIM_APP_NO_SENSOR] = (uint32_t) strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--area") == 0)
+        {
+            if (sscanf(p_value, "%lfx%lf", &p_config->area_width, &p_config->area_height) != 2)
+            {
+                fprintf(stderr, "sim: área inválida: %s\n", p_value);
+                return false;
+            }
+        }
+        else if (strcmp(p_arg, "--range") == 0)
+        {
+            p_config->range = strtod(p_value, NULL);
+        }
+        else if (strcmp(p_arg, "--loss") == 0)
+        {
+            p_config->loss = strtod(p_value, NULL);
+        }
+        else if (strcmp(p_arg, "--ttl") == 0)
+        {
+            p_config->ttl = (uint8_t) strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--repeats") == 0)
+        {
+            p_config->repeats = (uint8_t) strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--duration") == 0)
+        {
+            p_config->duration_s = strtod(p_value, NULL);
+        }
+        else if (strcmp(p_arg, "--boot-spread") == 0)
+        {
+            p_config->boot_spread_s = strtod(p_value, NULL);
+        }
+        else if (strcmp(p_arg, "--seed") == 0)
+        {
+            p_config->seed = strtoull(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--threads") == 0)
+        {
+            p_config->threads = (uint32_t) strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--map") == 0)
+        {
+            p_config->p_map_path = p_value;
+        }
+        else if (strcmp(p_arg, "--trace") == 0)
+        {
+            p_config->p_trace_path = p_value;
+        }
+        else if (strcmp(p_arg, "--log") == 0)
+        {
+            p_config->log_level = (int) strtol(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--app-dir") == 0)
+        {
+            p_config->p_app_dir = p_value;
+        }
+        else
+        {
+            fprintf(stderr, "sim: opção desconhecida: %s\n", p_arg);
+            return false;
+        }
+        i += has_value;
+    }
+
+    if (p_config->ttl > NRF_MESH_TTL_MAX || p_config->repeats == 0 || p_config->threads == 0 || p_config->loss < 0.0 ||
+        p_config->loss >= 1.0)
+    {
+        fprintf(stderr, "sim: --ttl deve ser no máximo %u, --repeats e --threads pelo menos 1 e --loss em [0, 1)\n",
+                NRF_MESH_TTL_MAX);
+        return false;
+    }
+    return true;
+}
+
+static sim_node_t * node_add(sim_app_t app, double x, double y)
+{
+    g_sim.p_nodes = realloc(g_sim.p_nodes, (g_sim.node_count + 1) * sizeof(sim_node_t));
+    sim_node_t * p_node = &g_sim.p_nodes[g_sim.node_count];
+    memset(p_node, 0, sizeof(*p_node));
+    p_node->index = g_sim.node_count++;
+    p_node->app = app;
+    p_node->x = x;
+    p_node->y = y;
+    return p_node;
+}
+
+static bool map_load(const char * p_path)
+{
+    FILE * p_file = fopen(p_path, "r");
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return false;
+    }
+    memset(g_sim.config.node_count, 0, sizeof(g_sim.config.node_count));
+
+    char line[256];
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        char name[32];
+        double x;
+        double y;
+        sim_app_t app;
+        line_number++;
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+        if (sscanf(line, "%31s %lf %lf", name, &x, &y) != 3 || !app_parse(name, &app))
+        {
+            fprintf(stderr, "%s:%u: linha inválida\n", p_path, line_number);
+            fclose(p_file);
+            return false;
+        }
+        (void) node_add(app, x, y);
+        g_sim.config.node_count[app]++;
+    }
+    fclose(p_file);
+    return true;
+}
+
+/* Posições uniformes na área; o provisionador fica no centro */
+static void map_generate(void)
+{
+    uint64_t rng = seed_mix(g_sim.config.seed);
+    for (uint32_t app = 0; app < SIM_APP_COUNT; app++)
+    {
+        for (uint32_t i = 0; i < g_sim.config.node_count[app]; i++)
+        {
+            if (app == SIM_APP_PROVISIONER)
+            {
+                (void) node_add(SIM_APP_PROVISIONER, g_sim.config.area_width / 2, g_sim.config.area_height / 2);
+                continue;
+            }
+            rng = seed_mix(rng);
+            double x = (rng >> 11) * (1.0 / 9007199254740992.0) * g_sim.config.area_width;
+            rng = seed_mix(rng);
+            double y = (rng >> 11) * (1.0 / 9007199254740992.0) * g_sim.config.area_height;
+            (void) node_add((sim_app_t) app, x, y);
+        }
+    }
+}
+
+static bool file_copy(const char * p_from, const char * p_to)
+{
+    FILE * p_in = fopen(p_from, "rb");
+    FILE * p_out = p_in != NULL ? fopen(p_to, "wb") : NULL;
+    bool ok = p_out != NULL;
+    char buffer[65536];
+    size_t length;
+    while (ok && (length = fread(buffer, 1, sizeof(buffer), p_in)) > 0)
+    {
+        ok = fwrite(buffer, 1, length, p_out) == length;
+    }
+    if (p_in != NULL)
+    {
+        fclose(p_in);
+    }
+    if (p_out != NULL)
+    {
+        ok = fclose(p_out) == 0 && ok;
+    }
+    return ok;
+}
+
+/* Cada nó carrega uma cópia própria do módulo da aplicação, para ter o seu próprio estado estático:
+ * o carregador dinâmico não abre duas vezes o mesmo arquivo */
+static bool node_module_load(sim_node_t * p_node, const char * p_tmp_dir)
+{
+    char source[PATH_MAX];
+    char copy[PATH_MAX];
+    snprintf(source, sizeof(source), "%s/%s", g_sim.config.p_app_dir, m_module_names[p_node->app]);
+    snprintf(copy, sizeof(copy), "%s/node%u.so", p_tmp_dir, p_node->index);
+
+    if (!file_copy(source, copy))
+    {
+        fprintf(stderr, "sim: não foi possível copiar %s\n", source);
+        return false;
+    }
+    p_node->p_module = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+    (void) unlink(copy);
+    if (p_node->p_module == NULL)
+    {
+        fprintf(stderr, "sim: %s\n", dlerror());
+        return false;
+    }
+    *(void **) &p_node->p_app_main = dlsym(p_node->p_module, "sim_app_main");
+    if (p_node->p_app_main == NULL)
+    {
+        fprintf(stderr, "sim: %s sem sim_app_main\n", source);
+        return false;
+    }
+    return true;
+}
+
+static int node_position_compare(const void * p_a, const void * p_b)
+{
+    const sim_node_t * p_node_a = *(const sim_node_t * const *) p_a;
+    const sim_node_t * p_node_b = *(const sim_node_t * const *) p_b;
+    if (p_node_a->x != p_node_b->x)
+    {
+        return p_node_a->x < p_node_b->x ? -1 : 1;
+    }
+    if (p_node_a->y != p_node_b->y)
+    {
+        return p_node_a->y < p_node_b->y ? -1 : 1;
+    }
+    return (p_node_a->index > p_node_b->index) - (p_node_a->index < p_node_b->index);
+}
+
+/* Faixas verticais com o mesmo número de nós: vizinhos de rádio tendem a ficar na mesma partição */
+static void partitions_assign(void)
+{
+    uint32_t count = g_sim.config.threads;
+    if (count > g_sim.node_count)
+    {
+        count = g_sim.node_count;
+    }
+    sim_partitions_init(count);
+
+    sim_node_t ** pp_sorted = malloc(g_sim.node_count * sizeof(sim_node_t *));
+    for (uint32_t i = 0; i < g_sim.node_count; i++)
+    {
+        pp_sorted[i] = &g_sim.p_nodes[i];
+    }
+    qsort(pp_sorted, g_sim.node_count, sizeof(sim_node_t *), node_position_compare);
+    for (uint32_t i = 0; i < g_sim.node_count; i++)
+    {
+        pp_sorted[i]->p_partition = &g_sim.p_partitions[(uint64_t) i * count / g_sim.node_count];
+    }
+    free(pp_sorted);
+}
+
+static void node_boot_event(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_node_boot(p_node, value);
+}
+
+int main(int argc, char ** argv)
+{
+    if (!config_parse(argc, argv, &g_sim.config))
+    {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    g_sim_log_level = g_sim.config.log_level;
+    g_sim.preprovisioned = g_sim.config.node_count[SIM_APP_PROVISIONER] == 0;
+
+    if (g_sim.config.p_map_path != NULL)
+    {
+        if (!map_load(g_sim.config.p_map_path))
+        {
+            return EXIT_FAILURE;
+        }
+        g_sim.preprovisioned = g_sim.config.node_count[SIM_APP_PROVISIONER] == 0;
+    }
+    else
+    {
+        map_generate();
+    }
+    if (g_sim.node_count == 0)
+    {
+        fprintf(stderr, "sim: nenhum nó\n");
+        return EXIT_FAILURE;
+    }
+    partitions_assign();
+    sim_grid_init();
+
+    if (g_sim.config.p_trace_path != NULL)
+    {
+        g_sim.p_trace = fopen(g_sim.config.p_trace_path, "w");
+        if (g_sim.p_trace == NULL)
+        {
+            perror(g_sim.config.p_trace_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    char tmp_dir[] = "/tmp/smart_city_sim.XXXXXX";
+    if (mkdtemp(tmp_dir) == NULL)
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    bool loaded = true;
+    uint64_t boot_rng = seed_mix(g_sim.config.seed ^ 0xB007);
+    uint16_t address = SIM_PREPROVISIONED_START_ADDRESS;
+    for (uint32_t i = 0; i < g_sim.node_count && loaded; i++)
+    {
+        sim_node_t * p_node = &g_sim.p_nodes[i];
+        loaded = node_module_load(p_node, tmp_dir);
+
+        /* UUID: a primeira metade é refeita pela aplicação (mesh_app_uuid_gen); a segunda faz as vezes do DEVICEID do
+         * FICR, com o índice do nó nos dois últimos bytes, lidos como ID do sensor */
+        p_node->rng = seed_mix(g_sim.config.seed * 0x100000001B3ULL + i);
+        for (uint32_t j = 0; j < NRF_MESH_UUID_SIZE; j++)
+        {
+            p_node->uuid[j] = (uint8_t) sim_rand(p_node);
+        }
+        p_node->uuid[NRF_MESH_UUID_SIZE - 2] = (uint8_t) ((i + 1) >> 8);
+        p_node->uuid[NRF_MESH_UUID_SIZE - 1] = (uint8_t) (i + 1);
+        p_node->alive = true;
+
+        boot_rng = seed_mix(boot_rng);
+        uint64_t boot_us = (uint64_t) ((boot_rng >> 11) * (1.0 / 9007199254740992.0) * g_sim.config.boot_spread_s * 1e6);
+        if (p_node->app == SIM_APP_PROVISIONER)
+        {
+            /* O provisionador parte primeiro, como na bancada */
+            boot_us = 0;
+        }
+        sim_event_schedule(boot_us, p_node, node_boot_event, NULL, p_node->app == SIM_APP_PROVISIONER ? 0 : address++);
+    }
+    (void) rmdir(tmp_dir);
+    if (!loaded)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct timespec wall_start;
+    struct timespec wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    sim_run((uint64_t) (g_sim.config.duration_s * 1e6));
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+    if (g_sim.p_trace != NULL)
+    {
+        fclose(g_sim.p_trace);
+    }
+    sim_stats_report(stdout, (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9);
+    return EXIT_SUCCESS;
+}
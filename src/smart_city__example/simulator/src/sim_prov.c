@@ -0,0 +1,465 @@
+#include "sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh_provisionee.h"
+#include "nrf_mesh_prov.h"
+#include "nrf_mesh_prov_bearer_adv.h"
+#include "rand.h"
+
+/** Provisionamento simulado (PB-ADV). O protocolo é reduzido às etapas que geram eventos nas aplicações, com as
+ *  latências típicas de um enlace PB-ADV de um salto; não há criptografia. As etapas que envolvem o dispositivo são
+ *  eventos trocados entre os dois nós (abertura do enlace e dados de provisionamento), e cada nó só altera o próprio
+ *  estado. O dispositivo só responde se ainda anuncia o beacon e está ao alcance; sem resposta, o enlace é encerrado
+ *  por timeout. Como no SDK, cada contexto nrf_mesh_prov_ctx_t tem o seu enlace, e o provisionador pode manter vários
+ *  em paralelo */
+
+#define PROV_BEACON_INTERVAL_US     (2000000)   /**< Beacon de dispositivo não provisionado */
+#define PROV_BEACON_JITTER_US       (500000)
+#define PROV_LINK_OPEN_US           (150000)
+#define PROV_CAPABILITIES_US        (150000)
+#define PROV_PUBLIC_KEY_US          (1500000)   /**< Troca de chaves públicas e ECDH */
+#define PROV_DATA_US                (1000000)   /**< Confirmação, random e dados de provisionamento */
+#define PROV_LINK_CLOSE_US          (100000)
+#define PROV_TIMEOUT_MARGIN_US      (500000)    /**< Espera além da ida e volta antes de desistir do dispositivo */
+
+typedef enum
+{
+    PROV_LINK_OPENING,
+    PROV_LINK_CAPABILITIES,
+    PROV_LINK_WAIT_OOB,
+    PROV_LINK_PUBLIC_KEY,
+    PROV_LINK_WAIT_AUTH,
+    PROV_LINK_DATA,
+    PROV_LINK_CLOSING
+} prov_link_stage_t;
+
+/* Os eventos do enlace levam a geração nos 16 bits altos do valor e o dado da etapa nos baixos */
+static uint32_t link_value(const sim_prov_link_t * p_link, uint16_t payload)
+{
+    return ((uint32_t) p_link->generation << 16) | payload;
+}
+
+/* Enlace ativo do nó com a geração do evento, se ainda estiver na etapa esperada */
+static sim_prov_link_t * link_current(sim_node_t * p_node, uint32_t value, prov_link_stage_t stage)
+{
+    for (uint32_t i = 0; i < p_node->prov_link_count; i++)
+    {
+        sim_prov_link_t * p_link = &p_node->prov_links[i];
+        if (p_link->active && p_link->generation == value >> 16)
+        {
+            return p_link->stage == stage ? p_link : NULL;
+        }
+    }
+    return NULL;
+}
+
+static void prov_event(const sim_prov_link_t * p_link, const nrf_mesh_prov_evt_t * p_evt)
+{
+    if (p_link->p_ctx->event_handler != NULL)
+    {
+        p_link->p_ctx->event_handler(p_evt);
+    }
+}
+
+/*****************************************************************************
+ * Dispositivo
+ *****************************************************************************/
+
+/* O uuid e a aplicação de um nó não mudam, e a posição só muda entre janelas: podem ser lidos de qualquer partição */
+static void beacon_receive(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_node_t * p_device = p_arg;
+    if (p_node->scan_handler == NULL)
+    {
+        return;
+    }
+
+    nrf_mesh_rx_metadata_t metadata;
+    memset(&metadata, 0, sizeof(metadata));
+    metadata.source = NRF_MESH_RX_SOURCE_SCANNER;
+    metadata.params.scanner.rssi = sim_rssi(p_device, p_node);
+
+    nrf_mesh_prov_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = NRF_MESH_PROV_EVT_UNPROVISIONED_RECEIVED;
+    memcpy(event.params.unprov.device_uuid, p_device->uuid, NRF_MESH_UUID_SIZE);
+    event.params.unprov.p_metadata = &metadata;
+    p_node->scan_handler(&event);
+}
+
+static void beacon_send(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    if (!p_node->beaconing)
+    {
+        return;
+    }
+    uint32_t neighbor_count;
+    sim_node_t * const * pp_neighbors = sim_neighbors(p_node, &neighbor_count);
+    for (uint32_t i = 0; i < neighbor_count; i++)
+    {
+        sim_node_t * p_rx = pp_neighbors[i];
+        if (p_rx->app == SIM_APP_PROVISIONER)
+        {
+            sim_event_schedule(g_sim_now + SIM_ADV_TX_LATENCY_US + SIM_ADV_AIRTIME_US, p_rx, beacon_receive, p_node, 0);
+        }
+    }
+    sim_event_schedule(g_sim_now + PROV_BEACON_INTERVAL_US + sim_rand(p_node) % PROV_BEACON_JITTER_US, p_node, beacon_send,
+                       NULL, 0);
+}
+
+uint32_t mesh_provisionee_prov_start(const mesh_provisionee_start_params_t * p_start_params)
+{
+    if (g_sim_node->beaconing)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    g_sim_node->prov_complete_cb = p_start_params->prov_complete_cb;
+    g_sim_node->beaconing = true;
+    sim_event_schedule(g_sim_now + sim_rand(g_sim_node) % PROV_BEACON_INTERVAL_US, g_sim_node, beacon_send, NULL, 0);
+    return NRF_SUCCESS;
+}
+
+static void link_ack(sim_node_t * p_node, void * p_arg, uint32_t value);
+static void link_capabilities(sim_node_t * p_node, void * p_arg, uint32_t value);
+static void link_complete(sim_node_t * p_node, void * p_arg, uint32_t value);
+
+/* p_arg é o provisionador; só responde a ele se ainda anuncia o beacon e o alcança */
+static bool device_reachable(const sim_node_t * p_node, const sim_node_t * p_provisioner)
+{
+    return p_node->beaconing && sim_in_range(p_node, p_provisioner);
+}
+
+static void device_link_open(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    if (device_reachable(p_node, p_arg))
+    {
+        uint16_t element_count = p_node->element_count ? p_node->element_count : 1;
+        sim_event_schedule(g_sim_now + PROV_LINK_OPEN_US / 2, p_arg, link_ack, NULL, (value & 0xFFFF0000) | element_count);
+    }
+}
+
+/* Recebe endereço e chave de rede e deixa de anunciar o beacon */
+static void device_prov_data(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    if (!device_reachable(p_node, p_arg))
+    {
+        return;
+    }
+    p_node->unicast = value & 0xFFFF;
+    if (p_node->element_count == 0)
+    {
+        p_node->element_count = 1;
+    }
+    p_node->has_subnet = true;
+    p_node->beaconing = false;
+    if (p_node->prov_complete_cb != NULL)
+    {
+        p_node->prov_complete_cb();
+    }
+    sim_event_schedule(g_sim_now + PROV_DATA_US / 2, p_arg, link_complete, NULL, value & 0xFFFF0000);
+}
+
+void sim_prov_preprovision(sim_node_t * p_node, uint16_t address)
+{
+    p_node->unicast = address;
+    if (p_node->element_count == 0)
+    {
+        p_node->element_count = 1;
+    }
+    p_node->has_subnet = true;
+    p_node->has_appkey = true;
+    p_node->beaconing = false;
+    if (p_node->prov_complete_cb != NULL)
+    {
+        p_node->prov_complete_cb();
+    }
+}
+
+/* Configuração que o provisionador aplicaria: cada modelo da aplicação publica e assina o grupo do seu modelo */
+void sim_prov_configure_defaults(sim_node_t * p_node)
+{
+    for (uint16_t i = 0; i < p_node->model_count; i++)
+    {
+        sim_model_t * p_model = &p_node->models[i];
+        if (p_model->id.company_id == ACCESS_COMPANY_ID_NONE)
+        {
+            continue;
+        }
+        uint16_t group = 0xC000 | p_model->id.model_id;
+        p_model->app_bound = true;
+        p_model->publish_appkey = true;
+        p_model->publish_address = group;
+        p_model->publish_ttl = g_sim.config.ttl;
+        if (p_model->subscription_list && p_model->subscription_count == 0)
+        {
+            p_model->subscriptions[p_model->subscription_count++] = group;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Provisionador
+ *****************************************************************************/
+
+static void link_closed(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_prov_link_t * p_link = link_current(p_node, value, PROV_LINK_CLOSING);
+    if (p_link == NULL)
+    {
+        return;
+    }
+    nrf_mesh_prov_ctx_t * p_ctx = p_link->p_ctx;
+    p_link->active = false;
+    p_ctx->state = p_link->close_reason == NRF_MESH_PROV_LINK_CLOSE_REASON_SUCCESS ?
+                   NRF_MESH_PROV_STATE_COMPLETE : NRF_MESH_PROV_STATE_IDLE;
+
+    nrf_mesh_prov_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = NRF_MESH_PROV_EVT_LINK_CLOSED;
+    event.params.link_closed.p_context = p_ctx;
+    event.params.link_closed.close_reason = (nrf_mesh_prov_link_close_reason_t) p_link->close_reason;
+    prov_event(p_link, &event);
+}
+
+static void link_close(sim_node_t * p_node, sim_prov_link_t * p_link, nrf_mesh_prov_link_close_reason_t reason)
+{
+    p_link->close_reason = reason;
+    p_link->stage = PROV_LINK_CLOSING;
+    sim_event_schedule(g_sim_now + PROV_LINK_CLOSE_US, p_node, link_closed, NULL, link_value(p_link, 0));
+}
+
+static void link_timeout(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_prov_link_t * p_link = link_current(p_node, value, (prov_link_stage_t) (value & 0xFFFF));
+    if (p_link != NULL)
+    {
+        link_close(p_node, p_link, NRF_MESH_PROV_LINK_CLOSE_REASON_TIMEOUT);
+    }
+}
+
+/* Envia uma etapa ao dispositivo e desiste se a resposta não chegar a tempo */
+static void link_request(sim_node_t * p_node, sim_prov_link_t * p_link, sim_event_cb_t device_cb, uint16_t payload,
+                         uint64_t one_way_us)
+{
+    sim_event_schedule(g_sim_now + one_way_us, p_link->p_target, device_cb, p_node, link_value(p_link, payload));
+    sim_event_schedule(g_sim_now + 2 * one_way_us + PROV_TIMEOUT_MARGIN_US, p_node, link_timeout, NULL,
+                       link_value(p_link, p_link->stage));
+}
+
+static void link_ack(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_prov_link_t * p_link = link_current(p_node, value, PROV_LINK_OPENING);
+    if (p_link == NULL)
+    {
+        return;
+    }
+    p_link->stage = PROV_LINK_CAPABILITIES;
+    p_link->p_ctx->state = NRF_MESH_PROV_STATE_LINK_ESTABLISHED;
+    sim_event_schedule(g_sim_now + PROV_CAPABILITIES_US, p_node, link_capabilities, NULL, value);
+
+    nrf_mesh_prov_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = NRF_MESH_PROV_EVT_LINK_ESTABLISHED;
+    event.params.link_established.p_context = p_link->p_ctx;
+    prov_event(p_link, &event);
+}
+
+/* value traz o número de elementos informado pelo dispositivo na abertura do enlace */
+static void link_capabilities(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_prov_link_t * p_link = link_current(p_node, value, PROV_LINK_CAPABILITIES);
+    if (p_link == NULL)
+    {
+        return;
+    }
+    nrf_mesh_prov_oob_caps_t caps = NRF_MESH_PROV_OOB_CAPS_DEFAULT(value & 0xFFFF);
+    p_link->stage = PROV_LINK_WAIT_OOB;
+    p_link->p_ctx->peer_capabilities = caps;
+
+    nrf_mesh_prov_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = NRF_MESH_PROV_EVT_CAPS_RECEIVED;
+    event.params.oob_caps_received.p_context = p_link->p_ctx;
+    event.params.oob_caps_received.oob_caps = caps;
+    prov_event(p_link, &event);
+}
+
+static void link_data_send(sim_node_t * p_node, sim_prov_link_t * p_link)
+{
+    p_link->stage = PROV_LINK_DATA;
+    link_request(p_node, p_link, device_prov_data, p_link->p_ctx->data.address, PROV_DATA_US / 2);
+}
+
+/* value traz o método de OOB escolhido: com OOB estático, a aplicação ainda precisa fornecer o dado */
+static void link_public_key(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_prov_link_t * p_link = link_current(p_node, value, PROV_LINK_PUBLIC_KEY);
+    if (p_link == NULL)
+    {
+        return;
+    }
+    if ((value & 0xFFFF) != NRF_MESH_PROV_OOB_METHOD_STATIC)
+    {
+        link_data_send(p_node, p_link);
+        return;
+    }
+    p_link->stage = PROV_LINK_WAIT_AUTH;
+
+    nrf_mesh_prov_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = NRF_MESH_PROV_EVT_STATIC_REQUEST;
+    event.params.static_request.p_context = p_link->p_ctx;
+    prov_event(p_link, &event);
+}
+
+static void link_complete(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_prov_link_t * p_link = link_current(p_node, value, PROV_LINK_DATA);
+    if (p_link == NULL)
+    {
+        return;
+    }
+    nrf_mesh_prov_ctx_t * p_ctx = p_link->p_ctx;
+    for (uint32_t i = 0; i < NRF_MESH_KEY_SIZE; i++)
+    {
+        p_ctx->device_key[i] = (uint8_t) sim_rand(p_node);
+    }
+    link_close(p_node, p_link, NRF_MESH_PROV_LINK_CLOSE_REASON_SUCCESS);
+
+    nrf_mesh_prov_evt_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = NRF_MESH_PROV_EVT_COMPLETE;
+    event.params.complete.p_context = p_ctx;
+    event.params.complete.p_devkey = p_ctx->device_key;
+    event.params.complete.p_prov_data = &p_ctx->data;
+    prov_event(p_link, &event);
+}
+
+uint32_t nrf_mesh_prov_generate_keys(uint8_t * p_public, uint8_t * p_private)
+{
+    rand_hw_rng_get(p_public, NRF_MESH_PROV_PUBKEY_SIZE);
+    rand_hw_rng_get(p_private, NRF_MESH_PROV_PRIVKEY_SIZE);
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_mesh_prov_init(nrf_mesh_prov_ctx_t * p_ctx, const uint8_t * p_public_key, const uint8_t * p_private_key,
+                            const nrf_mesh_prov_oob_caps_t * p_caps, nrf_mesh_prov_evt_handler_cb_t event_handler)
+{
+    if (p_ctx == NULL || p_caps == NULL || event_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    /* Cada contexto tem o seu enlace, reaproveitado se o contexto for inicializado de novo */
+    sim_prov_link_t * p_link = NULL;
+    for (uint32_t i = 0; i < g_sim_node->prov_link_count && p_link == NULL; i++)
+    {
+        if (g_sim_node->prov_links[i].p_ctx == p_ctx)
+        {
+            p_link = &g_sim_node->prov_links[i];
+        }
+    }
+    if (p_link == NULL)
+    {
+        if (g_sim_node->prov_link_count == SIM_PROV_LINKS_MAX)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        p_link = &g_sim_node->prov_links[g_sim_node->prov_link_count++];
+    }
+    p_link->active = false;
+    p_link->p_ctx = p_ctx;
+
+    p_ctx->event_handler = event_handler;
+    p_ctx->capabilities = *p_caps;
+    p_ctx->state = NRF_MESH_PROV_STATE_IDLE;
+    p_ctx->p_sim_link = p_link;
+    return NRF_SUCCESS;
+}
+
+prov_bearer_t * nrf_mesh_prov_bearer_adv_interface_get(nrf_mesh_prov_bearer_adv_t * p_bearer_adv)
+{
+    p_bearer_adv->prov_bearer.sim_bearer_type = NRF_MESH_PROV_BEARER_ADV;
+    return &p_bearer_adv->prov_bearer;
+}
+
+uint32_t nrf_mesh_prov_bearer_add(nrf_mesh_prov_ctx_t * p_ctx, prov_bearer_t * p_prov_bearer)
+{
+    p_ctx->p_bearer = p_prov_bearer;
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_mesh_prov_provision(nrf_mesh_prov_ctx_t * p_ctx, const uint8_t * p_target_uuid,
+                                 const nrf_mesh_prov_provisioning_data_t * p_data, nrf_mesh_prov_bearer_type_t bearer)
+{
+    sim_prov_link_t * p_link = p_ctx->p_sim_link;
+    if (p_link == NULL || p_link->active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    sim_node_t * p_target = NULL;
+    for (uint32_t i = 0; i < g_sim.node_count && p_target == NULL; i++)
+    {
+        if (memcmp(g_sim.p_nodes[i].uuid, p_target_uuid, NRF_MESH_UUID_SIZE) == 0)
+        {
+            p_target = &g_sim.p_nodes[i];
+        }
+    }
+
+    p_link->active = true;
+    p_link->generation = ++g_sim_node->prov_generation;
+    p_link->p_target = p_target;
+    p_ctx->data = *p_data;
+
+    if (p_target == NULL || p_target == g_sim_node)
+    {
+        link_close(g_sim_node, p_link, NRF_MESH_PROV_LINK_CLOSE_REASON_TIMEOUT);
+    }
+    else
+    {
+        p_link->stage = PROV_LINK_OPENING;
+        link_request(g_sim_node, p_link, device_link_open, 0, PROV_LINK_OPEN_US / 2);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_mesh_prov_oob_use(nrf_mesh_prov_ctx_t * p_ctx, nrf_mesh_prov_oob_method_t method, uint8_t action, uint8_t size)
+{
+    sim_prov_link_t * p_link = p_ctx->p_sim_link;
+    if (p_link == NULL || !p_link->active || p_link->stage != PROV_LINK_WAIT_OOB)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (method != NRF_MESH_PROV_OOB_METHOD_STATIC && method != NRF_MESH_PROV_OOB_METHOD_NONE)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    p_link->stage = PROV_LINK_PUBLIC_KEY;
+    sim_event_schedule(g_sim_now + PROV_PUBLIC_KEY_US, g_sim_node, link_public_key, NULL, link_value(p_link, method));
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_mesh_prov_auth_data_provide(nrf_mesh_prov_ctx_t * p_ctx, const uint8_t * p_data, uint8_t size)
+{
+    sim_prov_link_t * p_link = p_ctx->p_sim_link;
+    if (p_link == NULL || !p_link->active || p_link->stage != PROV_LINK_WAIT_AUTH)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    link_data_send(g_sim_node, p_link);
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_mesh_prov_scan_start(nrf_mesh_prov_evt_handler_cb_t event_handler)
+{
+    g_sim_node->scan_handler = event_handler;
+    return NRF_SUCCESS;
+}
+
+void nrf_mesh_prov_scan_stop(void)
+{
+    g_sim_node->scan_handler = NULL;
+}
@@ -0,0 +1,269 @@
+#include "sim.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Bearer de advertising e camada de rede simulados.
+ *  Uma transmissão ocupa o rádio do emissor e de todos os nós ao alcance durante o tempo no ar dos seus segmentos.
+ *  Duas transmissões que se sobrepõem num receptor colidem e são perdidas, a não ser que uma seja mais forte por
+ *  SIM_CAPTURE_DB (captura); as recebidas enquanto o próprio receptor transmite também são perdidas.
+ *  Cada segmento ainda pode ser perdido com a probabilidade --loss. Os receptores vêm do índice espacial (sim_grid.c),
+ *  e o emissor só altera o próprio estado: cada recepção começa como um evento no receptor.
+ *  Todo nó provisionado retransmite (relay) com TTL decrementado, filtrando cópias pelo cache (src, seq) */
+
+double sim_distance(const sim_node_t * p_a, const sim_node_t * p_b)
+{
+    return hypot(p_a->x - p_b->x, p_a->y - p_b->y);
+}
+
+bool sim_in_range(const sim_node_t * p_a, const sim_node_t * p_b)
+{
+    return sim_distance(p_a, p_b) <= g_sim.config.range;
+}
+
+int8_t sim_rssi(const sim_node_t * p_a, const sim_node_t * p_b)
+{
+    double d = sim_distance(p_a, p_b);
+    double rssi = SIM_RSSI_AT_1M - 10.0 * SIM_RSSI_PATH_LOSS_EXP * log10(d < 1.0 ? 1.0 : d);
+    return (int8_t) (rssi < -127.0 ? -127.0 : rssi);
+}
+
+static uint64_t cache_key(uint16_t src, uint32_t seq)
+{
+    return ((uint64_t) src << 32) | seq;
+}
+
+/* Retorna false se (src, seq) já estava no cache */
+static bool net_cache_add(sim_node_t * p_node, uint16_t src, uint32_t seq)
+{
+    uint64_t key = cache_key(src, seq);
+    for (uint32_t i = 0; i < SIM_NET_CACHE_SIZE; i++)
+    {
+        if (p_node->net_cache[i] == key)
+        {
+            return false;
+        }
+    }
+    p_node->net_cache[p_node->net_cache_next] = key;
+    p_node->net_cache_next = (p_node->net_cache_next + 1) % SIM_NET_CACHE_SIZE;
+    return true;
+}
+
+/* A PDU é compartilhada pelos receptores de todas as partições */
+static void pdu_retain(sim_pdu_t * p_pdu)
+{
+    __atomic_fetch_add(&p_pdu->refs, 1, __ATOMIC_RELAXED);
+}
+
+static void pdu_release(sim_pdu_t * p_pdu)
+{
+    if (__atomic_sub_fetch(&p_pdu->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        free(p_pdu);
+    }
+}
+
+/* Registra a ocupação do rádio de @p p_node, marcando as recepções sobrepostas como corrompidas */
+static void air_add(sim_node_t * p_node, sim_air_t * p_new)
+{
+    sim_air_t ** pp = &p_node->p_air;
+    while (*pp != NULL)
+    {
+        sim_air_t * p_air = *pp;
+        /* Transmissões próprias encerradas não têm evento de fim: são removidas aqui */
+        if (p_air->own && p_air->end <= g_sim_now)
+        {
+            *pp = p_air->p_next;
+            free(p_air);
+            continue;
+        }
+        if (p_air->start < p_new->end && p_new->start < p_air->end && !(p_air->own && p_new->own))
+        {
+            /* Efeito de captura: entre duas recepções, a mais forte por SIM_CAPTURE_DB sobrevive */
+            bool own = p_air->own || p_new->own;
+            if (!p_new->own && (own || p_air->rssi + SIM_CAPTURE_DB > p_new->rssi))
+            {
+                p_new->corrupt = true;
+            }
+            if (!p_air->own && (own || p_new->rssi + SIM_CAPTURE_DB > p_air->rssi))
+            {
+                p_air->corrupt = true;
+            }
+        }
+        pp = &p_air->p_next;
+    }
+    p_new->p_next = p_node->p_air;
+    p_node->p_air = p_new;
+}
+
+static void air_remove(sim_node_t * p_node, sim_air_t * p_remove)
+{
+    for (sim_air_t ** pp = &p_node->p_air; *pp != NULL; pp = &(*pp)->p_next)
+    {
+        if (*pp == p_remove)
+        {
+            *pp = p_remove->p_next;
+            return;
+        }
+    }
+}
+
+static void radio_transmit(sim_node_t * p_node, sim_pdu_t * p_pdu, uint8_t ttl, bool relay);
+
+/* Recepção na camada de rede: filtra cópias, entrega à camada de acesso e retransmite */
+static void net_receive(sim_node_t * p_node, sim_pdu_t * p_pdu, uint8_t ttl, int8_t rssi)
+{
+    if (!p_node->has_subnet || p_pdu->src == p_node->unicast || !net_cache_add(p_node, p_pdu->src, p_pdu->seq))
+    {
+        return;
+    }
+
+    bool for_me = p_pdu->dst >= p_node->unicast && p_pdu->dst < p_node->unicast + p_node->element_count;
+    if (for_me || sim_node_accepts(p_node, p_pdu->dst, p_pdu->kind))
+    {
+        p_node->rx_count++;
+        sim_stats_delivery(p_node, p_pdu, ttl);
+        sim_access_deliver(p_node, p_pdu, ttl, rssi);
+    }
+
+    if (!for_me && ttl >= 2)
+    {
+        radio_transmit(p_node, p_pdu, ttl - 1, true);
+    }
+}
+
+static void radio_rx_end(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_air_t * p_air = p_arg;
+    air_remove(p_node, p_air);
+
+    if (p_air->corrupt)
+    {
+        p_node->collision_count++;
+        sim_trace("collision", p_node, p_air->p_pdu, g_sim_now, p_air->ttl);
+    }
+    else if (g_sim.config.loss > 0.0 && sim_rand_unit(p_node) >= pow(1.0 - g_sim.config.loss, p_air->p_pdu->segments))
+    {
+        p_node->loss_count++;
+        sim_trace("loss", p_node, p_air->p_pdu, g_sim_now, p_air->ttl);
+    }
+    else
+    {
+        net_receive(p_node, p_air->p_pdu, p_air->ttl, p_air->rssi);
+    }
+
+    pdu_release(p_air->p_pdu);
+    free(p_air);
+}
+
+static void radio_rx_start(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_air_t * p_air = p_arg;
+    air_add(p_node, p_air);
+    sim_event_schedule(p_air->end, p_node, radio_rx_end, p_air, 0);
+}
+
+/* Coloca a PDU na fila de advertising do nó; cada repetição é um evento de advertising separado */
+static void radio_transmit(sim_node_t * p_node, sim_pdu_t * p_pdu, uint8_t ttl, bool relay)
+{
+    uint64_t airtime = (uint64_t) p_pdu->segments * SIM_ADV_AIRTIME_US;
+    uint64_t earliest = g_sim_now + SIM_ADV_TX_LATENCY_US;
+    uint64_t start = p_node->tx_busy_until > earliest ? p_node->tx_busy_until : earliest;
+
+    if (relay)
+    {
+        p_node->relay_count++;
+    }
+    else
+    {
+        p_node->tx_count++;
+    }
+
+    for (uint8_t repeat = 0; repeat < g_sim.config.repeats; repeat++)
+    {
+        start += (repeat ? SIM_ADV_INTERVAL_US : 0) + sim_rand(p_node) % SIM_ADV_DELAY_MAX_US;
+        uint64_t end = start + airtime;
+        p_node->adv_count++;
+        sim_trace(relay ? "relay" : "tx", p_node, p_pdu, start, ttl);
+
+        sim_air_t * p_own = calloc(1, sizeof(sim_air_t));
+        p_own->start = start;
+        p_own->end = end;
+        p_own->own = true;
+        air_add(p_node, p_own);
+
+        uint32_t neighbor_count;
+        sim_node_t * const * pp_neighbors = sim_neighbors(p_node, &neighbor_count);
+        for (uint32_t i = 0; i < neighbor_count; i++)
+        {
+            sim_node_t * p_rx = pp_neighbors[i];
+            sim_air_t * p_air = calloc(1, sizeof(sim_air_t));
+            p_air->start = start;
+            p_air->end = end;
+            p_air->p_pdu = p_pdu;
+            p_air->ttl = ttl;
+            p_air->rssi = sim_rssi(p_node, p_rx);
+            pdu_retain(p_pdu);
+            sim_event_schedule(start, p_rx, radio_rx_start, p_air, 0);
+        }
+        start = end;
+    }
+    p_node->tx_busy_until = start;
+}
+
+static uint8_t opcode_size(access_opcode_t opcode)
+{
+    if (opcode.company_id != ACCESS_COMPANY_ID_NONE)
+    {
+        return 3;
+    }
+    return opcode.opcode < 0x80 ? 1 : 2;
+}
+
+static void loopback_deliver(sim_node_t * p_node, void * p_arg, uint32_t value)
+{
+    sim_pdu_t * p_pdu = p_arg;
+    sim_access_deliver(p_node, p_pdu, p_pdu->ttl, 0);
+    pdu_release(p_pdu);
+}
+
+void sim_net_send(sim_node_t * p_node, sim_pdu_kind_t kind, uint16_t dst, uint8_t ttl, access_opcode_t opcode,
+                  const uint8_t * p_data, uint16_t length, bool force_segmented)
+{
+    sim_pdu_t * p_pdu = calloc(1, sizeof(sim_pdu_t));
+    p_pdu->refs = 1;
+    p_pdu->kind = kind;
+    p_pdu->src = p_node->unicast;
+    p_pdu->dst = dst;
+    p_pdu->seq = p_node->seq++;
+    p_pdu->ttl = ttl;
+    p_pdu->opcode = opcode;
+    p_pdu->length = length;
+    p_pdu->origin_us = g_sim_now;
+    memcpy(p_pdu->data, p_data, length);
+
+    /* PDU de transporte: acima de 11 bytes (ou se forçado) é segmentada em blocos de 12 bytes com o TransMIC */
+    uint32_t access_length = opcode_size(opcode) + length;
+    if (force_segmented || access_length > NRF_MESH_UNSEG_PAYLOAD_SIZE_MAX)
+    {
+        p_pdu->segments = (access_length + NRF_MESH_TRANSMIC_SIZE + NRF_MESH_SEG_SIZE - 1) / NRF_MESH_SEG_SIZE;
+    }
+    else
+    {
+        p_pdu->segments = 1;
+    }
+
+    sim_stats_sent(p_node, p_pdu, sim_access_expected(p_node, dst, kind));
+    (void) net_cache_add(p_node, p_pdu->src, p_pdu->seq);
+
+    /* Como no SDK, elementos locais inscritos no destino também recebem a mensagem (loopback) */
+    if (sim_node_accepts(p_node, dst, kind))
+    {
+        pdu_retain(p_pdu);
+        sim_event_schedule(g_sim_now, p_node, loopback_deliver, p_pdu, 0);
+    }
+
+    radio_transmit(p_node, p_pdu, ttl, false);
+    pdu_release(p_pdu);
+}
@@ -0,0 +1,349 @@
+#include "sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simple_smart_city_common.h"
+
+/** Estatísticas e trace da simulação.
+ *  Cada mensagem originada registra quantos nós deveriam recebê-la (destino unicast ou grupo assinado, como publicado
+ *  no início da janela do envio); cada entrega conta uma vez por nó, com a latência desde a origem e o número de saltos.
+ *  Cada partição acumula as suas tabelas, somadas no relatório. As linhas de trace também ficam na partição até o fim
+ *  da janela, quando são ordenadas por (tempo, nó, ordem no nó) e gravadas */
+
+#define STATS_OPCODES_MAX   (32)
+
+typedef struct
+{
+    uint32_t key;
+    uint64_t sent;
+    uint64_t expected;
+    uint64_t delivered;
+    uint64_t hops;
+    uint32_t * p_latency_us;
+    uint32_t latency_count;
+    uint32_t latency_size;
+} stats_opcode_t;
+
+typedef struct
+{
+    uint64_t time;
+    uint64_t event_time;        /**< Instante do evento que gerou a linha: chave de ordenação */
+    uint32_t node;
+    uint32_t node_seq;
+    const char * p_event;
+    uint16_t src;
+    uint16_t dst;
+    uint32_t seq;
+    uint16_t opcode;
+    uint16_t length;
+    uint8_t segments;
+    uint8_t ttl;
+    uint8_t hops;
+    uint64_t latency_us;
+} stats_trace_row_t;
+
+struct sim_stats_partition
+{
+    stats_opcode_t opcodes[STATS_OPCODES_MAX];
+    uint32_t opcode_count;
+    stats_trace_row_t * p_rows;
+    uint32_t row_count;
+    uint32_t row_size;
+};
+
+static stats_trace_row_t * mp_flush_rows;
+static uint32_t m_flush_size;
+
+static void * array_grow(void * p_array, uint32_t * p_size, size_t element_size)
+{
+    *p_size = *p_size ? 2 * *p_size : 1024;
+    p_array = realloc(p_array, *p_size * element_size);
+    if (p_array == NULL)
+    {
+        fprintf(stderr, "sim: sem memória para as estatísticas\n");
+        exit(EXIT_FAILURE);
+    }
+    return p_array;
+}
+
+static uint32_t opcode_key(const sim_pdu_t * p_pdu)
+{
+    return ((uint32_t) p_pdu->kind << 16) | p_pdu->opcode.opcode;
+}
+
+static stats_opcode_t * opcode_get(sim_stats_partition_t * p_stats, uint32_t key)
+{
+    for (uint32_t i = 0; i < p_stats->opcode_count; i++)
+    {
+        if (p_stats->opcodes[i].key == key)
+        {
+            return &p_stats->opcodes[i];
+        }
+    }
+    if (p_stats->opcode_count == STATS_OPCODES_MAX)
+    {
+        return NULL;
+    }
+    p_stats->opcodes[p_stats->opcode_count].key = key;
+    return &p_stats->opcodes[p_stats->opcode_count++];
+}
+
+static const char * opcode_name(uint32_t key, char * p_buffer, size_t size)
+{
+    sim_pdu_kind_t kind = (sim_pdu_kind_t) (key >> 16);
+    uint16_t opcode = key & 0xFFFF;
+    if (kind == SIM_PDU_APP)
+    {
+        switch (opcode)
+        {
+            case SIMPLE_SMART_CITY_SHARE:           return "SHARE";
+            case SIMPLE_SMART_CITY_SET:             return "SET";
+            case SIMPLE_SMART_CITY_GET:             return "GET";
+            case SIMPLE_SMART_CITY_SHARE_COMPACT:   return "SHARE_COMPACT";
+            case SIMPLE_SMART_CITY_SET_COMPACT:     return "SET_COMPACT";
+            case SIMPLE_SMART_CITY_SHARE_BATCH:     return "SHARE_BATCH";
+            default: break;
+        }
+    }
+    snprintf(p_buffer, size, "%s 0x%04x", kind == SIM_PDU_APP ? "app" : kind == SIM_PDU_HEALTH ? "health" : "config", opcode);
+    return p_buffer;
+}
+
+void sim_stats_partition_init(sim_partition_t * p_partition)
+{
+    p_partition->p_stats = calloc(1, sizeof(sim_stats_partition_t));
+    if (p_partition->p_stats == NULL)
+    {
+        fprintf(stderr, "sim: sem memória para as estatísticas\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void sim_stats_sent(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint32_t expected)
+{
+    stats_opcode_t * p_opcode = opcode_get(p_node->p_partition->p_stats, opcode_key(p_pdu));
+    if (p_opcode != NULL)
+    {
+        p_opcode->sent++;
+        p_opcode->expected += expected;
+    }
+}
+
+void sim_stats_delivery(sim_node_t * p_node, const sim_pdu_t * p_pdu, uint8_t ttl)
+{
+    sim_trace("rx", p_node, p_pdu, g_sim_now, ttl);
+
+    stats_opcode_t * p_opcode = opcode_get(p_node->p_partition->p_stats, opcode_key(p_pdu));
+    if (p_opcode == NULL)
+    {
+        return;
+    }
+    p_opcode->delivered++;
+    p_opcode->hops += (uint8_t) (p_pdu->ttl - ttl);
+    if (p_opcode->latency_count == p_opcode->latency_size)
+    {
+        p_opcode->p_latency_us = array_grow(p_opcode->p_latency_us, &p_opcode->latency_size, sizeof(uint32_t));
+    }
+    p_opcode->p_latency_us[p_opcode->latency_count++] = (uint32_t) (g_sim_now - p_pdu->origin_us);
+}
+
+void sim_trace(const char * p_event, sim_node_t * p_node, const sim_pdu_t * p_pdu, uint64_t time, uint8_t ttl)
+{
+    if (g_sim.p_trace == NULL)
+    {
+        return;
+    }
+    sim_stats_partition_t * p_stats = p_node->p_partition->p_stats;
+    if (p_stats->row_count == p_stats->row_size)
+    {
+        p_stats->p_rows = array_grow(p_stats->p_rows, &p_stats->row_size, sizeof(stats_trace_row_t));
+    }
+    p_stats->p_rows[p_stats->row_count++] = (stats_trace_row_t)
+    {
+        .time = time,
+        .event_time = g_sim_now,
+        .node = p_node->index,
+        .node_seq = p_node->trace_seq++,
+        .p_event = p_event,
+        .src = p_pdu->src,
+        .dst = p_pdu->dst,
+        .seq = p_pdu->seq,
+        .opcode = p_pdu->opcode.opcode,
+        .length = p_pdu->length,
+        .segments = p_pdu->segments,
+        .ttl = ttl,
+        .hops = (uint8_t) (p_pdu->ttl - ttl),
+        .latency_us = time - p_pdu->origin_us
+    };
+}
+
+static int trace_row_compare(const void * p_a, const void * p_b)
+{
+    const stats_trace_row_t * p_row_a = p_a;
+    const stats_trace_row_t * p_row_b = p_b;
+    if (p_row_a->event_time != p_row_b->event_time)
+    {
+        return p_row_a->event_time < p_row_b->event_time ? -1 : 1;
+    }
+    if (p_row_a->node != p_row_b->node)
+    {
+        return p_row_a->node < p_row_b->node ? -1 : 1;
+    }
+    return (p_row_a->node_seq > p_row_b->node_seq) - (p_row_a->node_seq < p_row_b->node_seq);
+}
+
+void sim_trace_flush(void)
+{
+    if (g_sim.p_trace == NULL)
+    {
+        return;
+    }
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < g_sim.partition_count; i++)
+    {
+        sim_stats_partition_t * p_stats = g_sim.p_partitions[i].p_stats;
+        while (count + p_stats->row_count > m_flush_size)
+        {
+            mp_flush_rows = array_grow(mp_flush_rows, &m_flush_size, sizeof(stats_trace_row_t));
+        }
+        memcpy(&mp_flush_rows[count], p_stats->p_rows, p_stats->row_count * sizeof(stats_trace_row_t));
+        count += p_stats->row_count;
+        p_stats->row_count = 0;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    qsort(mp_flush_rows, count, sizeof(stats_trace_row_t), trace_row_compare);
+    if (ftell(g_sim.p_trace) == 0)
+    {
+        fprintf(g_sim.p_trace, "event,time_us,node,src,dst,seq,opcode,length,segments,ttl,hops,latency_us\n");
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const stats_trace_row_t * p_row = &mp_flush_rows[i];
+        fprintf(g_sim.p_trace, "%s,%llu,%u,0x%04x,0x%04x,%u,0x%04x,%u,%u,%u,%u,%llu\n",
+                p_row->p_event, (unsigned long long) p_row->time, p_row->node, p_row->src, p_row->dst, p_row->seq,
+                p_row->opcode, p_row->length, p_row->segments, p_row->ttl, p_row->hops,
+                (unsigned long long) p_row->latency_us);
+    }
+}
+
+static int latency_compare(const void * p_a, const void * p_b)
+{
+    uint32_t a = *(const uint32_t *) p_a;
+    uint32_t b = *(const uint32_t *) p_b;
+    return (a > b) - (a < b);
+}
+
+static int opcode_compare(const void * p_a, const void * p_b)
+{
+    uint32_t a = ((const stats_opcode_t *) p_a)->key;
+    uint32_t b = ((const stats_opcode_t *) p_b)->key;
+    return (a > b) - (a < b);
+}
+
+static double percentile_ms(const stats_opcode_t * p_opcode, double fraction)
+{
+    if (p_opcode->latency_count == 0)
+    {
+        return 0.0;
+    }
+    uint32_t index = (uint32_t) (fraction * (p_opcode->latency_count - 1) + 0.5);
+    return p_opcode->p_latency_us[index] / 1000.0;
+}
+
+/* Soma as tabelas das partições; as linhas saem em ordem de chave, independentemente do particionamento */
+static uint32_t opcodes_merge(stats_opcode_t * p_merged)
+{
+    uint32_t merged_count = 0;
+    for (uint32_t i = 0; i < g_sim.partition_count; i++)
+    {
+        sim_stats_partition_t * p_stats = g_sim.p_partitions[i].p_stats;
+        for (uint32_t j = 0; j < p_stats->opcode_count; j++)
+        {
+            const stats_opcode_t * p_opcode = &p_stats->opcodes[j];
+            stats_opcode_t * p_total = NULL;
+            for (uint32_t k = 0; k < merged_count && p_total == NULL; k++)
+            {
+                p_total = p_merged[k].key == p_opcode->key ? &p_merged[k] : NULL;
+            }
+            if (p_total == NULL)
+            {
+                if (merged_count == STATS_OPCODES_MAX)
+                {
+                    continue;
+                }
+                p_total = &p_merged[merged_count++];
+                p_total->key = p_opcode->key;
+            }
+            p_total->sent += p_opcode->sent;
+            p_total->expected += p_opcode->expected;
+            p_total->delivered += p_opcode->delivered;
+            p_total->hops += p_opcode->hops;
+            while (p_total->latency_count + p_opcode->latency_count > p_total->latency_size)
+            {
+                p_total->p_latency_us = array_grow(p_total->p_latency_us, &p_total->latency_size, sizeof(uint32_t));
+            }
+            memcpy(&p_total->p_latency_us[p_total->latency_count], p_opcode->p_latency_us,
+                   p_opcode->latency_count * sizeof(uint32_t));
+            p_total->latency_count += p_opcode->latency_count;
+        }
+    }
+    qsort(p_merged, merged_count, sizeof(stats_opcode_t), opcode_compare);
+    return merged_count;
+}
+
+void sim_stats_report(FILE * p_out, double wall_s)
+{
+    uint32_t provisioned = 0;
+    uint64_t tx = 0;
+    uint64_t relays = 0;
+    uint64_t advs = 0;
+    uint64_t collisions = 0;
+    uint64_t losses = 0;
+    for (uint32_t i = 0; i < g_sim.node_count; i++)
+    {
+        const sim_node_t * p_node = &g_sim.p_nodes[i];
+        provisioned += p_node->has_subnet && p_node->app != SIM_APP_PROVISIONER;
+        tx += p_node->tx_count;
+        relays += p_node->relay_count;
+        advs += p_node->adv_count;
+        collisions += p_node->collision_count;
+        losses += p_node->loss_count;
+    }
+
+    fprintf(p_out, "nós: %u full, %u no_sensor, %u provisioner; %u provisionados\n",
+            g_sim.config.node_count[SIM_APP_FULL], g_sim.config.node_count[SIM_APP_NO_SENSOR],
+            g_sim.config.node_count[SIM_APP_PROVISIONER], provisioned);
+    fprintf(p_out, "tempo simulado %.1f s em %.2f s (%.0fx), %u partições\n", g_sim_now / 1e6, wall_s,
+            wall_s > 0.0 ? g_sim_now / 1e6 / wall_s : 0.0, g_sim.partition_count);
+    fprintf(p_out, "mensagens originadas %llu, retransmissões (relay) %llu, eventos de advertising %llu, "
+            "colisões %llu, perdas %llu\n\n",
+            (unsigned long long) tx, (unsigned long long) relays, (unsigned long long) advs,
+            (unsigned long long) collisions, (unsigned long long) losses);
+
+    stats_opcode_t opcodes[STATS_OPCODES_MAX];
+    memset(opcodes, 0, sizeof(opcodes));
+    uint32_t opcode_count = opcodes_merge(opcodes);
+
+    fprintf(p_out, "%-16s %8s %10s %10s %8s %7s %9s %9s %9s %9s\n",
+            "opcode", "enviadas", "esperadas", "entregues", "entrega", "saltos", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (uint32_t i = 0; i < opcode_count; i++)
+    {
+        stats_opcode_t * p_opcode = &opcodes[i];
+        char name[32];
+        qsort(p_opcode->p_latency_us, p_opcode->latency_count, sizeof(uint32_t), latency_compare);
+        fprintf(p_out, "%-16s %8llu %10llu %10llu %7.1f%% %7.2f %9.1f %9.1f %9.1f %9.1f\n",
+                opcode_name(p_opcode->key, name, sizeof(name)),
+                (unsigned long long) p_opcode->sent, (unsigned long long) p_opcode->expected,
+                (unsigned long long) p_opcode->delivered,
+                p_opcode->expected ? 100.0 * p_opcode->delivered / p_opcode->expected : 0.0,
+                p_opcode->delivered ? (double) p_opcode->hops / p_opcode->delivered : 0.0,
+                percentile_ms(p_opcode, 0.50), percentile_ms(p_opcode, 0.90), percentile_ms(p_opcode, 0.99),
+                percentile_ms(p_opcode, 1.0));
+        free(p_opcode->p_latency_us);
+    }
+}
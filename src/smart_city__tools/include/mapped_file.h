@@ -0,0 +1,25 @@
+#ifndef MAPPED_FILE_H__
+#define MAPPED_FILE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Arquivo de captura mapeado em memória, somente leitura, para as ferramentas de análise.
+ *  O kernel é avisado de que a leitura é sequencial, de modo que arquivos de vários GB são lidos numa única passada
+ *  sem cópia para buffers da aplicação */
+
+typedef struct
+{
+    const char * p_data;
+    size_t size;
+} mapped_file_t;
+
+/** Mapeia o arquivo. Arquivos vazios são aceitos (p_data == NULL, size == 0). Em caso de erro, imprime a causa em
+ *  stderr e retorna false */
+bool mapped_file_open(mapped_file_t * p_file, const char * p_path);
+void mapped_file_close(mapped_file_t * p_file);
+
+/** Primeira ocorrência de c em [p, p_end), ou p_end. Varre 16 bytes por vez onde houver SSE2 */
+const char * mapped_find(const char * p, const char * p_end, char c);
+
+#endif /* MAPPED_FILE_H__ */
@@ -0,0 +1,39 @@
+#ifndef MESH_CRYPTO_H__
+#define MESH_CRYPTO_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Funções criptográficas do Mesh Profile (seção 3.8) necessárias para ler capturas com as chaves conhecidas:
+ *  AES-128, AES-CMAC, as derivações k2 e k4 e a decifração AES-CCM com nonce de 13 bytes.
+ *  Implementação direta, sem tabelas dependentes da plataforma; não é protegida contra canais laterais e só deve ser
+ *  usada em ferramentas de análise */
+
+#define MESH_KEY_SIZE       (16)
+#define MESH_NONCE_SIZE     (13)
+
+/** Credenciais de rede derivadas da NetKey por k2 */
+typedef struct
+{
+    uint8_t nid;
+    uint8_t encryption_key[MESH_KEY_SIZE];
+    uint8_t privacy_key[MESH_KEY_SIZE];
+} mesh_net_keys_t;
+
+void mesh_aes128_encrypt(const uint8_t key[MESH_KEY_SIZE], const uint8_t in[16], uint8_t out[16]);
+void mesh_aes_cmac(const uint8_t key[MESH_KEY_SIZE], const uint8_t * p_message, uint32_t length, uint8_t mac[16]);
+
+void mesh_k2(const uint8_t net_key[MESH_KEY_SIZE], mesh_net_keys_t * p_keys);
+/** AID de 6 bits de uma AppKey */
+uint8_t mesh_k4(const uint8_t app_key[MESH_KEY_SIZE]);
+
+/** Decifra e autentica (CCM, sem dados associados). Retorna false se o MIC não conferir; p_out recebe o texto mesmo assim */
+bool mesh_ccm_decrypt(const uint8_t key[MESH_KEY_SIZE], const uint8_t nonce[MESH_NONCE_SIZE], const uint8_t * p_in,
+                      uint32_t length, const uint8_t * p_mic, uint8_t mic_size, uint8_t * p_out);
+
+/** Decifra só o trecho [offset, offset + length) da mensagem (modo CTR do CCM), sem autenticar: permite ler o início
+ *  de uma mensagem segmentada antes de ter todos os segmentos */
+void mesh_ccm_ctr(const uint8_t key[MESH_KEY_SIZE], const uint8_t nonce[MESH_NONCE_SIZE], uint32_t offset,
+                  const uint8_t * p_in, uint32_t length, uint8_t * p_out);
+
+#endif /* MESH_CRYPTO_H__ */
@@ -0,0 +1,48 @@
+#ifndef PCAPNG_H__
+#define PCAPNG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Leitura sequencial de capturas pcapng já mapeadas em memória (mapped_file.h): os pacotes apontam para o próprio
+ *  mapeamento, sem cópia. Suporta várias seções, as duas ordens de bytes e a resolução de tempo de cada interface
+ *  (if_tsresol); os pacotes vêm dos Enhanced Packet Blocks e dos Packet Blocks obsoletos */
+
+#define PCAPNG_INTERFACES_MAX   (16)
+
+#define PCAPNG_LINKTYPE_BLUETOOTH_LE_LL             (251)
+#define PCAPNG_LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR   (256)
+#define PCAPNG_LINKTYPE_NORDIC_BLE                  (272)
+
+typedef struct
+{
+    const uint8_t * p_data;
+    uint32_t length;            /**< Bytes capturados */
+    uint32_t original_length;
+    uint16_t link_type;
+    uint64_t timestamp_us;
+} pcapng_packet_t;
+
+typedef struct
+{
+    uint16_t link_type;
+    uint8_t tsresol;            /**< Opção if_tsresol: bit 7 indica base 2, os outros o expoente */
+} pcapng_interface_t;
+
+typedef struct
+{
+    const uint8_t * p;
+    const uint8_t * p_end;
+    bool swap;                  /**< Seção gravada na ordem de bytes oposta à little-endian */
+    uint32_t interface_count;
+    pcapng_interface_t interfaces[PCAPNG_INTERFACES_MAX];
+    const char * p_error;       /**< Causa do fim prematuro, NULL se o arquivo terminou normalmente */
+} pcapng_reader_t;
+
+void pcapng_reader_init(pcapng_reader_t * p_reader, const void * p_data, size_t size);
+
+/** Próximo pacote. Retorna false no fim do arquivo ou num bloco inválido (p_reader->p_error) */
+bool pcapng_next(pcapng_reader_t * p_reader, pcapng_packet_t * p_packet);
+
+#endif /* PCAPNG_H__ */
@@ -0,0 +1,703 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapped_file.h"
+
+/** Análise dos logs RTT dos dispositivos e do provisionador (Logs and captured data/Log_*.txt).
+ *  Cada linha tem o formato do __LOG: "<t: ticks>, arquivo.c, linha, mensagem". O arquivo é mapeado em memória e
+ *  percorrido uma única vez, sem cópias, com memória constante; a saída é uma linha JSON por arquivo com:
+ *    - o atraso entre receber (ou enviar) o SET de um semáforo e enviar / receber o SHARE com o mesmo estado;
+ *    - a proporção de SHAREs recebidos que já estavam armazenados ("Message not stored");
+ *    - a duração de cada etapa do provisionamento e da configuração, medida até a etapa seguinte;
+ *    - a taxa de mensagens de cada origem.
+ *  Um tick menor que o anterior indica que o dispositivo reiniciou: o tempo continua a partir do último tick, e as
+ *  medidas em curso são descartadas.
+ *  Uso: smart_city_log_analyzer [--hz N] Log_*.txt */
+
+#define LOG_TICKS_PER_S_DEFAULT (32768)     /**< RTC de 32768 Hz das marcas de tempo do __LOG */
+#define LOG_ADDRESSES           (0x10000)
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} delay_t;
+
+/** SET mais recente de um semáforo, à espera do SHARE correspondente */
+typedef struct
+{
+    bool seen;
+    bool pending_tx;
+    bool pending_rx;
+    uint8_t state;
+    uint32_t sets;
+    uint64_t set_ticks;
+    delay_t share_tx;
+    delay_t share_rx;
+} t_light_t;
+
+typedef enum
+{
+    PHASE_PROVISIONING,
+    PHASE_CONFIGURATION,
+    PHASE_COUNT
+} phase_t;
+
+typedef enum
+{
+    MILESTONE_START,
+    MILESTONE_STEP,
+    MILESTONE_END
+} milestone_kind_t;
+
+/** Linha do provisionador que marca o início de uma etapa; a etapa dura até a próxima marca da mesma fase */
+typedef struct
+{
+    const char * p_prefix;
+    const char * p_step;        /**< NULL na marca que encerra a fase */
+    phase_t phase;
+    milestone_kind_t kind;
+    bool success;               /**< A fase termina com sucesso se esta for a última etapa antes do fim */
+} milestone_t;
+
+static const milestone_t m_milestones[] =
+{
+    { "Scanning For Unprovisioned Devices",     "prov.scan",                PHASE_PROVISIONING,  MILESTONE_START },
+    { "UUID filter matched",                    "prov.link_open",           PHASE_PROVISIONING,  MILESTONE_STEP },
+    { "Provisioning link established",          "prov.capabilities_auth",   PHASE_PROVISIONING,  MILESTONE_STEP },
+    { "Static authentication data provided",    "prov.data",                PHASE_PROVISIONING,  MILESTONE_STEP },
+    { "Provisioning completed received",        "prov.link_close",          PHASE_PROVISIONING,  MILESTONE_STEP, true },
+    { "Local provisioning link closed",         NULL,                       PHASE_PROVISIONING,  MILESTONE_END },
+    { "Configuring Node:",                      "config.client_setup",      PHASE_CONFIGURATION, MILESTONE_START },
+    { "Getting composition data",               "config.composition_get",   PHASE_CONFIGURATION, MILESTONE_STEP },
+    { "Adding appkey",                          "config.appkey_add",        PHASE_CONFIGURATION, MILESTONE_STEP },
+    { "App key bind:",                          "config.app_bind",          PHASE_CONFIGURATION, MILESTONE_STEP },
+    { "Setting publication address",            "config.health_pub",       PHASE_CONFIGURATION, MILESTONE_STEP },
+    { "Set: smart city device",                 "config.model_set",         PHASE_CONFIGURATION, MILESTONE_STEP },
+    { "Adding subscription",                    "config.subscription_add",  PHASE_CONFIGURATION, MILESTONE_STEP },
+    { "Configuration of device",                NULL,                       PHASE_CONFIGURATION, MILESTONE_END },
+};
+
+#define MILESTONE_COUNT (sizeof(m_milestones) / sizeof(m_milestones[0]))
+
+static const char * const m_phase_names[PHASE_COUNT] = { "provisioning", "configuration" };
+
+typedef struct
+{
+    bool active;
+    int open_milestone;         /**< Etapa em curso, -1 se nenhuma */
+    uint64_t step_start;
+    uint64_t phase_start;
+    uint64_t started;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t abandoned;         /**< Reiniciada antes de terminar */
+    delay_t total;
+} phase_state_t;
+
+typedef struct
+{
+    uint64_t lines;
+    uint64_t unparsed;
+    uint64_t reboots;
+    uint64_t first_ticks;
+    uint64_t last_ticks;
+    uint64_t offset;            /**< Ticks acumulados antes do último reinício */
+    uint32_t previous_ticks;
+    bool has_ticks;
+
+    int32_t own_t_light;        /**< Últimos dois bytes do UUID do dispositivo, -1 se desconhecido */
+    t_light_t * p_t_lights;     /**< Indexado pelo endereço de 16 bits do semáforo */
+    uint16_t * p_seen;          /**< Semáforos com SET, para não varrer a tabela inteira a cada reinício */
+    uint32_t seen_count;
+
+    uint64_t share_rx;
+    uint64_t share_tx;
+    uint64_t set_rx;
+    uint64_t set_tx;
+    uint64_t get_rx;
+    uint64_t get_tx;
+    uint64_t get_reply;
+    uint64_t not_stored;
+    uint32_t * p_share_from;    /**< SHAREs recebidos por endereço de origem */
+    uint32_t * p_set_from;      /**< SETs recebidos por semáforo de origem */
+
+    phase_state_t phases[PHASE_COUNT];
+    delay_t steps[MILESTONE_COUNT];
+    uint64_t config_timeouts;
+    uint64_t config_retries;
+} analysis_t;
+
+static uint32_t m_ticks_per_s = LOG_TICKS_PER_S_DEFAULT;
+
+/*****************************************************************************
+ * Leitura das linhas
+ *****************************************************************************/
+
+static void delay_add(delay_t * p_delay, uint64_t ticks)
+{
+    if (p_delay->count == 0 || ticks < p_delay->min)
+    {
+        p_delay->min = ticks;
+    }
+    if (ticks > p_delay->max)
+    {
+        p_delay->max = ticks;
+    }
+    p_delay->count++;
+    p_delay->sum += ticks;
+}
+
+/* Consome o literal, se a mensagem começar por ele */
+static bool literal(const char ** pp, const char * p_end, const char * p_literal)
+{
+    size_t length = strlen(p_literal);
+    if ((size_t) (p_end - *pp) < length || memcmp(*pp, p_literal, length) != 0)
+    {
+        return false;
+    }
+    *pp += length;
+    return true;
+}
+
+static bool hex_digit(char c, uint32_t * p_value)
+{
+    if (c >= '0' && c <= '9')
+    {
+        *p_value = (uint32_t) (c - '0');
+    }
+    else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+    {
+        *p_value = (uint32_t) ((c | 0x20) - 'a' + 10);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/* Número hexadecimal com prefixo 0x opcional */
+static bool hex_parse(const char ** pp, const char * p_end, uint32_t * p_value)
+{
+    const char * p = *pp;
+    (void) literal(&p, p_end, "0x");
+    uint32_t value = 0;
+    uint32_t digit;
+    const char * p_start = p;
+    while (p < p_end && hex_digit(*p, &digit))
+    {
+        value = (value << 4) | digit;
+        p++;
+    }
+    if (p == p_start)
+    {
+        return false;
+    }
+    *pp = p;
+    *p_value = value;
+    return true;
+}
+
+/* "<t:    2687944>, main.c,   80, mensagem": separa o tick e a mensagem */
+static bool line_split(const char * p, const char * p_end, uint32_t * p_ticks, const char ** pp_message)
+{
+    if (!literal(&p, p_end, "<t:"))
+    {
+        return false;
+    }
+    while (p < p_end && *p == ' ')
+    {
+        p++;
+    }
+    uint32_t ticks = 0;
+    const char * p_digits = p;
+    while (p < p_end && *p >= '0' && *p <= '9')
+    {
+        ticks = ticks * 10 + (uint32_t) (*p - '0');
+        p++;
+    }
+    if (p == p_digits || !literal(&p, p_end, ">,"))
+    {
+        return false;
+    }
+    /* Arquivo e número da linha */
+    for (uint32_t field = 0; field < 2; field++)
+    {
+        p = mapped_find(p, p_end, ',');
+        if (p == p_end)
+        {
+            return false;
+        }
+        p++;
+    }
+    while (p < p_end && *p == ' ')
+    {
+        p++;
+    }
+    *p_ticks = ticks;
+    *pp_message = p;
+    return true;
+}
+
+/*****************************************************************************
+ * Métricas
+ *****************************************************************************/
+
+static void t_light_set(analysis_t * p_analysis, uint32_t t_light, uint32_t state, uint64_t now)
+{
+    t_light_t * p_t_light = &p_analysis->p_t_lights[t_light & 0xFFFF];
+    if (!p_t_light->seen)
+    {
+        p_analysis->p_seen[p_analysis->seen_count++] = (uint16_t) t_light;
+    }
+    p_t_light->seen = true;
+    p_t_light->sets++;
+    p_t_light->state = (uint8_t) state;
+    p_t_light->set_ticks = now;
+    p_t_light->pending_tx = true;
+    p_t_light->pending_rx = true;
+}
+
+static void t_light_share(analysis_t * p_analysis, uint32_t t_light, uint32_t state, uint64_t now, bool tx)
+{
+    t_light_t * p_t_light = &p_analysis->p_t_lights[t_light & 0xFFFF];
+    bool * p_pending = tx ? &p_t_light->pending_tx : &p_t_light->pending_rx;
+    if (*p_pending && p_t_light->state == (uint8_t) state)
+    {
+        delay_add(tx ? &p_t_light->share_tx : &p_t_light->share_rx, now - p_t_light->set_ticks);
+        *p_pending = false;
+    }
+}
+
+static bool text_contains(const char * p, const char * p_end, const char * p_text)
+{
+    for (; p < p_end; p++)
+    {
+        const char * p_match = p;
+        if (literal(&p_match, p_end, p_text))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void milestone_reached(analysis_t * p_analysis, uint32_t index, const char * p_message, const char * p_end,
+                              uint64_t now)
+{
+    const milestone_t * p_milestone = &m_milestones[index];
+    phase_state_t * p_phase = &p_analysis->phases[p_milestone->phase];
+    int previous = p_phase->open_milestone;
+
+    if (previous >= 0)
+    {
+        delay_add(&p_analysis->steps[previous], now - p_phase->step_start);
+    }
+    p_phase->open_milestone = p_milestone->p_step != NULL ? (int) index : -1;
+    p_phase->step_start = now;
+
+    switch (p_milestone->kind)
+    {
+        case MILESTONE_START:
+            p_phase->abandoned += p_phase->active;
+            p_phase->active = true;
+            p_phase->started++;
+            p_phase->phase_start = now;
+            break;
+
+        case MILESTONE_END:
+        {
+            if (!p_phase->active)
+            {
+                break;
+            }
+            /* O enlace fecha com sucesso depois de "Provisioning completed received"; a configuração informa o resultado */
+            bool success = (previous >= 0 && m_milestones[previous].success) || text_contains(p_message, p_end, "successful");
+            if (success)
+            {
+                p_phase->completed++;
+                delay_add(&p_phase->total, now - p_phase->phase_start);
+            }
+            else
+            {
+                p_phase->failed++;
+            }
+            p_phase->active = false;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void message_analyze(analysis_t * p_analysis, const char * p, const char * p_end, uint64_t now)
+{
+    uint32_t source;
+    uint32_t t_light;
+    uint32_t state;
+
+    if (literal(&p, p_end, "Got a SIMPLE_SMART_CITY_SHARE message from "))
+    {
+        p_analysis->share_rx++;
+        if (hex_parse(&p, p_end, &source) && literal(&p, p_end, " saying t_light ") && hex_parse(&p, p_end, &t_light) &&
+            literal(&p, p_end, " was state ") && hex_parse(&p, p_end, &state))
+        {
+            p_analysis->p_share_from[source & 0xFFFF]++;
+            t_light_share(p_analysis, t_light, state, now, false);
+        }
+    }
+    else if (literal(&p, p_end, "Message not stored"))
+    {
+        p_analysis->not_stored++;
+    }
+    else if (literal(&p, p_end, "Sending a SIMPLE_SMART_CITY_SHARE message with tlight "))
+    {
+        p_analysis->share_tx++;
+        if (hex_parse(&p, p_end, &t_light) && literal(&p, p_end, " state eguals to ") && hex_parse(&p, p_end, &state))
+        {
+            t_light_share(p_analysis, t_light, state, now, true);
+        }
+    }
+    else if (literal(&p, p_end, "Got a SIMPLE_SMART_CITY_SET message from t_light "))
+    {
+        p_analysis->set_rx++;
+        if (hex_parse(&p, p_end, &t_light) && literal(&p, p_end, " with state ") && hex_parse(&p, p_end, &state))
+        {
+            p_analysis->p_set_from[t_light & 0xFFFF]++;
+            t_light_set(p_analysis, t_light, state, now);
+        }
+    }
+    else if (literal(&p, p_end, "Sending a SIMPLE_SMART_CITY_SET message with state "))
+    {
+        p_analysis->set_tx++;
+        if (p_analysis->own_t_light >= 0 && hex_parse(&p, p_end, &state))
+        {
+            t_light_set(p_analysis, (uint32_t) p_analysis->own_t_light, state, now);
+        }
+    }
+    else if (literal(&p, p_end, "Got a SIMPLE_SMART_CITY_GET message"))
+    {
+        p_analysis->get_rx++;
+    }
+    else if (literal(&p, p_end, "Requesting a SIMPLE_SMART_CITY_GET message"))
+    {
+        p_analysis->get_tx++;
+    }
+    else if (literal(&p, p_end, "Replying a SIMPLE_SMART_CITY_GET message"))
+    {
+        p_analysis->get_reply++;
+    }
+    else if (literal(&p, p_end, "Device UUID : "))
+    {
+        /* O identificador do semáforo são os dois últimos bytes do UUID */
+        uint32_t digit;
+        uint32_t id = 0;
+        const char * p_uuid_end = p + 32;
+        if (p_uuid_end <= p_end && hex_digit(p_uuid_end[-4], &digit))
+        {
+            for (const char * p_digit = p_uuid_end - 4; p_digit < p_uuid_end && hex_digit(*p_digit, &digit); p_digit++)
+            {
+                id = (id << 4) | digit;
+            }
+            p_analysis->own_t_light = (int32_t) id;
+        }
+    }
+    else if (literal(&p, p_end, "Acknowledged message status not received"))
+    {
+        p_analysis->config_timeouts++;
+    }
+    else if (literal(&p, p_end, "Retry"))
+    {
+        p_analysis->config_retries++;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < MILESTONE_COUNT; i++)
+        {
+            const char * p_message = p;
+            if (literal(&p_message, p_end, m_milestones[i].p_prefix))
+            {
+                milestone_reached(p_analysis, i, p, p_end, now);
+                break;
+            }
+        }
+    }
+}
+
+static void reboot(analysis_t * p_analysis)
+{
+    p_analysis->reboots++;
+    p_analysis->offset += p_analysis->previous_ticks;
+    for (uint32_t i = 0; i < p_analysis->seen_count; i++)
+    {
+        p_analysis->p_t_lights[p_analysis->p_seen[i]].pending_tx = false;
+        p_analysis->p_t_lights[p_analysis->p_seen[i]].pending_rx = false;
+    }
+    for (uint32_t i = 0; i < PHASE_COUNT; i++)
+    {
+        p_analysis->phases[i].abandoned += p_analysis->phases[i].active;
+        p_analysis->phases[i].active = false;
+        p_analysis->phases[i].open_milestone = -1;
+    }
+}
+
+static void analysis_run(analysis_t * p_analysis, const char * p_data, size_t size)
+{
+    const char * p = p_data;
+    const char * p_end = p_data + size;
+    while (p < p_end)
+    {
+        const char * p_line_end = mapped_find(p, p_end, '\n');
+        const char * p_message_end = p_line_end;
+        if (p_message_end > p && p_message_end[-1] == '\r')
+        {
+            p_message_end--;
+        }
+
+        uint32_t ticks;
+        const char * p_message;
+        if (p_message_end > p)
+        {
+            p_analysis->lines++;
+            if (!line_split(p, p_message_end, &ticks, &p_message))
+            {
+                p_analysis->unparsed++;
+            }
+            else
+            {
+                if (p_analysis->has_ticks && ticks < p_analysis->previous_ticks)
+                {
+                    reboot(p_analysis);
+                }
+                uint64_t now = p_analysis->offset + ticks;
+                if (!p_analysis->has_ticks)
+                {
+                    p_analysis->first_ticks = now;
+                    p_analysis->has_ticks = true;
+                }
+                p_analysis->last_ticks = now;
+                p_analysis->previous_ticks = ticks;
+                message_analyze(p_analysis, p_message, p_message_end, now);
+            }
+        }
+        p = p_line_end + 1;
+    }
+}
+
+/*****************************************************************************
+ * Saída JSON
+ *****************************************************************************/
+
+static double ticks_ms(uint64_t ticks)
+{
+    return ticks * 1000.0 / m_ticks_per_s;
+}
+
+static void delay_print(FILE * p_out, const char * p_name, const delay_t * p_delay)
+{
+    fprintf(p_out, "\"%s\":{\"count\":%llu,\"mean_ms\":%.1f,\"min_ms\":%.1f,\"max_ms\":%.1f}", p_name,
+            (unsigned long long) p_delay->count, p_delay->count ? ticks_ms(p_delay->sum) / p_delay->count : 0.0,
+            ticks_ms(p_delay->min), ticks_ms(p_delay->max));
+}
+
+static void rates_print(FILE * p_out, const char * p_message, const uint32_t * p_counts, double minutes, bool * p_first)
+{
+    for (uint32_t i = 0; i < LOG_ADDRESSES; i++)
+    {
+        if (p_counts[i] > 0)
+        {
+            fprintf(p_out, "%s{\"message\":\"%s\",\"source\":\"0x%04X\",\"count\":%u,\"per_min\":%.2f}", *p_first ? "" : ",",
+                    p_message, i, p_counts[i], minutes > 0.0 ? p_counts[i] / minutes : 0.0);
+            *p_first = false;
+        }
+    }
+}
+
+static void rate_print(FILE * p_out, const char * p_message, uint64_t count, double minutes, bool * p_first)
+{
+    if (count > 0)
+    {
+        fprintf(p_out, "%s{\"message\":\"%s\",\"source\":\"self\",\"count\":%llu,\"per_min\":%.2f}", *p_first ? "" : ",",
+                p_message, (unsigned long long) count, minutes > 0.0 ? count / minutes : 0.0);
+        *p_first = false;
+    }
+}
+
+static void analysis_print(FILE * p_out, const char * p_path, const analysis_t * p_analysis)
+{
+    double duration_s = (p_analysis->last_ticks - p_analysis->first_ticks) / (double) m_ticks_per_s;
+    double minutes = duration_s / 60.0;
+
+    fputs("{\"file\":\"", p_out);
+    for (const char * p = p_path; *p != '\0'; p++)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            fputc('\\', p_out);
+        }
+        fputc(*p, p_out);
+    }
+    fprintf(p_out, "\",\"lines\":%llu,\"unparsed\":%llu,\"reboots\":%llu,\"duration_s\":%.1f",
+            (unsigned long long) p_analysis->lines, (unsigned long long) p_analysis->unparsed,
+            (unsigned long long) p_analysis->reboots, duration_s);
+    if (p_analysis->own_t_light >= 0)
+    {
+        fprintf(p_out, ",\"t_light\":\"0x%04X\"", (unsigned int) p_analysis->own_t_light);
+    }
+
+    fputs(",\"set_to_share\":[", p_out);
+    bool first = true;
+    for (uint32_t i = 0; i < LOG_ADDRESSES; i++)
+    {
+        const t_light_t * p_t_light = &p_analysis->p_t_lights[i];
+        if (!p_t_light->seen)
+        {
+            continue;
+        }
+        fprintf(p_out, "%s{\"t_light\":\"0x%04X\",\"sets\":%u,", first ? "" : ",", i, p_t_light->sets);
+        delay_print(p_out, "share_tx", &p_t_light->share_tx);
+        fputc(',', p_out);
+        delay_print(p_out, "share_rx", &p_t_light->share_rx);
+        fputc('}', p_out);
+        first = false;
+    }
+
+    fprintf(p_out, "],\"duplicates\":{\"share_rx\":%llu,\"not_stored\":%llu,\"ratio\":%.3f}",
+            (unsigned long long) p_analysis->share_rx, (unsigned long long) p_analysis->not_stored,
+            p_analysis->share_rx ? (double) p_analysis->not_stored / p_analysis->share_rx : 0.0);
+
+    fputs(",\"phases\":[", p_out);
+    first = true;
+    for (uint32_t i = 0; i < PHASE_COUNT; i++)
+    {
+        const phase_state_t * p_phase = &p_analysis->phases[i];
+        if (p_phase->started == 0)
+        {
+            continue;
+        }
+        fprintf(p_out, "%s{\"phase\":\"%s\",\"started\":%llu,\"completed\":%llu,\"failed\":%llu,\"abandoned\":%llu,",
+                first ? "" : ",", m_phase_names[i], (unsigned long long) p_phase->started,
+                (unsigned long long) p_phase->completed, (unsigned long long) p_phase->failed,
+                (unsigned long long) (p_phase->abandoned + p_phase->active));
+        delay_print(p_out, "duration", &p_phase->total);
+        fputc('}', p_out);
+        first = false;
+    }
+
+    fputs("],\"steps\":[", p_out);
+    first = true;
+    for (uint32_t i = 0; i < MILESTONE_COUNT; i++)
+    {
+        if (p_analysis->steps[i].count == 0)
+        {
+            continue;
+        }
+        fprintf(p_out, "%s{\"step\":\"%s\",", first ? "" : ",", m_milestones[i].p_step);
+        delay_print(p_out, "duration", &p_analysis->steps[i]);
+        fputc('}', p_out);
+        first = false;
+    }
+    fprintf(p_out, "],\"config_timeouts\":%llu,\"config_retries\":%llu",
+            (unsigned long long) p_analysis->config_timeouts, (unsigned long long) p_analysis->config_retries);
+
+    fputs(",\"rates\":[", p_out);
+    first = true;
+    rates_print(p_out, "SHARE", p_analysis->p_share_from, minutes, &first);
+    rates_print(p_out, "SET", p_analysis->p_set_from, minutes, &first);
+    rate_print(p_out, "SHARE_TX", p_analysis->share_tx, minutes, &first);
+    rate_print(p_out, "SET_TX", p_analysis->set_tx, minutes, &first);
+    rate_print(p_out, "GET_TX", p_analysis->get_tx, minutes, &first);
+    rate_print(p_out, "GET_RX", p_analysis->get_rx, minutes, &first);
+    rate_print(p_out, "GET_REPLY", p_analysis->get_reply, minutes, &first);
+    fputs("]}\n", p_out);
+}
+
+static void analysis_reset(analysis_t * p_analysis)
+{
+    t_light_t * p_t_lights = p_analysis->p_t_lights;
+    uint16_t * p_seen = p_analysis->p_seen;
+    uint32_t * p_share_from = p_analysis->p_share_from;
+    uint32_t * p_set_from = p_analysis->p_set_from;
+    memset(p_t_lights, 0, LOG_ADDRESSES * sizeof(t_light_t));
+    memset(p_share_from, 0, LOG_ADDRESSES * sizeof(uint32_t));
+    memset(p_set_from, 0, LOG_ADDRESSES * sizeof(uint32_t));
+    memset(p_analysis, 0, sizeof(analysis_t));
+    p_analysis->p_t_lights = p_t_lights;
+    p_analysis->p_seen = p_seen;
+    p_analysis->p_share_from = p_share_from;
+    p_analysis->p_set_from = p_set_from;
+    p_analysis->own_t_light = -1;
+    for (uint32_t i = 0; i < PHASE_COUNT; i++)
+    {
+        p_analysis->phases[i].open_milestone = -1;
+    }
+}
+
+static void usage(FILE * p_out)
+{
+    fprintf(p_out,
+            "uso: smart_city_log_analyzer [--hz N] ARQ...\n"
+            "  --hz N     frequência das marcas de tempo do log (padrão %u)\n"
+            "Imprime uma linha JSON com as métricas de cada arquivo de log RTT\n",
+            LOG_TICKS_PER_S_DEFAULT);
+}
+
+int main(int argc, char ** argv)
+{
+    static analysis_t analysis;
+    analysis.p_t_lights = malloc(LOG_ADDRESSES * sizeof(t_light_t));
+    analysis.p_seen = malloc(LOG_ADDRESSES * sizeof(uint16_t));
+    analysis.p_share_from = malloc(LOG_ADDRESSES * sizeof(uint32_t));
+    analysis.p_set_from = malloc(LOG_ADDRESSES * sizeof(uint32_t));
+    if (analysis.p_t_lights == NULL || analysis.p_seen == NULL || analysis.p_share_from == NULL || analysis.p_set_from == NULL)
+    {
+        fprintf(stderr, "sem memória\n");
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    uint32_t files = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        }
+        if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc)
+        {
+            m_ticks_per_s = (uint32_t) strtoul(argv[++i], NULL, 0);
+            if (m_ticks_per_s == 0)
+            {
+                usage(stderr);
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        mapped_file_t file;
+        files++;
+        if (!mapped_file_open(&file, argv[i]))
+        {
+            status = EXIT_FAILURE;
+            continue;
+        }
+        analysis_reset(&analysis);
+        analysis_run(&analysis, file.p_data, file.size);
+        mapped_file_close(&file);
+        analysis_print(stdout, argv[i], &analysis);
+    }
+    if (files == 0)
+    {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    return status;
+}
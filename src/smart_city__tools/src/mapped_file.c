@@ -0,0 +1,78 @@
+#include "mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+bool mapped_file_open(mapped_file_t * p_file, const char * p_path)
+{
+    p_file->p_data = NULL;
+    p_file->size = 0;
+
+    int fd = open(p_path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", p_path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", p_path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    if (st.st_size > 0)
+    {
+        void * p_data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p_data == MAP_FAILED)
+        {
+            fprintf(stderr, "%s: %s\n", p_path, strerror(errno));
+            close(fd);
+            return false;
+        }
+        (void) madvise(p_data, (size_t) st.st_size, MADV_SEQUENTIAL);
+        p_file->p_data = p_data;
+        p_file->size = (size_t) st.st_size;
+    }
+    /* O mapeamento continua válido depois de fechar o descritor */
+    close(fd);
+    return true;
+}
+
+void mapped_file_close(mapped_file_t * p_file)
+{
+    if (p_file->p_data != NULL)
+    {
+        (void) munmap((void *) p_file->p_data, p_file->size);
+    }
+    p_file->p_data = NULL;
+    p_file->size = 0;
+}
+
+const char * mapped_find(const char * p, const char * p_end, char c)
+{
+#if defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(c);
+    while (p_end - p >= 16)
+    {
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) p), needle));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    const char * p_found = memchr(p, c, (size_t) (p_end - p));
+    return p_found != NULL ? p_found : p_end;
+}
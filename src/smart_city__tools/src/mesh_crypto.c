@@ -0,0 +1,268 @@
+#include "mesh_crypto.h"
+
+#include <string.h>
+
+/*****************************************************************************
+ * AES-128 (FIPS-197), só cifração
+ *****************************************************************************/
+
+static uint8_t m_sbox[256];
+static bool m_sbox_ready;
+
+static uint8_t gf_mul2(uint8_t x)
+{
+    return (uint8_t) ((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+/* S-box gerada a partir da definição: inverso multiplicativo em GF(2^8) seguido da transformação afim */
+static void sbox_init(void)
+{
+    uint8_t p = 1;
+    uint8_t q = 1;
+    do
+    {
+        /* p percorre o grupo multiplicativo com gerador 3, e q o acompanha com o inverso */
+        p = (uint8_t) (p ^ gf_mul2(p));
+        q ^= (uint8_t) (q << 1);
+        q ^= (uint8_t) (q << 2);
+        q ^= (uint8_t) (q << 4);
+        if (q & 0x80)
+        {
+            q ^= 0x09;
+        }
+        uint8_t x = (uint8_t) (q ^ (uint8_t) ((q << 1) | (q >> 7)) ^ (uint8_t) ((q << 2) | (q >> 6)) ^
+                               (uint8_t) ((q << 3) | (q >> 5)) ^ (uint8_t) ((q << 4) | (q >> 4)));
+        m_sbox[p] = x ^ 0x63;
+    } while (p != 1);
+    m_sbox[0] = 0x63;
+    m_sbox_ready = true;
+}
+
+void mesh_aes128_encrypt(const uint8_t key[MESH_KEY_SIZE], const uint8_t in[16], uint8_t out[16])
+{
+    if (!m_sbox_ready)
+    {
+        sbox_init();
+    }
+
+    uint8_t round_key[16];
+    uint8_t state[16];
+    uint8_t rcon = 1;
+    memcpy(round_key, key, 16);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        state[i] = in[i] ^ round_key[i];
+    }
+
+    for (uint32_t round = 1; round <= 10; round++)
+    {
+        /* SubBytes e ShiftRows; o estado é armazenado por colunas */
+        uint8_t shifted[16];
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                shifted[4 * column + row] = m_sbox[state[4 * ((column + row) % 4) + row]];
+            }
+        }
+        /* MixColumns, exceto na última rodada */
+        if (round < 10)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                uint8_t * c = &shifted[4 * column];
+                uint8_t all = c[0] ^ c[1] ^ c[2] ^ c[3];
+                uint8_t first = c[0];
+                c[0] ^= all ^ gf_mul2(c[0] ^ c[1]);
+                c[1] ^= all ^ gf_mul2(c[1] ^ c[2]);
+                c[2] ^= all ^ gf_mul2(c[2] ^ c[3]);
+                c[3] ^= all ^ gf_mul2(c[3] ^ first);
+            }
+        }
+        /* Próxima chave de rodada */
+        round_key[0] ^= m_sbox[round_key[13]] ^ rcon;
+        round_key[1] ^= m_sbox[round_key[14]];
+        round_key[2] ^= m_sbox[round_key[15]];
+        round_key[3] ^= m_sbox[round_key[12]];
+        for (uint32_t i = 4; i < 16; i++)
+        {
+            round_key[i] ^= round_key[i - 4];
+        }
+        rcon = gf_mul2(rcon);
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            state[i] = shifted[i] ^ round_key[i];
+        }
+    }
+    memcpy(out, state, 16);
+}
+
+/*****************************************************************************
+ * AES-CMAC (RFC 4493)
+ *****************************************************************************/
+
+static void subkey_shift(const uint8_t in[16], uint8_t out[16])
+{
+    uint8_t carry = 0;
+    for (int i = 15; i >= 0; i--)
+    {
+        uint8_t next = in[i] >> 7;
+        out[i] = (uint8_t) ((in[i] << 1) | carry);
+        carry = next;
+    }
+    if (in[0] & 0x80)
+    {
+        out[15] ^= 0x87;
+    }
+}
+
+void mesh_aes_cmac(const uint8_t key[MESH_KEY_SIZE], const uint8_t * p_message, uint32_t length, uint8_t mac[16])
+{
+    uint8_t zero[16] = { 0 };
+    uint8_t k1[16];
+    uint8_t k2[16];
+    uint8_t l[16];
+    mesh_aes128_encrypt(key, zero, l);
+    subkey_shift(l, k1);
+    subkey_shift(k1, k2);
+
+    uint32_t blocks = length ? (length + 15) / 16 : 1;
+    bool complete = length > 0 && length % 16 == 0;
+    uint8_t x[16] = { 0 };
+    for (uint32_t block = 0; block + 1 < blocks; block++)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            x[i] ^= p_message[16 * block + i];
+        }
+        mesh_aes128_encrypt(key, x, x);
+    }
+
+    uint8_t last[16] = { 0 };
+    uint32_t rest = length - 16 * (blocks - 1);
+    memcpy(last, &p_message[16 * (blocks - 1)], rest);
+    if (!complete)
+    {
+        last[rest] = 0x80;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        x[i] ^= last[i] ^ (complete ? k1[i] : k2[i]);
+    }
+    mesh_aes128_encrypt(key, x, mac);
+}
+
+/*****************************************************************************
+ * Derivações do Mesh Profile (3.8.2)
+ *****************************************************************************/
+
+static void s1(const char * p_text, uint8_t salt[16])
+{
+    uint8_t zero[16] = { 0 };
+    mesh_aes_cmac(zero, (const uint8_t *) p_text, (uint32_t) strlen(p_text), salt);
+}
+
+void mesh_k2(const uint8_t net_key[MESH_KEY_SIZE], mesh_net_keys_t * p_keys)
+{
+    uint8_t salt[16];
+    uint8_t t[16];
+    uint8_t t1[16];
+    uint8_t t2[16];
+    uint8_t t3[16];
+    uint8_t input[16 + 2];
+    s1("smk2", salt);
+    mesh_aes_cmac(salt, net_key, MESH_KEY_SIZE, t);
+
+    /* P = 0x00: credenciais de inundação (managed flooding) */
+    input[0] = 0x00;
+    input[1] = 0x01;
+    mesh_aes_cmac(t, input, 2, t1);
+    memcpy(input, t1, 16);
+    input[16] = 0x00;
+    input[17] = 0x02;
+    mesh_aes_cmac(t, input, 18, t2);
+    memcpy(input, t2, 16);
+    input[17] = 0x03;
+    mesh_aes_cmac(t, input, 18, t3);
+
+    p_keys->nid = t1[15] & 0x7F;
+    memcpy(p_keys->encryption_key, t2, 16);
+    memcpy(p_keys->privacy_key, t3, 16);
+}
+
+uint8_t mesh_k4(const uint8_t app_key[MESH_KEY_SIZE])
+{
+    static const uint8_t id6[] = { 'i', 'd', '6', 0x01 };
+    uint8_t salt[16];
+    uint8_t t[16];
+    uint8_t result[16];
+    s1("smk4", salt);
+    mesh_aes_cmac(salt, app_key, MESH_KEY_SIZE, t);
+    mesh_aes_cmac(t, id6, sizeof(id6), result);
+    return result[15] & 0x3F;
+}
+
+/*****************************************************************************
+ * AES-CCM com nonce de 13 bytes (L = 2), sem dados associados
+ *****************************************************************************/
+
+static void ccm_counter_block(const uint8_t nonce[MESH_NONCE_SIZE], uint32_t counter, uint8_t block[16])
+{
+    block[0] = 0x01;
+    memcpy(&block[1], nonce, MESH_NONCE_SIZE);
+    block[14] = (uint8_t) (counter >> 8);
+    block[15] = (uint8_t) counter;
+}
+
+void mesh_ccm_ctr(const uint8_t key[MESH_KEY_SIZE], const uint8_t nonce[MESH_NONCE_SIZE], uint32_t offset,
+                  const uint8_t * p_in, uint32_t length, uint8_t * p_out)
+{
+    uint8_t block[16];
+    uint8_t stream[16];
+    uint32_t counter = 0;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        uint32_t position = offset + i;
+        if (i == 0 || position % 16 == 0)
+        {
+            counter = 1 + position / 16;
+            ccm_counter_block(nonce, counter, block);
+            mesh_aes128_encrypt(key, block, stream);
+        }
+        p_out[i] = p_in[i] ^ stream[position % 16];
+    }
+}
+
+bool mesh_ccm_decrypt(const uint8_t key[MESH_KEY_SIZE], const uint8_t nonce[MESH_NONCE_SIZE], const uint8_t * p_in,
+                      uint32_t length, const uint8_t * p_mic, uint8_t mic_size, uint8_t * p_out)
+{
+    mesh_ccm_ctr(key, nonce, 0, p_in, length, p_out);
+
+    /* CBC-MAC sobre B0 e o texto claro */
+    uint8_t x[16];
+    x[0] = (uint8_t) (((mic_size - 2) / 2) << 3 | 0x01);
+    memcpy(&x[1], nonce, MESH_NONCE_SIZE);
+    x[14] = (uint8_t) (length >> 8);
+    x[15] = (uint8_t) length;
+    mesh_aes128_encrypt(key, x, x);
+    for (uint32_t offset = 0; offset < length; offset += 16)
+    {
+        for (uint32_t i = 0; i < 16 && offset + i < length; i++)
+        {
+            x[i] ^= p_out[offset + i];
+        }
+        mesh_aes128_encrypt(key, x, x);
+    }
+
+    uint8_t block[16];
+    uint8_t s0[16];
+    ccm_counter_block(nonce, 0, block);
+    mesh_aes128_encrypt(key, block, s0);
+    uint8_t difference = 0;
+    for (uint32_t i = 0; i < mic_size; i++)
+    {
+        difference |= (uint8_t) ((x[i] ^ s0[i]) ^ p_mic[i]);
+    }
+    return difference == 0;
+}
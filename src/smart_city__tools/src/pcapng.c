@@ -0,0 +1,151 @@
+#include "pcapng.h"
+
+#define BLOCK_SECTION_HEADER        (0x0A0D0D0A)
+#define BLOCK_INTERFACE_DESCRIPTION (0x00000001)
+#define BLOCK_PACKET                (0x00000002)
+#define BLOCK_ENHANCED_PACKET       (0x00000006)
+#define BYTE_ORDER_MAGIC            (0x1A2B3C4D)
+#define OPTION_END                  (0)
+#define OPTION_IF_TSRESOL           (9)
+
+static uint16_t read16(const pcapng_reader_t * p_reader, const uint8_t * p)
+{
+    return p_reader->swap ? (uint16_t) (p[0] << 8 | p[1]) : (uint16_t) (p[1] << 8 | p[0]);
+}
+
+static uint32_t read32(const pcapng_reader_t * p_reader, const uint8_t * p)
+{
+    return p_reader->swap ? (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3] :
+                            (uint32_t) p[3] << 24 | (uint32_t) p[2] << 16 | (uint32_t) p[1] << 8 | p[0];
+}
+
+void pcapng_reader_init(pcapng_reader_t * p_reader, const void * p_data, size_t size)
+{
+    p_reader->p = p_data;
+    p_reader->p_end = p_reader->p + size;
+    p_reader->swap = false;
+    p_reader->interface_count = 0;
+    p_reader->p_error = NULL;
+}
+
+static void interface_add(pcapng_reader_t * p_reader, const uint8_t * p_body, uint32_t body_length)
+{
+    if (body_length < 8 || p_reader->interface_count == PCAPNG_INTERFACES_MAX)
+    {
+        p_reader->interface_count += p_reader->interface_count < PCAPNG_INTERFACES_MAX;
+        return;
+    }
+    pcapng_interface_t * p_interface = &p_reader->interfaces[p_reader->interface_count++];
+    p_interface->link_type = read16(p_reader, p_body);
+    p_interface->tsresol = 6;
+
+    const uint8_t * p = p_body + 8;
+    const uint8_t * p_end = p_body + body_length;
+    while (p + 4 <= p_end)
+    {
+        uint16_t code = read16(p_reader, p);
+        uint16_t length = read16(p_reader, p + 2);
+        if (code == OPTION_END || p + 4 + length > p_end)
+        {
+            break;
+        }
+        if (code == OPTION_IF_TSRESOL && length >= 1)
+        {
+            p_interface->tsresol = p[4];
+        }
+        p += 4 + ((length + 3u) & ~3u);
+    }
+}
+
+static uint64_t timestamp_us(const pcapng_interface_t * p_interface, uint64_t timestamp)
+{
+    uint8_t exponent = p_interface->tsresol & 0x7F;
+    if (p_interface->tsresol & 0x80)
+    {
+        if (exponent >= 64)
+        {
+            return 0;
+        }
+        uint64_t mask = (UINT64_C(1) << exponent) - 1;
+        return (timestamp >> exponent) * 1000000 + ((timestamp & mask) * 1000000 >> exponent);
+    }
+    for (; exponent > 6; exponent--)
+    {
+        timestamp /= 10;
+    }
+    for (; exponent < 6; exponent++)
+    {
+        timestamp *= 10;
+    }
+    return timestamp;
+}
+
+bool pcapng_next(pcapng_reader_t * p_reader, pcapng_packet_t * p_packet)
+{
+    while (p_reader->p_end - p_reader->p >= 12)
+    {
+        const uint8_t * p_block = p_reader->p;
+        if (read32(p_reader, p_block) == BLOCK_SECTION_HEADER)
+        {
+            /* A ordem de bytes da seção vale a partir do seu próprio cabeçalho */
+            uint32_t magic = (uint32_t) p_block[11] << 24 | (uint32_t) p_block[10] << 16 | (uint32_t) p_block[9] << 8 | p_block[8];
+            if (magic != BYTE_ORDER_MAGIC && magic != 0x4D3C2B1A)
+            {
+                p_reader->p_error = "seção com ordem de bytes inválida";
+                return false;
+            }
+            p_reader->swap = magic != BYTE_ORDER_MAGIC;
+            p_reader->interface_count = 0;
+        }
+
+        uint32_t type = read32(p_reader, p_block);
+        uint32_t length = read32(p_reader, p_block + 4);
+        if (length < 12 || length % 4 != 0 || length > (size_t) (p_reader->p_end - p_block))
+        {
+            p_reader->p_error = "bloco truncado ou com tamanho inválido";
+            return false;
+        }
+        p_reader->p += length;
+
+        const uint8_t * p_body = p_block + 8;
+        uint32_t body_length = length - 12;
+        switch (type)
+        {
+            case BLOCK_INTERFACE_DESCRIPTION:
+                interface_add(p_reader, p_body, body_length);
+                break;
+
+            case BLOCK_ENHANCED_PACKET:
+            case BLOCK_PACKET:
+            {
+                /* O Packet Block obsoleto tem a interface em 16 bits, seguida do contador de descartes */
+                uint32_t interface = type == BLOCK_PACKET ? read16(p_reader, p_body) : read32(p_reader, p_body);
+                if (body_length < 20 || interface >= p_reader->interface_count || interface >= PCAPNG_INTERFACES_MAX)
+                {
+                    break;
+                }
+                uint32_t captured = read32(p_reader, p_body + 12);
+                if (captured > body_length - 20)
+                {
+                    break;
+                }
+                const pcapng_interface_t * p_interface = &p_reader->interfaces[interface];
+                uint64_t timestamp = (uint64_t) read32(p_reader, p_body + 4) << 32 | read32(p_reader, p_body + 8);
+                p_packet->p_data = p_body + 20;
+                p_packet->length = captured;
+                p_packet->original_length = read32(p_reader, p_body + 16);
+                p_packet->link_type = p_interface->link_type;
+                p_packet->timestamp_us = timestamp_us(p_interface, timestamp);
+                return true;
+            }
+
+            default:
+                break;
+        }
+    }
+    if (p_reader->p != p_reader->p_end)
+    {
+        p_reader->p_error = "bytes após o último bloco";
+    }
+    return false;
+}
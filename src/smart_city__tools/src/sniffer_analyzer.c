@@ -0,0 +1,932 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapped_file.h"
+#include "mesh_crypto.h"
+#include "pcapng.h"
+
+/** Análise das capturas do nRF Sniffer (Logs and captured data/Sniffer*.pcapng): quanto do canal de anúncio cada
+ *  dispositivo ocupa, e com que tipo de tráfego. O arquivo é mapeado em memória e percorrido uma única vez.
+ *  Cada pacote de anúncio com CRC válido é atribuído a uma série (endereço de anúncio, origem mesh, tráfego):
+ *    - other_adv, pb_adv e beacon pelo tipo de AD;
+ *    - nas PDUs de rede mesh, sem a NetKey só se conhece o NID (mesh_nid_0xNN); com a NetKey (--netkey) a PDU é
+ *      desofuscada e autenticada, o que revela o endereço de origem, e as mensagens de controle e as cifradas com a
+ *      DevKey são separadas; com a AppKey (--appkey) a mensagem de acesso é decifrada e atribuída ao seu opcode
+ *      (SHARE, SET, GET, ... ou opcode_0xNNNNNN). Mensagens segmentadas são identificadas pelo segmento 0 e os demais
+ *      segmentos herdam o seu opcode.
+ *  A saída é um CSV com o total de cada série e, opcionalmente (--series), uma série temporal binária com os pacotes
+ *  e bytes de cada série por intervalo. Os bytes contados são os do pacote no ar, do access address ao CRC.
+ *  Uso: smart_city_sniffer_analyzer [opções] CAPTURA.pcapng */
+
+#define SNIFFER_INTERVAL_MS_DEFAULT (1000)
+#define SNIFFER_KEYS_MAX            (8)
+#define SNIFFER_SEGMENTS_MAX        (64)    /**< Mensagens segmentadas acompanhadas ao mesmo tempo */
+#define SNIFFER_SERIES_MAX          (0xFFFF)
+
+#define BLE_ADV_ACCESS_ADDRESS      (0x8E89BED6)
+#define BLE_ADDRESS_SIZE            (6)
+#define BLE_CRC_SIZE                (3)
+
+#define AD_TYPE_PB_ADV              (0x29)
+#define AD_TYPE_MESH_MESSAGE        (0x2A)
+#define AD_TYPE_MESH_BEACON         (0x2B)
+
+#define NORDIC_BLE_PAYLOAD_OFFSET   (7)
+#define NORDIC_BLE_EVENT_PACKET     (0x06)
+#define NORDIC_BLE_EVENT_PACKET_V3  (0x02)
+#define NORDIC_BLE_FLAG_CRC_OK      (0x01)
+
+#define PHDR_SIZE                   (10)
+#define PHDR_FLAG_CRC_CHECKED       (0x0400)
+#define PHDR_FLAG_CRC_VALID         (0x0800)
+
+#define SMART_CITY_COMPANY_ID       (0x0059)
+
+/** Formato da série temporal (little-endian): cabeçalho, registros e, no fim, a tabela de séries */
+#define SERIES_MAGIC                "SCTS"
+#define SERIES_VERSION              (1)
+#define SERIES_HEADER_SIZE          (32)
+#define SERIES_RECORD_SIZE          (12)    /**< u32 intervalo, u16 série, u16 pacotes, u32 bytes */
+#define SERIES_ENTRY_SIZE           (12)    /**< endereço[6], u16 origem mesh, u8 tráfego, u24 opcode ou NID */
+
+typedef enum
+{
+    TRAFFIC_OTHER_ADV,
+    TRAFFIC_PB_ADV,
+    TRAFFIC_BEACON,
+    TRAFFIC_MESH_NID,           /**< NID sem NetKey conhecida; o NID vai no lugar do opcode */
+    TRAFFIC_MESH_INVALID,       /**< NID conhecido, mas o NetMIC não confere */
+    TRAFFIC_MESH_CONTROL,
+    TRAFFIC_MESH_DEVKEY,
+    TRAFFIC_MESH_APPKEY,        /**< AID sem AppKey conhecida, ou TransMIC que não confere */
+    TRAFFIC_MESH_SEGMENT,       /**< Segmento de uma mensagem cujo segmento 0 não foi capturado */
+    TRAFFIC_MESH_OPCODE,
+} traffic_t;
+
+static const char * const m_traffic_names[] =
+{
+    "other_adv", "pb_adv", "beacon", "mesh_nid", "mesh_invalid", "mesh_control", "mesh_devkey", "mesh_appkey",
+    "mesh_segment", "opcode"
+};
+
+static const char * const m_smart_city_opcodes[] =
+{
+    "SHARE", "SET", "GET", "SHARE_COMPACT", "SET_COMPACT", "SHARE_BATCH"
+};
+
+/** A série é identificada por duas palavras, na ordem em que aparece no CSV:
+ *  endereço de anúncio << 16 | origem mesh, e tráfego << 24 | opcode */
+typedef struct
+{
+    uint64_t address_src;
+    uint64_t traffic_opcode;
+    uint64_t packets;
+    uint64_t bytes;
+    uint32_t bin_packets;
+    uint32_t bin_bytes;
+} series_t;
+
+typedef struct
+{
+    uint16_t src;
+    uint16_t seq_zero;
+    traffic_t traffic;
+    uint32_t opcode;
+} segmented_t;
+
+typedef struct
+{
+    bool crc_ok;
+    const uint8_t * p_data;     /**< Do access address ao CRC */
+    uint32_t length;
+} ble_packet_t;
+
+typedef struct
+{
+    series_t * p_series;
+    uint32_t series_count;
+    uint32_t * p_table;         /**< Índice + 1 de cada série, endereçamento aberto */
+    uint32_t table_size;
+    uint16_t * p_touched;       /**< Séries com pacotes no intervalo corrente */
+    uint32_t touched_count;
+
+    segmented_t segments[SNIFFER_SEGMENTS_MAX];
+    uint32_t segment_next;
+
+    FILE * p_series_file;
+    uint64_t interval_us;
+    uint64_t start_us;
+    uint64_t end_us;
+    uint32_t bin;
+    uint64_t records;
+
+    uint64_t packets;
+    uint64_t crc_errors;
+    uint64_t data_channel;
+    uint64_t unsupported;
+    uint64_t dropped;
+} analysis_t;
+
+static mesh_net_keys_t m_net_keys[SNIFFER_KEYS_MAX];
+static uint32_t m_net_key_count;
+static uint8_t m_app_keys[SNIFFER_KEYS_MAX][MESH_KEY_SIZE];
+static uint8_t m_app_aids[SNIFFER_KEYS_MAX];
+static uint32_t m_app_key_count;
+static uint32_t m_iv_index;
+
+static uint16_t be16(const uint8_t * p)
+{
+    return (uint16_t) (p[0] << 8 | p[1]);
+}
+
+static uint32_t le32(const uint8_t * p)
+{
+    return (uint32_t) p[3] << 24 | (uint32_t) p[2] << 16 | (uint32_t) p[1] << 8 | p[0];
+}
+
+static void put16(uint8_t * p, uint16_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+}
+
+static void put32(uint8_t * p, uint32_t value)
+{
+    put16(p, (uint16_t) value);
+    put16(p + 2, (uint16_t) (value >> 16));
+}
+
+static void put64(uint8_t * p, uint64_t value)
+{
+    put32(p, (uint32_t) value);
+    put32(p + 4, (uint32_t) (value >> 32));
+}
+
+/*****************************************************************************
+ * Séries
+ *****************************************************************************/
+
+static uint32_t series_hash(uint64_t address_src, uint64_t traffic_opcode)
+{
+    uint64_t hash = (address_src ^ (traffic_opcode * UINT64_C(0x9E3779B97F4A7C15))) * UINT64_C(0xFF51AFD7ED558CCD);
+    return (uint32_t) (hash >> 32);
+}
+
+static bool table_grow(analysis_t * p_analysis)
+{
+    uint32_t size = p_analysis->table_size ? 2 * p_analysis->table_size : 1024;
+    uint32_t * p_table = calloc(size, sizeof(uint32_t));
+    series_t * p_series = realloc(p_analysis->p_series, size / 2 * sizeof(series_t));
+    uint16_t * p_touched = realloc(p_analysis->p_touched, size / 2 * sizeof(uint16_t));
+    if (p_series != NULL)
+    {
+        p_analysis->p_series = p_series;
+    }
+    if (p_touched != NULL)
+    {
+        p_analysis->p_touched = p_touched;
+    }
+    if (p_table == NULL || p_series == NULL || p_touched == NULL)
+    {
+        free(p_table);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < p_analysis->series_count; i++)
+    {
+        const series_t * p_entry = &p_analysis->p_series[i];
+        uint32_t slot = series_hash(p_entry->address_src, p_entry->traffic_opcode) & (size - 1);
+        while (p_table[slot] != 0)
+        {
+            slot = (slot + 1) & (size - 1);
+        }
+        p_table[slot] = i + 1;
+    }
+    free(p_analysis->p_table);
+    p_analysis->p_table = p_table;
+    p_analysis->table_size = size;
+    return true;
+}
+
+/** Série da chave, criada se ainda não existir. Retorna NULL se o limite de séries foi atingido */
+static series_t * series_get(analysis_t * p_analysis, uint64_t address_src, uint64_t traffic_opcode)
+{
+    if (2 * (p_analysis->series_count + 1) > p_analysis->table_size && !table_grow(p_analysis))
+    {
+        return NULL;
+    }
+    uint32_t mask = p_analysis->table_size - 1;
+    uint32_t slot = series_hash(address_src, traffic_opcode) & mask;
+    while (p_analysis->p_table[slot] != 0)
+    {
+        series_t * p_entry = &p_analysis->p_series[p_analysis->p_table[slot] - 1];
+        if (p_entry->address_src == address_src && p_entry->traffic_opcode == traffic_opcode)
+        {
+            return p_entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (p_analysis->series_count == SNIFFER_SERIES_MAX)
+    {
+        return NULL;
+    }
+
+    series_t * p_entry = &p_analysis->p_series[p_analysis->series_count++];
+    memset(p_entry, 0, sizeof(series_t));
+    p_entry->address_src = address_src;
+    p_entry->traffic_opcode = traffic_opcode;
+    p_analysis->p_table[slot] = p_analysis->series_count;
+    return p_entry;
+}
+
+/** Grava os registros do intervalo corrente e zera os contadores das séries envolvidas */
+static void bin_flush(analysis_t * p_analysis)
+{
+    for (uint32_t i = 0; i < p_analysis->touched_count; i++)
+    {
+        uint16_t index = p_analysis->p_touched[i];
+        series_t * p_entry = &p_analysis->p_series[index];
+        if (p_analysis->p_series_file != NULL)
+        {
+            uint8_t record[SERIES_RECORD_SIZE];
+            put32(record, p_analysis->bin);
+            put16(record + 4, index);
+            put16(record + 6, (uint16_t) (p_entry->bin_packets > UINT16_MAX ? UINT16_MAX : p_entry->bin_packets));
+            put32(record + 8, p_entry->bin_bytes);
+            fwrite(record, sizeof(record), 1, p_analysis->p_series_file);
+            p_analysis->records++;
+        }
+        p_entry->bin_packets = 0;
+        p_entry->bin_bytes = 0;
+    }
+    p_analysis->touched_count = 0;
+}
+
+static void traffic_add(analysis_t * p_analysis, uint64_t timestamp_us, const uint8_t * p_address, uint16_t src,
+                        traffic_t traffic, uint32_t opcode, uint32_t bytes)
+{
+    if (p_analysis->packets == 0)
+    {
+        p_analysis->start_us = timestamp_us;
+    }
+    p_analysis->packets++;
+    if (timestamp_us > p_analysis->end_us)
+    {
+        p_analysis->end_us = timestamp_us;
+    }
+
+    /* Marcas de tempo fora de ordem ficam no intervalo corrente: a série temporal nunca volta */
+    uint64_t bin = timestamp_us > p_analysis->start_us ? (timestamp_us - p_analysis->start_us) / p_analysis->interval_us : 0;
+    if (bin > p_analysis->bin)
+    {
+        bin_flush(p_analysis);
+        p_analysis->bin = (uint32_t) bin;
+    }
+
+    uint64_t address = 0;
+    for (uint32_t i = 0; i < BLE_ADDRESS_SIZE; i++)
+    {
+        address = address << 8 | p_address[BLE_ADDRESS_SIZE - 1 - i];
+    }
+    series_t * p_entry = series_get(p_analysis, address << 16 | src, (uint64_t) traffic << 24 | opcode);
+    if (p_entry == NULL)
+    {
+        p_analysis->dropped++;
+        return;
+    }
+    if (p_entry->bin_packets == 0)
+    {
+        p_analysis->p_touched[p_analysis->touched_count++] = (uint16_t) (p_entry - p_analysis->p_series);
+    }
+    p_entry->packets++;
+    p_entry->bytes += bytes;
+    p_entry->bin_packets++;
+    p_entry->bin_bytes += bytes;
+}
+
+/*****************************************************************************
+ * Camadas mesh
+ *****************************************************************************/
+
+static uint32_t opcode_parse(const uint8_t * p_access, uint32_t length)
+{
+    if (length == 0 || p_access[0] == 0x7F)
+    {
+        return 0;
+    }
+    if ((p_access[0] & 0x80) == 0)
+    {
+        return p_access[0];
+    }
+    if ((p_access[0] & 0x40) == 0)
+    {
+        return length >= 2 ? (uint32_t) be16(p_access) : 0;
+    }
+    /* Opcode de fabricante: 0b11xxxxxx seguido do company ID em little-endian */
+    return length >= 3 ? (uint32_t) p_access[0] << 16 | (uint32_t) p_access[2] << 8 | p_access[1] : 0;
+}
+
+static const mesh_net_keys_t * net_keys_find(uint8_t nid, uint32_t * p_next)
+{
+    for (; *p_next < m_net_key_count; (*p_next)++)
+    {
+        if (m_net_keys[*p_next].nid == nid)
+        {
+            return &m_net_keys[(*p_next)++];
+        }
+    }
+    return NULL;
+}
+
+static void application_nonce(uint8_t nonce[MESH_NONCE_SIZE], bool aszmic, uint32_t seq, uint16_t src, uint16_t dst,
+                              uint32_t iv_index)
+{
+    nonce[0] = 0x01;
+    nonce[1] = aszmic ? 0x80 : 0x00;
+    nonce[2] = (uint8_t) (seq >> 16);
+    nonce[3] = (uint8_t) (seq >> 8);
+    nonce[4] = (uint8_t) seq;
+    nonce[5] = (uint8_t) (src >> 8);
+    nonce[6] = (uint8_t) src;
+    nonce[7] = (uint8_t) (dst >> 8);
+    nonce[8] = (uint8_t) dst;
+    nonce[9] = (uint8_t) (iv_index >> 24);
+    nonce[10] = (uint8_t) (iv_index >> 16);
+    nonce[11] = (uint8_t) (iv_index >> 8);
+    nonce[12] = (uint8_t) iv_index;
+}
+
+/** Decifra o início de uma PDU de acesso e devolve o opcode. Sem segmentação a mensagem é autenticada pelo TransMIC;
+ *  o segmento 0 de uma mensagem segmentada só é decifrado, pois o MIC está no último segmento */
+static bool access_opcode(uint8_t aid, bool segmented, bool szmic, uint32_t seq, uint16_t src, uint16_t dst,
+                          uint32_t iv_index, const uint8_t * p_upper, uint32_t length, uint32_t * p_opcode)
+{
+    uint8_t nonce[MESH_NONCE_SIZE];
+    uint8_t access[32];
+    application_nonce(nonce, szmic, seq, src, dst, iv_index);
+    for (uint32_t i = 0; i < m_app_key_count; i++)
+    {
+        if (m_app_aids[i] != aid)
+        {
+            continue;
+        }
+        if (segmented)
+        {
+            uint32_t prefix = length < 3 ? length : 3;
+            mesh_ccm_ctr(m_app_keys[i], nonce, 0, p_upper, prefix, access);
+            *p_opcode = opcode_parse(access, prefix);
+            return true;
+        }
+        if (length > 4 && length - 4 <= sizeof(access) &&
+            mesh_ccm_decrypt(m_app_keys[i], nonce, p_upper, length - 4, p_upper + length - 4, 4, access))
+        {
+            *p_opcode = opcode_parse(access, length - 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+static segmented_t * segmented_find(analysis_t * p_analysis, uint16_t src, uint16_t seq_zero)
+{
+    for (uint32_t i = 0; i < SNIFFER_SEGMENTS_MAX; i++)
+    {
+        segmented_t * p_segmented = &p_analysis->segments[i];
+        if (p_segmented->src == src && p_segmented->seq_zero == seq_zero)
+        {
+            return p_segmented;
+        }
+    }
+    return NULL;
+}
+
+/** Classifica a PDU de transporte já decifrada (DST seguido da PDU de transporte inferior) */
+static traffic_t transport_classify(analysis_t * p_analysis, bool ctl, uint32_t seq, uint16_t src, uint32_t iv_index,
+                                    const uint8_t * p_plain, uint32_t length, uint32_t * p_opcode)
+{
+    if (ctl)
+    {
+        return TRAFFIC_MESH_CONTROL;
+    }
+    uint16_t dst = be16(p_plain);
+    uint8_t header = p_plain[2];
+    bool segmented = header & 0x80;
+    bool akf = header & 0x40;
+    uint8_t aid = header & 0x3F;
+    if (!akf)
+    {
+        return TRAFFIC_MESH_DEVKEY;
+    }
+    if (!segmented)
+    {
+        return access_opcode(aid, false, false, seq, src, dst, iv_index, p_plain + 3, length - 3, p_opcode) ?
+               TRAFFIC_MESH_OPCODE : TRAFFIC_MESH_APPKEY;
+    }
+
+    if (length < 6 + 1)
+    {
+        return TRAFFIC_MESH_SEGMENT;
+    }
+    bool szmic = p_plain[3] & 0x80;
+    uint16_t seq_zero = (uint16_t) ((p_plain[3] & 0x7F) << 6 | p_plain[4] >> 2);
+    uint8_t seg_o = (uint8_t) ((p_plain[4] & 0x03) << 3 | p_plain[5] >> 5);
+    if (seg_o != 0)
+    {
+        segmented_t * p_segmented = segmented_find(p_analysis, src, seq_zero);
+        if (p_segmented == NULL)
+        {
+            return TRAFFIC_MESH_SEGMENT;
+        }
+        *p_opcode = p_segmented->opcode;
+        return p_segmented->traffic;
+    }
+
+    /* SeqAuth: os 24 bits baixos do SEQ do segmento 0 completados pelo SeqZero, no passado mais próximo */
+    uint32_t seq_auth = (seq & ~UINT32_C(0x1FFF)) | seq_zero;
+    if (seq_auth > seq)
+    {
+        seq_auth -= 0x2000;
+    }
+    traffic_t traffic = access_opcode(aid, true, szmic, seq_auth & 0xFFFFFF, src, dst, iv_index, p_plain + 6, length - 6,
+                                      p_opcode) ? TRAFFIC_MESH_OPCODE : TRAFFIC_MESH_APPKEY;
+    segmented_t * p_segmented = segmented_find(p_analysis, src, seq_zero);
+    if (p_segmented == NULL)
+    {
+        p_segmented = &p_analysis->segments[p_analysis->segment_next];
+        p_analysis->segment_next = (p_analysis->segment_next + 1) % SNIFFER_SEGMENTS_MAX;
+    }
+    p_segmented->src = src;
+    p_segmented->seq_zero = seq_zero;
+    p_segmented->traffic = traffic;
+    p_segmented->opcode = traffic == TRAFFIC_MESH_OPCODE ? *p_opcode : 0;
+    return traffic;
+}
+
+/** Desofusca e autentica uma PDU de rede com as NetKeys conhecidas (Mesh Profile 3.8.7) */
+static traffic_t network_classify(analysis_t * p_analysis, const uint8_t * p_pdu, uint32_t length, uint16_t * p_src,
+                                  uint32_t * p_opcode)
+{
+    uint8_t nid = p_pdu[0] & 0x7F;
+    if (length < 1 + 6 + 7 + 4)
+    {
+        return TRAFFIC_MESH_INVALID;
+    }
+    /* O IVI é o bit menos significativo do IV index usado pelo emissor */
+    uint32_t iv_index = m_iv_index;
+    if ((iv_index & 1) != (p_pdu[0] >> 7) && iv_index > 0)
+    {
+        iv_index--;
+    }
+
+    bool known = false;
+    uint32_t next = 0;
+    const mesh_net_keys_t * p_keys;
+    while ((p_keys = net_keys_find(nid, &next)) != NULL)
+    {
+        known = true;
+        uint8_t pecb[16] = { 0 };
+        pecb[5] = (uint8_t) (iv_index >> 24);
+        pecb[6] = (uint8_t) (iv_index >> 16);
+        pecb[7] = (uint8_t) (iv_index >> 8);
+        pecb[8] = (uint8_t) iv_index;
+        memcpy(&pecb[9], &p_pdu[7], 7);
+        mesh_aes128_encrypt(p_keys->privacy_key, pecb, pecb);
+
+        uint8_t header[6];
+        for (uint32_t i = 0; i < sizeof(header); i++)
+        {
+            header[i] = p_pdu[1 + i] ^ pecb[i];
+        }
+        bool ctl = header[0] & 0x80;
+        uint8_t mic_size = ctl ? 8 : 4;
+        if (length < 1 + 6 + 3 + mic_size)
+        {
+            continue;
+        }
+
+        uint8_t nonce[MESH_NONCE_SIZE] = { 0x00 };
+        memcpy(&nonce[1], header, sizeof(header));
+        nonce[9] = (uint8_t) (iv_index >> 24);
+        nonce[10] = (uint8_t) (iv_index >> 16);
+        nonce[11] = (uint8_t) (iv_index >> 8);
+        nonce[12] = (uint8_t) iv_index;
+        uint8_t plain[32];
+        uint32_t plain_length = length - 7 - mic_size;
+        if (plain_length > sizeof(plain) ||
+            !mesh_ccm_decrypt(p_keys->encryption_key, nonce, &p_pdu[7], plain_length, &p_pdu[7 + plain_length],
+                              mic_size, plain))
+        {
+            continue;
+        }
+
+        uint32_t seq = (uint32_t) header[1] << 16 | (uint32_t) header[2] << 8 | header[3];
+        *p_src = be16(&header[4]);
+        return transport_classify(p_analysis, ctl, seq, *p_src, iv_index, plain, plain_length, p_opcode);
+    }
+    if (known)
+    {
+        return TRAFFIC_MESH_INVALID;
+    }
+    *p_opcode = nid;
+    return TRAFFIC_MESH_NID;
+}
+
+/*****************************************************************************
+ * Camada de enlace
+ *****************************************************************************/
+
+/** Extrai o pacote BLE do formato de cada tipo de enlace suportado */
+static bool link_unwrap(const pcapng_packet_t * p_packet, ble_packet_t * p_ble)
+{
+    const uint8_t * p = p_packet->p_data;
+    uint32_t length = p_packet->length;
+    switch (p_packet->link_type)
+    {
+        case PCAPNG_LINKTYPE_NORDIC_BLE:
+        {
+            /* Placa, cabeçalho do protocolo do sniffer até o byte 6, e o cabeçalho do pacote com o seu tamanho em
+             * primeiro lugar: flags, canal, RSSI, contador de eventos e marca de tempo */
+            if (length < NORDIC_BLE_PAYLOAD_OFFSET + 2 ||
+                (p[6] != NORDIC_BLE_EVENT_PACKET && p[6] != NORDIC_BLE_EVENT_PACKET_V3))
+            {
+                return false;
+            }
+            uint32_t offset = NORDIC_BLE_PAYLOAD_OFFSET + p[NORDIC_BLE_PAYLOAD_OFFSET];
+            if (offset > length)
+            {
+                return false;
+            }
+            p_ble->crc_ok = p[NORDIC_BLE_PAYLOAD_OFFSET + 1] & NORDIC_BLE_FLAG_CRC_OK;
+            p_ble->p_data = p + offset;
+            p_ble->length = length - offset;
+            return true;
+        }
+
+        case PCAPNG_LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR:
+        {
+            if (length < PHDR_SIZE)
+            {
+                return false;
+            }
+            uint16_t flags = (uint16_t) (p[9] << 8 | p[8]);
+            p_ble->crc_ok = !(flags & PHDR_FLAG_CRC_CHECKED) || (flags & PHDR_FLAG_CRC_VALID);
+            p_ble->p_data = p + PHDR_SIZE;
+            p_ble->length = length - PHDR_SIZE;
+            return true;
+        }
+
+        case PCAPNG_LINKTYPE_BLUETOOTH_LE_LL:
+            p_ble->crc_ok = true;
+            p_ble->p_data = p;
+            p_ble->length = length;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static void packet_analyze(analysis_t * p_analysis, const pcapng_packet_t * p_packet)
+{
+    static const uint8_t no_address[BLE_ADDRESS_SIZE] = { 0 };
+    ble_packet_t ble;
+    if (!link_unwrap(p_packet, &ble) || ble.length < 6)
+    {
+        p_analysis->unsupported++;
+        return;
+    }
+    if (!ble.crc_ok)
+    {
+        p_analysis->crc_errors++;
+        return;
+    }
+    if (le32(ble.p_data) != BLE_ADV_ACCESS_ADDRESS)
+    {
+        p_analysis->data_channel++;
+        return;
+    }
+
+    uint8_t pdu_type = ble.p_data[4] & 0x0F;
+    uint8_t pdu_length = ble.p_data[5];
+    const uint8_t * p_payload = ble.p_data + 6;
+    if (6u + pdu_length > ble.length)
+    {
+        p_analysis->unsupported++;
+        return;
+    }
+    uint32_t bytes = 4 + 2 + pdu_length + BLE_CRC_SIZE;
+
+    /* Todos os tipos legados começam pelo endereço do emissor (AdvA, ScanA ou InitA); só os com dados AD seguem */
+    if (pdu_type > 6 || pdu_length < BLE_ADDRESS_SIZE)
+    {
+        traffic_add(p_analysis, p_packet->timestamp_us, no_address, 0, TRAFFIC_OTHER_ADV, 0, bytes);
+        return;
+    }
+    traffic_t traffic = TRAFFIC_OTHER_ADV;
+    uint16_t src = 0;
+    uint32_t opcode = 0;
+    bool has_ad = pdu_type == 0 || pdu_type == 2 || pdu_type == 4 || pdu_type == 6;
+    const uint8_t * p_ad = p_payload + BLE_ADDRESS_SIZE;
+    const uint8_t * p_ad_end = p_payload + pdu_length;
+    while (has_ad && p_ad + 2 <= p_ad_end && p_ad[0] != 0 && p_ad + 1 + p_ad[0] <= p_ad_end)
+    {
+        if (p_ad[1] == AD_TYPE_PB_ADV)
+        {
+            traffic = TRAFFIC_PB_ADV;
+            break;
+        }
+        if (p_ad[1] == AD_TYPE_MESH_BEACON)
+        {
+            traffic = TRAFFIC_BEACON;
+            break;
+        }
+        if (p_ad[1] == AD_TYPE_MESH_MESSAGE)
+        {
+            traffic = network_classify(p_analysis, p_ad + 2, p_ad[0] - 1u, &src, &opcode);
+            break;
+        }
+        p_ad += 1 + p_ad[0];
+    }
+    traffic_add(p_analysis, p_packet->timestamp_us, p_payload, src, traffic, opcode, bytes);
+}
+
+/*****************************************************************************
+ * Saída
+ *****************************************************************************/
+
+static void traffic_name(uint64_t traffic_opcode, char * p_name, size_t size)
+{
+    traffic_t traffic = (traffic_t) (traffic_opcode >> 24);
+    uint32_t opcode = traffic_opcode & 0xFFFFFF;
+    if (traffic == TRAFFIC_MESH_NID)
+    {
+        snprintf(p_name, size, "mesh_nid_0x%02X", (unsigned) opcode);
+    }
+    else if (traffic != TRAFFIC_MESH_OPCODE)
+    {
+        snprintf(p_name, size, "%s", m_traffic_names[traffic]);
+    }
+    else if ((opcode & 0xFFFF) == SMART_CITY_COMPANY_ID && opcode >> 16 >= 0xD1 && opcode >> 16 <= 0xD6)
+    {
+        snprintf(p_name, size, "%s", m_smart_city_opcodes[(opcode >> 16) - 0xD1]);
+    }
+    else
+    {
+        snprintf(p_name, size, opcode > 0xFFFF ? "opcode_0x%06X" : opcode > 0xFF ? "opcode_0x%04X" : "opcode_0x%02X",
+                 (unsigned) opcode);
+    }
+}
+
+static int series_compare(const void * p_a, const void * p_b)
+{
+    const series_t * p_series_a = p_a;
+    const series_t * p_series_b = p_b;
+    if (p_series_a->address_src != p_series_b->address_src)
+    {
+        return p_series_a->address_src < p_series_b->address_src ? -1 : 1;
+    }
+    if (p_series_a->traffic_opcode != p_series_b->traffic_opcode)
+    {
+        return p_series_a->traffic_opcode < p_series_b->traffic_opcode ? -1 : 1;
+    }
+    return 0;
+}
+
+static void csv_print(FILE * p_out, const analysis_t * p_analysis)
+{
+    double seconds = (double) (p_analysis->end_us - p_analysis->start_us) / 1e6;
+    series_t * p_sorted = malloc((p_analysis->series_count + 1) * sizeof(series_t));
+    if (p_sorted == NULL)
+    {
+        fprintf(stderr, "sem memória\n");
+        return;
+    }
+    memcpy(p_sorted, p_analysis->p_series, p_analysis->series_count * sizeof(series_t));
+    qsort(p_sorted, p_analysis->series_count, sizeof(series_t), series_compare);
+
+    fputs("adv_address,mesh_src,traffic,packets,bytes,packets_per_s,bytes_per_s\n", p_out);
+    for (uint32_t i = 0; i < p_analysis->series_count; i++)
+    {
+        const series_t * p_entry = &p_sorted[i];
+        uint64_t address = p_entry->address_src >> 16;
+        uint16_t src = (uint16_t) p_entry->address_src;
+        char name[32];
+        char src_text[8] = "";
+        traffic_name(p_entry->traffic_opcode, name, sizeof(name));
+        if (src != 0)
+        {
+            snprintf(src_text, sizeof(src_text), "0x%04X", src);
+        }
+        fprintf(p_out, "%02X:%02X:%02X:%02X:%02X:%02X,%s,%s,%llu,%llu,%.3f,%.1f\n",
+                (unsigned) (address >> 40) & 0xFF, (unsigned) (address >> 32) & 0xFF, (unsigned) (address >> 24) & 0xFF,
+                (unsigned) (address >> 16) & 0xFF, (unsigned) (address >> 8) & 0xFF, (unsigned) address & 0xFF,
+                src_text, name, (unsigned long long) p_entry->packets, (unsigned long long) p_entry->bytes,
+                seconds > 0 ? p_entry->packets / seconds : 0.0, seconds > 0 ? p_entry->bytes / seconds : 0.0);
+    }
+    free(p_sorted);
+}
+
+static void series_header_write(FILE * p_file, const analysis_t * p_analysis, uint64_t table_offset)
+{
+    uint8_t header[SERIES_HEADER_SIZE] = { 0 };
+    memcpy(header, SERIES_MAGIC, 4);
+    put16(header + 4, SERIES_VERSION);
+    put16(header + 6, SERIES_RECORD_SIZE);
+    put32(header + 8, (uint32_t) p_analysis->interval_us);
+    put32(header + 12, p_analysis->series_count);
+    put64(header + 16, p_analysis->start_us);
+    put64(header + 24, table_offset);
+    fwrite(header, sizeof(header), 1, p_file);
+}
+
+/** Tabela de séries no fim do arquivo, na ordem dos índices usados nos registros, e o cabeçalho definitivo */
+static bool series_finish(const analysis_t * p_analysis)
+{
+    FILE * p_file = p_analysis->p_series_file;
+    uint64_t table_offset = SERIES_HEADER_SIZE + p_analysis->records * SERIES_RECORD_SIZE;
+    for (uint32_t i = 0; i < p_analysis->series_count; i++)
+    {
+        const series_t * p_entry = &p_analysis->p_series[i];
+        uint64_t address = p_entry->address_src >> 16;
+        uint8_t entry[SERIES_ENTRY_SIZE];
+        for (uint32_t j = 0; j < BLE_ADDRESS_SIZE; j++)
+        {
+            entry[j] = (uint8_t) (address >> (8 * (BLE_ADDRESS_SIZE - 1 - j)));
+        }
+        put16(entry + 6, (uint16_t) p_entry->address_src);
+        entry[8] = (uint8_t) (p_entry->traffic_opcode >> 24);
+        entry[9] = (uint8_t) p_entry->traffic_opcode;
+        entry[10] = (uint8_t) (p_entry->traffic_opcode >> 8);
+        entry[11] = (uint8_t) (p_entry->traffic_opcode >> 16);
+        fwrite(entry, sizeof(entry), 1, p_file);
+    }
+    rewind(p_file);
+    series_header_write(p_file, p_analysis, table_offset);
+    return !ferror(p_file);
+}
+
+static bool key_parse(const char * p_text, uint8_t key[MESH_KEY_SIZE])
+{
+    if (strlen(p_text) != 2 * MESH_KEY_SIZE)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < MESH_KEY_SIZE; i++)
+    {
+        char byte[3] = { p_text[2 * i], p_text[2 * i + 1], '\0' };
+        char * p_end;
+        key[i] = (uint8_t) strtoul(byte, &p_end, 16);
+        if (*p_end != '\0')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(FILE * p_out)
+{
+    fprintf(p_out,
+            "uso: smart_city_sniffer_analyzer [opções] CAPTURA.pcapng\n"
+            "  --netkey HEX      NetKey da rede (repetível, até %u)\n"
+            "  --appkey HEX      AppKey da rede (repetível, até %u)\n"
+            "  --iv-index N      IV index da rede (padrão 0)\n"
+            "  --interval MS     intervalo da série temporal em ms (padrão %u)\n"
+            "  --csv ARQ         grava o CSV em ARQ em vez da saída padrão\n"
+            "  --series ARQ      grava a série temporal binária em ARQ\n"
+            "Imprime um CSV com pacotes e bytes por endereço de anúncio, origem mesh e tipo de tráfego.\n"
+            "As chaves aparecem nos logs do provisionador (\"Net key :\" e \"App key :\")\n",
+            SNIFFER_KEYS_MAX, SNIFFER_KEYS_MAX, SNIFFER_INTERVAL_MS_DEFAULT);
+}
+
+int main(int argc, char ** argv)
+{
+    static analysis_t analysis;
+    const char * p_capture = NULL;
+    const char * p_csv = NULL;
+    const char * p_series = NULL;
+    uint32_t interval_ms = SNIFFER_INTERVAL_MS_DEFAULT;
+    for (int i = 1; i < argc; i++)
+    {
+        uint8_t key[MESH_KEY_SIZE];
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        }
+        else if (strcmp(argv[i], "--netkey") == 0 && has_value && m_net_key_count < SNIFFER_KEYS_MAX &&
+                 key_parse(argv[i + 1], key))
+        {
+            mesh_k2(key, &m_net_keys[m_net_key_count++]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--appkey") == 0 && has_value && m_app_key_count < SNIFFER_KEYS_MAX &&
+                 key_parse(argv[i + 1], key))
+        {
+            memcpy(m_app_keys[m_app_key_count], key, MESH_KEY_SIZE);
+            m_app_aids[m_app_key_count++] = mesh_k4(key);
+            i++;
+        }
+        else if (strcmp(argv[i], "--iv-index") == 0 && has_value)
+        {
+            m_iv_index = (uint32_t) strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--interval") == 0 && has_value)
+        {
+            interval_ms = (uint32_t) strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && has_value)
+        {
+            p_csv = argv[++i];
+        }
+        else if (strcmp(argv[i], "--series") == 0 && has_value)
+        {
+            p_series = argv[++i];
+        }
+        else if (argv[i][0] != '-' && p_capture == NULL)
+        {
+            p_capture = argv[i];
+        }
+        else
+        {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+    if (p_capture == NULL || interval_ms == 0)
+    {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    mapped_file_t file;
+    if (!mapped_file_open(&file, p_capture))
+    {
+        return EXIT_FAILURE;
+    }
+    analysis.interval_us = (uint64_t) interval_ms * 1000;
+    if (p_series != NULL)
+    {
+        analysis.p_series_file = fopen(p_series, "wb");
+        if (analysis.p_series_file == NULL)
+        {
+            perror(p_series);
+            return EXIT_FAILURE;
+        }
+        /* Cabeçalho provisório; o definitivo é regravado no fim, com a posição da tabela de séries */
+        series_header_write(analysis.p_series_file, &analysis, 0);
+    }
+    if (!table_grow(&analysis))
+    {
+        fprintf(stderr, "sem memória\n");
+        return EXIT_FAILURE;
+    }
+
+    pcapng_reader_t reader;
+    pcapng_packet_t packet;
+    pcapng_reader_init(&reader, file.p_data, file.size);
+    while (pcapng_next(&reader, &packet))
+    {
+        packet_analyze(&analysis, &packet);
+    }
+    bin_flush(&analysis);
+    mapped_file_close(&file);
+
+    int status = EXIT_SUCCESS;
+    if (reader.p_error != NULL)
+    {
+        fprintf(stderr, "%s: %s\n", p_capture, reader.p_error);
+        status = EXIT_FAILURE;
+    }
+    if (analysis.p_series_file != NULL)
+    {
+        if (!series_finish(&analysis))
+        {
+            perror(p_series);
+            status = EXIT_FAILURE;
+        }
+        fclose(analysis.p_series_file);
+    }
+
+    FILE * p_out = stdout;
+    if (p_csv != NULL && (p_out = fopen(p_csv, "w")) == NULL)
+    {
+        perror(p_csv);
+        return EXIT_FAILURE;
+    }
+    csv_print(p_out, &analysis);
+    if (p_out != stdout)
+    {
+        fclose(p_out);
+    }
+    fprintf(stderr, "%s: %llu pacotes de anúncio em %.1f s, %llu com CRC inválido, %llu em canais de dados, "
+            "%llu não suportados, %llu fora do limite de séries\n",
+            p_capture, (unsigned long long) analysis.packets, (double) (analysis.end_us - analysis.start_us) / 1e6,
+            (unsigned long long) analysis.crc_errors, (unsigned long long) analysis.data_channel,
+            (unsigned long long) analysis.unsupported, (unsigned long long) analysis.dropped);
+    return status;
+}
@@ -0,0 +1,171 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapped_file.h"
+#include "smart_city_semaforo_trace_messages.h"
+
+/** Decodificador do trace binário dos dispositivos (smart_city_semaforo_trace.h), gravado do canal RTT 1 com
+ *  JLinkRTTLogger. Cada registro vira uma linha no formato do __LOG, "<t: ticks>, trace, ID, mensagem", com o texto
+ *  reconstruído a partir da mesma tabela de mensagens usada no firmware; a saída pode ser concatenada ao log de texto
+ *  do canal 0 e lida pelo smart_city_log_analyzer. O contador do RTC tem 24 bits: os ticks são estendidos para 32 bits
+ *  somando as diferenças entre registros consecutivos. Palavras que não começam um registro válido são puladas.
+ *  Uso: smart_city_trace_decoder TRACE.bin... */
+
+/* Os níveis só são usados pelo firmware; aqui bastam para expandir a tabela */
+#define LOG_LEVEL_ASSERT    (0)
+#define LOG_LEVEL_ERROR     (1)
+#define LOG_LEVEL_WARN      (2)
+#define LOG_LEVEL_REPORT    (3)
+#define LOG_LEVEL_INFO      (4)
+#define LOG_LEVEL_DBG1      (5)
+#define LOG_LEVEL_DBG2      (6)
+#define LOG_LEVEL_DBG3      (7)
+
+#define TRACE_RTC_MASK      (0xFFFFFF)
+#define TRACE_LINE_MAX      (512)
+
+typedef struct
+{
+    const char * p_format;
+    bool bytes;
+} message_t;
+
+#define MESSAGE_ENTRY(name, is_bytes)   { SMART_CITY_TRACE_##name##_FORMAT, (is_bytes) },
+
+static const message_t m_messages[SMART_CITY_TRACE_ID_COUNT] =
+{
+    SMART_CITY_TRACE_MESSAGES(MESSAGE_ENTRY)
+};
+
+typedef struct
+{
+    uint64_t records;
+    uint64_t skipped_words;
+    uint64_t dropped;
+} decoder_stats_t;
+
+static uint32_t le32(const uint8_t * p)
+{
+    return (uint32_t) p[3] << 24 | (uint32_t) p[2] << 16 | (uint32_t) p[1] << 8 | p[0];
+}
+
+static void record_print(FILE * p_out, uint32_t ticks, uint32_t id, const uint32_t * p_args, uint32_t count)
+{
+    char text[TRACE_LINE_MAX];
+    const message_t * p_message = &m_messages[id];
+    if (p_message->bytes)
+    {
+        uint32_t length = count > 0 ? p_args[0] : 0;
+        if (length > (count - 1) * sizeof(uint32_t))
+        {
+            length = (count - 1) * sizeof(uint32_t);
+        }
+        int used = snprintf(text, sizeof(text), "%s", p_message->p_format);
+        for (uint32_t i = 0; i < length && used + 3 < (int) sizeof(text); i++)
+        {
+            used += snprintf(&text[used], sizeof(text) - used, "%02x", (p_args[1 + i / 4] >> (8 * (i % 4))) & 0xFF);
+        }
+        snprintf(&text[used], sizeof(text) - used, "\n");
+    }
+    else
+    {
+        /* Os formatos da tabela só têm conversões inteiras; argumentos a mais são ignorados pelo printf */
+        uint32_t args[8] = { 0 };
+        memcpy(args, p_args, (count < 8 ? count : 8) * sizeof(uint32_t));
+        snprintf(text, sizeof(text), p_message->p_format,
+                 args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7]);
+    }
+    fprintf(p_out, "<t: %10u>, trace, %4u, %s", ticks, id, text);
+}
+
+static void decode(FILE * p_out, const uint8_t * p_data, size_t size, decoder_stats_t * p_stats)
+{
+    size_t words = size / sizeof(uint32_t);
+    uint32_t ticks = 0;
+    uint32_t rtc_previous = 0;
+    bool first = true;
+    uint32_t args[SMART_CITY_TRACE_ARGS_MAX];
+    size_t i = 0;
+    while (i + 2 <= words)
+    {
+        uint32_t header = le32(&p_data[4 * i]);
+        uint32_t count = SMART_CITY_TRACE_HEADER_ARGS(header);
+        uint32_t id = SMART_CITY_TRACE_HEADER_ID(header);
+        uint32_t rtc = le32(&p_data[4 * (i + 1)]);
+        if (SMART_CITY_TRACE_HEADER_MARK(header) != SMART_CITY_TRACE_MARK || count > SMART_CITY_TRACE_ARGS_MAX ||
+            id >= SMART_CITY_TRACE_ID_COUNT || rtc > TRACE_RTC_MASK || i + 2 + count > words)
+        {
+            p_stats->skipped_words++;
+            i++;
+            continue;
+        }
+
+        if (first)
+        {
+            ticks = rtc;
+            first = false;
+        }
+        else
+        {
+            ticks += (rtc - rtc_previous) & TRACE_RTC_MASK;
+        }
+        rtc_previous = rtc;
+
+        for (uint32_t j = 0; j < count; j++)
+        {
+            args[j] = le32(&p_data[4 * (i + 2 + j)]);
+        }
+        if (id == SMART_CITY_TRACE_ID_DROPPED && count > 0)
+        {
+            p_stats->dropped += args[0];
+        }
+        record_print(p_out, ticks, id, args, count);
+        p_stats->records++;
+        i += 2 + count;
+    }
+    p_stats->skipped_words += words - i;
+}
+
+static void usage(FILE * p_out)
+{
+    fprintf(p_out,
+            "uso: smart_city_trace_decoder ARQ...\n"
+            "Converte o trace binário do canal RTT 1 dos dispositivos em linhas no formato do __LOG\n");
+}
+
+int main(int argc, char ** argv)
+{
+    int status = EXIT_SUCCESS;
+    uint32_t files = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        }
+
+        mapped_file_t file;
+        files++;
+        if (!mapped_file_open(&file, argv[i]))
+        {
+            status = EXIT_FAILURE;
+            continue;
+        }
+        decoder_stats_t stats = { 0 };
+        decode(stdout, (const uint8_t *) file.p_data, file.size, &stats);
+        mapped_file_close(&file);
+        fprintf(stderr, "%s: %llu registros, %llu palavras puladas, %llu registros descartados no dispositivo\n",
+                argv[i], (unsigned long long) stats.records, (unsigned long long) stats.skipped_words,
+                (unsigned long long) stats.dropped);
+    }
+    if (files == 0)
+    {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    return status;
+}
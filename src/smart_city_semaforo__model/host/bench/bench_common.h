@@ -0,0 +1,49 @@
+#ifndef BENCH_COMMON_H__
+#define BENCH_COMMON_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "smart_city_semaforo_common.h"
+
+/** Funções auxiliares das medições do build nativo */
+
+#define BENCH_ITERATIONS_DEFAULT (5000000UL)
+#define BENCH_SRC_ADDRESS        (0x0100)
+
+/** Evita que o compilador elimine o trabalho medido */
+static volatile uint32_t bench_sink;
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static inline unsigned long bench_iterations(int argc, char ** argv)
+{
+    unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS_DEFAULT;
+    return iterations ? iterations : BENCH_ITERATIONS_DEFAULT;
+}
+
+static inline void bench_report(const char * p_name, unsigned long messages, uint64_t elapsed_ns)
+{
+    printf("%-28s %10lu msgs %10.2f ns/msg %8.2f Mmsg/s\n", p_name, messages,
+           (double) elapsed_ns / messages, messages * 1e3 / (double) elapsed_ns);
+}
+
+/** Registro de teste: semáforos espalhados em torno da origem, timestamps crescentes */
+static inline void bench_msg_fill(smart_city_semaforo_default_msg_t * p_msg, uint32_t i)
+{
+    p_msg->basic.timestamp64[0] = 0;
+    p_msg->basic.timestamp64[1] = 0x5B0EED02UL + i;
+    p_msg->basic.geolocalizador.latitude = -15.832167f + (float) (i % 32) * 1e-4f;
+    p_msg->basic.geolocalizador.longitude = -47.835299f + (float) (i % 17) * 1e-4f;
+    p_msg->sensor_ID = (sensor_ID_t) (0x0100 + (i % 64));
+    p_msg->data = semaforo_setData(i % 3, 5 + (i % 120));
+}
+
+#endif /* BENCH_COMMON_H__ */
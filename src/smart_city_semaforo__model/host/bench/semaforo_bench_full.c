@@ -0,0 +1,131 @@
+/** Medição dos handlers de opcode do modelo smart_city_semaforo_full no build nativo.
+ *  Cada mensagem passa pela mesma busca em m_opcode_handlers que a camada de acesso faz na recepção.
+ *  Uso: semaforo_bench_full [iterações] */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_common.h"
+#include "mock_access.h"
+#include "smart_city_semaforo_full.h"
+#include "smart_city_semaforo_common.h"
+#include "smart_city_semaforo_store.h"
+#include "smart_city_semaforo_dedup.h"
+
+#define BENCH_MSG_VARIANTS (256)
+
+static smart_city_semaforo_full_t m_semaforo_full;
+static smart_city_semaforo_default_msg_t m_estado_atual;
+
+SMART_CITY_SEMAFORO_STORE_DEF(m_data_store, 64);
+SMART_CITY_SEMAFORO_DEDUP_DEF(m_share_dedup, 128);
+
+static void set_cb(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
+{
+    bench_sink += msg->data;
+}
+
+static void share_cb(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
+{
+    bench_sink += msg->data;
+}
+
+static void share_batch_cb(const smart_city_semaforo_full_t * p_self, const smart_city_semaforo_default_msg_t * p_msgs, uint8_t count, uint16_t src)
+{
+    bench_sink += count;
+}
+
+static smart_city_semaforo_default_msg_t * get_cb(const smart_city_semaforo_full_t * p_self)
+{
+    return &m_estado_atual;
+}
+
+static uint64_t time_cb(const smart_city_semaforo_full_t * p_self)
+{
+    return semaforo_msg_timestamp_get(&m_estado_atual);
+}
+
+/** Entrega "iterations" mensagens do opcode, alternando entre "variants" conteúdos de "size" bytes */
+static void bench_opcode(const char * p_name, uint16_t opcode, const uint8_t * p_payloads, uint16_t size, uint32_t variants, unsigned long iterations)
+{
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        (void) mock_access_deliver(m_semaforo_full.model_handle, opcode, &p_payloads[(i % variants) * size], size, BENCH_SRC_ADDRESS);
+    }
+    bench_report(p_name, iterations, bench_now_ns() - start);
+}
+
+int main(int argc, char ** argv)
+{
+    static smart_city_semaforo_default_msg_t msgs[BENCH_MSG_VARIANTS];
+    static smart_city_semaforo_compact_msg_t compact[BENCH_MSG_VARIANTS];
+    static smart_city_semaforo_batch_msg_t batch;
+    unsigned long iterations = bench_iterations(argc, argv);
+
+    mock_access_reset();
+    m_semaforo_full.set_cb = set_cb;
+    m_semaforo_full.share_cb = share_cb;
+    m_semaforo_full.share_batch_cb = share_batch_cb;
+    m_semaforo_full.get_cb = get_cb;
+    m_semaforo_full.time_cb = time_cb;
+    m_semaforo_full.format = SMART_CITY_SEMAFORO_FORMAT_COMPACT;
+    m_semaforo_full.origin.latitude = -15.832167f;
+    m_semaforo_full.origin.longitude = -47.835299f;
+    if (smart_city_semaforo_full_init(&m_semaforo_full, 0) != NRF_SUCCESS)
+    {
+        fprintf(stderr, "smart_city_semaforo_full_init failed\n");
+        return 1;
+    }
+    mock_access_publish_address_set(m_semaforo_full.model_handle, 0);
+
+    bench_msg_fill(&m_estado_atual, 0);
+    uint64_t now = semaforo_msg_timestamp_get(&m_estado_atual);
+    smart_city_semaforo_batch_init(&batch);
+    for (uint32_t i = 0; i < BENCH_MSG_VARIANTS; i++)
+    {
+        bench_msg_fill(&msgs[i], i);
+        if (!smart_city_semaforo_compact_pack(&msgs[i], &m_semaforo_full.origin, now, &compact[i]))
+        {
+            fprintf(stderr, "record %u does not fit the compact format\n", i);
+            return 1;
+        }
+        (void) smart_city_semaforo_batch_add(&batch, &msgs[i]);
+    }
+
+    printf("smart_city_semaforo_full: %lu iterations per opcode\n", iterations);
+    bench_opcode("SET", SIMPLE_SMART_CITY_SET, (const uint8_t *) msgs, sizeof(msgs[0]), BENCH_MSG_VARIANTS, iterations);
+    bench_opcode("SHARE", SIMPLE_SMART_CITY_SHARE, (const uint8_t *) msgs, sizeof(msgs[0]), BENCH_MSG_VARIANTS, iterations);
+    bench_opcode("SET_COMPACT", SIMPLE_SMART_CITY_SET_COMPACT, (const uint8_t *) compact, sizeof(compact[0]), BENCH_MSG_VARIANTS, iterations);
+    bench_opcode("SHARE_COMPACT", SIMPLE_SMART_CITY_SHARE_COMPACT, (const uint8_t *) compact, sizeof(compact[0]), BENCH_MSG_VARIANTS, iterations);
+    bench_opcode("GET (reply published)", SIMPLE_SMART_CITY_GET, NULL, 0, 1, iterations);
+
+    unsigned long batches = iterations / batch.header.count + 1;
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < batches; i++)
+    {
+        (void) mock_access_deliver(m_semaforo_full.model_handle, SIMPLE_SMART_CITY_SHARE_BATCH, &batch,
+                                   semaforo_batch_length(batch.header.count), BENCH_SRC_ADDRESS);
+    }
+    bench_report("SHARE_BATCH (per record)", batches * batch.header.count, bench_now_ns() - start);
+
+    // Estruturas de recepção da aplicação (ver smart_city__example)
+    smart_city_semaforo_store_clear(&m_data_store);
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        (void) smart_city_semaforo_store_put(&m_data_store, &msgs[i % BENCH_MSG_VARIANTS]);
+    }
+    bench_report("store_put", iterations, bench_now_ns() - start);
+
+    smart_city_semaforo_dedup_clear(&m_share_dedup);
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        bench_sink += smart_city_semaforo_dedup_check(&m_share_dedup, &msgs[i % BENCH_MSG_VARIANTS]);
+    }
+    bench_report("dedup_check", iterations, bench_now_ns() - start);
+
+    printf("publications: %u\n", mock_access_publish_count());
+    return 0;
+}
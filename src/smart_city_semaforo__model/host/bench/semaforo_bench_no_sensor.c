@@ -0,0 +1,94 @@
+/** Medição dos handlers de opcode do modelo smart_city_semaforo_no_sensor no build nativo.
+ *  Uso: semaforo_bench_no_sensor [iterações] */
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bench_common.h"
+#include "mock_access.h"
+#include "smart_city_semaforo_no_sensor.h"
+#include "smart_city_semaforo_common.h"
+
+#define BENCH_MSG_VARIANTS (256)
+
+static smart_city_semaforo_no_sensor_t m_semaforo_no_sensor;
+
+static void set_cb(const smart_city_semaforo_no_sensor_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
+{
+    bench_sink += msg->data;
+}
+
+static void share_cb(const smart_city_semaforo_no_sensor_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
+{
+    bench_sink += msg->data;
+}
+
+static void share_batch_cb(const smart_city_semaforo_no_sensor_t * p_self, const smart_city_semaforo_default_msg_t * p_msgs, uint8_t count, uint16_t src)
+{
+    bench_sink += count;
+}
+
+static uint64_t time_cb(const smart_city_semaforo_no_sensor_t * p_self)
+{
+    return 0x5B0EED02UL + BENCH_MSG_VARIANTS;
+}
+
+/** Entrega "iterations" mensagens do opcode, alternando entre BENCH_MSG_VARIANTS conteúdos de "size" bytes */
+static void bench_opcode(const char * p_name, uint16_t opcode, const uint8_t * p_payloads, uint16_t size, unsigned long iterations)
+{
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        (void) mock_access_deliver(m_semaforo_no_sensor.model_handle, opcode, &p_payloads[(i % BENCH_MSG_VARIANTS) * size],
+                                   size, BENCH_SRC_ADDRESS);
+    }
+    bench_report(p_name, iterations, bench_now_ns() - start);
+}
+
+int main(int argc, char ** argv)
+{
+    static smart_city_semaforo_default_msg_t msgs[BENCH_MSG_VARIANTS];
+    static smart_city_semaforo_compact_msg_t compact[BENCH_MSG_VARIANTS];
+    static smart_city_semaforo_batch_msg_t batch;
+    unsigned long iterations = bench_iterations(argc, argv);
+
+    mock_access_reset();
+    m_semaforo_no_sensor.set_cb = set_cb;
+    m_semaforo_no_sensor.share_cb = share_cb;
+    m_semaforo_no_sensor.share_batch_cb = share_batch_cb;
+    m_semaforo_no_sensor.time_cb = time_cb;
+    m_semaforo_no_sensor.origin.latitude = -15.832167f;
+    m_semaforo_no_sensor.origin.longitude = -47.835299f;
+    if (smart_city_semaforo_no_sensor_init(&m_semaforo_no_sensor, 0) != NRF_SUCCESS)
+    {
+        fprintf(stderr, "smart_city_semaforo_no_sensor_init failed\n");
+        return 1;
+    }
+
+    smart_city_semaforo_batch_init(&batch);
+    for (uint32_t i = 0; i < BENCH_MSG_VARIANTS; i++)
+    {
+        bench_msg_fill(&msgs[i], i);
+        if (!smart_city_semaforo_compact_pack(&msgs[i], &m_semaforo_no_sensor.origin, time_cb(&m_semaforo_no_sensor), &compact[i]))
+        {
+            fprintf(stderr, "record %u does not fit the compact format\n", i);
+            return 1;
+        }
+        (void) smart_city_semaforo_batch_add(&batch, &msgs[i]);
+    }
+
+    printf("smart_city_semaforo_no_sensor: %lu iterations per opcode\n", iterations);
+    bench_opcode("SET", SIMPLE_SMART_CITY_SET, (const uint8_t *) msgs, sizeof(msgs[0]), iterations);
+    bench_opcode("SHARE", SIMPLE_SMART_CITY_SHARE, (const uint8_t *) msgs, sizeof(msgs[0]), iterations);
+    bench_opcode("SET_COMPACT", SIMPLE_SMART_CITY_SET_COMPACT, (const uint8_t *) compact, sizeof(compact[0]), iterations);
+    bench_opcode("SHARE_COMPACT", SIMPLE_SMART_CITY_SHARE_COMPACT, (const uint8_t *) compact, sizeof(compact[0]), iterations);
+
+    unsigned long batches = iterations / batch.header.count + 1;
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < batches; i++)
+    {
+        (void) mock_access_deliver(m_semaforo_no_sensor.model_handle, SIMPLE_SMART_CITY_SHARE_BATCH, &batch,
+                                   semaforo_batch_length(batch.header.count), BENCH_SRC_ADDRESS);
+    }
+    bench_report("SHARE_BATCH (per record)", batches * batch.header.count, bench_now_ns() - start);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef ACCESS_H__
+#define ACCESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_mesh.h"
+#include "device_state_manager.h"
+
+/** Subconjunto da API da camada de acesso usado pelos modelos (build nativo).
+ *  Os tipos seguem access.h do nRF5 SDK for Mesh; a implementação está em mock_access.c */
+
+#define ACCESS_COMPANY_ID_NONE      (0xFFFF)
+#define ACCESS_COMPANY_ID_NORDIC    (0x0059)
+
+typedef uint16_t access_model_handle_t;
+#define ACCESS_HANDLE_INVALID (0xFFFF)
+
+typedef struct
+{
+    uint16_t opcode;
+    uint16_t company_id;
+} access_opcode_t;
+
+typedef struct
+{
+    uint16_t company_id;
+    uint16_t model_id;
+} access_model_id_t;
+
+typedef struct
+{
+    nrf_mesh_address_t src;
+    nrf_mesh_address_t dst;
+    uint8_t ttl;
+    dsm_handle_t appkey_handle;
+    dsm_handle_t subnet_handle;
+} access_message_rx_meta_t;
+
+typedef struct
+{
+    access_opcode_t opcode;
+    const uint8_t * p_data;
+    uint16_t length;
+    access_message_rx_meta_t meta_data;
+} access_message_rx_t;
+
+typedef struct
+{
+    access_opcode_t opcode;
+    const uint8_t * p_buffer;
+    uint16_t length;
+    bool force_segmented;
+    nrf_mesh_transmic_size_t transmic_size;
+} access_message_tx_t;
+
+typedef void (*access_opcode_handler_cb_t)(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args);
+
+typedef struct
+{
+    access_opcode_t opcode;
+    access_opcode_handler_cb_t handler;
+} access_opcode_handler_t;
+
+typedef void (*access_publish_timeout_cb_t)(access_model_handle_t handle, void * p_args);
+
+typedef struct
+{
+    access_model_id_t model_id;
+    uint16_t element_index;
+    const access_opcode_handler_t * p_opcode_handlers;
+    uint32_t opcode_count;
+    void * p_args;
+    access_publish_timeout_cb_t publish_timeout_cb;
+} access_model_add_params_t;
+
+uint32_t access_model_add(const access_model_add_params_t * p_model_params, access_model_handle_t * p_model_handle);
+uint32_t access_model_publish(access_model_handle_t handle, const access_message_tx_t * p_message);
+uint32_t access_model_publish_address_get(access_model_handle_t handle, dsm_handle_t * p_address_handle);
+uint32_t access_model_subscription_list_alloc(access_model_handle_t handle);
+
+#endif /* ACCESS_H__ */
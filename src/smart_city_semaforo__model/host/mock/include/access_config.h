@@ -0,0 +1,9 @@
+#ifndef ACCESS_CONFIG_H__
+#define ACCESS_CONFIG_H__
+
+#include "access.h"
+
+/** Número de modelos aceitos pela camada de acesso simulada (build nativo) */
+#define ACCESS_MODEL_COUNT (8)
+
+#endif /* ACCESS_CONFIG_H__ */
@@ -0,0 +1,8 @@
+#ifndef ACCESS_RELIABLE_H__
+#define ACCESS_RELIABLE_H__
+
+#include "access.h"
+
+/** Os modelos Smart City não usam mensagens confirmadas. Cabeçalho vazio no build nativo */
+
+#endif /* ACCESS_RELIABLE_H__ */
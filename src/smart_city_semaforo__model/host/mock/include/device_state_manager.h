@@ -0,0 +1,19 @@
+#ifndef DEVICE_STATE_MANAGER_H__
+#define DEVICE_STATE_MANAGER_H__
+
+#include <stdint.h>
+
+/** Subconjunto de device_state_manager.h usado pelos modelos (build nativo) */
+typedef uint16_t dsm_handle_t;
+#define DSM_HANDLE_INVALID (0xFFFF)
+
+typedef struct
+{
+    uint16_t address_start;
+    uint16_t count;
+} dsm_local_unicast_address_t;
+
+/** Endereço do nó simulado: MOCK_LOCAL_ADDRESS (ver mock_access.h) */
+void dsm_local_unicast_addresses_get(dsm_local_unicast_address_t * p_address);
+
+#endif /* DEVICE_STATE_MANAGER_H__ */
@@ -0,0 +1,20 @@
+#ifndef LOG_H__
+#define LOG_H__
+
+/** Log da mesh (RTT). No build nativo as mensagens são descartadas, para não distorcer as medições */
+#define LOG_SRC_APP         (1 << 0)
+#define LOG_SRC_ACCESS      (1 << 1)
+
+#define LOG_LEVEL_ASSERT    (0)
+#define LOG_LEVEL_ERROR     (1)
+#define LOG_LEVEL_WARN      (2)
+#define LOG_LEVEL_REPORT    (3)
+#define LOG_LEVEL_INFO      (4)
+#define LOG_LEVEL_DBG1      (5)
+#define LOG_LEVEL_DBG2      (6)
+#define LOG_LEVEL_DBG3      (7)
+
+#define __LOG(source, level, ...)                       do { } while (0)
+#define __LOG_XB(source, level, msg, array, array_len)  do { (void) (array); (void) (array_len); } while (0)
+
+#endif /* LOG_H__ */
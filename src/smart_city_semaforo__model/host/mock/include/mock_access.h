@@ -0,0 +1,40 @@
+#ifndef MOCK_ACCESS_H__
+#define MOCK_ACCESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "access.h"
+#include "timer.h"
+
+/** Camada de acesso simulada para o build nativo dos modelos.
+ *  access_model_add() guarda a tabela de opcodes do modelo; mock_access_deliver() entrega uma mensagem
+ *  ao handler correspondente, como a camada de acesso faria ao receber a PDU. As publicações são contadas
+ *  e, opcionalmente, repassadas a um callback */
+
+/** Endereço unicast do nó simulado. As mensagens entregues com este "src" são do próprio nó */
+#define MOCK_LOCAL_ADDRESS (0x0001)
+
+/** callback chamado a cada access_model_publish() */
+typedef void (*mock_access_publish_cb_t)(access_model_handle_t handle, const access_message_tx_t * p_message);
+
+/** Esvazia a camada de acesso e o escalonador de timers */
+void mock_access_reset(void);
+
+/** Entrega a mensagem ao modelo. Retorna NRF_ERROR_NOT_FOUND se o modelo não tratar o opcode */
+uint32_t mock_access_deliver(access_model_handle_t handle, uint16_t opcode, const void * p_data, uint16_t length, uint16_t src);
+
+/** Endereço de publicação do modelo (DSM_HANDLE_INVALID: não configurado) */
+void mock_access_publish_address_set(access_model_handle_t handle, dsm_handle_t address_handle);
+
+void mock_access_publish_cb_set(mock_access_publish_cb_t publish_cb);
+
+/** Número de publicações desde o último mock_access_reset() */
+uint32_t mock_access_publish_count(void);
+
+/** Avança o relógio simulado, disparando os timers vencidos */
+void mock_timer_set_now(timestamp_t now);
+
+/** Zera o relógio simulado e descarta os timers armados. Chamado por mock_access_reset() */
+void mock_timer_reset(void);
+
+#endif /* MOCK_ACCESS_H__ */
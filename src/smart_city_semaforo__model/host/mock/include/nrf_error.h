@@ -0,0 +1,14 @@
+#ifndef NRF_ERROR_H__
+#define NRF_ERROR_H__
+
+/** Códigos de erro do SoftDevice usados pelos modelos (build nativo) */
+#define NRF_SUCCESS                 (0)
+#define NRF_ERROR_INTERNAL          (3)
+#define NRF_ERROR_NO_MEM            (4)
+#define NRF_ERROR_NOT_FOUND         (5)
+#define NRF_ERROR_INVALID_PARAM     (7)
+#define NRF_ERROR_INVALID_STATE     (8)
+#define NRF_ERROR_INVALID_LENGTH    (9)
+#define NRF_ERROR_NULL              (14)
+
+#endif /* NRF_ERROR_H__ */
@@ -0,0 +1,37 @@
+#ifndef NRF_MESH_H__
+#define NRF_MESH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_error.h"
+
+/** Subconjunto de nrf_mesh.h / nrf_mesh_defines.h usado pelos modelos (build nativo) */
+#define NRF_MESH_SEG_PAYLOAD_SIZE_MAX   (384)
+#define NRF_MESH_UUID_SIZE              (16)
+#define NRF_MESH_KEY_SIZE               (16)
+#define NRF_MESH_TTL_MAX                (0x7F)
+
+typedef enum
+{
+    NRF_MESH_TRANSMIC_SIZE_SMALL,
+    NRF_MESH_TRANSMIC_SIZE_LARGE,
+    NRF_MESH_TRANSMIC_SIZE_DEFAULT,
+    NRF_MESH_TRANSMIC_SIZE_INVALID
+} nrf_mesh_transmic_size_t;
+
+typedef enum
+{
+    NRF_MESH_ADDRESS_TYPE_INVALID,
+    NRF_MESH_ADDRESS_TYPE_UNICAST,
+    NRF_MESH_ADDRESS_TYPE_VIRTUAL,
+    NRF_MESH_ADDRESS_TYPE_GROUP
+} nrf_mesh_address_type_t;
+
+typedef struct
+{
+    nrf_mesh_address_type_t type;
+    uint16_t value;
+    const uint8_t * p_virtual_uuid;
+} nrf_mesh_address_t;
+
+#endif /* NRF_MESH_H__ */
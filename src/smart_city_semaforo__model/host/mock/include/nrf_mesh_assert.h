@@ -0,0 +1,9 @@
+#ifndef NRF_MESH_ASSERT_H__
+#define NRF_MESH_ASSERT_H__
+
+#include <assert.h>
+
+/** No build nativo as asserções da mesh viram assert() da biblioteca C */
+#define NRF_MESH_ASSERT(cond) assert(cond)
+
+#endif /* NRF_MESH_ASSERT_H__ */
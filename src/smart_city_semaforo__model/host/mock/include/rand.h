@@ -0,0 +1,9 @@
+#ifndef RAND_H__
+#define RAND_H__
+
+#include <stdint.h>
+
+/** Gerador de números aleatórios. No build nativo é um xorshift determinístico (ver mock_timer.c) */
+void rand_hw_rng_get(uint8_t * p_result, uint16_t bytes);
+
+#endif /* RAND_H__ */
@@ -0,0 +1,25 @@
+#ifndef TIMER_SCHEDULER_H__
+#define TIMER_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/** Subconjunto do escalonador de timers da mesh (build nativo) */
+typedef void (*timer_sch_callback_t)(timestamp_t timestamp, void * p_context);
+
+typedef struct timer_event
+{
+    volatile uint8_t state;
+    timestamp_t timestamp;
+    timer_sch_callback_t cb;
+    timestamp_t interval;
+    void * p_context;
+    struct timer_event * p_next;
+} timer_event_t;
+
+void timer_sch_schedule(timer_event_t * p_timer_evt);
+void timer_sch_abort(timer_event_t * p_timer_evt);
+void timer_sch_reschedule(timer_event_t * p_timer_evt, timestamp_t new_timestamp);
+
+#endif /* TIMER_SCHEDULER_H__ */
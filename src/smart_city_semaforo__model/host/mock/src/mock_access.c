@@ -0,0 +1,132 @@
+#include "mock_access.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "access_config.h"
+#include "nrf_error.h"
+
+typedef struct
+{
+    access_model_add_params_t params;
+    dsm_handle_t publish_address;
+} mock_model_t;
+
+static mock_model_t m_models[ACCESS_MODEL_COUNT];
+static uint16_t m_model_count;
+static uint32_t m_publish_count;
+static mock_access_publish_cb_t m_publish_cb;
+
+void mock_access_reset(void)
+{
+    memset(m_models, 0, sizeof(m_models));
+    m_model_count = 0;
+    m_publish_count = 0;
+    m_publish_cb = NULL;
+    mock_timer_reset();
+}
+
+uint32_t access_model_add(const access_model_add_params_t * p_model_params, access_model_handle_t * p_model_handle)
+{
+    if (p_model_params == NULL || p_model_handle == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (m_model_count >= ACCESS_MODEL_COUNT)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_models[m_model_count].params = *p_model_params;
+    m_models[m_model_count].publish_address = DSM_HANDLE_INVALID;
+    *p_model_handle = m_model_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_publish(access_model_handle_t handle, const access_message_tx_t * p_message)
+{
+    if (handle >= m_model_count)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_message == NULL || (p_message->length > 0 && p_message->p_buffer == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    m_publish_count++;
+    if (m_publish_cb != NULL)
+    {
+        m_publish_cb(handle, p_message);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_publish_address_get(access_model_handle_t handle, dsm_handle_t * p_address_handle)
+{
+    if (handle >= m_model_count)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_address_handle = m_models[handle].publish_address;
+    return NRF_SUCCESS;
+}
+
+uint32_t access_model_subscription_list_alloc(access_model_handle_t handle)
+{
+    return handle < m_model_count ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND;
+}
+
+/** Procura o opcode na tabela do modelo, como a camada de acesso faz na recepção */
+uint32_t mock_access_deliver(access_model_handle_t handle, uint16_t opcode, const void * p_data, uint16_t length, uint16_t src)
+{
+    if (handle >= m_model_count)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    const access_model_add_params_t * p_params = &m_models[handle].params;
+    for (uint32_t i = 0; i < p_params->opcode_count; i++)
+    {
+        const access_opcode_handler_t * p_handler = &p_params->p_opcode_handlers[i];
+        if (p_handler->opcode.opcode == opcode && p_handler->opcode.company_id == p_params->model_id.company_id)
+        {
+            access_message_rx_t message;
+            message.opcode = p_handler->opcode;
+            message.p_data = p_data;
+            message.length = length;
+            message.meta_data.src.type = NRF_MESH_ADDRESS_TYPE_UNICAST;
+            message.meta_data.src.value = src;
+            message.meta_data.src.p_virtual_uuid = NULL;
+            message.meta_data.dst = message.meta_data.src;
+            message.meta_data.ttl = NRF_MESH_TTL_MAX;
+            message.meta_data.appkey_handle = 0;
+            message.meta_data.subnet_handle = 0;
+            p_handler->handler(handle, &message, p_params->p_args);
+            return NRF_SUCCESS;
+        }
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
+
+void mock_access_publish_address_set(access_model_handle_t handle, dsm_handle_t address_handle)
+{
+    if (handle < m_model_count)
+    {
+        m_models[handle].publish_address = address_handle;
+    }
+}
+
+void mock_access_publish_cb_set(mock_access_publish_cb_t publish_cb)
+{
+    m_publish_cb = publish_cb;
+}
+
+void dsm_local_unicast_addresses_get(dsm_local_unicast_address_t * p_address)
+{
+    p_address->address_start = MOCK_LOCAL_ADDRESS;
+    p_address->count = 1;
+}
+
+uint32_t mock_access_publish_count(void)
+{
+    return m_publish_count;
+}
@@ -0,0 +1,94 @@
+#include "mock_access.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+
+/** Escalonador simulado: uma lista de timers armados, disparados por mock_timer_set_now() */
+#define MOCK_TIMER_STATE_IDLE       (0)
+#define MOCK_TIMER_STATE_QUEUED     (1)
+
+static timestamp_t m_now;
+static timer_event_t * mp_head;
+static uint32_t m_rand_state = 0x2545F491UL;
+
+void mock_timer_reset(void)
+{
+    m_now = 0;
+    mp_head = NULL;
+    m_rand_state = 0x2545F491UL;
+}
+
+timestamp_t timer_now(void)
+{
+    return m_now;
+}
+
+void timer_sch_abort(timer_event_t * p_timer_evt)
+{
+    for (timer_event_t ** pp = &mp_head; *pp != NULL; pp = &(*pp)->p_next)
+    {
+        if (*pp == p_timer_evt)
+        {
+            *pp = p_timer_evt->p_next;
+            break;
+        }
+    }
+    p_timer_evt->state = MOCK_TIMER_STATE_IDLE;
+}
+
+void timer_sch_schedule(timer_event_t * p_timer_evt)
+{
+    timer_sch_abort(p_timer_evt);
+    p_timer_evt->p_next = mp_head;
+    p_timer_evt->state = MOCK_TIMER_STATE_QUEUED;
+    mp_head = p_timer_evt;
+}
+
+void timer_sch_reschedule(timer_event_t * p_timer_evt, timestamp_t new_timestamp)
+{
+    p_timer_evt->timestamp = new_timestamp;
+    timer_sch_schedule(p_timer_evt);
+}
+
+/** Dispara, em ordem, os timers vencidos até "now". Timers periódicos são rearmados */
+void mock_timer_set_now(timestamp_t now)
+{
+    for (;;)
+    {
+        timer_event_t * p_next = NULL;
+        for (timer_event_t * p = mp_head; p != NULL; p = p->p_next)
+        {
+            if ((int32_t) (p->timestamp - now) <= 0 && (p_next == NULL || (int32_t) (p->timestamp - p_next->timestamp) < 0))
+            {
+                p_next = p;
+            }
+        }
+        if (p_next == NULL)
+        {
+            break;
+        }
+        timer_sch_abort(p_next);
+        m_now = p_next->timestamp;
+        if (p_next->interval > 0)
+        {
+            timer_sch_reschedule(p_next, p_next->timestamp + p_next->interval);
+        }
+        p_next->cb(m_now, p_next->p_context);
+    }
+    m_now = now;
+}
+
+void rand_hw_rng_get(uint8_t * p_result, uint16_t bytes)
+{
+    for (uint16_t i = 0; i < bytes; i++)
+    {
+        m_rand_state ^= m_rand_state << 13;
+        m_rand_state ^= m_rand_state >> 17;
+        m_rand_state ^= m_rand_state << 5;
+        p_result[i] = (uint8_t) m_rand_state;
+    }
+}
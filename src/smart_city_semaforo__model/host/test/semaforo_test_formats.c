@@ -0,0 +1,149 @@
+/** Testes dos formatos compacto e SHARE_BATCH (smart_city_semaforo_common.h) */
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "test_common.h"
+#include "smart_city_semaforo_common.h"
+
+#define TEST_NOW_SENDER    (0x5B0EED02ULL + 1000)
+#define TEST_NOW_RECEIVER  (0x5B0EED02ULL + 50)    /** Relógio de quem recebe, atrasado em relação ao de quem envia */
+
+static const geolocalizador_t m_origin = {.latitude = -15.832167f, .longitude = -47.835299f};
+
+static void msg_fill(smart_city_semaforo_default_msg_t * p_msg, uint64_t timestamp, int32_t latitude_steps, int32_t longitude_steps)
+{
+    semaforo_msg_timestamp_set(p_msg, timestamp);
+    p_msg->basic.geolocalizador.latitude = m_origin.latitude + latitude_steps * SEMAFORO_COMPACT_GEO_QUANTUM;
+    p_msg->basic.geolocalizador.longitude = m_origin.longitude + longitude_steps * SEMAFORO_COMPACT_GEO_QUANTUM;
+    p_msg->sensor_ID = 0x0123;
+    p_msg->data = semaforo_setData(SEMAFORO_ABERTO, 30);
+}
+
+static bool geo_close(float a, float b, float quantum)
+{
+    return fabsf(a - b) <= quantum / 2;
+}
+
+/** Ida e volta: a idade é preservada e o timestamp passa para o relógio de quem recebe */
+static void test_compact_round_trip(void)
+{
+    static const int32_t steps[][2] = {{0, 0}, {1, -1}, {511, -512}, {-512, 511}, {-300, 200}};
+    for (uint32_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        smart_city_semaforo_default_msg_t msg, unpacked;
+        smart_city_semaforo_compact_msg_t compact = {0};
+        msg_fill(&msg, TEST_NOW_SENDER - 7 * i, steps[i][0], steps[i][1]);
+        TEST_CHECK(smart_city_semaforo_compact_pack(&msg, &m_origin, TEST_NOW_SENDER, &compact));
+        smart_city_semaforo_compact_unpack(&compact, &m_origin, TEST_NOW_RECEIVER, &unpacked);
+        TEST_CHECK(semaforo_msg_timestamp_get(&unpacked) == TEST_NOW_RECEIVER - 7 * i);
+        TEST_CHECK(unpacked.sensor_ID == msg.sensor_ID);
+        TEST_CHECK(unpacked.data == msg.data);
+        TEST_CHECK(geo_close(unpacked.basic.geolocalizador.latitude, msg.basic.geolocalizador.latitude, SEMAFORO_COMPACT_GEO_QUANTUM));
+        TEST_CHECK(geo_close(unpacked.basic.geolocalizador.longitude, msg.basic.geolocalizador.longitude, SEMAFORO_COMPACT_GEO_QUANTUM));
+    }
+}
+
+/** Limites: idade de 12 bits e coordenadas de 10 bits em complemento de dois */
+static void test_compact_limits(void)
+{
+    smart_city_semaforo_default_msg_t msg, unpacked;
+    smart_city_semaforo_compact_msg_t compact = {0};
+
+    msg_fill(&msg, TEST_NOW_SENDER - SEMAFORO_COMPACT_MAX_AGE, 0, 0);
+    TEST_CHECK(smart_city_semaforo_compact_pack(&msg, &m_origin, TEST_NOW_SENDER, &compact));
+    smart_city_semaforo_compact_unpack(&compact, &m_origin, TEST_NOW_SENDER, &unpacked);
+    TEST_CHECK(semaforo_msg_timestamp_get(&unpacked) == TEST_NOW_SENDER - SEMAFORO_COMPACT_MAX_AGE);
+
+    msg_fill(&msg, TEST_NOW_SENDER - SEMAFORO_COMPACT_MAX_AGE - 1, 0, 0);
+    TEST_CHECK(!smart_city_semaforo_compact_pack(&msg, &m_origin, TEST_NOW_SENDER, &compact));
+
+    // Timestamp à frente do relógio: idade zero
+    msg_fill(&msg, TEST_NOW_SENDER + 5, 0, 0);
+    TEST_CHECK(smart_city_semaforo_compact_pack(&msg, &m_origin, TEST_NOW_SENDER, &compact));
+    smart_city_semaforo_compact_unpack(&compact, &m_origin, TEST_NOW_RECEIVER, &unpacked);
+    TEST_CHECK(semaforo_msg_timestamp_get(&unpacked) == TEST_NOW_RECEIVER);
+
+    msg_fill(&msg, TEST_NOW_SENDER, 512, 0);
+    TEST_CHECK(!smart_city_semaforo_compact_pack(&msg, &m_origin, TEST_NOW_SENDER, &compact));
+    msg_fill(&msg, TEST_NOW_SENDER, 0, -513);
+    TEST_CHECK(!smart_city_semaforo_compact_pack(&msg, &m_origin, TEST_NOW_SENDER, &compact));
+}
+
+/** Montagem, conversão para idade e reconstrução de um lote */
+static void test_batch_round_trip(void)
+{
+    static smart_city_semaforo_batch_msg_t batch;
+    smart_city_semaforo_default_msg_t msgs[3], record;
+    msg_fill(&msgs[0], TEST_NOW_SENDER - 10, 0, 0);
+    msg_fill(&msgs[1], TEST_NOW_SENDER - 40, 20, -20);
+    msg_fill(&msgs[2], TEST_NOW_SENDER - 2, -5, 3);
+    msgs[1].sensor_ID = 0x0200;
+    msgs[2].data = semaforo_setData(SEMAFORO_FECHADO, 12);
+
+    smart_city_semaforo_batch_init(&batch);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(smart_city_semaforo_batch_add(&batch, &msgs[i]));
+    }
+    TEST_CHECK(batch.header.count == 3);
+
+    smart_city_semaforo_batch_age_set(&batch, TEST_NOW_SENDER);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        smart_city_semaforo_batch_record_get(&batch, i, TEST_NOW_RECEIVER, &record);
+        TEST_CHECK(semaforo_msg_timestamp_get(&record) ==
+                   TEST_NOW_RECEIVER - (TEST_NOW_SENDER - semaforo_msg_timestamp_get(&msgs[i])));
+        TEST_CHECK(record.sensor_ID == msgs[i].sensor_ID);
+        TEST_CHECK(record.data == msgs[i].data);
+        TEST_CHECK(geo_close(record.basic.geolocalizador.latitude, msgs[i].basic.geolocalizador.latitude, SEMAFORO_BATCH_GEO_QUANTUM));
+        TEST_CHECK(geo_close(record.basic.geolocalizador.longitude, msgs[i].basic.geolocalizador.longitude, SEMAFORO_BATCH_GEO_QUANTUM));
+    }
+}
+
+/** O registro que não cabe no lote (cheio, ou longe demais da referência) é recusado sem alterar o lote */
+static void test_batch_limits(void)
+{
+    static smart_city_semaforo_batch_msg_t batch;
+    smart_city_semaforo_default_msg_t msg;
+    smart_city_semaforo_batch_init(&batch);
+    msg_fill(&msg, TEST_NOW_SENDER, 0, 0);
+    TEST_CHECK(smart_city_semaforo_batch_add(&batch, &msg));
+
+    msg_fill(&msg, TEST_NOW_SENDER + INT16_MAX + 1, 0, 0);
+    TEST_CHECK(!smart_city_semaforo_batch_add(&batch, &msg));
+    msg.basic.geolocalizador.latitude = m_origin.latitude + 0.4f;
+    semaforo_msg_timestamp_set(&msg, TEST_NOW_SENDER);
+    TEST_CHECK(!smart_city_semaforo_batch_add(&batch, &msg));
+    TEST_CHECK(batch.header.count == 1);
+
+    msg_fill(&msg, TEST_NOW_SENDER, 0, 0);
+    while (batch.header.count < SEMAFORO_BATCH_MAX_RECORDS)
+    {
+        TEST_CHECK(smart_city_semaforo_batch_add(&batch, &msg));
+    }
+    TEST_CHECK(!smart_city_semaforo_batch_add(&batch, &msg));
+    TEST_CHECK(semaforo_batch_length(batch.header.count) <= SEMAFORO_BATCH_PARAMS_SIZE_MAX);
+}
+
+/** O lote limitado a um número de segmentos cabe neles com o opcode (3) e a TransMIC (4), e um registro a mais não */
+static void test_batch_segments(void)
+{
+    for (uint32_t segments = 3; segments <= 32; segments++)
+    {
+        uint32_t count = SEMAFORO_BATCH_RECORDS_IN_SEGMENTS(segments);
+        TEST_CHECK(count >= 1);
+        TEST_CHECK(3 + semaforo_batch_length(count) + 4 <= segments * SEMAFORO_SEG_SIZE);
+        TEST_CHECK(3 + semaforo_batch_length(count + 1) + 4 > segments * SEMAFORO_SEG_SIZE);
+    }
+}
+
+int main(void)
+{
+    test_compact_round_trip();
+    test_compact_limits();
+    test_batch_round_trip();
+    test_batch_limits();
+    test_batch_segments();
+    return TEST_RESULT();
+}
@@ -0,0 +1,226 @@
+/** Testes da tabela de registros (smart_city_semaforo_store.h) e do conjunto de mensagens recentes (smart_city_semaforo_dedup.h).
+ *  A tabela só remove registros cheia, e logo em seguida ocupa o buraco; por isso a remoção com deslocamento é
+ *  testada diretamente, com o fonte da tabela incluído aqui */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "test_common.h"
+#include "smart_city_semaforo_store.h"
+#include "smart_city_semaforo_dedup.h"
+#include "../../src/smart_city_semaforo_store.c"
+
+#define TEST_STORE_SIZE (8)
+#define TEST_T0         (0x5B0EED02ULL)
+
+SMART_CITY_SEMAFORO_STORE_DEF(m_store, TEST_STORE_SIZE);
+SMART_CITY_SEMAFORO_DEDUP_DEF(m_dedup, SMART_CITY_SEMAFORO_DEDUP_WAYS);
+
+static smart_city_semaforo_default_msg_t msg_make(sensor_ID_t sensor_ID, uint64_t timestamp, uint8_t estado, uint16_t tempo)
+{
+    smart_city_semaforo_default_msg_t msg = {0};
+    semaforo_msg_timestamp_set(&msg, timestamp);
+    msg.sensor_ID = sensor_ID;
+    msg.data = semaforo_setData(estado, tempo);
+    return msg;
+}
+
+/** Ordem das informações de um mesmo semáforo */
+static void test_store_put(void)
+{
+    smart_city_semaforo_store_clear(&m_store);
+    smart_city_semaforo_default_msg_t msg = msg_make(1, TEST_T0 + 100, SEMAFORO_ABERTO, 30);
+    TEST_CHECK(smart_city_semaforo_store_put(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_INSERTED);
+
+    // Cópia da mesma informação, arredondada em outro caminho
+    msg = msg_make(1, TEST_T0 + 100 + SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S, SEMAFORO_ABERTO, 30);
+    TEST_CHECK(smart_city_semaforo_store_put(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_STALE);
+    msg = msg_make(1, TEST_T0 + 90, SEMAFORO_FECHADO, 30);
+    TEST_CHECK(smart_city_semaforo_store_put(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_STALE);
+    msg = msg_make(1, TEST_T0 + 130, SEMAFORO_ATENCAO, 5);
+    TEST_CHECK(smart_city_semaforo_store_put(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_UPDATED);
+    TEST_CHECK(smart_city_semaforo_store_get(&m_store, 1)->data == msg.data);
+
+    // O SET ouvido do semáforo é aceito mesmo com um timestamp anterior ao armazenado
+    msg = msg_make(1, TEST_T0 + 50, SEMAFORO_FECHADO, 40);
+    TEST_CHECK(smart_city_semaforo_store_set(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_UPDATED);
+    TEST_CHECK(semaforo_msg_timestamp_get(smart_city_semaforo_store_get(&m_store, 1)) == TEST_T0 + 50);
+    TEST_CHECK(smart_city_semaforo_store_count(&m_store) == 1);
+}
+
+/** Procura "count" semáforos com a posição inicial "home", a partir de "sensor_ID" */
+static sensor_ID_t colliding_find(uint16_t home, sensor_ID_t sensor_ID, sensor_ID_t * p_ids, uint8_t count)
+{
+    for (uint8_t n = 0; n < count; sensor_ID++)
+    {
+        if (store_home(&m_store, sensor_ID) == home)
+        {
+            p_ids[n++] = sensor_ID;
+        }
+    }
+    return sensor_ID;
+}
+
+/** Nenhuma entrada válida pode ter um buraco entre a sua posição inicial e a posição que ocupa */
+static bool store_chains_valid(void)
+{
+    const uint16_t mask = m_store.capacity - 1;
+    for (uint16_t i = 0; i < m_store.capacity; i++)
+    {
+        if (!m_store.p_entries[i].valid)
+        {
+            continue;
+        }
+        for (uint16_t j = store_home(&m_store, m_store.p_entries[i].msg.sensor_ID); j != i; j = (j + 1) & mask)
+        {
+            if (!m_store.p_entries[j].valid)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** Cadeia de quatro semáforos com a mesma posição inicial e um quinto que começa no meio dela. Cada um é removido
+ *  por vez, em todas as posições da tabela (inclusive as cadeias que dão a volta no fim do vetor) */
+static void test_store_backward_shift(void)
+{
+    sensor_ID_t ids[5];
+    for (uint16_t home = 0; home < TEST_STORE_SIZE; home++)
+    {
+        for (uint8_t removido = 0; removido < 5; removido++)
+        {
+            smart_city_semaforo_store_clear(&m_store);
+            sensor_ID_t proximo = colliding_find(home, 1, ids, 4);
+            (void) colliding_find((home + 1) & (TEST_STORE_SIZE - 1), proximo, &ids[4], 1);
+            for (uint8_t i = 0; i < 5; i++)
+            {
+                smart_city_semaforo_default_msg_t msg = msg_make(ids[i], TEST_T0 + i, SEMAFORO_ABERTO, 10);
+                TEST_CHECK(smart_city_semaforo_store_put(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_INSERTED);
+            }
+
+            bool found;
+            uint16_t i = store_find(&m_store, ids[removido], &found);
+            TEST_CHECK(found);
+            store_remove(&m_store, i);
+            TEST_CHECK(smart_city_semaforo_store_count(&m_store) == 4);
+            TEST_CHECK(store_chains_valid());
+            for (uint8_t k = 0; k < 5; k++)
+            {
+                TEST_CHECK((smart_city_semaforo_store_get(&m_store, ids[k]) != NULL) == (k != removido));
+            }
+        }
+    }
+}
+
+/** Com a tabela cheia cada semáforo novo substitui o mais antigo. A remoção desloca as entradas seguintes da
+ *  sequência de sondagem, e todos os registros que ficam devem continuar acessíveis */
+static void test_store_replace_oldest(void)
+{
+    const uint16_t total = 200;
+    smart_city_semaforo_store_clear(&m_store);
+    for (uint16_t i = 0; i < total; i++)
+    {
+        smart_city_semaforo_default_msg_t msg = msg_make(0x0100 + i * 7, TEST_T0 + i, SEMAFORO_ABERTO, 10);
+        smart_city_semaforo_store_result_t result = smart_city_semaforo_store_put(&m_store, &msg);
+        TEST_CHECK(result == (i < TEST_STORE_SIZE ? SMART_CITY_SEMAFORO_STORE_INSERTED : SMART_CITY_SEMAFORO_STORE_REPLACED));
+        TEST_CHECK(smart_city_semaforo_store_count(&m_store) == (i < TEST_STORE_SIZE ? i + 1 : TEST_STORE_SIZE));
+        for (uint16_t j = 0; j <= i; j++)
+        {
+            bool presente = (smart_city_semaforo_store_get(&m_store, 0x0100 + j * 7) != NULL);
+            TEST_CHECK(presente == (i - j < TEST_STORE_SIZE));
+        }
+    }
+
+    uint16_t cursor = SMART_CITY_SEMAFORO_STORE_ITERATOR_START;
+    uint16_t percorridos = 0;
+    while (smart_city_semaforo_store_next(&m_store, &cursor) != NULL)
+    {
+        percorridos++;
+    }
+    TEST_CHECK(percorridos == TEST_STORE_SIZE);
+
+    // Informação de outro dispositivo mais antiga que toda a tabela cheia não entra; o SET ouvido do semáforo entra
+    smart_city_semaforo_default_msg_t msg = msg_make(0x7000, TEST_T0, SEMAFORO_ABERTO, 10);
+    TEST_CHECK(smart_city_semaforo_store_put(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_STALE);
+    TEST_CHECK(smart_city_semaforo_store_set(&m_store, &msg) == SMART_CITY_SEMAFORO_STORE_REPLACED);
+    TEST_CHECK(smart_city_semaforo_store_get(&m_store, 0x7000) != NULL);
+    TEST_CHECK(smart_city_semaforo_store_count(&m_store) == TEST_STORE_SIZE);
+}
+
+static void test_store_stale_count(void)
+{
+    smart_city_semaforo_store_clear(&m_store);
+    smart_city_semaforo_default_msg_t msg = msg_make(1, TEST_T0, SEMAFORO_ABERTO, 30);
+    (void) smart_city_semaforo_store_put(&m_store, &msg);
+    msg = msg_make(2, TEST_T0 + 20, SEMAFORO_ABERTO, 30);
+    (void) smart_city_semaforo_store_put(&m_store, &msg);
+    TEST_CHECK(smart_city_semaforo_store_stale_count(&m_store, TEST_T0 + 35, 5) == 0);
+    TEST_CHECK(smart_city_semaforo_store_stale_count(&m_store, TEST_T0 + 36, 5) == 1);
+    TEST_CHECK(smart_city_semaforo_store_stale_count(&m_store, TEST_T0 + 56, 5) == 2);
+}
+
+/** Um único grupo: a quinta impressão substitui a primeira, em ordem de chegada */
+static void test_dedup_eviction(void)
+{
+    smart_city_semaforo_default_msg_t msgs[SMART_CITY_SEMAFORO_DEDUP_WAYS + 1];
+    smart_city_semaforo_dedup_clear(&m_dedup);
+    for (uint8_t i = 0; i <= SMART_CITY_SEMAFORO_DEDUP_WAYS; i++)
+    {
+        msgs[i] = msg_make(0x0100 + i, TEST_T0 + i, SEMAFORO_ABERTO, 10);
+    }
+    for (uint8_t i = 0; i < SMART_CITY_SEMAFORO_DEDUP_WAYS; i++)
+    {
+        TEST_CHECK(smart_city_semaforo_dedup_check(&m_dedup, &msgs[i]));
+    }
+    for (uint8_t i = 0; i < SMART_CITY_SEMAFORO_DEDUP_WAYS; i++)
+    {
+        TEST_CHECK(!smart_city_semaforo_dedup_check(&m_dedup, &msgs[i]));
+    }
+
+    // O tempo até a próxima mudança não faz parte da chave
+    smart_city_semaforo_default_msg_t copia = msgs[0];
+    copia.data = semaforo_setData(SEMAFORO_ABERTO, 3);
+    TEST_CHECK(!smart_city_semaforo_dedup_check(&m_dedup, &copia));
+
+    TEST_CHECK(smart_city_semaforo_dedup_check(&m_dedup, &msgs[SMART_CITY_SEMAFORO_DEDUP_WAYS]));
+    for (uint8_t i = 1; i <= SMART_CITY_SEMAFORO_DEDUP_WAYS; i++)
+    {
+        TEST_CHECK(!smart_city_semaforo_dedup_check(&m_dedup, &msgs[i]));
+    }
+    TEST_CHECK(smart_city_semaforo_dedup_check(&m_dedup, &msgs[0]));
+}
+
+/** As cópias de um registro chegam com o timestamp reconstruído da idade, que difere em até
+ *  SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S entre os caminhos. Todas são repetidas, em qualquer posição do intervalo de tempo */
+static void test_dedup_time_slack(void)
+{
+    for (uint64_t offset = 0; offset < SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S; offset++)
+    {
+        smart_city_semaforo_dedup_clear(&m_dedup);
+        smart_city_semaforo_default_msg_t msg = msg_make(0x0100, TEST_T0 + offset, SEMAFORO_ABERTO, 30);
+        TEST_CHECK(smart_city_semaforo_dedup_check(&m_dedup, &msg));
+        for (int8_t delta = -SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S; delta <= SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S; delta++)
+        {
+            smart_city_semaforo_default_msg_t copia = msg_make(0x0100, TEST_T0 + offset + delta, SEMAFORO_ABERTO, 30);
+            TEST_CHECK(!smart_city_semaforo_dedup_check(&m_dedup, &copia));
+        }
+
+        // O mesmo estado na fase seguinte, e outro estado no mesmo instante, são mensagens novas
+        msg = msg_make(0x0100, TEST_T0 + offset + 3 * SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S, SEMAFORO_ABERTO, 30);
+        TEST_CHECK(smart_city_semaforo_dedup_check(&m_dedup, &msg));
+        msg = msg_make(0x0100, TEST_T0 + offset + 1, SEMAFORO_ATENCAO, 5);
+        TEST_CHECK(smart_city_semaforo_dedup_check(&m_dedup, &msg));
+    }
+}
+
+int main(void)
+{
+    test_store_put();
+    test_store_backward_shift();
+    test_store_replace_oldest();
+    test_store_stale_count();
+    test_dedup_eviction();
+    test_dedup_time_slack();
+    return TEST_RESULT();
+}
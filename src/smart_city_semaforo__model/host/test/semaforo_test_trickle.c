@@ -0,0 +1,106 @@
+/** Testes do escalonador Trickle das mensagens SHARE (smart_city_semaforo_full.h) */
+#include <stdint.h>
+#include <stdio.h>
+
+#include "test_common.h"
+#include "mock_access.h"
+#include "smart_city_semaforo_full.h"
+
+#define TEST_INTERVAL_MIN_MS  (100)
+#define TEST_DOUBLINGS        (3)
+
+static smart_city_semaforo_full_t m_semaforo_full;
+static smart_city_semaforo_default_msg_t m_estado_atual;
+static uint32_t m_fires;
+
+static void set_cb(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
+{
+}
+
+static void share_cb(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src)
+{
+}
+
+static smart_city_semaforo_default_msg_t * get_cb(const smart_city_semaforo_full_t * p_self)
+{
+    return &m_estado_atual;
+}
+
+static uint64_t time_cb(const smart_city_semaforo_full_t * p_self)
+{
+    return 0x5B0EED02ULL + timer_now() / 1000000;
+}
+
+static void share_fire_cb(smart_city_semaforo_full_t * p_self)
+{
+    m_fires++;
+}
+
+/** Avança o relógio até o fim do intervalo atual. Retorna o número de compartilhamentos nele */
+static uint32_t interval_run(void)
+{
+    const smart_city_semaforo_trickle_t * p_trickle = &m_semaforo_full.share_trickle_state;
+    uint32_t fires = m_fires;
+    mock_timer_set_now(p_trickle->interval_start + MS_TO_US(p_trickle->interval_ms));
+    return m_fires - fires;
+}
+
+/** Sem novidades o intervalo dobra até o máximo, com um compartilhamento por intervalo */
+static void test_trickle_doubling(void)
+{
+    const smart_city_semaforo_trickle_t * p_trickle = &m_semaforo_full.share_trickle_state;
+    smart_city_semaforo_share_trickle_start(&m_semaforo_full);
+    TEST_CHECK(p_trickle->interval_ms == TEST_INTERVAL_MIN_MS);
+    for (uint8_t i = 0; i < TEST_DOUBLINGS + 3; i++)
+    {
+        uint32_t esperado = TEST_INTERVAL_MIN_MS << (i < TEST_DOUBLINGS ? i : TEST_DOUBLINGS);
+        TEST_CHECK(p_trickle->interval_ms == esperado);
+        timestamp_t inicio = p_trickle->interval_start;
+        // O compartilhamento é sorteado na segunda metade do intervalo
+        mock_timer_set_now(inicio + MS_TO_US(esperado / 2) - 1);
+        TEST_CHECK(m_fires == i);
+        TEST_CHECK(interval_run() == 1);
+    }
+}
+
+/** redundancy_k mensagens consistentes antes do instante de compartilhamento o suprimem. Novidade volta ao mínimo */
+static void test_trickle_suppression(void)
+{
+    const smart_city_semaforo_trickle_t * p_trickle = &m_semaforo_full.share_trickle_state;
+    smart_city_semaforo_share_trickle_reset(&m_semaforo_full);
+    TEST_CHECK(p_trickle->interval_ms == TEST_INTERVAL_MIN_MS);
+
+    smart_city_semaforo_share_trickle_consistent(&m_semaforo_full);
+    TEST_CHECK(interval_run() == 1);
+    smart_city_semaforo_share_trickle_consistent(&m_semaforo_full);
+    smart_city_semaforo_share_trickle_consistent(&m_semaforo_full);
+    TEST_CHECK(interval_run() == 0);
+    // O contador recomeça a cada intervalo, e a supressão não impede a duplicação do intervalo
+    TEST_CHECK(p_trickle->interval_ms == TEST_INTERVAL_MIN_MS << 2);
+    TEST_CHECK(interval_run() == 1);
+
+    smart_city_semaforo_share_trickle_reset(&m_semaforo_full);
+    TEST_CHECK(p_trickle->interval_ms == TEST_INTERVAL_MIN_MS);
+    TEST_CHECK(p_trickle->interval_start == timer_now());
+}
+
+int main(void)
+{
+    mock_access_reset();
+    m_semaforo_full.set_cb = set_cb;
+    m_semaforo_full.share_cb = share_cb;
+    m_semaforo_full.get_cb = get_cb;
+    m_semaforo_full.time_cb = time_cb;
+    m_semaforo_full.share_fire_cb = share_fire_cb;
+    m_semaforo_full.share_trickle.interval_min_ms = TEST_INTERVAL_MIN_MS;
+    m_semaforo_full.share_trickle.interval_doublings = TEST_DOUBLINGS;
+    m_semaforo_full.share_trickle.redundancy_k = 2;
+    if (smart_city_semaforo_full_init(&m_semaforo_full, 0) != NRF_SUCCESS)
+    {
+        fprintf(stderr, "smart_city_semaforo_full_init failed\n");
+        return 1;
+    }
+    test_trickle_doubling();
+    test_trickle_suppression();
+    return TEST_RESULT();
+}
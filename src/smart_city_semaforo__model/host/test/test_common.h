@@ -0,0 +1,23 @@
+#ifndef TEST_COMMON_H__
+#define TEST_COMMON_H__
+
+#include <stdio.h>
+
+/** Verificações dos testes do build nativo. Uma falha é informada e contada, e o teste continua;
+ *  main() retorna TEST_RESULT() para que o ctest veja o resultado */
+
+static unsigned test_failures;
+
+#define TEST_CHECK(cond)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);  \
+            test_failures++;                                                    \
+        }                                                                       \
+    } while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+#endif /* TEST_COMMON_H__ */
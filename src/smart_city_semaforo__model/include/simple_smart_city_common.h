@@ -13,6 +13,9 @@ typedef enum
     SIMPLE_SMART_CITY_SHARE = 0xD1,		/** Compartilhar dados históricos aprendidos ou capturados pelo dispositivo */
     SIMPLE_SMART_CITY_SET = 0xD2,		/** Compartilhar uma nova leitura feita pelo dispositivo sensor, ou a mais recente */
     SIMPLE_SMART_CITY_GET = 0xD3,		/** Usado por um dispositivo para obter a última leitura feita pelo(s) dispositivo(s) sensor(es) daquele serviço */
+    SIMPLE_SMART_CITY_SHARE_COMPACT = 0xD4,	/** SHARE no formato compacto, que cabe em uma única PDU de acesso não segmentada */
+    SIMPLE_SMART_CITY_SET_COMPACT = 0xD5,	/** SET no formato compacto, que cabe em uma única PDU de acesso não segmentada */
+    SIMPLE_SMART_CITY_SHARE_BATCH = 0xD6,	/** Vários registros SHARE em uma única mensagem segmentada */
 } simple_smart_city_opcode_t;
 
 /** Estrutura de dados da mensagem */
@@ -2,6 +2,7 @@
 #define SMART_CITY_SEMAFORO_COMMON_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "access.h"
 
 #include "simple_smart_city_common.h"
@@ -37,4 +38,225 @@ typedef struct __attribute((packed))
 
 } smart_city_semaforo_default_msg_t;
 
+/** Os relgios dos dispositivos no so sincronizados: cada um conta a partir do prprio provisionamento.
+ *  Por isso o tempo das mensagens SHARE e SHARE_BATCH (e do formato compacto) viaja como idade da informao,
+ *  em segundos antes do envio. Quem envia converte o timestamp do prprio relgio em idade, e quem recebe converte
+ *  a idade em timestamp do prprio relgio. Assim os registros s so comparados dentro de um mesmo relgio */
+static inline uint64_t semaforo_age_get(uint64_t timestamp, uint64_t now)
+{
+    return timestamp < now ? now - timestamp : 0;
+}
+
+static inline uint64_t semaforo_age_to_timestamp(uint64_t age, uint64_t now)
+{
+    return age < now ? now - age : 0;
+}
+
+/** Formato compacto da mensagem.
+ *  Uma PDU de acesso no segmentada comporta 11 bytes. Descontados os 3 bytes do opcode do fabricante,
+ *  restam 8 bytes: sensor_ID, data e 32 bits de tempo e espao quantizados no campo "local", na forma
+ *  0xLLLL LLLL LLAA AAAA AAAA TTTT TTTT TTTT, onde
+ *  T: idade da informao (segundos) no momento do envio
+ *  A: latitude relativa  origem, em passos de SEMAFORO_COMPACT_GEO_QUANTUM (complemento de dois)
+ *  L: longitude relativa  origem, em passos de SEMAFORO_COMPACT_GEO_QUANTUM (complemento de dois) */
+#define SEMAFORO_COMPACT_TIME_BITS      (12)
+#define SEMAFORO_COMPACT_GEO_BITS       (10)
+#define SEMAFORO_COMPACT_GEO_QUANTUM    (1e-4f) /** Resoluo das coordenadas em graus (cerca de 11 m) */
+
+/** Maior idade representvel no formato compacto */
+#define SEMAFORO_COMPACT_TIME_SPAN      (1UL << SEMAFORO_COMPACT_TIME_BITS)
+#define SEMAFORO_COMPACT_MAX_AGE        (SEMAFORO_COMPACT_TIME_SPAN - 1)
+
+typedef struct __attribute((packed))
+{
+    sensor_ID_t sensor_ID;
+    uint16_t data;    /** Igual a smart_city_semaforo_default_msg_t.data */
+    uint32_t local;   /** Tempo e espao quantizados */
+} smart_city_semaforo_compact_msg_t;
+
+/** Converso do timestamp da mensagem para segundos e vice-versa */
+static inline uint64_t semaforo_msg_timestamp_get(const smart_city_semaforo_default_msg_t * p_msg)
+{
+    return (((uint64_t) p_msg->basic.timestamp64[0]) << 32) | p_msg->basic.timestamp64[1];
+}
+
+static inline void semaforo_msg_timestamp_set(smart_city_semaforo_default_msg_t * p_msg, uint64_t timestamp)
+{
+    p_msg->basic.timestamp64[0] = (uint32_t) (timestamp >> 32);
+    p_msg->basic.timestamp64[1] = (uint32_t) timestamp;
+}
+
+/** Quantiza uma coordenada em relao  origem. Retorna false se ela estiver fora do alcance do formato compacto */
+static inline bool semaforo_geo_quantize(float coordenada, float origem, int32_t * p_passos)
+{
+    float passos = (coordenada - origem) / SEMAFORO_COMPACT_GEO_QUANTUM;
+    passos += (passos < 0) ? -0.5f : 0.5f;
+    if (passos <= -(float) (1 << (SEMAFORO_COMPACT_GEO_BITS - 1)) - 1 || passos >= (float) (1 << (SEMAFORO_COMPACT_GEO_BITS - 1)))
+    {
+        return false;
+    }
+    *p_passos = (int32_t) passos;
+    return true;
+}
+
+/** Empacota a mensagem no formato compacto.
+ *  @param[in]  p_origin  Origem das coordenadas, comum a toda a rede
+ *  @param[in]  now       Relgio local de quem envia, em segundos
+ *  @returns false se a mensagem no puder ser representada (longe da origem ou antiga demais).
+ *           Nesse caso deve-se usar o formato padro */
+static inline bool smart_city_semaforo_compact_pack(const smart_city_semaforo_default_msg_t * p_msg, const geolocalizador_t * p_origin,
+                                                    uint64_t now, smart_city_semaforo_compact_msg_t * p_compact)
+{
+    uint64_t age = semaforo_age_get(semaforo_msg_timestamp_get(p_msg), now);
+    int32_t latitude, longitude;
+    if (age > SEMAFORO_COMPACT_MAX_AGE ||
+        !semaforo_geo_quantize(p_msg->basic.geolocalizador.latitude, p_origin->latitude, &latitude) ||
+        !semaforo_geo_quantize(p_msg->basic.geolocalizador.longitude, p_origin->longitude, &longitude))
+    {
+        return false;
+    }
+    const uint32_t geo_mask = (1UL << SEMAFORO_COMPACT_GEO_BITS) - 1;
+    p_compact->sensor_ID = p_msg->sensor_ID;
+    p_compact->data = p_msg->data;
+    p_compact->local = (uint32_t) age |
+                       (((uint32_t) latitude & geo_mask) << SEMAFORO_COMPACT_TIME_BITS) |
+                       (((uint32_t) longitude & geo_mask) << (SEMAFORO_COMPACT_TIME_BITS + SEMAFORO_COMPACT_GEO_BITS));
+    return true;
+}
+
+/** Desempacota a mensagem compacta.
+ *  O timestamp  reconstrudo a partir da idade e de "now" (relgio local de quem recebe) */
+static inline void smart_city_semaforo_compact_unpack(const smart_city_semaforo_compact_msg_t * p_compact, const geolocalizador_t * p_origin,
+                                                      uint64_t now, smart_city_semaforo_default_msg_t * p_msg)
+{
+    uint32_t local = p_compact->local;
+    uint64_t timestamp = semaforo_age_to_timestamp(local & (SEMAFORO_COMPACT_TIME_SPAN - 1), now);
+    // Extenso de sinal dos campos de 10 bits
+    int32_t latitude = ((int32_t) (local << (32 - SEMAFORO_COMPACT_TIME_BITS - SEMAFORO_COMPACT_GEO_BITS))) >> (32 - SEMAFORO_COMPACT_GEO_BITS);
+    int32_t longitude = ((int32_t) local) >> (SEMAFORO_COMPACT_TIME_BITS + SEMAFORO_COMPACT_GEO_BITS);
+
+    semaforo_msg_timestamp_set(p_msg, timestamp);
+    p_msg->basic.geolocalizador.latitude = p_origin->latitude + latitude * SEMAFORO_COMPACT_GEO_QUANTUM;
+    p_msg->basic.geolocalizador.longitude = p_origin->longitude + longitude * SEMAFORO_COMPACT_GEO_QUANTUM;
+    p_msg->sensor_ID = p_compact->sensor_ID;
+    p_msg->data = p_compact->data;
+}
+
+/** Formato da mensagem SHARE_BATCH.
+ *  O cabealho traz o tempo e o espao do primeiro registro. Cada registro traz sensor_ID, data e
+ *  as diferenas de tempo (segundos) e de coordenadas (passos de SEMAFORO_BATCH_GEO_QUANTUM) em relao ao cabealho.
+ *  O lote  montado com timestamps locais; na transmisso o tempo do cabealho  a idade do primeiro registro
+ *  (ver smart_city_semaforo_batch_age_set e smart_city_semaforo_batch_record_get)
+ *  O lote ocupa no mximo uma mensagem segmentada: 384 bytes menos a TransMIC (4) e o opcode do fabricante (3) */
+#define SEMAFORO_BATCH_GEO_QUANTUM      (1e-5f) /** Resoluo das diferenas de coordenadas em graus (cerca de 1 m) */
+#define SEMAFORO_BATCH_PARAMS_SIZE_MAX  (NRF_MESH_SEG_PAYLOAD_SIZE_MAX - 4 - 3)
+
+typedef struct __attribute((packed))
+{
+    basic_smart_city_msg_t basic; /** Referncia: tempo e espao do primeiro registro */
+    uint8_t count;                /** Nmero de registros no lote */
+} smart_city_semaforo_batch_header_t;
+
+typedef struct __attribute((packed))
+{
+    sensor_ID_t sensor_ID;
+    uint16_t data;
+    int16_t timestamp_delta;
+    int16_t latitude_delta;
+    int16_t longitude_delta;
+} smart_city_semaforo_batch_record_t;
+
+#define SEMAFORO_BATCH_MAX_RECORDS ((SEMAFORO_BATCH_PARAMS_SIZE_MAX - sizeof(smart_city_semaforo_batch_header_t)) / sizeof(smart_city_semaforo_batch_record_t))
+
+/** Bytes da mensagem de acesso, com a TransMIC, em cada segmento de transporte */
+#define SEMAFORO_SEG_SIZE               (12)
+
+/** Nmero de registros de um lote que ocupa no mximo "segments" segmentos de transporte.
+ *  Publicado para um endereo de grupo, o lote segmentado no tem confirmao: a perda de um segmento perde o lote
+ *  inteiro, e por isso o lote deve ocupar poucos segmentos. Com o cabealho, cada registro a mais  um segmento a mais */
+#define SEMAFORO_BATCH_RECORDS_IN_SEGMENTS(segments) \
+    (((segments) * SEMAFORO_SEG_SIZE - 4 - 3 - sizeof(smart_city_semaforo_batch_header_t)) / sizeof(smart_city_semaforo_batch_record_t))
+
+typedef struct __attribute((packed))
+{
+    smart_city_semaforo_batch_header_t header;
+    smart_city_semaforo_batch_record_t records[SEMAFORO_BATCH_MAX_RECORDS];
+} smart_city_semaforo_batch_msg_t;
+
+/** Tamanho dos parmetros de um lote com "count" registros */
+#define semaforo_batch_length(count) (sizeof(smart_city_semaforo_batch_header_t) + (count) * sizeof(smart_city_semaforo_batch_record_t))
+
+static inline void smart_city_semaforo_batch_init(smart_city_semaforo_batch_msg_t * p_batch)
+{
+    p_batch->header.count = 0;
+}
+
+/** Calcula a diferena em passos de SEMAFORO_BATCH_GEO_QUANTUM. Retorna false se ela no couber em 16 bits */
+static inline bool semaforo_batch_geo_delta(float coordenada, float referencia, int16_t * p_delta)
+{
+    float passos = (coordenada - referencia) / SEMAFORO_BATCH_GEO_QUANTUM;
+    passos += (passos < 0) ? -0.5f : 0.5f;
+    if (passos <= INT16_MIN - 1.0f || passos >= INT16_MAX + 1.0f)
+    {
+        return false;
+    }
+    *p_delta = (int16_t) passos;
+    return true;
+}
+
+/** Acrescenta um registro ao lote. O primeiro registro define a referncia do lote.
+ *  @returns false se o lote estiver cheio ou se o registro estiver longe demais da referncia.
+ *           Nesse caso o lote deve ser publicado e um novo lote iniciado com o registro */
+static inline bool smart_city_semaforo_batch_add(smart_city_semaforo_batch_msg_t * p_batch, const smart_city_semaforo_default_msg_t * p_msg)
+{
+    if (p_batch->header.count >= SEMAFORO_BATCH_MAX_RECORDS)
+    {
+        return false;
+    }
+    if (p_batch->header.count == 0)
+    {
+        p_batch->header.basic = p_msg->basic;
+    }
+    smart_city_semaforo_batch_record_t * p_record = &p_batch->records[p_batch->header.count];
+    int64_t timestamp_delta = (int64_t) (semaforo_msg_timestamp_get(p_msg) -
+                                         ((((uint64_t) p_batch->header.basic.timestamp64[0]) << 32) | p_batch->header.basic.timestamp64[1]));
+    int16_t latitude_delta, longitude_delta;
+    if (timestamp_delta < INT16_MIN || timestamp_delta > INT16_MAX ||
+        !semaforo_batch_geo_delta(p_msg->basic.geolocalizador.latitude, p_batch->header.basic.geolocalizador.latitude, &latitude_delta) ||
+        !semaforo_batch_geo_delta(p_msg->basic.geolocalizador.longitude, p_batch->header.basic.geolocalizador.longitude, &longitude_delta))
+    {
+        return false;
+    }
+    p_record->timestamp_delta = (int16_t) timestamp_delta;
+    p_record->latitude_delta = latitude_delta;
+    p_record->longitude_delta = longitude_delta;
+    p_record->sensor_ID = p_msg->sensor_ID;
+    p_record->data = p_msg->data;
+    p_batch->header.count++;
+    return true;
+}
+
+/** Prepara o lote para a transmisso: o tempo do cabealho passa a ser a idade do primeiro registro em "now" */
+static inline void smart_city_semaforo_batch_age_set(smart_city_semaforo_batch_msg_t * p_batch, uint64_t now)
+{
+    smart_city_semaforo_default_msg_t referencia;
+    referencia.basic = p_batch->header.basic;
+    semaforo_msg_timestamp_set(&referencia, semaforo_age_get(semaforo_msg_timestamp_get(&referencia), now));
+    p_batch->header.basic = referencia.basic;
+}
+
+/** Reconstri o registro "index" de um lote recebido no formato padro. O timestamp  convertido para "now",
+ *  o relgio local de quem recebe */
+static inline void smart_city_semaforo_batch_record_get(const smart_city_semaforo_batch_msg_t * p_batch, uint8_t index, uint64_t now,
+                                                        smart_city_semaforo_default_msg_t * p_msg)
+{
+    const smart_city_semaforo_batch_record_t * p_record = &p_batch->records[index];
+    p_msg->basic = p_batch->header.basic;
+    semaforo_msg_timestamp_set(p_msg, semaforo_age_to_timestamp(semaforo_msg_timestamp_get(p_msg), now) + p_record->timestamp_delta);
+    p_msg->basic.geolocalizador.latitude += p_record->latitude_delta * SEMAFORO_BATCH_GEO_QUANTUM;
+    p_msg->basic.geolocalizador.longitude += p_record->longitude_delta * SEMAFORO_BATCH_GEO_QUANTUM;
+    p_msg->sensor_ID = p_record->sensor_ID;
+    p_msg->data = p_record->data;
+}
+
 #endif /* SMART_CITY_SEMAFORO_COMMON_H__ */
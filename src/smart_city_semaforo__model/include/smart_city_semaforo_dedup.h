@@ -0,0 +1,47 @@
+#ifndef SMART_CITY_SEMAFORO_DEDUP_H__
+#define SMART_CITY_SEMAFORO_DEDUP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smart_city_semaforo_common.h"
+#include "smart_city_semaforo_store.h"
+
+/** Conjunto das mensagens recebidas recentemente, para descartar cópias que chegam por vizinhos diferentes.
+ *  Cada mensagem é representada por uma impressão digital de 32 bits de (sensor_ID, estado, intervalo de tempo).
+ *  Na recepção o timestamp é reconstruído da idade com o relógio local, e as cópias de um mesmo registro chegam com
+ *  timestamps que diferem em até SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S. Por isso o tempo entra na impressão como o
+ *  intervalo de SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S segundos que o contém, e a consulta procura os intervalos
+ *  de timestamp - slack e de timestamp + slack.
+ *  As impressões ficam em grupos de SMART_CITY_SEMAFORO_DEDUP_WAYS posições. Cada impressão tem dois grupos candidatos
+ *  e ocupa uma posição livre em qualquer um deles; com os dois cheios, a impressão mais antiga do primeiro é substituída.
+ *  A memória é fixa e a consulta examina no máximo 2 * SMART_CITY_SEMAFORO_DEDUP_WAYS posições.
+ *  Falsos positivos (mensagem nova tomada como repetida) exigem a colisão dos 32 bits nos mesmos grupos. */
+
+/** Número de posições por grupo */
+#define SMART_CITY_SEMAFORO_DEDUP_WAYS (4)
+
+/** Largura dos intervalos de tempo, maior que a janela de 2 * slack: ela toca no máximo dois intervalos */
+#define SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S (2 * SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S + 1)
+
+typedef struct
+{
+    uint32_t * p_fingerprints;
+    uint8_t * p_next;    /** Próxima posição a ser substituída em cada grupo cheio */
+    uint16_t sets;       /** Número de grupos (potência de dois) */
+} smart_city_semaforo_dedup_t;
+
+/** Define um conjunto estático com "size" impressões. "size" / SMART_CITY_SEMAFORO_DEDUP_WAYS deve ser potência de dois */
+#define SMART_CITY_SEMAFORO_DEDUP_DEF(name, size)                                                \
+    static uint32_t name##_fingerprints[size];                                                  \
+    static uint8_t name##_next[(size) / SMART_CITY_SEMAFORO_DEDUP_WAYS];                        \
+    static smart_city_semaforo_dedup_t name = {name##_fingerprints, name##_next, (size) / SMART_CITY_SEMAFORO_DEDUP_WAYS}
+
+/** Esvazia o conjunto */
+void smart_city_semaforo_dedup_clear(smart_city_semaforo_dedup_t * p_dedup);
+
+/** Registra a mensagem no conjunto.
+ *  @returns false se a mensagem já tiver sido vista recentemente (repetida), inclusive com um timestamp que difere em
+ *           até SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S */
+bool smart_city_semaforo_dedup_check(smart_city_semaforo_dedup_t * p_dedup, const smart_city_semaforo_default_msg_t * p_msg);
+
+#endif /* SMART_CITY_SEMAFORO_DEDUP_H__ */
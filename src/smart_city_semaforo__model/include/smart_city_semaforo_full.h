@@ -2,7 +2,9 @@
 #define SMART_CITY_SEMAFORO_FULL_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "access.h"
+#include "timer_scheduler.h"
 #include "smart_city_semaforo_common.h"
 
 /** Simple Smart City Semaforo Client model ID. */
@@ -18,9 +20,69 @@ typedef void (*smart_city_semaforo_set_cb_t)(const smart_city_semaforo_full_t *
 /** callback type para processar  mensagens tipo SHARE */
 typedef void (*smart_city_semaforo_share_cb_t)(const smart_city_semaforo_full_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src);
 
+/** callback type para processar mensagens tipo SHARE_BATCH. Todos os registros do lote são entregues em uma única chamada */
+typedef void (*smart_city_semaforo_share_batch_cb_t)(const smart_city_semaforo_full_t * p_self, const smart_city_semaforo_default_msg_t * p_msgs, uint8_t count, uint16_t src);
+
 /** callback type para processar  mensagens tipo GET */
 typedef smart_city_semaforo_default_msg_t * (*smart_city_semaforo_get_cb_t)(const smart_city_semaforo_full_t * p_self);
 
+/** callback type para obter o relógio local em segundos. Converte o tempo das mensagens SHARE entre idade e timestamp local */
+typedef uint64_t (*smart_city_semaforo_time_cb_t)(const smart_city_semaforo_full_t * p_self);
+
+/** callback type chamado pelo escalonador Trickle quando o dispositivo deve compartilhar o que sabe (SHARE/SHARE_BATCH) */
+typedef void (*smart_city_semaforo_share_fire_cb_t)(smart_city_semaforo_full_t * p_self);
+
+/** Parâmetros do escalonador Trickle (RFC 6206) das mensagens SHARE.
+ *  O intervalo começa em interval_min_ms e dobra a cada intervalo sem novidades, até interval_min_ms << interval_doublings.
+ *  Em cada intervalo o compartilhamento é feito num instante aleatório da segunda metade, a menos que
+ *  redundancy_k mensagens SHARE consistentes (sem novidades) tenham sido ouvidas antes dele */
+typedef struct
+{
+    uint32_t interval_min_ms;
+    uint8_t interval_doublings;
+    uint8_t redundancy_k;
+} smart_city_semaforo_trickle_config_t;
+
+/** Estado interno do escalonador. Não deve ser alterado pela aplicação */
+typedef struct
+{
+    timer_event_t timer;
+    timestamp_t interval_start;
+    uint32_t interval_ms;
+    uint8_t counter;
+    bool fire_pending;    /** O instante de compartilhamento do intervalo atual ainda não chegou */
+} smart_city_semaforo_trickle_t;
+
+/** Contadores das respostas ao GET, para monitoração */
+typedef struct
+{
+    uint32_t scheduled;         /** Respostas agendadas com atraso aleatório */
+    uint32_t suppressed;        /** Respostas agendadas e canceladas porque outro nó já informou o mesmo estado */
+    uint32_t coalesced;         /** GETs recebidos com uma resposta já agendada, atendidos por ela */
+    uint64_t delay_ms_total;    /** Soma dos atrasos sorteados das respostas agendadas */
+} smart_city_semaforo_get_reply_stats_t;
+
+/** Estado da resposta agendada. Não deve ser alterado pela aplicação */
+typedef struct
+{
+    timer_event_t timer;
+    sensor_ID_t sensor_ID;    /** Semáforo e estado informados por get_cb quando o GET é atendido, para a supressão.
+                                  A resposta publicada é obtida de novo de get_cb no fim do atraso */
+    uint8_t estado;
+    volatile bool pending;
+    smart_city_semaforo_get_reply_stats_t stats;
+} smart_city_semaforo_get_reply_t;
+
+/** Formato usado na publicação das mensagens SET e SHARE.
+    Ambos os formatos são sempre aceitos na recepção */
+typedef enum
+{
+    /** Somente smart_city_semaforo_default_msg_t (mensagem segmentada) */
+    SMART_CITY_SEMAFORO_FORMAT_DEFAULT = 0,
+    /** smart_city_semaforo_compact_msg_t sempre que a mensagem puder ser representada nele, senão o formato padrão */
+    SMART_CITY_SEMAFORO_FORMAT_COMPACT
+} smart_city_semaforo_format_t;
+
 /** Estrutura de dados que define o modelo */
 struct __smart_city_semaforo_full
 {
@@ -30,18 +92,55 @@ struct __smart_city_semaforo_full
     smart_city_semaforo_set_cb_t set_cb;
     /** callback para mensagem do tipo share */
     smart_city_semaforo_share_cb_t share_cb;
+    /** callback para mensagem do tipo share_batch. Opcional: se NULL, cada registro do lote é entregue a share_cb */
+    smart_city_semaforo_share_batch_cb_t share_batch_cb;
     /** callback para mensagem do tipo GET */
     smart_city_semaforo_get_cb_t get_cb;
+    /** Formato das mensagens publicadas */
+    smart_city_semaforo_format_t format;
+    /** Origem das coordenadas do formato compacto. Deve ser a mesma em toda a rede */
+    geolocalizador_t origin;
+    /** callback para o relógio local. Obrigatório */
+    smart_city_semaforo_time_cb_t time_cb;
+    /** Parâmetros do escalonador das mensagens SHARE */
+    smart_city_semaforo_trickle_config_t share_trickle;
+    /** callback para o compartilhamento. Opcional: se NULL, o escalonador não é usado */
+    smart_city_semaforo_share_fire_cb_t share_fire_cb;
+    /** Estado do escalonador */
+    smart_city_semaforo_trickle_t share_trickle_state;
+    /** Janela das respostas ao GET, em ms. Cada resposta é publicada após um atraso aleatório em [0, janela), para que
+     *  um GET de grupo não faça todos os dispositivos responderem ao mesmo tempo; se antes disso outro nó publicar o
+     *  mesmo semáforo no mesmo estado (SET, SHARE ou lote), a resposta é cancelada. 0: resposta imediata */
+    uint32_t get_reply_window_ms;
+    /** Estado da resposta agendada */
+    smart_city_semaforo_get_reply_t get_reply_state;
 };
 
 /** Inicializa o modelo */
 uint32_t smart_city_semaforo_full_init(smart_city_semaforo_full_t * p_semaforo_full, uint16_t element_index);
 
+/** Contadores das respostas ao GET */
+static inline const smart_city_semaforo_get_reply_stats_t * smart_city_semaforo_get_reply_stats(const smart_city_semaforo_full_t * p_semaforo_full)
+{
+    return &p_semaforo_full->get_reply_state.stats;
+}
+
 /** Mensagens que serão geradas */
 /** API da mensagem GET */
 uint32_t smart_city_semaforo_get(smart_city_semaforo_full_t * p_semaforo_full);
 
-/** API para as mensagens SET e SHARE */
+/** API para as mensagens SET e SHARE. O timestamp é do relógio local (time_cb); no SHARE ele é convertido em idade */
 uint32_t smart_city_semaforo_publish(smart_city_semaforo_full_t * p_semaforo_full, smart_city_semaforo_default_msg_t * semaforo_msg, simple_smart_city_opcode_t msg_type);
 
+/** API da mensagem SHARE_BATCH. O lote deve ser montado com smart_city_semaforo_batch_add(), com timestamps locais */
+uint32_t smart_city_semaforo_share_batch(smart_city_semaforo_full_t * p_semaforo_full, const smart_city_semaforo_batch_msg_t * p_batch);
+
+/** Escalonador Trickle das mensagens SHARE.
+ *  start: inicia o escalonador no intervalo mínimo. Deve ser chamado quando o dispositivo puder publicar
+ *  reset: informação nova (SET recebido). Volta ao intervalo mínimo
+ *  consistent: ouviu uma mensagem SHARE sem novidades. Conta para a supressão do próximo compartilhamento */
+void smart_city_semaforo_share_trickle_start(smart_city_semaforo_full_t * p_semaforo_full);
+void smart_city_semaforo_share_trickle_reset(smart_city_semaforo_full_t * p_semaforo_full);
+void smart_city_semaforo_share_trickle_consistent(smart_city_semaforo_full_t * p_semaforo_full);
+
 #endif /* SMART_CITY_SEMAFORO_FULL_H__ */
@@ -0,0 +1,57 @@
+#ifndef SMART_CITY_SEMAFORO_NO_SENSOR_H__
+#define SMART_CITY_SEMAFORO_NO_SENSOR_H__
+
+#include <stdint.h>
+#include "access.h"
+#include "smart_city_semaforo_common.h"
+
+/** Simple Smart City Semaforo model ID para dispositivos sem sensor. */
+#define SMART_CITY_SEMAFORO_NO_SENSOR_MODEL_ID (0xC002)
+
+/** Forward declaration. */
+typedef struct __smart_city_semaforo_no_sensor smart_city_semaforo_no_sensor_t;
+
+/** Mensagens que serão recebidas */
+/** callback type para processar mensagens do tipo SET */
+typedef void (*smart_city_semaforo_no_sensor_set_cb_t)(const smart_city_semaforo_no_sensor_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src);
+
+/** callback type para processar  mensagens tipo SHARE */
+typedef void (*smart_city_semaforo_no_sensor_share_cb_t)(const smart_city_semaforo_no_sensor_t * p_self, smart_city_semaforo_default_msg_t * msg, uint16_t src);
+
+/** callback type para processar mensagens tipo SHARE_BATCH. Todos os registros do lote são entregues em uma única chamada */
+typedef void (*smart_city_semaforo_no_sensor_share_batch_cb_t)(const smart_city_semaforo_no_sensor_t * p_self, const smart_city_semaforo_default_msg_t * p_msgs, uint8_t count, uint16_t src);
+
+/** callback type para obter o relógio local em segundos. Converte o tempo das mensagens SHARE entre idade e timestamp local */
+typedef uint64_t (*smart_city_semaforo_no_sensor_time_cb_t)(const smart_city_semaforo_no_sensor_t * p_self);
+
+/** Estrutura de dados que define o modelo */
+struct __smart_city_semaforo_no_sensor
+{
+    /** Model handle assigned to the client. */
+    access_model_handle_t model_handle;
+    /** callback para mensagem do tipo set */
+    smart_city_semaforo_no_sensor_set_cb_t set_cb;
+    /** callback para mensagem do tipo share */
+    smart_city_semaforo_no_sensor_share_cb_t share_cb;
+    /** callback para mensagem do tipo share_batch. Opcional: se NULL, cada registro do lote é entregue a share_cb */
+    smart_city_semaforo_no_sensor_share_batch_cb_t share_batch_cb;
+    /** Origem das coordenadas do formato compacto. Deve ser a mesma em toda a rede */
+    geolocalizador_t origin;
+    /** callback para o relógio local. Obrigatório */
+    smart_city_semaforo_no_sensor_time_cb_t time_cb;
+};
+
+/** Inicializa o modelo */
+uint32_t smart_city_semaforo_no_sensor_init(smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor, uint16_t element_index);
+
+/** Mensagens que serão geradas */
+/** API da mensagem GET */
+uint32_t smart_city_semaforo_get(smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor);
+
+/** API da mensagem SHARE. O timestamp é do relógio local (time_cb) e é convertido em idade */
+uint32_t smart_city_semaforo_share(smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor, smart_city_semaforo_default_msg_t * semaforo_msg);
+
+/** API da mensagem SHARE_BATCH. O lote deve ser montado com smart_city_semaforo_batch_add(), com timestamps locais */
+uint32_t smart_city_semaforo_share_batch(smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor, const smart_city_semaforo_batch_msg_t * p_batch);
+
+#endif /* SMART_CITY_SEMAFORO_NO_SENSOR_H__ */
@@ -0,0 +1,81 @@
+#ifndef SMART_CITY_SEMAFORO_STORE_H__
+#define SMART_CITY_SEMAFORO_STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smart_city_semaforo_common.h"
+
+/** Tabela com o registro mais recente de cada semáforo, indexada por sensor_ID.
+ *  Endereçamento aberto com sondagem linear: inserção e consulta em O(1) no caso médio.
+ *  A capacidade deve ser uma potência de dois. Quando a tabela está cheia, um semáforo novo
+ *  substitui o registro mais antigo da tabela.
+ *  Todos os timestamps da tabela são do relógio local (ver semaforo_age_to_timestamp em smart_city_semaforo_common.h) */
+
+/** Diferença de tempo (segundos) abaixo da qual registros com o mesmo "data" são a mesma informação.
+ *  A conversão entre idade e timestamp arredonda para segundos inteiros em cada salto */
+#define SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S (2)
+
+/** Entrada da tabela */
+typedef struct
+{
+    smart_city_semaforo_default_msg_t msg;
+    bool valid;
+} smart_city_semaforo_store_entry_t;
+
+typedef struct
+{
+    smart_city_semaforo_store_entry_t * p_entries;
+    uint16_t capacity;
+    uint16_t count;
+} smart_city_semaforo_store_t;
+
+/** Resultado da inserção */
+typedef enum
+{
+    /** Semáforo novo na tabela */
+    SMART_CITY_SEMAFORO_STORE_INSERTED,
+    /** Registro do semáforo atualizado com uma informação mais recente */
+    SMART_CITY_SEMAFORO_STORE_UPDATED,
+    /** Semáforo novo na tabela cheia: o registro mais antigo foi descartado */
+    SMART_CITY_SEMAFORO_STORE_REPLACED,
+    /** Informação igual ou mais antiga que a armazenada. Nada foi alterado */
+    SMART_CITY_SEMAFORO_STORE_STALE
+} smart_city_semaforo_store_result_t;
+
+/** Valor inicial do cursor de smart_city_semaforo_store_next() */
+#define SMART_CITY_SEMAFORO_STORE_ITERATOR_START (0)
+
+/** Define uma tabela estática com "size" entradas (potência de dois) */
+#define SMART_CITY_SEMAFORO_STORE_DEF(name, size)                                   \
+    static smart_city_semaforo_store_entry_t name##_entries[size];                  \
+    static smart_city_semaforo_store_t name = {name##_entries, (size), 0}
+
+/** Esvazia a tabela */
+void smart_city_semaforo_store_clear(smart_city_semaforo_store_t * p_store);
+
+/** Armazena o registro recebido de outro dispositivo se ele for mais recente que o armazenado para o mesmo semáforo */
+smart_city_semaforo_store_result_t smart_city_semaforo_store_put(smart_city_semaforo_store_t * p_store, const smart_city_semaforo_default_msg_t * p_msg);
+
+/** Armazena o registro ouvido diretamente do semáforo. É sempre aceito, mesmo que a tabela tenha um registro mais
+ *  recente (relógio do semáforo reiniciado, por exemplo): o semáforo é a fonte da informação */
+smart_city_semaforo_store_result_t smart_city_semaforo_store_set(smart_city_semaforo_store_t * p_store, const smart_city_semaforo_default_msg_t * p_msg);
+
+/** Retorna o registro mais recente do semáforo, ou NULL se ele não estiver na tabela */
+const smart_city_semaforo_default_msg_t * smart_city_semaforo_store_get(const smart_city_semaforo_store_t * p_store, sensor_ID_t sensor_ID);
+
+/** Percorre a tabela. O cursor deve começar em SMART_CITY_SEMAFORO_STORE_ITERATOR_START.
+ *  @returns o próximo registro, ou NULL quando a tabela termina.
+ *  A ordem não é definida e a tabela não deve ser alterada durante a iteração */
+const smart_city_semaforo_default_msg_t * smart_city_semaforo_store_next(const smart_city_semaforo_store_t * p_store, uint16_t * p_cursor);
+
+/** Número de semáforos cujo registro já deveria ter sido substituído: o instante anunciado para a próxima mudança
+ *  de estado (timestamp + tempo em "data") mais "tolerance" segundos é anterior a "now" */
+uint16_t smart_city_semaforo_store_stale_count(const smart_city_semaforo_store_t * p_store, uint64_t now, uint32_t tolerance);
+
+/** Número de semáforos na tabela */
+static inline uint16_t smart_city_semaforo_store_count(const smart_city_semaforo_store_t * p_store)
+{
+    return p_store->count;
+}
+
+#endif /* SMART_CITY_SEMAFORO_STORE_H__ */
@@ -0,0 +1,93 @@
+#ifndef SMART_CITY_SEMAFORO_TRACE_H__
+#define SMART_CITY_SEMAFORO_TRACE_H__
+
+#include <stdint.h>
+#include "log.h"
+#include "nrf_mesh_config_app.h"
+#include "smart_city_semaforo_trace_messages.h"
+
+/** Trace das mensagens frequentes da aplicação (SET, SHARE, GET), chamadas nos callbacks da mesh e dos temporizadores.
+ *  Com SMART_CITY_TRACE_BINARY, SMART_CITY_TRACE grava só o ID da mensagem, o contador do RTC e os argumentos brutos
+ *  num ring em RAM, sem formatar texto e sem bloqueio: cada registro é reservado com uma operação atômica sobre o
+ *  índice de escrita, e uma interrupção de prioridade maior pode gravar no meio de outra. O laço ocioso de main()
+ *  esvazia o ring no canal RTT SMART_CITY_TRACE_RTT_CHANNEL, e smart_city_trace_decoder (smart_city__tools) reconstrói
+ *  as linhas do __LOG a partir de smart_city_semaforo_trace_messages.h. Com o ring cheio, os registros novos são
+ *  descartados e a quantidade perdida é registrada no próximo esvaziamento.
+ *  Sem SMART_CITY_TRACE_BINARY as mensagens vão para o __LOG, como antes.
+ *  Captura: JLinkRTTLogger -Device NRF52832_XXAA -If SWD -Speed 4000 -RTTChannel 1 trace.bin */
+
+#ifndef SMART_CITY_TRACE_BINARY
+#define SMART_CITY_TRACE_BINARY         (0)
+#endif
+
+/** Nível máximo das mensagens gravadas no modo binário (o __LOG filtra pelo nível de __LOG_INIT) */
+#ifndef SMART_CITY_TRACE_LEVEL
+#define SMART_CITY_TRACE_LEVEL          (LOG_LEVEL_INFO)
+#endif
+
+/** Tamanho do ring em palavras de 32 bits. Deve ser potência de dois */
+#ifndef SMART_CITY_TRACE_RING_WORDS
+#define SMART_CITY_TRACE_RING_WORDS     (512)
+#endif
+
+/** Canal RTT do trace binário; o canal 0 continua com o __LOG */
+#ifndef SMART_CITY_TRACE_RTT_CHANNEL
+#define SMART_CITY_TRACE_RTT_CHANNEL    (1)
+#endif
+
+#if SMART_CITY_TRACE_BINARY
+
+/** Configura o canal RTT. Deve ser chamada depois de __LOG_INIT */
+void smart_city_semaforo_trace_init(void);
+
+/** Esvazia o ring no canal RTT. Chamada no laço ocioso de main(), fora de contexto de interrupção */
+void smart_city_semaforo_trace_flush(void);
+
+/** Grava um registro com "count" argumentos (no máximo SMART_CITY_TRACE_ARGS_MAX). Pode ser chamada de qualquer
+ *  prioridade de interrupção */
+void smart_city_semaforo_trace_record(smart_city_trace_id_t id, const uint32_t * p_args, uint32_t count);
+
+/** Grava um registro com os bytes de p_data, truncados ao que cabe em SMART_CITY_TRACE_ARGS_MAX - 1 palavras */
+void smart_city_semaforo_trace_bytes(smart_city_trace_id_t id, const void * p_data, uint32_t length);
+
+/** SMART_CITY_TRACE(nome, argumentos...): nome de uma mensagem de smart_city_semaforo_trace_messages.h, sem o prefixo */
+#define SMART_CITY_TRACE(name, ...)                                                                         \
+    do                                                                                                      \
+    {                                                                                                       \
+        if (SMART_CITY_TRACE_##name##_LEVEL <= SMART_CITY_TRACE_LEVEL)                                     \
+        {                                                                                                   \
+            const uint32_t trace_args[] = { 0, ##__VA_ARGS__ };                                             \
+            smart_city_semaforo_trace_record(SMART_CITY_TRACE_ID_##name, &trace_args[1],                    \
+                                             sizeof(trace_args) / sizeof(trace_args[0]) - 1);               \
+        }                                                                                                   \
+    } while (0)
+
+#define SMART_CITY_TRACE_HEX(name, p_data, length)                                                          \
+    do                                                                                                      \
+    {                                                                                                       \
+        if (SMART_CITY_TRACE_##name##_LEVEL <= SMART_CITY_TRACE_LEVEL)                                     \
+        {                                                                                                   \
+            smart_city_semaforo_trace_bytes(SMART_CITY_TRACE_ID_##name, (p_data), (length));                \
+        }                                                                                                   \
+    } while (0)
+
+#else
+
+#define smart_city_semaforo_trace_init()    do { } while (0)
+#define smart_city_semaforo_trace_flush()   do { } while (0)
+
+#define SMART_CITY_TRACE(name, ...)                                                                         \
+    do                                                                                                      \
+    {                                                                                                       \
+        __LOG(LOG_SRC_APP, SMART_CITY_TRACE_##name##_LEVEL, SMART_CITY_TRACE_##name##_FORMAT, ##__VA_ARGS__); \
+    } while (0)
+
+#define SMART_CITY_TRACE_HEX(name, p_data, length)                                                          \
+    do                                                                                                      \
+    {                                                                                                       \
+        __LOG_XB(LOG_SRC_APP, SMART_CITY_TRACE_##name##_LEVEL, SMART_CITY_TRACE_##name##_FORMAT, (p_data), (length)); \
+    } while (0)
+
+#endif /* SMART_CITY_TRACE_BINARY */
+
+#endif /* SMART_CITY_SEMAFORO_TRACE_H__ */
@@ -0,0 +1,99 @@
+#ifndef SMART_CITY_SEMAFORO_TRACE_MESSAGES_H__
+#define SMART_CITY_SEMAFORO_TRACE_MESSAGES_H__
+
+#include <stdint.h>
+
+/** Tabela das mensagens do trace binário (ver smart_city_semaforo_trace.h).
+ *  Cada mensagem tem o nível de log e o formato printf; os argumentos são gravados como palavras de 32 bits.
+ *  O formato não vai para o firmware no modo binário: o decodificador (smart_city__tools) inclui este mesmo arquivo
+ *  para reconstruir o texto. Novas mensagens entram sempre no fim da lista, para que os IDs de capturas antigas
+ *  continuem válidos. Os textos são os do __LOG original, de que dependem as análises dos logs */
+
+#define SMART_CITY_TRACE_DROPPED_LEVEL              LOG_LEVEL_WARN
+#define SMART_CITY_TRACE_DROPPED_FORMAT             "%u trace records dropped \n"
+
+#define SMART_CITY_TRACE_STORE_STALE_LEVEL          LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_STORE_STALE_FORMAT         "Message not stored \n"
+
+#define SMART_CITY_TRACE_STORE_REPLACED_LEVEL       LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_STORE_REPLACED_FORMAT      "data_store full: oldest record replaced by t_light 0x%04x \n"
+
+#define SMART_CITY_TRACE_SHARE_DUPLICATE_LEVEL      LOG_LEVEL_DBG1
+#define SMART_CITY_TRACE_SHARE_DUPLICATE_FORMAT     "Duplicate of t_light 0x%04x discarded \n"
+
+#define SMART_CITY_TRACE_SET_RX_LEVEL               LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_SET_RX_FORMAT              "Got a SIMPLE_SMART_CITY_SET message from t_light 0x%04x with state 0x%01x \n"
+
+#define SMART_CITY_TRACE_SHARE_RX_LEVEL             LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_SHARE_RX_FORMAT            "Got a SIMPLE_SMART_CITY_SHARE message from 0x%04x saying t_light 0x%04x was state 0x%01x \n"
+
+#define SMART_CITY_TRACE_SHARE_BATCH_RX_LEVEL       LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_SHARE_BATCH_RX_FORMAT      "Got a SIMPLE_SMART_CITY_SHARE_BATCH message from 0x%04x with %u records \n"
+
+#define SMART_CITY_TRACE_GET_REPLY_LEVEL            LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_GET_REPLY_FORMAT           "Replying a SIMPLE_SMART_CITY_GET message with state 0x%01x \n"
+
+#define SMART_CITY_TRACE_GET_RX_LEVEL               LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_GET_RX_FORMAT              "Got a SIMPLE_SMART_CITY_GET message. Nothing to say\n"
+
+#define SMART_CITY_TRACE_SET_TX_LEVEL               LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_SET_TX_FORMAT              "Sending a SIMPLE_SMART_CITY_SET message with state 0x%01x \n"
+
+/** Mensagem com bytes em vez de argumentos (SMART_CITY_TRACE_HEX): o formato é o prefixo do __LOG_XB */
+#define SMART_CITY_TRACE_SET_TX_CONTENT_LEVEL       LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_SET_TX_CONTENT_FORMAT      "Message content: "
+
+#define SMART_CITY_TRACE_SHARE_BATCH_TX_LEVEL       LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_SHARE_BATCH_TX_FORMAT      "Sending a SIMPLE_SMART_CITY_SHARE_BATCH message with %u records \n"
+
+#define SMART_CITY_TRACE_STORE_EMPTY_LEVEL          LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_STORE_EMPTY_FORMAT         "There is still no data in data_store \n"
+
+#define SMART_CITY_TRACE_GET_TX_LEVEL               LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_GET_TX_FORMAT              "Requesting a SIMPLE_SMART_CITY_GET message \n"
+
+#define SMART_CITY_TRACE_GET_STATS_LEVEL            LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_GET_STATS_FORMAT           "GET on demand: %u stale lights, %u sent, %u saved against polling, next check in %u s \n"
+
+#define SMART_CITY_TRACE_GET_REPLY_STATS_LEVEL      LOG_LEVEL_INFO
+#define SMART_CITY_TRACE_GET_REPLY_STATS_FORMAT     "GET replies: %u delayed (mean %u ms), %u suppressed, %u coalesced \n"
+
+/** Lista das mensagens, na ordem dos IDs: X(nome, bytes), com bytes = 1 nas mensagens de SMART_CITY_TRACE_HEX */
+#define SMART_CITY_TRACE_MESSAGES(X)    \
+    X(DROPPED, 0)                       \
+    X(STORE_STALE, 0)                   \
+    X(STORE_REPLACED, 0)                \
+    X(SHARE_DUPLICATE, 0)               \
+    X(SET_RX, 0)                        \
+    X(SHARE_RX, 0)                      \
+    X(SHARE_BATCH_RX, 0)                \
+    X(GET_REPLY, 0)                     \
+    X(GET_RX, 0)                        \
+    X(SET_TX, 0)                        \
+    X(SET_TX_CONTENT, 1)                \
+    X(SHARE_BATCH_TX, 0)                \
+    X(STORE_EMPTY, 0)                   \
+    X(GET_TX, 0)                        \
+    X(GET_STATS, 0)                     \
+    X(GET_REPLY_STATS, 0)
+
+#define SMART_CITY_TRACE_ID_ENTRY(name, bytes)  SMART_CITY_TRACE_ID_##name,
+
+/** IDs das mensagens */
+typedef enum
+{
+    SMART_CITY_TRACE_MESSAGES(SMART_CITY_TRACE_ID_ENTRY)
+    SMART_CITY_TRACE_ID_COUNT
+} smart_city_trace_id_t;
+
+/** Formato de um registro no ring e no canal RTT, em palavras de 32 bits little-endian:
+ *  cabeçalho (marca, número de palavras de argumento, ID), contador do RTC (24 bits, 32768 Hz) e os argumentos.
+ *  Nas mensagens de bytes, o primeiro argumento é o número de bytes, seguidos dos bytes em ordem */
+#define SMART_CITY_TRACE_MARK                   (0xA5u)
+#define SMART_CITY_TRACE_ARGS_MAX               (15)
+#define SMART_CITY_TRACE_HEADER(id, args)       ((SMART_CITY_TRACE_MARK << 24) | ((uint32_t) (args) << 16) | (uint32_t) (id))
+#define SMART_CITY_TRACE_HEADER_MARK(header)    ((header) >> 24)
+#define SMART_CITY_TRACE_HEADER_ARGS(header)    (((header) >> 16) & 0xFF)
+#define SMART_CITY_TRACE_HEADER_ID(header)      ((header) & 0xFFFF)
+
+#endif /* SMART_CITY_SEMAFORO_TRACE_MESSAGES_H__ */
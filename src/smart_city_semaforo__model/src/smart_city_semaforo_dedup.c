@@ -0,0 +1,115 @@
+#include "smart_city_semaforo_dedup.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "nrf_mesh_assert.h"
+
+/** Impressão vazia. Uma mensagem cujo hash resulte nela é registrada com o valor 1 */
+#define DEDUP_EMPTY (0)
+
+/** Mistura de 32 bits (finalizador do MurmurHash3) */
+static uint32_t dedup_mix(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BUL;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35UL;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/** Impressão de (sensor_ID, estado, intervalo de tempo). O tempo até a próxima mudança de estado não faz parte da chave.
+ *  Nunca é DEDUP_EMPTY */
+static uint32_t dedup_fingerprint(const smart_city_semaforo_default_msg_t * p_msg, uint64_t bucket)
+{
+    uint32_t hash = dedup_mix((uint32_t) bucket ^ ((uint32_t) p_msg->sensor_ID << 16) ^ semaforo_getstate(p_msg->data));
+    hash = dedup_mix(hash ^ (uint32_t) (bucket >> 32));
+    return (hash == DEDUP_EMPTY) ? 1 : hash;
+}
+
+void smart_city_semaforo_dedup_clear(smart_city_semaforo_dedup_t * p_dedup)
+{
+    NRF_MESH_ASSERT(p_dedup != NULL && p_dedup->sets > 0 && (p_dedup->sets & (p_dedup->sets - 1)) == 0);
+    memset(p_dedup->p_fingerprints, 0, p_dedup->sets * SMART_CITY_SEMAFORO_DEDUP_WAYS * sizeof(uint32_t));
+    memset(p_dedup->p_next, 0, p_dedup->sets);
+}
+
+/** Procura a impressão no grupo. Retorna true se ela estiver lá; "p_free" recebe uma posição livre, se houver */
+static bool dedup_set_find(const uint32_t * p_set, uint32_t fingerprint, int8_t * p_free)
+{
+    *p_free = -1;
+    for (uint8_t way = 0; way < SMART_CITY_SEMAFORO_DEDUP_WAYS; way++)
+    {
+        if (p_set[way] == fingerprint)
+        {
+            return true;
+        }
+        if (p_set[way] == DEDUP_EMPTY && *p_free < 0)
+        {
+            *p_free = (int8_t) way;
+        }
+    }
+    return false;
+}
+
+/** Dois grupos candidatos, escolhidos pelas metades da impressão. A impressão inteira é comparada dentro deles */
+static void dedup_sets(const smart_city_semaforo_dedup_t * p_dedup, uint32_t fingerprint, uint16_t * p_sets)
+{
+    const uint16_t mask = p_dedup->sets - 1;
+    p_sets[0] = (uint16_t) (fingerprint & mask);
+    p_sets[1] = (uint16_t) ((fingerprint >> 16) & mask);
+}
+
+bool smart_city_semaforo_dedup_check(smart_city_semaforo_dedup_t * p_dedup, const smart_city_semaforo_default_msg_t * p_msg)
+{
+    // Uma cópia registrada com timestamp t' está a no máximo slack deste: o intervalo de t' é o de timestamp - slack ou
+    // o de timestamp + slack
+    const uint64_t timestamp = semaforo_msg_timestamp_get(p_msg);
+    const uint64_t buckets[2] = {
+        (timestamp - SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S) / SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S,
+        (timestamp + SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S) / SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S
+    };
+    uint16_t sets[2];
+    int8_t free_way[2];
+    for (uint8_t b = 0; b < 2; b++)
+    {
+        if (b == 1 && buckets[1] == buckets[0])
+        {
+            break;
+        }
+        uint32_t fingerprint = dedup_fingerprint(p_msg, buckets[b]);
+        dedup_sets(p_dedup, fingerprint, sets);
+        for (uint8_t k = 0; k < 2; k++)
+        {
+            if (dedup_set_find(&p_dedup->p_fingerprints[sets[k] * SMART_CITY_SEMAFORO_DEDUP_WAYS], fingerprint, &free_way[k]))
+            {
+                return false;
+            }
+        }
+    }
+
+    // A mensagem nova é registrada com o intervalo do próprio timestamp
+    uint32_t fingerprint = dedup_fingerprint(p_msg, timestamp / SMART_CITY_SEMAFORO_DEDUP_TIME_BUCKET_S);
+    dedup_sets(p_dedup, fingerprint, sets);
+    for (uint8_t k = 0; k < 2; k++)
+    {
+        (void) dedup_set_find(&p_dedup->p_fingerprints[sets[k] * SMART_CITY_SEMAFORO_DEDUP_WAYS], fingerprint, &free_way[k]);
+    }
+
+    // Ocupa uma posição livre de qualquer um dos grupos. Com os dois cheios, substitui em ordem de chegada no primeiro
+    uint8_t k = (free_way[0] < 0 && free_way[1] >= 0) ? 1 : 0;
+    uint8_t way;
+    if (free_way[k] >= 0)
+    {
+        way = (uint8_t) free_way[k];
+    }
+    else
+    {
+        way = p_dedup->p_next[sets[k]];
+        p_dedup->p_next[sets[k]] = (way + 1) % SMART_CITY_SEMAFORO_DEDUP_WAYS;
+    }
+    p_dedup->p_fingerprints[sets[k] * SMART_CITY_SEMAFORO_DEDUP_WAYS + way] = fingerprint;
+    return true;
+}
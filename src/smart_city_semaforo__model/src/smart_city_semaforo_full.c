@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "access.h"
 #include "access_config.h"
@@ -10,19 +11,112 @@
 #include "device_state_manager.h"
 #include "nrf_mesh.h"
 #include "nrf_mesh_assert.h"
+#include "timer_scheduler.h"
+#include "timer.h"
+#include "rand.h"
 #include "log.h"
 
 /*****************************************************************************
  * Opcode handler callback(s)
  *****************************************************************************/
 
+/** O lote  entregue de uma s vez a share_batch_cb ou, sem ela, registro a registro a share_cb */
+static void share_batch_deliver(smart_city_semaforo_full_t * p_semaforo_full, smart_city_semaforo_default_msg_t * p_msgs, uint8_t count, uint16_t src)
+{
+    if (p_semaforo_full->share_batch_cb != NULL)
+    {
+        p_semaforo_full->share_batch_cb(p_semaforo_full, p_msgs, count, src);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            p_semaforo_full->share_cb(p_semaforo_full, &p_msgs[i], src);
+        }
+    }
+}
+
+/** A resposta ao GET  feita por meio de uma mensagem do tipo SIMPLE_SMART_CITY_SET.
+    Com a janela configurada, a resposta  publicada aps um atraso aleatrio (ver get_reply_timeout). Aqui o estado
+    s  consultado para a supresso */
+static void get_reply(smart_city_semaforo_full_t * p_semaforo_full)
+{
+    smart_city_semaforo_get_reply_t * p_reply = &p_semaforo_full->get_reply_state;
+    if (p_semaforo_full->get_reply_window_ms == 0)
+    {
+        smart_city_semaforo_publish(p_semaforo_full, p_semaforo_full->get_cb(p_semaforo_full),SIMPLE_SMART_CITY_SET);
+        return;
+    }
+    // GETs de vrios dispositivos dentro da janela so atendidos pela mesma resposta
+    if (p_reply->pending)
+    {
+        p_reply->stats.coalesced++;
+        return;
+    }
+    smart_city_semaforo_default_msg_t * p_semaforo_msg = p_semaforo_full->get_cb(p_semaforo_full);
+    if (p_semaforo_msg == NULL)
+    {
+        return;
+    }
+    uint32_t random;
+    rand_hw_rng_get((uint8_t *) &random, sizeof(random));
+    uint32_t delay_ms = random % p_semaforo_full->get_reply_window_ms;
+
+    p_reply->sensor_ID = p_semaforo_msg->sensor_ID;
+    p_reply->estado = semaforo_getstate(p_semaforo_msg->data);
+    p_reply->stats.scheduled++;
+    p_reply->stats.delay_ms_total += delay_ms;
+    p_reply->pending = true;
+    timer_sch_reschedule(&p_reply->timer, timer_now() + MS_TO_US(delay_ms));
+}
+
+static void get_reply_timeout(timestamp_t timestamp, void * p_context)
+{
+    smart_city_semaforo_full_t * p_semaforo_full = p_context;
+    smart_city_semaforo_get_reply_t * p_reply = &p_semaforo_full->get_reply_state;
+    // O estado  obtido na publicao: o tempo restante da fase (e at o estado) mudou durante o atraso
+    if (p_reply->pending)
+    {
+        p_reply->pending = false;
+        (void) smart_city_semaforo_publish(p_semaforo_full, p_semaforo_full->get_cb(p_semaforo_full), SIMPLE_SMART_CITY_SET);
+    }
+}
+
+/** Outro n publicou o semforo da resposta agendada no mesmo estado: quem pediu o GET j tem a informao, e a
+    resposta  cancelada. As mensagens deste prprio n, recebidas de volta pela assinatura do grupo, no contam */
+static void get_reply_suppress(smart_city_semaforo_full_t * p_semaforo_full, const smart_city_semaforo_default_msg_t * p_semaforo_msg, uint16_t src)
+{
+    smart_city_semaforo_get_reply_t * p_reply = &p_semaforo_full->get_reply_state;
+    if (!p_reply->pending ||
+        p_semaforo_msg->sensor_ID != p_reply->sensor_ID ||
+        semaforo_getstate(p_semaforo_msg->data) != p_reply->estado)
+    {
+        return;
+    }
+    dsm_local_unicast_address_t local_address;
+    dsm_local_unicast_addresses_get(&local_address);
+    if (src >= local_address.address_start && src < local_address.address_start + local_address.count)
+    {
+        return;
+    }
+    p_reply->pending = false;
+    timer_sch_abort(&p_reply->timer);
+    p_reply->stats.suppressed++;
+}
+
 /** As mensagens de SET e SHARE  devem encaminhar os dados recebidos a aplicao para que sejam processadas.
     O processamento  feito pela funo de callback definida na palicao */
 static void handle_set_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
 {
     smart_city_semaforo_full_t * p_semaforo_full = p_args;
     NRF_MESH_ASSERT(p_semaforo_full->set_cb != NULL);
+    if (p_message->length != sizeof(smart_city_semaforo_default_msg_t))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_WARN, "Malformed SET from 0x%04x discarded\n", p_message->meta_data.src.value);
+        return;
+    }
     smart_city_semaforo_default_msg_t * p_semaforo_msg = (smart_city_semaforo_default_msg_t *) p_message->p_data;
+    get_reply_suppress(p_semaforo_full, p_semaforo_msg, p_message->meta_data.src.value);
     p_semaforo_full->set_cb(p_semaforo_full, p_semaforo_msg, p_message->meta_data.src.value);
 }
 
@@ -30,28 +124,191 @@ static void handle_share_cb(access_model_handle_t handle, const access_message_r
 {
     smart_city_semaforo_full_t * p_semaforo_full = p_args;
     NRF_MESH_ASSERT(p_semaforo_full->share_cb != NULL);
-    smart_city_semaforo_default_msg_t * p_semaforo_msg = (smart_city_semaforo_default_msg_t *) p_message->p_data;
-    p_semaforo_full->share_cb(p_semaforo_full, p_semaforo_msg, p_message->meta_data.src.value);
+    if (p_message->length != sizeof(smart_city_semaforo_default_msg_t))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_WARN, "Malformed SHARE from 0x%04x discarded\n", p_message->meta_data.src.value);
+        return;
+    }
+    // O timestamp do SHARE  a idade da informao:  convertido para o relgio local
+    smart_city_semaforo_default_msg_t semaforo_msg = *(const smart_city_semaforo_default_msg_t *) p_message->p_data;
+    semaforo_msg_timestamp_set(&semaforo_msg, semaforo_age_to_timestamp(semaforo_msg_timestamp_get(&semaforo_msg),
+                                                                        p_semaforo_full->time_cb(p_semaforo_full)));
+    get_reply_suppress(p_semaforo_full, &semaforo_msg, p_message->meta_data.src.value);
+    p_semaforo_full->share_cb(p_semaforo_full, &semaforo_msg, p_message->meta_data.src.value);
+}
+
+/** Os registros do lote so reconstrudos no formato padro e entregues  aplicao de uma s vez.
+    O buffer  esttico para no ocupar a pilha do contexto da mesh */
+static void handle_share_batch_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
+{
+    static smart_city_semaforo_default_msg_t semaforo_msgs[SEMAFORO_BATCH_MAX_RECORDS];
+    smart_city_semaforo_full_t * p_semaforo_full = p_args;
+    const smart_city_semaforo_batch_msg_t * p_batch = (const smart_city_semaforo_batch_msg_t *) p_message->p_data;
+    NRF_MESH_ASSERT(p_semaforo_full->share_cb != NULL);
+
+    if (p_message->length < sizeof(smart_city_semaforo_batch_header_t) ||
+        p_batch->header.count > SEMAFORO_BATCH_MAX_RECORDS ||
+        p_message->length != semaforo_batch_length(p_batch->header.count))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_WARN, "Malformed batch from 0x%04x discarded\n", p_message->meta_data.src.value);
+        return;
+    }
+    // Lote vazio: nada a entregar
+    if (p_batch->header.count == 0)
+    {
+        return;
+    }
+
+    uint64_t now = p_semaforo_full->time_cb(p_semaforo_full);
+    for (uint8_t i = 0; i < p_batch->header.count; i++)
+    {
+        smart_city_semaforo_batch_record_get(p_batch, i, now, &semaforo_msgs[i]);
+        get_reply_suppress(p_semaforo_full, &semaforo_msgs[i], p_message->meta_data.src.value);
+    }
+
+    share_batch_deliver(p_semaforo_full, semaforo_msgs, p_batch->header.count, p_message->meta_data.src.value);
+}
+
+/** As mensagens compactas so convertidas para o formato padro antes de chegar  aplicao */
+static bool compact_msg_decode(const smart_city_semaforo_full_t * p_semaforo_full, const access_message_rx_t * p_message, smart_city_semaforo_default_msg_t * p_semaforo_msg)
+{
+    if (p_message->length != sizeof(smart_city_semaforo_compact_msg_t))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_WARN, "Compact message from 0x%04x discarded\n", p_message->meta_data.src.value);
+        return false;
+    }
+    smart_city_semaforo_compact_unpack((const smart_city_semaforo_compact_msg_t *) p_message->p_data, &p_semaforo_full->origin,
+                                       p_semaforo_full->time_cb(p_semaforo_full), p_semaforo_msg);
+    return true;
+}
+
+static void handle_set_compact_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
+{
+    smart_city_semaforo_full_t * p_semaforo_full = p_args;
+    NRF_MESH_ASSERT(p_semaforo_full->set_cb != NULL);
+    smart_city_semaforo_default_msg_t semaforo_msg;
+    if (!compact_msg_decode(p_semaforo_full, p_message, &semaforo_msg))
+    {
+        return;
+    }
+    get_reply_suppress(p_semaforo_full, &semaforo_msg, p_message->meta_data.src.value);
+    p_semaforo_full->set_cb(p_semaforo_full, &semaforo_msg, p_message->meta_data.src.value);
+}
+
+static void handle_share_compact_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
+{
+    smart_city_semaforo_full_t * p_semaforo_full = p_args;
+    NRF_MESH_ASSERT(p_semaforo_full->share_cb != NULL);
+    smart_city_semaforo_default_msg_t semaforo_msg;
+    if (!compact_msg_decode(p_semaforo_full, p_message, &semaforo_msg))
+    {
+        return;
+    }
+    get_reply_suppress(p_semaforo_full, &semaforo_msg, p_message->meta_data.src.value);
+    p_semaforo_full->share_cb(p_semaforo_full, &semaforo_msg, p_message->meta_data.src.value);
 }
 
 /** Ao receber uma mensagem tipo GET, o dispositivo sensor deve responder com a ltima leitura. 
     Opcionalemnte pode-se fazer uma nova leitura neste momento.
-    Essa deciso deve ser tomada dentro da funo de callback definida pela aplicao.
-    A resposta  feita por meio de uma mensagem do tipo SIMPLE_SMART_CITY_SET */
+    Essa deciso deve ser tomada dentro da funo de callback definida pela aplicao */
 static void handle_get_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
 {
     smart_city_semaforo_full_t * p_semaforo_full = p_args;
     NRF_MESH_ASSERT(p_semaforo_full->get_cb != NULL);
-    smart_city_semaforo_publish(p_semaforo_full, p_semaforo_full->get_cb(p_semaforo_full),SIMPLE_SMART_CITY_SET);
+    get_reply(p_semaforo_full);
 }
 
 static const access_opcode_handler_t m_opcode_handlers[] =
 {
     {{SIMPLE_SMART_CITY_SHARE, SIMPLE_SMART_CITY_COMPANY_ID}, handle_share_cb},
     {{SIMPLE_SMART_CITY_SET, SIMPLE_SMART_CITY_COMPANY_ID}, handle_set_cb},
-    {{SIMPLE_SMART_CITY_GET, SIMPLE_SMART_CITY_COMPANY_ID}, handle_get_cb}
+    {{SIMPLE_SMART_CITY_GET, SIMPLE_SMART_CITY_COMPANY_ID}, handle_get_cb},
+    {{SIMPLE_SMART_CITY_SHARE_COMPACT, SIMPLE_SMART_CITY_COMPANY_ID}, handle_share_compact_cb},
+    {{SIMPLE_SMART_CITY_SET_COMPACT, SIMPLE_SMART_CITY_COMPANY_ID}, handle_set_compact_cb},
+    {{SIMPLE_SMART_CITY_SHARE_BATCH, SIMPLE_SMART_CITY_COMPANY_ID}, handle_share_batch_cb}
 };
 
+/*****************************************************************************
+ * Escalonador Trickle das mensagens SHARE (RFC 6206)
+ *****************************************************************************/
+
+/** Inicia um novo intervalo: sorteia o instante de compartilhamento em [I/2, I) e zera o contador */
+static void trickle_interval_begin(smart_city_semaforo_full_t * p_semaforo_full, timestamp_t now)
+{
+    smart_city_semaforo_trickle_t * p_trickle = &p_semaforo_full->share_trickle_state;
+    uint32_t random;
+    rand_hw_rng_get((uint8_t *) &random, sizeof(random));
+    uint32_t half = p_trickle->interval_ms / 2;
+    uint32_t fire_ms = half + (half ? random % half : 0);
+
+    p_trickle->interval_start = now;
+    p_trickle->counter = 0;
+    p_trickle->fire_pending = true;
+    timer_sch_reschedule(&p_trickle->timer, now + MS_TO_US(fire_ms));
+}
+
+/** O mesmo evento do timer marca o instante de compartilhamento e, depois, o fim do intervalo */
+static void trickle_timeout(timestamp_t timestamp, void * p_context)
+{
+    smart_city_semaforo_full_t * p_semaforo_full = p_context;
+    smart_city_semaforo_trickle_t * p_trickle = &p_semaforo_full->share_trickle_state;
+    const smart_city_semaforo_trickle_config_t * p_config = &p_semaforo_full->share_trickle;
+
+    if (p_trickle->fire_pending)
+    {
+        p_trickle->fire_pending = false;
+        if (p_trickle->counter >= p_config->redundancy_k)
+        {
+            __LOG(LOG_SRC_APP, LOG_LEVEL_DBG1, "SHARE suppressed (%u consistent messages heard)\n", p_trickle->counter);
+        }
+        else
+        {
+            p_semaforo_full->share_fire_cb(p_semaforo_full);
+        }
+        timer_sch_reschedule(&p_trickle->timer, p_trickle->interval_start + MS_TO_US(p_trickle->interval_ms));
+        return;
+    }
+
+    // Fim do intervalo sem novidades: dobra o intervalo at o mximo
+    if (p_trickle->interval_ms < (p_config->interval_min_ms << p_config->interval_doublings))
+    {
+        p_trickle->interval_ms *= 2;
+    }
+    trickle_interval_begin(p_semaforo_full, timestamp);
+}
+
+void smart_city_semaforo_share_trickle_start(smart_city_semaforo_full_t * p_semaforo_full)
+{
+    if (p_semaforo_full->share_fire_cb == NULL)
+    {
+        return;
+    }
+    p_semaforo_full->share_trickle_state.interval_ms = p_semaforo_full->share_trickle.interval_min_ms;
+    trickle_interval_begin(p_semaforo_full, timer_now());
+}
+
+void smart_city_semaforo_share_trickle_reset(smart_city_semaforo_full_t * p_semaforo_full)
+{
+    smart_city_semaforo_trickle_t * p_trickle = &p_semaforo_full->share_trickle_state;
+    // Parado ou j no intervalo mnimo: nada a fazer (RFC 6206, seo 4.2, regra 6)
+    if (p_semaforo_full->share_fire_cb == NULL || p_trickle->interval_ms == 0 ||
+        p_trickle->interval_ms == p_semaforo_full->share_trickle.interval_min_ms)
+    {
+        return;
+    }
+    p_trickle->interval_ms = p_semaforo_full->share_trickle.interval_min_ms;
+    trickle_interval_begin(p_semaforo_full, timer_now());
+}
+
+void smart_city_semaforo_share_trickle_consistent(smart_city_semaforo_full_t * p_semaforo_full)
+{
+    smart_city_semaforo_trickle_t * p_trickle = &p_semaforo_full->share_trickle_state;
+    if (p_trickle->counter < UINT8_MAX)
+    {
+        p_trickle->counter++;
+    }
+}
+
 /*****************************************************************************
  * Public API: Funes que podero ser usadas para uso do Modelo
  *****************************************************************************/
@@ -62,11 +319,30 @@ uint32_t smart_city_semaforo_full_init(smart_city_semaforo_full_t * p_semaforo_f
     if (p_semaforo_full == NULL ||
         p_semaforo_full->get_cb == NULL ||
         p_semaforo_full->set_cb == NULL ||
-        p_semaforo_full->share_cb == NULL)
+        p_semaforo_full->share_cb == NULL ||
+        p_semaforo_full->time_cb == NULL)
     {
         return NRF_ERROR_NULL;
     }
 
+    // o escalonador Trickle precisa de um intervalo mnimo e de um mximo que caiba em 32 bits
+    if (p_semaforo_full->share_fire_cb != NULL &&
+        (p_semaforo_full->share_trickle.interval_min_ms < 2 ||
+         p_semaforo_full->share_trickle.interval_doublings > 20 ||
+         p_semaforo_full->share_trickle.redundancy_k == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    p_semaforo_full->share_trickle_state.interval_ms = 0;
+    p_semaforo_full->share_trickle_state.timer.cb = trickle_timeout;
+    p_semaforo_full->share_trickle_state.timer.p_context = p_semaforo_full;
+    p_semaforo_full->share_trickle_state.timer.interval = 0;
+    p_semaforo_full->get_reply_state.pending = false;
+    p_semaforo_full->get_reply_state.timer.cb = get_reply_timeout;
+    p_semaforo_full->get_reply_state.timer.p_context = p_semaforo_full;
+    p_semaforo_full->get_reply_state.timer.interval = 0;
+    memset(&p_semaforo_full->get_reply_state.stats, 0, sizeof(p_semaforo_full->get_reply_state.stats));
+
     // Parâmentros para associar o modelo ao elemento na camada de acesso
     access_model_add_params_t init_params;
     init_params.model_id.model_id = SMART_CITY_SEMAFORO_FULL_MODEL_ID;
@@ -98,10 +374,58 @@ uint32_t smart_city_semaforo_publish(smart_city_semaforo_full_t * p_semaforo_ful
         return NRF_ERROR_NULL;
     }
     access_message_tx_t message;
-    message.opcode.opcode = msg_type;
+    smart_city_semaforo_compact_msg_t compact_msg;
+    smart_city_semaforo_default_msg_t share_msg;
+    uint64_t now = p_semaforo_full->time_cb(p_semaforo_full);
+    message.opcode.company_id = SIMPLE_SMART_CITY_COMPANY_ID;
+    // Negociao do formato: o compacto  usado sempre que o modelo permitir e a mensagem couber nele
+    if (p_semaforo_full->format == SMART_CITY_SEMAFORO_FORMAT_COMPACT &&
+        (msg_type == SIMPLE_SMART_CITY_SET || msg_type == SIMPLE_SMART_CITY_SHARE) &&
+        smart_city_semaforo_compact_pack(semaforo_msg, &p_semaforo_full->origin, now, &compact_msg))
+    {
+        message.opcode.opcode = (msg_type == SIMPLE_SMART_CITY_SET) ? SIMPLE_SMART_CITY_SET_COMPACT : SIMPLE_SMART_CITY_SHARE_COMPACT;
+        message.p_buffer = (const uint8_t*) &compact_msg;
+        message.length = sizeof(smart_city_semaforo_compact_msg_t);
+    }
+    else if (msg_type == SIMPLE_SMART_CITY_SHARE)
+    {
+        // O SHARE leva a idade da informao no lugar do timestamp
+        share_msg = *semaforo_msg;
+        semaforo_msg_timestamp_set(&share_msg, semaforo_age_get(semaforo_msg_timestamp_get(semaforo_msg), now));
+        message.opcode.opcode = msg_type;
+        message.p_buffer = (const uint8_t*) &share_msg;
+        message.length = sizeof(smart_city_semaforo_default_msg_t);
+    }
+    else
+    {
+        message.opcode.opcode = msg_type;
+        message.p_buffer = (const uint8_t*) semaforo_msg;
+        message.length = sizeof(smart_city_semaforo_default_msg_t);
+    }
+    message.force_segmented = false;
+    message.transmic_size = NRF_MESH_TRANSMIC_SIZE_DEFAULT;
+    return access_model_publish(p_semaforo_full->model_handle, &message);
+}
+
+uint32_t smart_city_semaforo_share_batch(smart_city_semaforo_full_t * p_semaforo_full, const smart_city_semaforo_batch_msg_t * p_batch)
+{
+    // Cpia transmitida, com o tempo do cabealho convertido em idade. Esttica para no ocupar a pilha
+    static smart_city_semaforo_batch_msg_t batch;
+    if(p_batch==NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if(p_batch->header.count==0 || p_batch->header.count>SEMAFORO_BATCH_MAX_RECORDS)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    memcpy(&batch, p_batch, semaforo_batch_length(p_batch->header.count));
+    smart_city_semaforo_batch_age_set(&batch, p_semaforo_full->time_cb(p_semaforo_full));
+    access_message_tx_t message;
+    message.opcode.opcode = SIMPLE_SMART_CITY_SHARE_BATCH;
     message.opcode.company_id = SIMPLE_SMART_CITY_COMPANY_ID;
-    message.p_buffer = (const uint8_t*) semaforo_msg;
-    message.length = sizeof(smart_city_semaforo_default_msg_t);
+    message.p_buffer = (const uint8_t*) &batch;
+    message.length = semaforo_batch_length(p_batch->header.count);
     message.force_segmented = false;
     message.transmic_size = NRF_MESH_TRANSMIC_SIZE_DEFAULT;
     return access_model_publish(p_semaforo_full->model_handle, &message);
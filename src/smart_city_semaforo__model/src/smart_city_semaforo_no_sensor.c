@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "access.h"
 #include "access_config.h"
@@ -30,14 +31,91 @@ static void handle_share_cb(access_model_handle_t handle, const access_message_r
 {
     smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor = p_args;
     NRF_MESH_ASSERT(p_semaforo_no_sensor->share_cb != NULL);
-    smart_city_semaforo_default_msg_t * p_semaforo_msg = (smart_city_semaforo_default_msg_t *) p_message->p_data;
-    p_semaforo_no_sensor->share_cb(p_semaforo_no_sensor, p_semaforo_msg, p_message->meta_data.src.value);
+    // O timestamp do SHARE  a idade da informao:  convertido para o relgio local
+    smart_city_semaforo_default_msg_t semaforo_msg = *(const smart_city_semaforo_default_msg_t *) p_message->p_data;
+    semaforo_msg_timestamp_set(&semaforo_msg, semaforo_age_to_timestamp(semaforo_msg_timestamp_get(&semaforo_msg),
+                                                                        p_semaforo_no_sensor->time_cb(p_semaforo_no_sensor)));
+    p_semaforo_no_sensor->share_cb(p_semaforo_no_sensor, &semaforo_msg, p_message->meta_data.src.value);
+}
+
+/** As mensagens compactas so reconstrudas no formato padro antes de chegarem  aplicao */
+static bool compact_msg_decode(const smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor, const access_message_rx_t * p_message, smart_city_semaforo_default_msg_t * p_semaforo_msg)
+{
+    if (p_message->length != sizeof(smart_city_semaforo_compact_msg_t))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_WARN, "Compact message from 0x%04x discarded\n", p_message->meta_data.src.value);
+        return false;
+    }
+    smart_city_semaforo_compact_unpack((const smart_city_semaforo_compact_msg_t *) p_message->p_data, &p_semaforo_no_sensor->origin,
+                                       p_semaforo_no_sensor->time_cb(p_semaforo_no_sensor), p_semaforo_msg);
+    return true;
+}
+
+static void handle_set_compact_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
+{
+    smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor = p_args;
+    NRF_MESH_ASSERT(p_semaforo_no_sensor->set_cb != NULL);
+    smart_city_semaforo_default_msg_t semaforo_msg;
+    if (compact_msg_decode(p_semaforo_no_sensor, p_message, &semaforo_msg))
+    {
+        p_semaforo_no_sensor->set_cb(p_semaforo_no_sensor, &semaforo_msg, p_message->meta_data.src.value);
+    }
+}
+
+static void handle_share_compact_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
+{
+    smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor = p_args;
+    NRF_MESH_ASSERT(p_semaforo_no_sensor->share_cb != NULL);
+    smart_city_semaforo_default_msg_t semaforo_msg;
+    if (compact_msg_decode(p_semaforo_no_sensor, p_message, &semaforo_msg))
+    {
+        p_semaforo_no_sensor->share_cb(p_semaforo_no_sensor, &semaforo_msg, p_message->meta_data.src.value);
+    }
+}
+
+/** Os registros do lote so reconstrudos no formato padro e entregues  aplicao de uma s vez.
+    O buffer  esttico para no ocupar a pilha do contexto da mesh */
+static void handle_share_batch_cb(access_model_handle_t handle, const access_message_rx_t * p_message, void * p_args)
+{
+    static smart_city_semaforo_default_msg_t semaforo_msgs[SEMAFORO_BATCH_MAX_RECORDS];
+    smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor = p_args;
+    const smart_city_semaforo_batch_msg_t * p_batch = (const smart_city_semaforo_batch_msg_t *) p_message->p_data;
+    NRF_MESH_ASSERT(p_semaforo_no_sensor->share_cb != NULL);
+
+    if (p_message->length < sizeof(smart_city_semaforo_batch_header_t) ||
+        p_batch->header.count > SEMAFORO_BATCH_MAX_RECORDS ||
+        p_message->length != semaforo_batch_length(p_batch->header.count))
+    {
+        __LOG(LOG_SRC_APP, LOG_LEVEL_WARN, "Malformed batch from 0x%04x discarded\n", p_message->meta_data.src.value);
+        return;
+    }
+
+    uint64_t now = p_semaforo_no_sensor->time_cb(p_semaforo_no_sensor);
+    for (uint8_t i = 0; i < p_batch->header.count; i++)
+    {
+        smart_city_semaforo_batch_record_get(p_batch, i, now, &semaforo_msgs[i]);
+    }
+
+    if (p_semaforo_no_sensor->share_batch_cb != NULL)
+    {
+        p_semaforo_no_sensor->share_batch_cb(p_semaforo_no_sensor, semaforo_msgs, p_batch->header.count, p_message->meta_data.src.value);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < p_batch->header.count; i++)
+        {
+            p_semaforo_no_sensor->share_cb(p_semaforo_no_sensor, &semaforo_msgs[i], p_message->meta_data.src.value);
+        }
+    }
 }
 
 static const access_opcode_handler_t m_opcode_handlers[] =
 {
     {{SIMPLE_SMART_CITY_SHARE, SIMPLE_SMART_CITY_COMPANY_ID}, handle_share_cb},
-    {{SIMPLE_SMART_CITY_SET, SIMPLE_SMART_CITY_COMPANY_ID}, handle_set_cb}
+    {{SIMPLE_SMART_CITY_SET, SIMPLE_SMART_CITY_COMPANY_ID}, handle_set_cb},
+    {{SIMPLE_SMART_CITY_SHARE_COMPACT, SIMPLE_SMART_CITY_COMPANY_ID}, handle_share_compact_cb},
+    {{SIMPLE_SMART_CITY_SET_COMPACT, SIMPLE_SMART_CITY_COMPANY_ID}, handle_set_compact_cb},
+    {{SIMPLE_SMART_CITY_SHARE_BATCH, SIMPLE_SMART_CITY_COMPANY_ID}, handle_share_batch_cb}
 };
 
 /*****************************************************************************
@@ -49,7 +127,8 @@ uint32_t smart_city_semaforo_no_sensor_init(smart_city_semaforo_no_sensor_t * p_
     // checa se a estrutura de dados que define o modelo foi corretamente configurada
     if (p_semaforo_no_sensor == NULL ||
         p_semaforo_no_sensor->set_cb == NULL ||
-        p_semaforo_no_sensor->share_cb == NULL)
+        p_semaforo_no_sensor->share_cb == NULL ||
+        p_semaforo_no_sensor->time_cb == NULL)
     {
         return NRF_ERROR_NULL;
     }
@@ -80,11 +159,39 @@ uint32_t smart_city_semaforo_get(smart_city_semaforo_no_sensor_t * p_semaforo_no
 
 uint32_t smart_city_semaforo_share(smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor, smart_city_semaforo_default_msg_t * semaforo_msg)
 {
+    // O SHARE leva a idade da informao no lugar do timestamp
+    smart_city_semaforo_default_msg_t share_msg = *semaforo_msg;
+    semaforo_msg_timestamp_set(&share_msg, semaforo_age_get(semaforo_msg_timestamp_get(semaforo_msg),
+                                                            p_semaforo_no_sensor->time_cb(p_semaforo_no_sensor)));
     access_message_tx_t message;
     message.opcode.opcode = SIMPLE_SMART_CITY_SHARE;
     message.opcode.company_id = SIMPLE_SMART_CITY_COMPANY_ID;
-    message.p_buffer = (const uint8_t*) &semaforo_msg;
-    message.length = sizeof(semaforo_msg);
+    message.p_buffer = (const uint8_t*) &share_msg;
+    message.length = sizeof(smart_city_semaforo_default_msg_t);
+    message.force_segmented = false;
+    message.transmic_size = NRF_MESH_TRANSMIC_SIZE_DEFAULT;
+    return access_model_publish(p_semaforo_no_sensor->model_handle, &message);
+}
+
+uint32_t smart_city_semaforo_share_batch(smart_city_semaforo_no_sensor_t * p_semaforo_no_sensor, const smart_city_semaforo_batch_msg_t * p_batch)
+{
+    // Cpia transmitida, com o tempo do cabealho convertido em idade. Esttica para no ocupar a pilha
+    static smart_city_semaforo_batch_msg_t batch;
+    if(p_batch==NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if(p_batch->header.count==0 || p_batch->header.count>SEMAFORO_BATCH_MAX_RECORDS)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    memcpy(&batch, p_batch, semaforo_batch_length(p_batch->header.count));
+    smart_city_semaforo_batch_age_set(&batch, p_semaforo_no_sensor->time_cb(p_semaforo_no_sensor));
+    access_message_tx_t message;
+    message.opcode.opcode = SIMPLE_SMART_CITY_SHARE_BATCH;
+    message.opcode.company_id = SIMPLE_SMART_CITY_COMPANY_ID;
+    message.p_buffer = (const uint8_t*) &batch;
+    message.length = semaforo_batch_length(p_batch->header.count);
     message.force_segmented = false;
     message.transmic_size = NRF_MESH_TRANSMIC_SIZE_DEFAULT;
     return access_model_publish(p_semaforo_no_sensor->model_handle, &message);
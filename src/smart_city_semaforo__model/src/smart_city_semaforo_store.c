@@ -0,0 +1,174 @@
+#include "smart_city_semaforo_store.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "nrf_mesh_assert.h"
+
+/** Posição inicial de um semáforo na tabela (hash multiplicativo de Fibonacci) */
+static uint16_t store_home(const smart_city_semaforo_store_t * p_store, sensor_ID_t sensor_ID)
+{
+    uint32_t hash = (uint32_t) sensor_ID * 2654435769UL;
+    return (uint16_t) ((hash ^ (hash >> 16)) & (p_store->capacity - 1));
+}
+
+/** Procura o semáforo. Retorna a posição dele, ou a posição livre onde ele deve entrar */
+static uint16_t store_find(const smart_city_semaforo_store_t * p_store, sensor_ID_t sensor_ID, bool * p_found)
+{
+    uint16_t i = store_home(p_store, sensor_ID);
+    for (uint16_t probes = 0; probes < p_store->capacity; probes++)
+    {
+        if (!p_store->p_entries[i].valid)
+        {
+            break;
+        }
+        if (p_store->p_entries[i].msg.sensor_ID == sensor_ID)
+        {
+            *p_found = true;
+            return i;
+        }
+        i = (i + 1) & (p_store->capacity - 1);
+    }
+    *p_found = false;
+    return i;
+}
+
+/** Remove a entrada "i" deslocando para trás as entradas seguintes da mesma sequência de sondagem,
+    de forma que nenhuma busca seja interrompida por um buraco */
+static void store_remove(smart_city_semaforo_store_t * p_store, uint16_t i)
+{
+    const uint16_t mask = p_store->capacity - 1;
+    uint16_t j = i;
+    p_store->p_entries[i].valid = false;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (!p_store->p_entries[j].valid)
+        {
+            break;
+        }
+        uint16_t home = store_home(p_store, p_store->p_entries[j].msg.sensor_ID);
+        // A entrada "j" só pode ocupar o buraco "i" se "home" não estiver no intervalo circular (i, j]
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            p_store->p_entries[i] = p_store->p_entries[j];
+            p_store->p_entries[j].valid = false;
+            i = j;
+        }
+    }
+    p_store->count--;
+}
+
+/** Localiza o registro mais antigo da tabela (somente quando ela está cheia) */
+static uint16_t store_oldest(const smart_city_semaforo_store_t * p_store)
+{
+    uint16_t oldest = 0;
+    for (uint16_t i = 1; i < p_store->capacity; i++)
+    {
+        if (semaforo_msg_timestamp_get(&p_store->p_entries[i].msg) < semaforo_msg_timestamp_get(&p_store->p_entries[oldest].msg))
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void smart_city_semaforo_store_clear(smart_city_semaforo_store_t * p_store)
+{
+    NRF_MESH_ASSERT(p_store != NULL && p_store->capacity > 0 && (p_store->capacity & (p_store->capacity - 1)) == 0);
+    memset(p_store->p_entries, 0, p_store->capacity * sizeof(smart_city_semaforo_store_entry_t));
+    p_store->count = 0;
+}
+
+/** Inclui um semáforo novo, descartando o registro mais antigo se a tabela estiver cheia.
+    Sem "force", o registro não entra se for mais antigo que todos os da tabela cheia */
+static smart_city_semaforo_store_result_t store_insert(smart_city_semaforo_store_t * p_store, uint16_t i,
+                                                       const smart_city_semaforo_default_msg_t * p_msg, bool force)
+{
+    bool found;
+    smart_city_semaforo_store_result_t result = SMART_CITY_SEMAFORO_STORE_INSERTED;
+    if (p_store->count == p_store->capacity)
+    {
+        uint16_t oldest = store_oldest(p_store);
+        if (!force && semaforo_msg_timestamp_get(p_msg) < semaforo_msg_timestamp_get(&p_store->p_entries[oldest].msg))
+        {
+            return SMART_CITY_SEMAFORO_STORE_STALE;
+        }
+        store_remove(p_store, oldest);
+        i = store_find(p_store, p_msg->sensor_ID, &found);
+        result = SMART_CITY_SEMAFORO_STORE_REPLACED;
+    }
+    p_store->p_entries[i].msg = *p_msg;
+    p_store->p_entries[i].valid = true;
+    p_store->count++;
+    return result;
+}
+
+smart_city_semaforo_store_result_t smart_city_semaforo_store_put(smart_city_semaforo_store_t * p_store, const smart_city_semaforo_default_msg_t * p_msg)
+{
+    bool found;
+    uint16_t i = store_find(p_store, p_msg->sensor_ID, &found);
+    if (!found)
+    {
+        return store_insert(p_store, i, p_msg, false);
+    }
+    smart_city_semaforo_default_msg_t * p_stored = &p_store->p_entries[i].msg;
+    uint64_t stored_timestamp = semaforo_msg_timestamp_get(p_stored);
+    uint64_t timestamp = semaforo_msg_timestamp_get(p_msg);
+    // Cópias da mesma informação chegam por caminhos diferentes com alguns segundos de diferença
+    if (timestamp < stored_timestamp ||
+        (p_msg->data == p_stored->data && timestamp <= stored_timestamp + SMART_CITY_SEMAFORO_STORE_TIME_SLACK_S))
+    {
+        return SMART_CITY_SEMAFORO_STORE_STALE;
+    }
+    *p_stored = *p_msg;
+    return SMART_CITY_SEMAFORO_STORE_UPDATED;
+}
+
+smart_city_semaforo_store_result_t smart_city_semaforo_store_set(smart_city_semaforo_store_t * p_store, const smart_city_semaforo_default_msg_t * p_msg)
+{
+    bool found;
+    uint16_t i = store_find(p_store, p_msg->sensor_ID, &found);
+    if (!found)
+    {
+        return store_insert(p_store, i, p_msg, true);
+    }
+    p_store->p_entries[i].msg = *p_msg;
+    return SMART_CITY_SEMAFORO_STORE_UPDATED;
+}
+
+const smart_city_semaforo_default_msg_t * smart_city_semaforo_store_get(const smart_city_semaforo_store_t * p_store, sensor_ID_t sensor_ID)
+{
+    bool found;
+    uint16_t i = store_find(p_store, sensor_ID, &found);
+    return found ? &p_store->p_entries[i].msg : NULL;
+}
+
+uint16_t smart_city_semaforo_store_stale_count(const smart_city_semaforo_store_t * p_store, uint64_t now, uint32_t tolerance)
+{
+    uint16_t stale = 0;
+    for (uint16_t i = 0; i < p_store->capacity; i++)
+    {
+        const smart_city_semaforo_store_entry_t * p_entry = &p_store->p_entries[i];
+        if (p_entry->valid &&
+            semaforo_msg_timestamp_get(&p_entry->msg) + semaforo_getdelay(p_entry->msg.data) + tolerance < now)
+        {
+            stale++;
+        }
+    }
+    return stale;
+}
+
+const smart_city_semaforo_default_msg_t * smart_city_semaforo_store_next(const smart_city_semaforo_store_t * p_store, uint16_t * p_cursor)
+{
+    while (*p_cursor < p_store->capacity)
+    {
+        const smart_city_semaforo_store_entry_t * p_entry = &p_store->p_entries[(*p_cursor)++];
+        if (p_entry->valid)
+        {
+            return &p_entry->msg;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,132 @@
+#include "smart_city_semaforo_trace.h"
+
+#if SMART_CITY_TRACE_BINARY
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "SEGGER_RTT.h"
+#include "nrf_mesh_assert.h"
+
+#if (SMART_CITY_TRACE_RING_WORDS & (SMART_CITY_TRACE_RING_WORDS - 1)) != 0
+#error SMART_CITY_TRACE_RING_WORDS must be a power of two
+#endif
+
+#define TRACE_RING_MASK         (SMART_CITY_TRACE_RING_WORDS - 1)
+#define TRACE_RECORD_WORDS_MAX  (2 + SMART_CITY_TRACE_ARGS_MAX)
+/** Buffer do canal RTT: o mesmo tamanho do ring, para que um esvaziamento completo caiba nele */
+#define TRACE_RTT_BUFFER_SIZE   (SMART_CITY_TRACE_RING_WORDS * sizeof(uint32_t))
+
+/* Os índices crescem sem máscara; a ocupação é m_head - m_tail. Uma posição com cabeçalho zero está reservada mas
+ * ainda não escrita, e é onde o esvaziamento para */
+static uint32_t m_ring[SMART_CITY_TRACE_RING_WORDS];
+static volatile uint32_t m_head;
+static volatile uint32_t m_tail;
+static volatile uint32_t m_dropped;
+static uint8_t m_rtt_buffer[TRACE_RTT_BUFFER_SIZE];
+
+void smart_city_semaforo_trace_init(void)
+{
+    m_head = 0;
+    m_tail = 0;
+    m_dropped = 0;
+    memset(m_ring, 0, sizeof(m_ring));
+    (void) SEGGER_RTT_ConfigUpBuffer(SMART_CITY_TRACE_RTT_CHANNEL, "SmartCityTrace", m_rtt_buffer, sizeof(m_rtt_buffer),
+                                     SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+}
+
+/** Reserva "words" palavras no ring. Retorna false se não houver espaço */
+static bool trace_reserve(uint32_t words, uint32_t * p_index)
+{
+    uint32_t head = __atomic_load_n(&m_head, __ATOMIC_RELAXED);
+    do
+    {
+        if (head + words - __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) > SMART_CITY_TRACE_RING_WORDS)
+        {
+            __atomic_fetch_add(&m_dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&m_head, &head, head + words, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    *p_index = head;
+    return true;
+}
+
+/** Escreve os argumentos e o carimbo de tempo, e por último o cabeçalho, que libera o registro para o esvaziamento */
+static void trace_commit(uint32_t index, smart_city_trace_id_t id, const uint32_t * p_args, uint32_t count)
+{
+    m_ring[(index + 1) & TRACE_RING_MASK] = app_timer_cnt_get();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_ring[(index + 2 + i) & TRACE_RING_MASK] = p_args[i];
+    }
+    __atomic_store_n(&m_ring[index & TRACE_RING_MASK], SMART_CITY_TRACE_HEADER(id, count), __ATOMIC_RELEASE);
+}
+
+void smart_city_semaforo_trace_record(smart_city_trace_id_t id, const uint32_t * p_args, uint32_t count)
+{
+    NRF_MESH_ASSERT(count <= SMART_CITY_TRACE_ARGS_MAX);
+    uint32_t index;
+    if (trace_reserve(2 + count, &index))
+    {
+        trace_commit(index, id, p_args, count);
+    }
+}
+
+void smart_city_semaforo_trace_bytes(smart_city_trace_id_t id, const void * p_data, uint32_t length)
+{
+    uint32_t args[SMART_CITY_TRACE_ARGS_MAX] = { 0 };
+    if (length > (SMART_CITY_TRACE_ARGS_MAX - 1) * sizeof(uint32_t))
+    {
+        length = (SMART_CITY_TRACE_ARGS_MAX - 1) * sizeof(uint32_t);
+    }
+    args[0] = length;
+    memcpy(&args[1], p_data, length);
+    smart_city_semaforo_trace_record(id, args, 1 + (length + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+}
+
+void smart_city_semaforo_trace_flush(void)
+{
+    uint32_t record[TRACE_RECORD_WORDS_MAX];
+    uint32_t tail = m_tail;
+    while (tail != __atomic_load_n(&m_head, __ATOMIC_ACQUIRE))
+    {
+        uint32_t header = __atomic_load_n(&m_ring[tail & TRACE_RING_MASK], __ATOMIC_ACQUIRE);
+        if (header == 0)
+        {
+            /* Registro reservado por uma interrupção que foi interrompida antes de terminá-lo */
+            break;
+        }
+        uint32_t words = 2 + SMART_CITY_TRACE_HEADER_ARGS(header);
+        for (uint32_t i = 0; i < words; i++)
+        {
+            record[i] = m_ring[(tail + i) & TRACE_RING_MASK];
+        }
+        /* Canal RTT cheio (nenhum host lendo, ou lendo devagar): o registro fica no ring para a próxima vez */
+        if (SEGGER_RTT_Write(SMART_CITY_TRACE_RTT_CHANNEL, record, words * sizeof(uint32_t)) == 0)
+        {
+            break;
+        }
+        for (uint32_t i = 0; i < words; i++)
+        {
+            m_ring[(tail + i) & TRACE_RING_MASK] = 0;
+        }
+        tail += words;
+        __atomic_store_n(&m_tail, tail, __ATOMIC_RELEASE);
+    }
+
+    uint32_t dropped = __atomic_exchange_n(&m_dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0)
+    {
+        record[0] = SMART_CITY_TRACE_HEADER(SMART_CITY_TRACE_ID_DROPPED, 1);
+        record[1] = app_timer_cnt_get();
+        record[2] = dropped;
+        if (SEGGER_RTT_Write(SMART_CITY_TRACE_RTT_CHANNEL, record, 3 * sizeof(uint32_t)) == 0)
+        {
+            __atomic_fetch_add(&m_dropped, dropped, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#endif /* SMART_CITY_TRACE_BINARY */